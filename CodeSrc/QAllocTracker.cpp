@@ -0,0 +1,331 @@
+#include "QAllocTracker.h"
+
+#ifdef QENGINE_TRACK_ALLOCATIONS
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include "Debug.h"
+#include "ThrowErr.h"
+
+namespace {
+	// Placed right before every block so delete knows the size and tag without a lookup table. offset is
+	// the distance back to what malloc returned, which over-aligned blocks pad to reach their alignment.
+	struct alignas(16) AllocHeader {
+		size_t size;
+		uint32_t offset;
+		uint16_t tag;
+		uint8_t counted;
+		uint8_t thread;
+	};
+
+	struct TagCounters {
+		std::atomic<uint64_t> count;
+		std::atomic<uint64_t> bytes;
+		std::atomic<uint64_t> liveBytes;
+		std::atomic<uint64_t> countHistogram[ALLOC_HISTOGRAM_BUCKETS];
+		std::atomic<uint64_t> bytesHistogram[ALLOC_HISTOGRAM_BUCKETS];
+	};
+
+	// Zero initialized statics, so tracking works for allocations made before main.
+	TagCounters tagCounters[static_cast<size_t>(QAllocTag::COUNT)];
+	std::atomic<uint64_t> threadCounters[ALLOC_TRACKER_MAX_THREADS];
+	std::atomic<uint32_t> nextThreadSlot;
+	std::atomic<uint64_t> frameAllocations;
+	std::atomic<int> steadyMode;
+	std::atomic<uint32_t> warmupFramesLeft;
+	std::atomic<bool> inFrame;
+
+	thread_local QAllocTag currentTag = QAllocTag::UNTAGGED;
+	thread_local uint32_t threadSlot = UINT32_MAX;
+	thread_local bool suspended = false;
+
+	const char* TAG_NAMES[] = { "untagged", "frame", "draw", "culling", "upload", "recording", "loading" };
+
+	uint32_t sizeBucket(size_t size) {
+		uint32_t bucket = 0;
+		while (size > 1 && bucket + 1 < ALLOC_HISTOGRAM_BUCKETS) {
+			size >>= 1;
+			bucket++;
+		}
+
+		return bucket;
+	}
+
+	uint32_t currentThreadSlot() {
+		if (threadSlot == UINT32_MAX) {
+			threadSlot = nextThreadSlot.fetch_add(1, std::memory_order_relaxed) % ALLOC_TRACKER_MAX_THREADS;
+		}
+
+		return threadSlot;
+	}
+
+	void* trackedAllocate(size_t size, size_t alignment = alignof(AllocHeader)) {
+		// malloc returns at least header-aligned memory, so this much padding always reaches the alignment.
+		size_t padding = alignment > sizeof(AllocHeader) ? alignment - sizeof(AllocHeader) : 0;
+		char* block = static_cast<char*>(malloc(sizeof(AllocHeader) + padding + size));
+		if (block == nullptr) {
+			throw std::bad_alloc();
+		}
+
+		uintptr_t address = reinterpret_cast<uintptr_t>(block) + sizeof(AllocHeader);
+		address = (address + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1);
+		AllocHeader* header = reinterpret_cast<AllocHeader*>(address) - 1;
+
+		header->size = size;
+		header->offset = static_cast<uint32_t>(address - reinterpret_cast<uintptr_t>(block));
+		header->tag = static_cast<uint16_t>(currentTag);
+		header->counted = !suspended;
+		header->thread = static_cast<uint8_t>(currentThreadSlot());
+
+		if (!suspended) {
+			TagCounters& counters = tagCounters[header->tag];
+			uint32_t bucket = sizeBucket(size);
+
+			counters.count.fetch_add(1, std::memory_order_relaxed);
+			counters.bytes.fetch_add(size, std::memory_order_relaxed);
+			counters.liveBytes.fetch_add(size, std::memory_order_relaxed);
+			counters.countHistogram[bucket].fetch_add(1, std::memory_order_relaxed);
+			counters.bytesHistogram[bucket].fetch_add(size, std::memory_order_relaxed);
+			threadCounters[header->thread].fetch_add(1, std::memory_order_relaxed);
+
+			if (inFrame.load(std::memory_order_relaxed) && header->tag != static_cast<uint16_t>(QAllocTag::LOADING)) {
+				frameAllocations.fetch_add(1, std::memory_order_relaxed);
+			}
+		}
+
+		return header + 1;
+	}
+
+	void trackedFree(void* pointer) {
+		if (pointer == nullptr) {
+			return;
+		}
+
+		AllocHeader* header = static_cast<AllocHeader*>(pointer) - 1;
+		if (header->counted) {
+			tagCounters[header->tag].liveBytes.fetch_sub(header->size, std::memory_order_relaxed);
+		}
+
+		free(static_cast<char*>(pointer) - header->offset);
+	}
+}
+
+void* operator new(size_t size) {
+	return trackedAllocate(size);
+}
+
+void* operator new[](size_t size) {
+	return trackedAllocate(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+	try {
+		return trackedAllocate(size);
+	}
+	catch (...) {
+		return nullptr;
+	}
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+	try {
+		return trackedAllocate(size);
+	}
+	catch (...) {
+		return nullptr;
+	}
+}
+
+void operator delete(void* pointer) noexcept {
+	trackedFree(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+	trackedFree(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+	trackedFree(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+	trackedFree(pointer);
+}
+
+void operator delete(void* pointer, const std::nothrow_t&) noexcept {
+	trackedFree(pointer);
+}
+
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept {
+	trackedFree(pointer);
+}
+
+// Over-aligned types only go through these from C++17 on (/std:c++17); before that the compiler ignores their alignment.
+#ifdef __cpp_aligned_new
+
+void* operator new(size_t size, std::align_val_t alignment) {
+	return trackedAllocate(size, static_cast<size_t>(alignment));
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+	return trackedAllocate(size, static_cast<size_t>(alignment));
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	try {
+		return trackedAllocate(size, static_cast<size_t>(alignment));
+	}
+	catch (...) {
+		return nullptr;
+	}
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+	try {
+		return trackedAllocate(size, static_cast<size_t>(alignment));
+	}
+	catch (...) {
+		return nullptr;
+	}
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+	trackedFree(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept {
+	trackedFree(pointer);
+}
+
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept {
+	trackedFree(pointer);
+}
+
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept {
+	trackedFree(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t, const std::nothrow_t&) noexcept {
+	trackedFree(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t, const std::nothrow_t&) noexcept {
+	trackedFree(pointer);
+}
+
+#endif
+
+QAllocScope::QAllocScope(QAllocTag tag) : _previous{ currentTag } {
+	if (currentTag != QAllocTag::LOADING) {
+		currentTag = tag;
+	}
+}
+
+QAllocScope::~QAllocScope() {
+	currentTag = this->_previous;
+}
+
+void QAllocTracker::setSteadyStateMode(QAllocSteadyMode mode, uint32_t warmupFrames) {
+	warmupFramesLeft.store(warmupFrames);
+	steadyMode.store(static_cast<int>(mode));
+}
+
+void QAllocTracker::beginFrame() {
+	frameAllocations.store(0, std::memory_order_relaxed);
+	inFrame.store(true, std::memory_order_relaxed);
+}
+
+uint64_t QAllocTracker::endFrame() {
+	inFrame.store(false, std::memory_order_relaxed);
+	uint64_t count = frameAllocations.load(std::memory_order_relaxed);
+
+	QAllocSteadyMode mode = static_cast<QAllocSteadyMode>(steadyMode.load());
+	if (mode == QAllocSteadyMode::OFF) {
+		return count;
+	}
+
+	if (warmupFramesLeft.load() > 0) {
+		warmupFramesLeft.fetch_sub(1);
+		return count;
+	}
+
+	if (count == 0) {
+		return count;
+	}
+
+	if (mode == QAllocSteadyMode::FAIL) {
+		ThrowErr::runtime("Steady-state frame allocated from the heap!..");
+	}
+
+	suspended = true;
+	Debug::print("Steady-state frame made " + std::to_string(count) + " heap allocations");
+	QAllocTracker::report();
+	suspended = false;
+
+	return count;
+}
+
+QAllocTagStats QAllocTracker::getTagStats(QAllocTag tag) {
+	const TagCounters& counters = tagCounters[static_cast<size_t>(tag)];
+
+	QAllocTagStats stats;
+	stats.count = counters.count.load(std::memory_order_relaxed);
+	stats.bytes = counters.bytes.load(std::memory_order_relaxed);
+	stats.liveBytes = counters.liveBytes.load(std::memory_order_relaxed);
+
+	for (uint32_t i = 0; i < ALLOC_HISTOGRAM_BUCKETS; i++) {
+		stats.countHistogram[i] = counters.countHistogram[i].load(std::memory_order_relaxed);
+		stats.bytesHistogram[i] = counters.bytesHistogram[i].load(std::memory_order_relaxed);
+	}
+
+	return stats;
+}
+
+uint64_t QAllocTracker::getThreadAllocationCount(uint32_t threadSlot) {
+	return threadCounters[threadSlot % ALLOC_TRACKER_MAX_THREADS].load(std::memory_order_relaxed);
+}
+
+void QAllocTracker::report() {
+	bool wasSuspended = suspended;
+	suspended = true;
+
+	for (size_t tag = 0; tag < static_cast<size_t>(QAllocTag::COUNT); tag++) {
+		QAllocTagStats stats = QAllocTracker::getTagStats(static_cast<QAllocTag>(tag));
+		if (stats.count == 0) {
+			continue;
+		}
+
+		Debug::print(std::string("[alloc] ") + TAG_NAMES[tag] + ": " + std::to_string(stats.count) + " allocations, " +
+			std::to_string(stats.bytes) + " bytes, " + std::to_string(stats.liveBytes) + " live bytes");
+
+		for (uint32_t bucket = 0; bucket < ALLOC_HISTOGRAM_BUCKETS; bucket++) {
+			if (stats.countHistogram[bucket] == 0) {
+				continue;
+			}
+
+			Debug::print("    >= " + std::to_string(1ull << bucket) + " B: " + std::to_string(stats.countHistogram[bucket]) +
+				" allocations, " + std::to_string(stats.bytesHistogram[bucket]) + " bytes");
+		}
+	}
+
+	for (uint32_t slot = 0; slot < ALLOC_TRACKER_MAX_THREADS; slot++) {
+		uint64_t count = threadCounters[slot].load(std::memory_order_relaxed);
+		if (count > 0) {
+			Debug::print("[alloc] thread " + std::to_string(slot) + ": " + std::to_string(count) + " allocations");
+		}
+	}
+
+	suspended = wasSuspended;
+}
+
+QAllocTag QAllocTracker::getCurrentTag() {
+	return currentTag;
+}
+
+const char* QAllocTracker::getTagName(QAllocTag tag) {
+	return TAG_NAMES[static_cast<size_t>(tag)];
+}
+
+#endif
@@ -0,0 +1,87 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// Heap allocation instrumentation, compiled in with QENGINE_TRACK_ALLOCATIONS
+// (msbuild /p:QEngineTrackAllocations=true). Without it every entry point is an empty inline.
+// Frames are bracketed by beginFrame/endFrame; once the warm-up frames have passed, any heap
+// allocation inside a frame is reported or turned into an error. LOADING allocations are exempt
+// because streaming legitimately allocates on its own threads while frames run; a scope opened inside
+// a LOADING one keeps the LOADING tag, so an upload made while loading stays exempt too.
+// QJobSystem workers run each parallelFor under the tag of the thread that submitted it.
+
+enum class QAllocTag : uint8_t {
+	UNTAGGED = 0,
+	FRAME,
+	DRAW,
+	CULLING,
+	UPLOAD,
+	RECORDING,
+	LOADING,
+	COUNT,
+};
+
+enum class QAllocSteadyMode {
+	OFF,
+	REPORT,
+	FAIL,
+};
+
+const uint32_t ALLOC_HISTOGRAM_BUCKETS = 32;
+const uint32_t ALLOC_TRACKER_MAX_THREADS = 64;
+const uint32_t ALLOC_STEADY_WARMUP_FRAMES = 120;
+
+struct QAllocTagStats {
+	uint64_t count = 0;
+	uint64_t bytes = 0;
+	uint64_t liveBytes = 0;
+	uint64_t countHistogram[ALLOC_HISTOGRAM_BUCKETS] = {};
+	uint64_t bytesHistogram[ALLOC_HISTOGRAM_BUCKETS] = {};
+};
+
+#ifdef QENGINE_TRACK_ALLOCATIONS
+
+class QAllocScope {
+public:
+	QAllocScope(QAllocTag tag);
+	~QAllocScope();
+private:
+	QAllocTag _previous;
+};
+
+class QAllocTracker {
+public:
+	static void setSteadyStateMode(QAllocSteadyMode mode, uint32_t warmupFrames = ALLOC_STEADY_WARMUP_FRAMES);
+	static void beginFrame();
+	static uint64_t endFrame();
+
+	static QAllocTagStats getTagStats(QAllocTag tag);
+	static uint64_t getThreadAllocationCount(uint32_t threadSlot);
+	static void report();
+
+	static QAllocTag getCurrentTag();
+	static const char* getTagName(QAllocTag tag);
+};
+
+#else
+
+class QAllocScope {
+public:
+	QAllocScope(QAllocTag) {}
+};
+
+class QAllocTracker {
+public:
+	static void setSteadyStateMode(QAllocSteadyMode, uint32_t = ALLOC_STEADY_WARMUP_FRAMES) {}
+	static void beginFrame() {}
+	static uint64_t endFrame() { return 0; }
+
+	static QAllocTagStats getTagStats(QAllocTag) { return QAllocTagStats(); }
+	static uint64_t getThreadAllocationCount(uint32_t) { return 0; }
+	static void report() {}
+
+	static QAllocTag getCurrentTag() { return QAllocTag::UNTAGGED; }
+	static const char* getTagName(QAllocTag) { return ""; }
+};
+
+#endif
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstring>
+#include <type_traits>
+#include "QFrameArena.h"
+
+// Non-owning view over contiguous elements, typically produced by a QArenaVector.
+template <typename T>
+class QSpan {
+public:
+	QSpan() : _data{ nullptr }, _size{ 0 } {}
+	QSpan(T* data, size_t size) : _data{ data }, _size{ size } {}
+
+	T* data() const { return this->_data; }
+	size_t size() const { return this->_size; }
+	bool empty() const { return this->_size == 0; }
+	T* begin() const { return this->_data; }
+	T* end() const { return this->_data + this->_size; }
+	T& operator[](size_t index) const { return this->_data[index]; }
+
+	QSpan<T> subspan(size_t offset, size_t count) const {
+		return QSpan<T>(this->_data + offset, count);
+	}
+private:
+	T* _data;
+	size_t _size;
+};
+
+// Growable array whose storage lives in a QLinearArena. Growing abandons the old storage to the
+// arena and nothing is ever freed or destroyed, so elements must be trivially copyable.
+template <typename T>
+class QArenaVector {
+	static_assert(std::is_trivially_copyable<T>::value, "QArenaVector only holds trivially copyable types");
+public:
+	QArenaVector(QLinearArena& arena, size_t capacity = 0) : _arena{ &arena } {
+		if (capacity > 0) {
+			this->reserve(capacity);
+		}
+	}
+
+	void reserve(size_t capacity) {
+		if (capacity <= this->_capacity) {
+			return;
+		}
+
+		T* data = this->_arena->allocate<T>(capacity);
+		if (this->_size > 0) {
+			memcpy(data, this->_data, sizeof(T) * this->_size);
+		}
+
+		this->_data = data;
+		this->_capacity = capacity;
+	}
+
+	void resize(size_t size) {
+		this->reserve(size);
+		this->_size = size;
+	}
+
+	void push_back(const T& value) {
+		if (this->_size == this->_capacity) {
+			this->reserve(this->_capacity < 8 ? 8 : this->_capacity * 2);
+		}
+
+		this->_data[this->_size++] = value;
+	}
+
+	void pop_back() { this->_size--; }
+	void clear() { this->_size = 0; }
+
+	T* data() const { return this->_data; }
+	size_t size() const { return this->_size; }
+	size_t capacity() const { return this->_capacity; }
+	bool empty() const { return this->_size == 0; }
+	T* begin() const { return this->_data; }
+	T* end() const { return this->_data + this->_size; }
+	T& back() const { return this->_data[this->_size - 1]; }
+	T& operator[](size_t index) const { return this->_data[index]; }
+
+	QSpan<T> span() const { return QSpan<T>(this->_data, this->_size); }
+private:
+	QLinearArena* _arena;
+	T* _data = nullptr;
+	size_t _size = 0;
+	size_t _capacity = 0;
+};
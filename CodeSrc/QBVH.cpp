@@ -0,0 +1,776 @@
+#include "QBVH.h"
+#include "ThrowErr.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+// Relative to the cost of testing one primitive.
+const float BVH_TRAVERSAL_COST = 1.0f;
+// Bounds the traversal stacks; a range that reaches it becomes a leaf whatever its size.
+const uint32_t BVH_MAX_DEPTH = 60;
+const uint32_t BVH_STACK_SIZE = 64;
+const uint32_t BVH_BIN_BATCH_SIZE = 16384;
+const uint32_t BVH_MIN_SUBTREE_SIZE = 2048;
+const size_t BVH_NODE_ALIGNMENT = 64;
+
+static void emptyBounds(QBVHBounds& bounds) {
+	for (uint32_t axis = 0; axis < 3; axis++) {
+		bounds.min[axis] = 1e30f;
+		bounds.max[axis] = -1e30f;
+	}
+}
+
+static void growBounds(QBVHBounds& bounds, const QBVHBounds& other) {
+	for (uint32_t axis = 0; axis < 3; axis++) {
+		bounds.min[axis] = std::min(bounds.min[axis], other.min[axis]);
+		bounds.max[axis] = std::max(bounds.max[axis], other.max[axis]);
+	}
+}
+
+static void growPoint(QBVHBounds& bounds, const float* point) {
+	for (uint32_t axis = 0; axis < 3; axis++) {
+		bounds.min[axis] = std::min(bounds.min[axis], point[axis]);
+		bounds.max[axis] = std::max(bounds.max[axis], point[axis]);
+	}
+}
+
+static float surfaceArea(const QBVHBounds& bounds) {
+	float x = bounds.max[0] - bounds.min[0];
+	float y = bounds.max[1] - bounds.min[1];
+	float z = bounds.max[2] - bounds.min[2];
+	if (x < 0.0f || y < 0.0f || z < 0.0f) {
+		return 0.0f;
+	}
+
+	return 2.0f * (x * y + y * z + z * x);
+}
+
+// Small ranges have few planes worth trying, and most nodes are small.
+static uint32_t getBinCount(uint32_t count) {
+	return std::min(BVH_BIN_COUNT, std::max(4u, count / 2));
+}
+
+static float binScale(const QBVHBounds& centroids, uint32_t axis, uint32_t binCount) {
+	float extent = centroids.max[axis] - centroids.min[axis];
+	return extent > 0.0f ? binCount / extent : 0.0f;
+}
+
+static uint32_t binIndex(float centroid, float minimum, float scale, uint32_t binCount) {
+	uint32_t bin = static_cast<uint32_t>((centroid - minimum) * scale);
+	return std::min(bin, binCount - 1);
+}
+
+// Distance along the ray to the box, or 1e30 if it is missed or further than tMax.
+static float intersectBox(const QBVHNode& node, const float* origin, const float* inverseDirection, float tMax) {
+	float tNear = 0.0f;
+	float tFar = tMax;
+	for (uint32_t axis = 0; axis < 3; axis++) {
+		float t0 = (node.min[axis] - origin[axis]) * inverseDirection[axis];
+		float t1 = (node.max[axis] - origin[axis]) * inverseDirection[axis];
+		tNear = std::max(tNear, std::min(t0, t1));
+		tFar = std::min(tFar, std::max(t0, t1));
+	}
+
+	return tNear <= tFar ? tNear : 1e30f;
+}
+
+QBVH::QBVH(uint32_t maxLeafSize) : _maxLeafSize{ maxLeafSize } {
+	if (this->_maxLeafSize == 0) {
+		ThrowErr::runtime("BVH leaves must hold at least one primitive!..");
+	}
+}
+
+QBVH::~QBVH() {
+}
+
+void QBVH::build(const QBVHBounds* bounds, uint32_t count, QJobSystem* jobSystem) {
+	QAllocScope allocScope(QAllocTag::LOADING);
+	auto start = std::chrono::steady_clock::now();
+
+	this->_bounds = bounds;
+	this->_stats = QBVHStats();
+	this->_stats.primitiveCount = count;
+	this->_buildNodes.clear();
+
+	if (count == 0) {
+		this->_primitiveIndices.clear();
+		this->_storeNodes();
+		return;
+	}
+
+	BuildTask root = {};
+	this->_computeReferences(count, jobSystem, root);
+
+	QBVHNode rootNode = {};
+	this->_buildNodes.push_back(rootNode);
+
+	// The upper levels are few nodes with many primitives each, so the binning and partitioning inside a
+	// node is what gets spread over the workers. Below the threshold there are enough ranges to hand out whole.
+	uint32_t workerCount = jobSystem->getWorkerCount();
+	uint32_t subtreeThreshold = std::max(count / (workerCount * 8), BVH_MIN_SUBTREE_SIZE);
+	uint32_t binsPerWorker = 3 * BVH_BIN_COUNT;
+
+	std::vector<BuildTask> pending(1, root);
+	std::vector<BuildTask> subtrees;
+	Bin bins[3 * BVH_BIN_COUNT];
+
+	while (!pending.empty()) {
+		BuildTask task = pending.back();
+		pending.pop_back();
+
+		if (task.count <= subtreeThreshold) {
+			subtrees.push_back(task);
+			continue;
+		}
+
+		this->_workerBins.resize(workerCount * binsPerWorker);
+		for (Bin& bin : this->_workerBins) {
+			emptyBounds(bin.bounds);
+			bin.count = 0;
+		}
+
+		jobSystem->parallelFor(task.count, BVH_BIN_BATCH_SIZE, [this, &task, binsPerWorker](uint32_t begin, uint32_t end, uint32_t workerIndex) {
+			this->_binRange(task, task.first + begin, task.first + end, &this->_workerBins[workerIndex * binsPerWorker]);
+		});
+
+		for (uint32_t i = 0; i < binsPerWorker; i++) {
+			bins[i] = this->_workerBins[i];
+			for (uint32_t worker = 1; worker < workerCount; worker++) {
+				const Bin& workerBin = this->_workerBins[worker * binsPerWorker + i];
+				growBounds(bins[i].bounds, workerBin.bounds);
+				bins[i].count += workerBin.count;
+			}
+		}
+
+		this->_stats.maxDepth = std::max(this->_stats.maxDepth, task.depth);
+
+		BuildTask left, right;
+		if (this->_splitTask(task, bins, this->_buildNodes, jobSystem, left, right)) {
+			pending.push_back(left);
+			pending.push_back(right);
+		}
+	}
+
+	// Each subtree builds into its own array with its root at 0, then moves behind the shared nodes.
+	this->_subtreeNodes.resize(subtrees.size());
+	this->_subtreeDepths.resize(subtrees.size());
+	jobSystem->parallelFor(static_cast<uint32_t>(subtrees.size()), 1, [this, &subtrees](uint32_t begin, uint32_t end, uint32_t) {
+		for (uint32_t i = begin; i < end; i++) {
+			this->_subtreeDepths[i] = this->_buildSubtree(subtrees[i], this->_subtreeNodes[i]);
+		}
+	});
+
+	for (size_t i = 0; i < subtrees.size(); i++) {
+		const std::vector<QBVHNode>& local = this->_subtreeNodes[i];
+		uint32_t base = static_cast<uint32_t>(this->_buildNodes.size());
+
+		for (size_t j = 0; j < local.size(); j++) {
+			QBVHNode node = local[j];
+			if (node.count == 0) {
+				node.leftOrFirst = node.leftOrFirst - 1 + base;
+			}
+
+			if (j == 0) {
+				this->_buildNodes[subtrees[i].node] = node;
+			}
+			else {
+				this->_buildNodes.push_back(node);
+			}
+		}
+
+		this->_stats.maxDepth = std::max(this->_stats.maxDepth, this->_subtreeDepths[i]);
+	}
+
+	for (uint32_t i = 0; i < count; i++) {
+		this->_primitiveIndices[i] = this->_references[i].primitive;
+	}
+
+	this->_stats.subtreeCount = static_cast<uint32_t>(subtrees.size());
+	this->_storeNodes();
+	this->_computeStats();
+
+	std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	this->_stats.buildMs = elapsed.count();
+}
+
+void QBVH::refit(const QBVHBounds* bounds) {
+	auto start = std::chrono::steady_clock::now();
+
+	// Children always come after their parent, so a reverse sweep sees every child before its parent.
+	this->_bounds = bounds;
+	for (uint32_t i = this->_nodeCount; i-- > 0;) {
+		QBVHNode& node = this->_nodes[i];
+
+		QBVHBounds nodeBounds;
+		emptyBounds(nodeBounds);
+		if (node.count > 0) {
+			for (uint32_t j = 0; j < node.count; j++) {
+				growBounds(nodeBounds, bounds[this->_primitiveIndices[node.leftOrFirst + j]]);
+			}
+		}
+		else {
+			for (uint32_t child = 0; child < 2; child++) {
+				const QBVHNode& childNode = this->_nodes[node.leftOrFirst + child];
+				growPoint(nodeBounds, childNode.min);
+				growPoint(nodeBounds, childNode.max);
+			}
+		}
+
+		memcpy(node.min, nodeBounds.min, sizeof(node.min));
+		memcpy(node.max, nodeBounds.max, sizeof(node.max));
+	}
+
+	this->_computeStats();
+
+	std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	this->_stats.refitMs = elapsed.count();
+}
+
+void QBVH::cullFrustum(const float planes[6][4], std::vector<uint32_t>& outPrimitives) const {
+	outPrimitives.clear();
+	if (this->_nodeCount == 0) {
+		return;
+	}
+
+	// The top bit marks a subtree already known to be fully inside, which needs no further tests.
+	const uint32_t INSIDE_BIT = 0x80000000u;
+	uint32_t stack[BVH_STACK_SIZE];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize > 0) {
+		uint32_t entry = stack[--stackSize];
+		const QBVHNode& node = this->_nodes[entry & ~INSIDE_BIT];
+		bool inside = (entry & INSIDE_BIT) != 0;
+
+		if (!inside) {
+			inside = true;
+			bool outside = false;
+			for (uint32_t p = 0; p < 6 && !outside; p++) {
+				float distance = planes[p][3];
+				float reach = 0.0f;
+				for (uint32_t axis = 0; axis < 3; axis++) {
+					float center = (node.min[axis] + node.max[axis]) * 0.5f;
+					float extent = (node.max[axis] - node.min[axis]) * 0.5f;
+					distance += planes[p][axis] * center;
+					reach += std::fabs(planes[p][axis]) * extent;
+				}
+
+				outside = distance < -reach;
+				inside = inside && distance >= reach;
+			}
+
+			if (outside) {
+				continue;
+			}
+		}
+
+		if (node.count > 0) {
+			const uint32_t* primitives = this->_primitiveIndices.data() + node.leftOrFirst;
+			outPrimitives.insert(outPrimitives.end(), primitives, primitives + node.count);
+			continue;
+		}
+
+		uint32_t flag = inside ? INSIDE_BIT : 0;
+		stack[stackSize++] = (node.leftOrFirst + 1) | flag;
+		stack[stackSize++] = node.leftOrFirst | flag;
+	}
+}
+
+bool QBVH::intersectTriangles(const QBVHRay& ray, const float* positions, const uint32_t* indices, QBVHHit& outHit) const {
+	outHit = QBVHHit();
+	outHit.t = ray.tMax;
+	if (this->_nodeCount == 0) {
+		return false;
+	}
+
+	float inverseDirection[3];
+	for (uint32_t axis = 0; axis < 3; axis++) {
+		inverseDirection[axis] = 1.0f / ray.direction[axis];
+	}
+
+	uint32_t stack[BVH_STACK_SIZE];
+	uint32_t stackSize = 0;
+	if (intersectBox(this->_nodes[0], ray.origin, inverseDirection, outHit.t) < 1e30f) {
+		stack[stackSize++] = 0;
+	}
+
+	while (stackSize > 0) {
+		const QBVHNode& node = this->_nodes[stack[--stackSize]];
+
+		if (node.count > 0) {
+			for (uint32_t i = 0; i < node.count; i++) {
+				// Moller-Trumbore.
+				uint32_t triangle = this->_primitiveIndices[node.leftOrFirst + i];
+				const float* v0 = positions + indices[triangle * 3 + 0] * 3;
+				const float* v1 = positions + indices[triangle * 3 + 1] * 3;
+				const float* v2 = positions + indices[triangle * 3 + 2] * 3;
+
+				float edge1[3] = { v1[0] - v0[0], v1[1] - v0[1], v1[2] - v0[2] };
+				float edge2[3] = { v2[0] - v0[0], v2[1] - v0[1], v2[2] - v0[2] };
+				const float* d = ray.direction;
+				float p[3] = { d[1] * edge2[2] - d[2] * edge2[1], d[2] * edge2[0] - d[0] * edge2[2], d[0] * edge2[1] - d[1] * edge2[0] };
+
+				float determinant = edge1[0] * p[0] + edge1[1] * p[1] + edge1[2] * p[2];
+				if (std::fabs(determinant) < 1e-12f) {
+					continue;
+				}
+
+				float inverseDeterminant = 1.0f / determinant;
+				float s[3] = { ray.origin[0] - v0[0], ray.origin[1] - v0[1], ray.origin[2] - v0[2] };
+				float u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inverseDeterminant;
+				if (u < 0.0f || u > 1.0f) {
+					continue;
+				}
+
+				float q[3] = { s[1] * edge1[2] - s[2] * edge1[1], s[2] * edge1[0] - s[0] * edge1[2], s[0] * edge1[1] - s[1] * edge1[0] };
+				float v = (d[0] * q[0] + d[1] * q[1] + d[2] * q[2]) * inverseDeterminant;
+				if (v < 0.0f || u + v > 1.0f) {
+					continue;
+				}
+
+				float t = (edge2[0] * q[0] + edge2[1] * q[1] + edge2[2] * q[2]) * inverseDeterminant;
+				if (t > 0.0f && t < outHit.t) {
+					outHit.primitive = triangle;
+					outHit.t = t;
+					outHit.u = u;
+					outHit.v = v;
+				}
+			}
+			continue;
+		}
+
+		// Nearer child on top of the stack, so hits found there prune the other one.
+		uint32_t near = node.leftOrFirst;
+		uint32_t far = node.leftOrFirst + 1;
+		float tNear = intersectBox(this->_nodes[near], ray.origin, inverseDirection, outHit.t);
+		float tFar = intersectBox(this->_nodes[far], ray.origin, inverseDirection, outHit.t);
+		if (tFar < tNear) {
+			std::swap(near, far);
+			std::swap(tNear, tFar);
+		}
+
+		if (tFar < 1e30f) {
+			stack[stackSize++] = far;
+		}
+		if (tNear < 1e30f) {
+			stack[stackSize++] = near;
+		}
+	}
+
+	return outHit.primitive != INVALID;
+}
+
+const QBVHNode* QBVH::getNodes() const {
+	return this->_nodes;
+}
+
+uint32_t QBVH::getNodeCount() const {
+	return this->_nodeCount;
+}
+
+const uint32_t* QBVH::getPrimitiveIndices() const {
+	return this->_primitiveIndices.data();
+}
+
+QBVHStats QBVH::getStats() const {
+	return this->_stats;
+}
+
+void QBVH::computeTriangleBounds(
+	const float* positions, const uint32_t* indices, uint32_t triangleCount, std::vector<QBVHBounds>& outBounds) {
+	outBounds.resize(triangleCount);
+	for (uint32_t triangle = 0; triangle < triangleCount; triangle++) {
+		QBVHBounds& bounds = outBounds[triangle];
+		emptyBounds(bounds);
+		for (uint32_t corner = 0; corner < 3; corner++) {
+			growPoint(bounds, positions + indices[triangle * 3 + corner] * 3);
+		}
+	}
+}
+
+void QBVH::_computeReferences(uint32_t count, QJobSystem* jobSystem, BuildTask& outRoot) {
+	this->_primitiveIndices.resize(count);
+	this->_references.resize(count);
+
+	// Primitive bounds and centroid bounds per worker, merged into the root's afterwards.
+	uint32_t workerCount = jobSystem->getWorkerCount();
+	this->_workerBounds.resize(workerCount * 2);
+	for (QBVHBounds& bounds : this->_workerBounds) {
+		emptyBounds(bounds);
+	}
+
+	jobSystem->parallelFor(count, BVH_BIN_BATCH_SIZE, [this](uint32_t begin, uint32_t end, uint32_t workerIndex) {
+		QBVHBounds& bounds = this->_workerBounds[workerIndex * 2];
+		QBVHBounds& centroids = this->_workerBounds[workerIndex * 2 + 1];
+		for (uint32_t i = begin; i < end; i++) {
+			Reference& reference = this->_references[i];
+			reference.bounds = this->_bounds[i];
+			for (uint32_t axis = 0; axis < 3; axis++) {
+				reference.centroid[axis] = (reference.bounds.min[axis] + reference.bounds.max[axis]) * 0.5f;
+			}
+			reference.primitive = i;
+
+			growBounds(bounds, reference.bounds);
+			growPoint(centroids, reference.centroid);
+		}
+	});
+
+	outRoot.node = 0;
+	outRoot.first = 0;
+	outRoot.count = count;
+	outRoot.depth = 0;
+	emptyBounds(outRoot.bounds);
+	emptyBounds(outRoot.centroids);
+	for (uint32_t worker = 0; worker < workerCount; worker++) {
+		growBounds(outRoot.bounds, this->_workerBounds[worker * 2]);
+		growBounds(outRoot.centroids, this->_workerBounds[worker * 2 + 1]);
+	}
+}
+
+bool QBVH::_findSplit(const BuildTask& task, Bin* bins, Split& outSplit) {
+	float nodeArea = surfaceArea(task.bounds);
+	uint32_t binCount = getBinCount(task.count);
+	outSplit.cost = 1e30f;
+	bool found = false;
+
+	for (uint32_t axis = 0; axis < 3; axis++) {
+		if (binScale(task.centroids, axis, binCount) == 0.0f) {
+			continue;
+		}
+
+		const Bin* axisBins = bins + axis * BVH_BIN_COUNT;
+
+		// Sweep from the right once to know every right-hand side, then from the left to price each plane.
+		float rightCosts[BVH_BIN_COUNT];
+		QBVHBounds rightBounds;
+		emptyBounds(rightBounds);
+		uint32_t rightCount = 0;
+		for (uint32_t bin = binCount - 1; bin > 0; bin--) {
+			growBounds(rightBounds, axisBins[bin].bounds);
+			rightCount += axisBins[bin].count;
+			rightCosts[bin] = rightCount > 0 ? surfaceArea(rightBounds) * rightCount : -1.0f;
+		}
+
+		QBVHBounds leftBounds;
+		emptyBounds(leftBounds);
+		uint32_t leftCount = 0;
+		for (uint32_t bin = 0; bin + 1 < binCount; bin++) {
+			growBounds(leftBounds, axisBins[bin].bounds);
+			leftCount += axisBins[bin].count;
+			if (leftCount == 0 || rightCosts[bin + 1] < 0.0f) {
+				continue;
+			}
+
+			float cost = nodeArea * BVH_TRAVERSAL_COST + surfaceArea(leftBounds) * leftCount + rightCosts[bin + 1];
+			if (cost < outSplit.cost) {
+				outSplit.cost = cost;
+				outSplit.axis = axis;
+				outSplit.bin = bin;
+				found = true;
+			}
+		}
+	}
+
+	if (!found) {
+		return false;
+	}
+
+	Bin* sides[2] = { &outSplit.left, &outSplit.right };
+	for (Bin* side : sides) {
+		emptyBounds(side->bounds);
+		side->count = 0;
+	}
+
+	const Bin* axisBins = bins + outSplit.axis * BVH_BIN_COUNT;
+	for (uint32_t bin = 0; bin < binCount; bin++) {
+		Bin* side = bin <= outSplit.bin ? &outSplit.left : &outSplit.right;
+		growBounds(side->bounds, axisBins[bin].bounds);
+		side->count += axisBins[bin].count;
+	}
+
+	return true;
+}
+
+void QBVH::_binRange(const BuildTask& task, uint32_t begin, uint32_t end, Bin* bins) {
+	uint32_t binCount = getBinCount(task.count);
+	float scales[3];
+	for (uint32_t axis = 0; axis < 3; axis++) {
+		scales[axis] = binScale(task.centroids, axis, binCount);
+	}
+
+	for (uint32_t i = begin; i < end; i++) {
+		const Reference& reference = this->_references[i];
+
+		for (uint32_t axis = 0; axis < 3; axis++) {
+			if (scales[axis] == 0.0f) {
+				continue;
+			}
+
+			Bin& bin = bins[axis * BVH_BIN_COUNT + binIndex(reference.centroid[axis], task.centroids.min[axis], scales[axis], binCount)];
+			growBounds(bin.bounds, reference.bounds);
+			bin.count++;
+		}
+	}
+}
+
+bool QBVH::_splitTask(
+	const BuildTask& task, Bin* bins, std::vector<QBVHNode>& nodes, QJobSystem* jobSystem, BuildTask& outLeft, BuildTask& outRight) {
+	QBVHNode& node = nodes[task.node];
+	memcpy(node.min, task.bounds.min, sizeof(node.min));
+	memcpy(node.max, task.bounds.max, sizeof(node.max));
+	node.leftOrFirst = task.first;
+	node.count = task.count;
+
+	if (task.count <= 1 || task.depth >= BVH_MAX_DEPTH) {
+		return false;
+	}
+
+	Split split;
+	bool found = this->_findSplit(task, bins, split);
+	float leafCost = surfaceArea(task.bounds) * task.count;
+
+	if (found && task.count <= this->_maxLeafSize && split.cost >= leafCost) {
+		return false;
+	}
+
+	uint32_t leftCount;
+	if (found) {
+		leftCount = this->_partition(task, split, jobSystem, outLeft.centroids, outRight.centroids);
+	}
+	else if (task.count > this->_maxLeafSize) {
+		// All centroids coincide, so no plane separates them; halve the range to keep leaves small.
+		leftCount = task.count / 2;
+	}
+	else {
+		return false;
+	}
+
+	outLeft.first = task.first;
+	outLeft.count = leftCount;
+	outRight.first = task.first + leftCount;
+	outRight.count = task.count - leftCount;
+
+	// The bins already hold the children's boxes and the partition gathered their centroid bounds.
+	if (found) {
+		outLeft.bounds = split.left.bounds;
+		outRight.bounds = split.right.bounds;
+	}
+	else {
+		BuildTask* sides[2] = { &outLeft, &outRight };
+		for (BuildTask* side : sides) {
+			emptyBounds(side->bounds);
+			emptyBounds(side->centroids);
+
+			for (uint32_t i = side->first; i < side->first + side->count; i++) {
+				growBounds(side->bounds, this->_references[i].bounds);
+				growPoint(side->centroids, this->_references[i].centroid);
+			}
+		}
+	}
+
+	uint32_t left = static_cast<uint32_t>(nodes.size());
+	nodes[task.node].leftOrFirst = left;
+	nodes[task.node].count = 0;
+
+	QBVHNode childNode = {};
+	nodes.push_back(childNode);
+	nodes.push_back(childNode);
+
+	outLeft.node = left;
+	outLeft.depth = task.depth + 1;
+	outRight.node = left + 1;
+	outRight.depth = task.depth + 1;
+
+	return true;
+}
+
+uint32_t QBVH::_partition(
+	const BuildTask& task, const Split& split, QJobSystem* jobSystem, QBVHBounds& outLeftCentroids, QBVHBounds& outRightCentroids) {
+	uint32_t axis = split.axis;
+	uint32_t binCount = getBinCount(task.count);
+	float minimum = task.centroids.min[axis];
+	float scale = binScale(task.centroids, axis, binCount);
+	uint32_t splitBin = split.bin;
+	auto isLeft = [=](const Reference& reference) {
+		return binIndex(reference.centroid[axis], minimum, scale, binCount) <= splitBin;
+	};
+
+	emptyBounds(outLeftCentroids);
+	emptyBounds(outRightCentroids);
+	Reference* first = this->_references.data() + task.first;
+
+	if (jobSystem == nullptr || jobSystem->getWorkerCount() == 1) {
+		// In place from both ends; each reference grows its side's centroid bounds once it is settled.
+		Reference* left = first;
+		Reference* right = first + task.count;
+		while (true) {
+			while (left < right && isLeft(*left)) {
+				growPoint(outLeftCentroids, left->centroid);
+				left++;
+			}
+			while (left < right && !isLeft(*(right - 1))) {
+				right--;
+				growPoint(outRightCentroids, right->centroid);
+			}
+			if (left == right) {
+				break;
+			}
+
+			right--;
+			std::swap(*left, *right);
+			growPoint(outLeftCentroids, left->centroid);
+			growPoint(outRightCentroids, right->centroid);
+			left++;
+		}
+
+		return static_cast<uint32_t>(left - first);
+	}
+
+	// Across the workers: count each batch's left side, scatter every batch to its prefix-summed place
+	// in the scratch array, then copy the range back.
+	uint32_t batchCount = (task.count + BVH_BIN_BATCH_SIZE - 1) / BVH_BIN_BATCH_SIZE;
+	this->_batchOffsets.resize(batchCount);
+	jobSystem->parallelFor(batchCount, 1, [&](uint32_t begin, uint32_t end, uint32_t) {
+		for (uint32_t batch = begin; batch < end; batch++) {
+			uint32_t batchEnd = std::min((batch + 1) * BVH_BIN_BATCH_SIZE, task.count);
+			uint32_t leftCount = 0;
+			for (uint32_t i = batch * BVH_BIN_BATCH_SIZE; i < batchEnd; i++) {
+				leftCount += isLeft(first[i]) ? 1 : 0;
+			}
+			this->_batchOffsets[batch] = leftCount;
+		}
+	});
+
+	uint32_t leftTotal = 0;
+	for (uint32_t& offset : this->_batchOffsets) {
+		uint32_t leftCount = offset;
+		offset = leftTotal;
+		leftTotal += leftCount;
+	}
+
+	uint32_t workerCount = jobSystem->getWorkerCount();
+	this->_scratchReferences.resize(task.count);
+	this->_workerBounds.resize(workerCount * 2);
+	for (QBVHBounds& bounds : this->_workerBounds) {
+		emptyBounds(bounds);
+	}
+
+	jobSystem->parallelFor(batchCount, 1, [&](uint32_t begin, uint32_t end, uint32_t workerIndex) {
+		QBVHBounds& leftCentroids = this->_workerBounds[workerIndex * 2];
+		QBVHBounds& rightCentroids = this->_workerBounds[workerIndex * 2 + 1];
+		for (uint32_t batch = begin; batch < end; batch++) {
+			uint32_t batchFirst = batch * BVH_BIN_BATCH_SIZE;
+			uint32_t batchEnd = std::min(batchFirst + BVH_BIN_BATCH_SIZE, task.count);
+			uint32_t left = this->_batchOffsets[batch];
+			uint32_t right = leftTotal + batchFirst - left;
+			for (uint32_t i = batchFirst; i < batchEnd; i++) {
+				if (isLeft(first[i])) {
+					growPoint(leftCentroids, first[i].centroid);
+					this->_scratchReferences[left++] = first[i];
+				}
+				else {
+					growPoint(rightCentroids, first[i].centroid);
+					this->_scratchReferences[right++] = first[i];
+				}
+			}
+		}
+	});
+
+	jobSystem->parallelFor(task.count, BVH_BIN_BATCH_SIZE, [&](uint32_t begin, uint32_t end, uint32_t) {
+		memcpy(first + begin, this->_scratchReferences.data() + begin, (end - begin) * sizeof(Reference));
+	});
+
+	for (uint32_t worker = 0; worker < workerCount; worker++) {
+		growBounds(outLeftCentroids, this->_workerBounds[worker * 2]);
+		growBounds(outRightCentroids, this->_workerBounds[worker * 2 + 1]);
+	}
+
+	return leftTotal;
+}
+
+uint32_t QBVH::_buildSubtree(const BuildTask& task, std::vector<QBVHNode>& nodes) {
+	nodes.clear();
+	QBVHNode rootNode = {};
+	nodes.push_back(rootNode);
+
+	std::vector<BuildTask> stack(1, task);
+	stack[0].node = 0;
+
+	uint32_t maxDepth = task.depth;
+	Bin bins[3 * BVH_BIN_COUNT];
+
+	while (!stack.empty()) {
+		BuildTask current = stack.back();
+		stack.pop_back();
+		maxDepth = std::max(maxDepth, current.depth);
+
+		uint32_t binCount = getBinCount(current.count);
+		for (uint32_t axis = 0; axis < 3; axis++) {
+			for (uint32_t bin = 0; bin < binCount; bin++) {
+				Bin& axisBin = bins[axis * BVH_BIN_COUNT + bin];
+				emptyBounds(axisBin.bounds);
+				axisBin.count = 0;
+			}
+		}
+
+		if (current.count > 1) {
+			this->_binRange(current, current.first, current.first + current.count, bins);
+		}
+
+		BuildTask left, right;
+		if (this->_splitTask(current, bins, nodes, nullptr, left, right)) {
+			stack.push_back(right);
+			stack.push_back(left);
+		}
+	}
+
+	return maxDepth;
+}
+
+void QBVH::_storeNodes() {
+	// A plain vector cannot promise more than the default alignment, so the final array is placed by hand.
+	this->_nodeCount = static_cast<uint32_t>(this->_buildNodes.size());
+	this->_nodeStorage.resize(this->_nodeCount * sizeof(QBVHNode) + BVH_NODE_ALIGNMENT);
+
+	uintptr_t address = reinterpret_cast<uintptr_t>(this->_nodeStorage.data());
+	uintptr_t aligned = (address + BVH_NODE_ALIGNMENT - 1) & ~static_cast<uintptr_t>(BVH_NODE_ALIGNMENT - 1);
+	this->_nodes = reinterpret_cast<QBVHNode*>(aligned);
+
+	if (this->_nodeCount > 0) {
+		memcpy(this->_nodes, this->_buildNodes.data(), this->_nodeCount * sizeof(QBVHNode));
+	}
+}
+
+void QBVH::_computeStats() {
+	this->_stats.nodeCount = this->_nodeCount;
+	this->_stats.leafCount = 0;
+	this->_stats.sahCost = 0.0f;
+	if (this->_nodeCount == 0) {
+		return;
+	}
+
+	QBVHBounds rootBounds;
+	memcpy(rootBounds.min, this->_nodes[0].min, sizeof(rootBounds.min));
+	memcpy(rootBounds.max, this->_nodes[0].max, sizeof(rootBounds.max));
+	float rootArea = surfaceArea(rootBounds);
+
+	float cost = 0.0f;
+	for (uint32_t i = 0; i < this->_nodeCount; i++) {
+		const QBVHNode& node = this->_nodes[i];
+		QBVHBounds bounds;
+		memcpy(bounds.min, node.min, sizeof(bounds.min));
+		memcpy(bounds.max, node.max, sizeof(bounds.max));
+
+		if (node.count > 0) {
+			this->_stats.leafCount++;
+			cost += surfaceArea(bounds) * node.count;
+		}
+		else {
+			cost += surfaceArea(bounds) * BVH_TRAVERSAL_COST;
+		}
+	}
+
+	this->_stats.sahCost = rootArea > 0.0f ? cost / rootArea : 0.0f;
+}
@@ -0,0 +1,132 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "QJobSystem.h"
+
+const uint32_t BVH_MAX_LEAF_SIZE = 4;
+const uint32_t BVH_BIN_COUNT = 16;
+
+struct QBVHBounds {
+	float min[3];
+	float max[3];
+};
+
+// 32 bytes, so with the array on a cache line boundary the two children of a node share one line.
+// Children are always adjacent and after their parent: an inner node only stores the left one.
+struct QBVHNode {
+	float min[3];
+	uint32_t leftOrFirst;
+	float max[3];
+	uint32_t count;
+};
+
+struct QBVHRay {
+	float origin[3];
+	float direction[3];
+	float tMax = 1e30f;
+};
+
+struct QBVHHit {
+	uint32_t primitive = UINT32_MAX;
+	float t = 1e30f;
+	float u = 0.0f;
+	float v = 0.0f;
+};
+
+struct QBVHStats {
+	uint32_t primitiveCount = 0;
+	uint32_t nodeCount = 0;
+	uint32_t leafCount = 0;
+	uint32_t maxDepth = 0;
+	uint32_t subtreeCount = 0;
+	float sahCost = 0.0f;
+	float buildMs = 0.0f;
+	float refitMs = 0.0f;
+};
+
+// Bounding volume hierarchy over primitive bounds: instances for culling, triangles for ray queries.
+// Built top-down with a binned SAH over all three axes. The upper levels bin in parallel on the job
+// system, then the remaining subtrees build one per job and are stitched together. Refit keeps the
+// topology and only recomputes boxes, which suits objects that move without changing much.
+// For ray queries primitive i is triangle i: positions are packed xyz and indices come in threes.
+class QBVH {
+public:
+	static const uint32_t INVALID = UINT32_MAX;
+
+	QBVH(uint32_t maxLeafSize = BVH_MAX_LEAF_SIZE);
+	~QBVH();
+
+	void build(const QBVHBounds* bounds, uint32_t count, QJobSystem* jobSystem);
+	void refit(const QBVHBounds* bounds);
+
+	void cullFrustum(const float planes[6][4], std::vector<uint32_t>& outPrimitives) const;
+	bool intersectTriangles(const QBVHRay& ray, const float* positions, const uint32_t* indices, QBVHHit& outHit) const;
+
+	const QBVHNode* getNodes() const;
+	uint32_t getNodeCount() const;
+	const uint32_t* getPrimitiveIndices() const;
+	QBVHStats getStats() const;
+
+	static void computeTriangleBounds(
+		const float* positions, const uint32_t* indices, uint32_t triangleCount, std::vector<QBVHBounds>& outBounds);
+private:
+	struct Bin {
+		QBVHBounds bounds;
+		uint32_t count;
+	};
+
+	struct BuildTask {
+		uint32_t node;
+		uint32_t first;
+		uint32_t count;
+		uint32_t depth;
+		QBVHBounds bounds;
+		QBVHBounds centroids;
+	};
+
+	// A primitive as the build sees it, moved around whole so that binning and partitioning stream
+	// through memory instead of chasing indices.
+	struct Reference {
+		QBVHBounds bounds;
+		float centroid[3];
+		uint32_t primitive;
+	};
+
+	struct Split {
+		uint32_t axis;
+		uint32_t bin;
+		float cost;
+		Bin left;
+		Bin right;
+	};
+
+	uint32_t _maxLeafSize;
+
+	std::vector<char> _nodeStorage;
+	QBVHNode* _nodes = nullptr;
+	uint32_t _nodeCount = 0;
+
+	std::vector<uint32_t> _primitiveIndices;
+	std::vector<Reference> _references;
+	const QBVHBounds* _bounds = nullptr;
+
+	std::vector<QBVHNode> _buildNodes;
+	std::vector<std::vector<QBVHNode>> _subtreeNodes;
+	std::vector<uint32_t> _subtreeDepths;
+	std::vector<Bin> _workerBins;
+	std::vector<QBVHBounds> _workerBounds;
+	std::vector<Reference> _scratchReferences;
+	std::vector<uint32_t> _batchOffsets;
+	QBVHStats _stats;
+
+	void _computeReferences(uint32_t count, QJobSystem* jobSystem, BuildTask& outRoot);
+	bool _findSplit(const BuildTask& task, Bin* bins, Split& outSplit);
+	void _binRange(const BuildTask& task, uint32_t begin, uint32_t end, Bin* bins);
+	bool _splitTask(
+		const BuildTask& task, Bin* bins, std::vector<QBVHNode>& nodes, QJobSystem* jobSystem, BuildTask& outLeft, BuildTask& outRight);
+	uint32_t _partition(
+		const BuildTask& task, const Split& split, QJobSystem* jobSystem, QBVHBounds& outLeftCentroids, QBVHBounds& outRightCentroids);
+	uint32_t _buildSubtree(const BuildTask& task, std::vector<QBVHNode>& nodes);
+	void _storeNodes();
+	void _computeStats();
+};
@@ -0,0 +1,173 @@
+#include "QFrameArena.h"
+#include "ThrowErr.h"
+
+static std::mutex& getSlotMutex() {
+	static std::mutex slotMutex;
+	return slotMutex;
+}
+
+static std::vector<uint32_t>& getFreeSlots() {
+	static std::vector<uint32_t> freeSlots;
+	return freeSlots;
+}
+
+static uint32_t& getNextSlot() {
+	static uint32_t nextSlot = 0;
+	return nextSlot;
+}
+
+QLinearArena::QLinearArena(size_t chunkSize) : _chunkSize{ chunkSize } {}
+
+QLinearArena::~QLinearArena() {
+	for (Chunk& chunk : this->_chunks) {
+		::operator delete(chunk.data);
+	}
+}
+
+void* QLinearArena::allocate(size_t size, size_t alignment) {
+	while (this->_chunkIndex < this->_chunks.size()) {
+		Chunk& chunk = this->_chunks[this->_chunkIndex];
+		uintptr_t base = reinterpret_cast<uintptr_t>(chunk.data);
+		uintptr_t aligned = (base + this->_offset + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+		size_t offset = static_cast<size_t>(aligned - base);
+
+		if (offset + size <= chunk.size) {
+			this->_usedBytes.store(this->_usedBytes.load(std::memory_order_relaxed) + offset + size - this->_offset, std::memory_order_relaxed);
+			this->_offset = offset + size;
+			return chunk.data + offset;
+		}
+
+		this->_chunkIndex++;
+		this->_offset = 0;
+	}
+
+	// Only reached while the arena is still growing towards its high-water mark.
+	Chunk chunk;
+	chunk.size = size + alignment > this->_chunkSize ? size + alignment : this->_chunkSize;
+	chunk.data = static_cast<char*>(::operator new(chunk.size));
+	this->_chunks.push_back(chunk);
+
+	return this->allocate(size, alignment);
+}
+
+void QLinearArena::reset() {
+	this->_chunkIndex = 0;
+	this->_offset = 0;
+	this->_usedBytes.store(0, std::memory_order_relaxed);
+}
+
+size_t QLinearArena::getUsedBytes() const {
+	return this->_usedBytes.load(std::memory_order_relaxed);
+}
+
+size_t QLinearArena::getCapacity() const {
+	size_t capacity = 0;
+	for (const Chunk& chunk : this->_chunks) {
+		capacity += chunk.size;
+	}
+
+	return capacity;
+}
+
+QFrameArena::QFrameArena(uint32_t frameCount, size_t chunkSize) :
+	_frameCount{ frameCount }, _chunkSize{ chunkSize }, _currentFrame{ 0 } {
+	if (frameCount == 0) {
+		ThrowErr::runtime("Frame arena needs at least one frame!..");
+	}
+
+	this->_frames = new Frame[frameCount];
+	for (uint32_t i = 0; i < frameCount; i++) {
+		this->_frames[i].epoch.store(1);
+	}
+}
+
+QFrameArena::~QFrameArena() {
+	for (uint32_t i = 0; i < this->_frameCount; i++) {
+		for (uint32_t j = 0; j < FRAME_ARENA_MAX_THREADS; j++) {
+			delete this->_frames[i].threads[j].arena.load();
+		}
+	}
+
+	delete[] this->_frames;
+}
+
+void QFrameArena::beginFrame(uint32_t frameIndex) {
+	this->_frames[frameIndex].epoch.fetch_add(1, std::memory_order_release);
+	this->_currentFrame.store(frameIndex, std::memory_order_release);
+}
+
+QLinearArena& QFrameArena::local() {
+	Frame& frame = this->_frames[this->_currentFrame.load(std::memory_order_acquire)];
+	SubArena& subArena = frame.threads[_getThreadSlot()];
+
+	QLinearArena* arena = subArena.arena.load(std::memory_order_relaxed);
+
+	if (arena == nullptr) {
+		arena = new QLinearArena(this->_chunkSize);
+		subArena.arena.store(arena, std::memory_order_release);
+	}
+
+	uint64_t epoch = frame.epoch.load(std::memory_order_acquire);
+	if (subArena.epoch.load(std::memory_order_relaxed) != epoch) {
+		arena->reset();
+		subArena.epoch.store(epoch, std::memory_order_release);
+	}
+
+	return *arena;
+}
+
+void* QFrameArena::allocate(size_t size, size_t alignment) {
+	return this->local().allocate(size, alignment);
+}
+
+uint32_t QFrameArena::getFrameCount() const {
+	return this->_frameCount;
+}
+
+size_t QFrameArena::getUsedBytes(uint32_t frameIndex) const {
+	const Frame& frame = this->_frames[frameIndex];
+	uint64_t epoch = frame.epoch.load(std::memory_order_acquire);
+	size_t usedBytes = 0;
+
+	for (uint32_t i = 0; i < FRAME_ARENA_MAX_THREADS; i++) {
+		const QLinearArena* arena = frame.threads[i].arena.load(std::memory_order_acquire);
+		if (arena != nullptr && frame.threads[i].epoch.load(std::memory_order_acquire) == epoch) {
+			usedBytes += arena->getUsedBytes();
+		}
+	}
+
+	return usedBytes;
+}
+
+uint32_t QFrameArena::_getThreadSlot() {
+	// Slots go back to a free list when their thread exits, so short-lived threads do not exhaust them.
+	struct ThreadSlot {
+		uint32_t index;
+
+		ThreadSlot() {
+			std::lock_guard<std::mutex> lock(getSlotMutex());
+			std::vector<uint32_t>& freeSlots = getFreeSlots();
+
+			if (!freeSlots.empty()) {
+				this->index = freeSlots.back();
+				freeSlots.pop_back();
+			}
+			else {
+				this->index = getNextSlot()++;
+			}
+		}
+
+		~ThreadSlot() {
+			std::lock_guard<std::mutex> lock(getSlotMutex());
+			getFreeSlots().push_back(this->index);
+		}
+	};
+
+	thread_local ThreadSlot slot;
+
+	if (slot.index >= FRAME_ARENA_MAX_THREADS) {
+		ThrowErr::runtime("Too many threads use the frame arena!..");
+	}
+
+	return slot.index;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+const size_t ARENA_CHUNK_SIZE = 1024 * 1024;
+const uint32_t FRAME_ARENA_MAX_THREADS = 64;
+
+// Bump allocator over a list of chunks. Reset rewinds to the first chunk and keeps every chunk,
+// so once a frame's high-water mark is reached it never touches the heap again.
+class QLinearArena {
+public:
+	QLinearArena(size_t chunkSize = ARENA_CHUNK_SIZE);
+	~QLinearArena();
+
+	void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+	template <typename T>
+	T* allocate(size_t count) {
+		return static_cast<T*>(this->allocate(sizeof(T) * count, alignof(T)));
+	}
+
+	void reset();
+	size_t getUsedBytes() const;
+	size_t getCapacity() const;
+private:
+	struct Chunk {
+		char* data;
+		size_t size;
+	};
+
+	std::vector<Chunk> _chunks;
+	size_t _chunkSize;
+	size_t _chunkIndex = 0;
+	size_t _offset = 0;
+	// Only the owning thread writes it; atomic so QFrameArena::getUsedBytes can read it from another.
+	std::atomic<size_t> _usedBytes{ 0 };
+
+	QLinearArena(const QLinearArena&) = delete;
+	QLinearArena& operator=(const QLinearArena&) = delete;
+};
+
+// Double or triple buffered per-frame arenas. Every thread gets its own sub-arena per frame,
+// found through a thread_local slot, so allocation never takes a lock. beginFrame only bumps an
+// epoch; sub-arenas rewind lazily the first time their thread touches them in the new frame.
+class QFrameArena {
+public:
+	QFrameArena(uint32_t frameCount, size_t chunkSize = ARENA_CHUNK_SIZE);
+	~QFrameArena();
+
+	void beginFrame(uint32_t frameIndex);
+	QLinearArena& local();
+
+	void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+	template <typename T>
+	T* allocate(size_t count) {
+		return this->local().allocate<T>(count);
+	}
+
+	uint32_t getFrameCount() const;
+	size_t getUsedBytes(uint32_t frameIndex) const;
+private:
+	// Written by the owning thread, read by getUsedBytes from any thread.
+	struct SubArena {
+		std::atomic<QLinearArena*> arena{ nullptr };
+		std::atomic<uint64_t> epoch{ 0 };
+	};
+
+	struct Frame {
+		std::atomic<uint64_t> epoch;
+		SubArena threads[FRAME_ARENA_MAX_THREADS];
+	};
+
+	Frame* _frames;
+	uint32_t _frameCount;
+	size_t _chunkSize;
+	std::atomic<uint32_t> _currentFrame;
+
+	static uint32_t _getThreadSlot();
+
+	QFrameArena(const QFrameArena&) = delete;
+	QFrameArena& operator=(const QFrameArena&) = delete;
+};
@@ -0,0 +1,312 @@
+#include "QFrustumCuller.h"
+#include "ThrowErr.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+// glm only turns on its SIMD layer when asked to; this file uses no glm types, so forcing it here leaves
+// every other translation unit's glm configuration alone.
+#define GLM_FORCE_INTRINSICS
+#include "detail/setup.hpp"
+#include "simd/common.h"
+
+#if defined(__AVX512F__) || defined(__AVX2__) || defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+// One lane type per instruction set, all with the same few operations so a single kernel serves them.
+struct ScalarLanes {
+	static const uint32_t WIDTH = 1;
+	typedef float Value;
+	typedef bool Mask;
+
+	static Value load(const float* data) { return *data; }
+	static Value splat(float value) { return value; }
+	static Value add(Value a, Value b) { return a + b; }
+	static Value mul(Value a, Value b) { return a * b; }
+	static Value negate(Value a) { return -a; }
+	static Mask greaterEqual(Value a, Value b) { return a >= b; }
+	static Mask allLanes() { return true; }
+	static Mask both(Mask a, Mask b) { return a && b; }
+	static uint32_t bits(Mask mask) { return mask ? 1u : 0u; }
+};
+
+#if defined(__AVX512F__)
+struct SimdLanes {
+	static const uint32_t WIDTH = 16;
+	typedef __m512 Value;
+	typedef __mmask16 Mask;
+
+	static Value load(const float* data) { return _mm512_loadu_ps(data); }
+	static Value splat(float value) { return _mm512_set1_ps(value); }
+	static Value add(Value a, Value b) { return _mm512_add_ps(a, b); }
+	static Value mul(Value a, Value b) { return _mm512_mul_ps(a, b); }
+	static Value negate(Value a) { return _mm512_sub_ps(_mm512_setzero_ps(), a); }
+	static Mask greaterEqual(Value a, Value b) { return _mm512_cmp_ps_mask(a, b, _CMP_GE_OQ); }
+	static Mask allLanes() { return 0xFFFF; }
+	static Mask both(Mask a, Mask b) { return static_cast<Mask>(a & b); }
+	static uint32_t bits(Mask mask) { return mask; }
+};
+#elif defined(__AVX2__) || defined(__AVX__)
+struct SimdLanes {
+	static const uint32_t WIDTH = 8;
+	typedef __m256 Value;
+	typedef __m256 Mask;
+
+	static Value load(const float* data) { return _mm256_loadu_ps(data); }
+	static Value splat(float value) { return _mm256_set1_ps(value); }
+	static Value add(Value a, Value b) { return _mm256_add_ps(a, b); }
+	static Value mul(Value a, Value b) { return _mm256_mul_ps(a, b); }
+	static Value negate(Value a) { return _mm256_sub_ps(_mm256_setzero_ps(), a); }
+	static Mask greaterEqual(Value a, Value b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+	static Mask allLanes() { return _mm256_castsi256_ps(_mm256_set1_epi32(-1)); }
+	static Mask both(Mask a, Mask b) { return _mm256_and_ps(a, b); }
+	static uint32_t bits(Mask mask) { return static_cast<uint32_t>(_mm256_movemask_ps(mask)); }
+};
+#elif GLM_ARCH & GLM_ARCH_SSE2_BIT
+struct SimdLanes {
+	static const uint32_t WIDTH = 4;
+	typedef glm_f32vec4 Value;
+	typedef glm_f32vec4 Mask;
+
+	static Value load(const float* data) { return _mm_loadu_ps(data); }
+	static Value splat(float value) { return _mm_set1_ps(value); }
+	static Value add(Value a, Value b) { return glm_vec4_add(a, b); }
+	static Value mul(Value a, Value b) { return glm_vec4_mul(a, b); }
+	static Value negate(Value a) { return glm_vec4_sub(_mm_setzero_ps(), a); }
+	static Mask greaterEqual(Value a, Value b) { return _mm_cmpge_ps(a, b); }
+	static Mask allLanes() { return _mm_castsi128_ps(_mm_set1_epi32(-1)); }
+	static Mask both(Mask a, Mask b) { return _mm_and_ps(a, b); }
+	static uint32_t bits(Mask mask) { return static_cast<uint32_t>(_mm_movemask_ps(mask)); }
+};
+#elif GLM_ARCH & GLM_ARCH_NEON_BIT
+struct SimdLanes {
+	static const uint32_t WIDTH = 4;
+	typedef glm_f32vec4 Value;
+	typedef glm_u32vec4 Mask;
+
+	static Value load(const float* data) { return vld1q_f32(data); }
+	static Value splat(float value) { return vdupq_n_f32(value); }
+	static Value add(Value a, Value b) { return vaddq_f32(a, b); }
+	static Value mul(Value a, Value b) { return vmulq_f32(a, b); }
+	static Value negate(Value a) { return vnegq_f32(a); }
+	static Mask greaterEqual(Value a, Value b) { return vcgeq_f32(a, b); }
+	static Mask allLanes() { return vdupq_n_u32(0xFFFFFFFFu); }
+	static Mask both(Mask a, Mask b) { return vandq_u32(a, b); }
+
+	// NEON has no movemask: keep one bit per lane and add the lanes up.
+	static uint32_t bits(Mask mask) {
+		static const uint32_t LANE_BITS[4] = { 1, 2, 4, 8 };
+		uint32x4_t laneBits = vandq_u32(mask, vld1q_u32(LANE_BITS));
+#if GLM_ARCH & GLM_ARCH_ARMV8_BIT
+		return vaddvq_u32(laneBits);
+#else
+		uint32x2_t pairs = vpadd_u32(vget_low_u32(laneBits), vget_high_u32(laneBits));
+		return vget_lane_u32(vpadd_u32(pairs, pairs), 0);
+#endif
+	}
+};
+#else
+typedef ScalarLanes SimdLanes;
+#endif
+
+// Tests objects [begin, end) in steps of L::WIDTH and appends the visible indices to out. Fields come in
+// QFrustumCuller::Field order. Returns where the loop stopped, short of end by a tail narrower than L.
+template <typename L>
+static uint32_t cullLanes(
+	const float* const* fields, const float planes[6][4], uint32_t begin, uint32_t end, uint32_t* out, uint32_t* outCount) {
+	typename L::Value planeX[6], planeY[6], planeZ[6], planeW[6];
+	typename L::Value absX[6], absY[6], absZ[6];
+	for (uint32_t p = 0; p < 6; p++) {
+		planeX[p] = L::splat(planes[p][0]);
+		planeY[p] = L::splat(planes[p][1]);
+		planeZ[p] = L::splat(planes[p][2]);
+		planeW[p] = L::splat(planes[p][3]);
+		absX[p] = L::splat(std::fabs(planes[p][0]));
+		absY[p] = L::splat(std::fabs(planes[p][1]));
+		absZ[p] = L::splat(std::fabs(planes[p][2]));
+	}
+
+	uint32_t count = *outCount;
+	uint32_t i = begin;
+	for (; i + L::WIDTH <= end; i += L::WIDTH) {
+		typename L::Value x = L::load(fields[0] + i);
+		typename L::Value y = L::load(fields[1] + i);
+		typename L::Value z = L::load(fields[2] + i);
+		typename L::Value negativeRadius = L::negate(L::load(fields[3] + i));
+
+		typename L::Mask visible = L::allLanes();
+		for (uint32_t p = 0; p < 6; p++) {
+			typename L::Value distance = L::add(
+				L::add(L::mul(planeX[p], x), L::mul(planeY[p], y)), L::add(L::mul(planeZ[p], z), planeW[p]));
+			visible = L::both(visible, L::greaterEqual(distance, negativeRadius));
+		}
+
+		if (L::bits(visible) == 0) {
+			continue;
+		}
+
+		// The box reaches furthest into a plane's negative side by the extents projected on |normal|.
+		x = L::load(fields[4] + i);
+		y = L::load(fields[5] + i);
+		z = L::load(fields[6] + i);
+		typename L::Value extentX = L::load(fields[7] + i);
+		typename L::Value extentY = L::load(fields[8] + i);
+		typename L::Value extentZ = L::load(fields[9] + i);
+
+		for (uint32_t p = 0; p < 6; p++) {
+			typename L::Value distance = L::add(
+				L::add(L::mul(planeX[p], x), L::mul(planeY[p], y)), L::add(L::mul(planeZ[p], z), planeW[p]));
+			typename L::Value reach = L::add(L::add(L::mul(absX[p], extentX), L::mul(absY[p], extentY)), L::mul(absZ[p], extentZ));
+			visible = L::both(visible, L::greaterEqual(distance, L::negate(reach)));
+		}
+
+		uint32_t bits = L::bits(visible);
+		for (uint32_t lane = 0; lane < L::WIDTH; lane++) {
+			if ((bits >> lane) & 1u) {
+				out[count++] = i + lane;
+			}
+		}
+	}
+
+	*outCount = count;
+	return i;
+}
+
+QFrustumCuller::QFrustumCuller(uint32_t chunkSize) : _chunkSize{ chunkSize } {
+	if (this->_chunkSize == 0 || this->_chunkSize % 16 != 0) {
+		ThrowErr::runtime("Frustum culler chunk size must be a multiple of 16!..");
+	}
+
+	// Everything passes until a view is set.
+	for (uint32_t p = 0; p < 6; p++) {
+		for (uint32_t i = 0; i < 4; i++) {
+			this->_planes[p][i] = 0.0f;
+		}
+	}
+}
+
+uint32_t QFrustumCuller::add(const float sphereCenter[3], float sphereRadius, const float aabbMin[3], const float aabbMax[3]) {
+	for (uint32_t field = 0; field < FIELD_COUNT; field++) {
+		this->_fields[field].push_back(0.0f);
+	}
+
+	uint32_t index = this->_count++;
+	this->set(index, sphereCenter, sphereRadius, aabbMin, aabbMax);
+
+	return index;
+}
+
+void QFrustumCuller::set(uint32_t index, const float sphereCenter[3], float sphereRadius, const float aabbMin[3], const float aabbMax[3]) {
+	if (index >= this->_count) {
+		ThrowErr::runtime("Frustum culler index out of range!..");
+	}
+
+	for (uint32_t axis = 0; axis < 3; axis++) {
+		this->_fields[SPHERE_X + axis][index] = sphereCenter[axis];
+		this->_fields[AABB_CENTER_X + axis][index] = (aabbMin[axis] + aabbMax[axis]) * 0.5f;
+		this->_fields[AABB_EXTENT_X + axis][index] = (aabbMax[axis] - aabbMin[axis]) * 0.5f;
+	}
+	this->_fields[SPHERE_RADIUS][index] = sphereRadius;
+}
+
+void QFrustumCuller::clear() {
+	for (uint32_t field = 0; field < FIELD_COUNT; field++) {
+		this->_fields[field].clear();
+	}
+	this->_count = 0;
+}
+
+void QFrustumCuller::reserve(uint32_t count) {
+	for (uint32_t field = 0; field < FIELD_COUNT; field++) {
+		this->_fields[field].reserve(count);
+	}
+}
+
+void QFrustumCuller::setPlanes(const float planes[6][4]) {
+	memcpy(this->_planes, planes, sizeof(this->_planes));
+}
+
+void QFrustumCuller::setViewProjection(const float viewProjection[16]) {
+	extractPlanes(viewProjection, this->_planes);
+}
+
+void QFrustumCuller::cull(QJobSystem* jobSystem, std::vector<uint32_t>& outVisible) {
+	QAllocScope allocScope(QAllocTag::CULLING);
+	auto start = std::chrono::steady_clock::now();
+
+	uint32_t chunkCount = (this->_count + this->_chunkSize - 1) / this->_chunkSize;
+	this->_chunkVisible.resize(this->_count);
+	this->_chunkCounts.assign(chunkCount, 0);
+
+	const float* fields[FIELD_COUNT];
+	for (uint32_t field = 0; field < FIELD_COUNT; field++) {
+		fields[field] = this->_fields[field].data();
+	}
+
+	// Each chunk writes its visible indices at its own offset, so no two workers share anything.
+	jobSystem->parallelFor(chunkCount, 1, [this, &fields](uint32_t begin, uint32_t end, uint32_t) {
+		for (uint32_t chunk = begin; chunk < end; chunk++) {
+			uint32_t first = chunk * this->_chunkSize;
+			uint32_t last = std::min(first + this->_chunkSize, this->_count);
+			uint32_t* out = this->_chunkVisible.data() + first;
+
+			uint32_t count = 0;
+			uint32_t tail = cullLanes<SimdLanes>(fields, this->_planes, first, last, out, &count);
+			cullLanes<ScalarLanes>(fields, this->_planes, tail, last, out, &count);
+			this->_chunkCounts[chunk] = count;
+		}
+	});
+
+	outVisible.clear();
+	for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+		const uint32_t* first = this->_chunkVisible.data() + chunk * this->_chunkSize;
+		outVisible.insert(outVisible.end(), first, first + this->_chunkCounts[chunk]);
+	}
+
+	std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+	this->_stats.objectCount = this->_count;
+	this->_stats.visibleCount = static_cast<uint32_t>(outVisible.size());
+	this->_stats.workerCount = jobSystem->getWorkerCount();
+	this->_stats.simdWidth = SimdLanes::WIDTH;
+	this->_stats.cullMs = elapsed.count();
+	this->_stats.objectsPerSecondPerWorker = elapsed.count() > 0.0f ?
+		this->_count / (elapsed.count() * 0.001f) / this->_stats.workerCount : 0.0f;
+}
+
+uint32_t QFrustumCuller::getCount() const {
+	return this->_count;
+}
+
+QFrustumCullerStats QFrustumCuller::getStats() const {
+	return this->_stats;
+}
+
+void QFrustumCuller::extractPlanes(const float viewProjection[16], float outPlanes[6][4]) {
+	// Gribb-Hartmann planes for a row-major matrix applied to column vectors, with clip z in [0, w].
+	// Normals point inside and are normalized, so plane distances are world units.
+	const float* row3 = viewProjection + 12;
+	for (uint32_t plane = 0; plane < 6; plane++) {
+		const float* row = viewProjection + (plane / 2) * 4;
+		float sign = (plane % 2 == 0) ? 1.0f : -1.0f;
+
+		float* out = outPlanes[plane];
+		for (uint32_t i = 0; i < 4; i++) {
+			// Near is z >= 0 on its own; every other plane is w +- row.
+			out[i] = (plane == 4) ? row[i] : row3[i] + sign * row[i];
+		}
+
+		float length = std::sqrt(out[0] * out[0] + out[1] * out[1] + out[2] * out[2]);
+		if (length > 0.0f) {
+			for (uint32_t i = 0; i < 4; i++) {
+				out[i] /= length;
+			}
+		}
+	}
+}
+
+uint32_t QFrustumCuller::getSimdWidth() {
+	return SimdLanes::WIDTH;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "QJobSystem.h"
+
+const uint32_t FRUSTUM_CULLER_CHUNK_SIZE = 4096;
+
+struct QFrustumCullerStats {
+	uint32_t objectCount = 0;
+	uint32_t visibleCount = 0;
+	uint32_t workerCount = 0;
+	uint32_t simdWidth = 0;
+	float cullMs = 0.0f;
+	float objectsPerSecondPerWorker = 0.0f;
+};
+
+// CPU frustum culling over world-space bounds kept as structure of arrays, one array per component, so
+// a whole register of objects is tested against a plane at once: 16 lanes with AVX-512, 8 with AVX2,
+// 4 with SSE2 or NEON through glm's simd layer and scalar otherwise, picked by the build's instruction
+// set; MSVC only emits AVX2 with msbuild /p:QEngineAvx2=true. An object is visible when its
+// bounding sphere and then its AABB are both inside or crossing every plane; a register whose spheres
+// are all outside skips the box test. Chunks go to the job system and are compacted in order, so the
+// visible list does not depend on the thread count.
+class QFrustumCuller {
+public:
+	QFrustumCuller(uint32_t chunkSize = FRUSTUM_CULLER_CHUNK_SIZE);
+
+	uint32_t add(const float sphereCenter[3], float sphereRadius, const float aabbMin[3], const float aabbMax[3]);
+	void set(uint32_t index, const float sphereCenter[3], float sphereRadius, const float aabbMin[3], const float aabbMax[3]);
+	void clear();
+	void reserve(uint32_t count);
+
+	void setPlanes(const float planes[6][4]);
+	void setViewProjection(const float viewProjection[16]);
+	void cull(QJobSystem* jobSystem, std::vector<uint32_t>& outVisible);
+
+	uint32_t getCount() const;
+	QFrustumCullerStats getStats() const;
+
+	static void extractPlanes(const float viewProjection[16], float outPlanes[6][4]);
+	static uint32_t getSimdWidth();
+private:
+	enum Field {
+		SPHERE_X, SPHERE_Y, SPHERE_Z, SPHERE_RADIUS,
+		AABB_CENTER_X, AABB_CENTER_Y, AABB_CENTER_Z,
+		AABB_EXTENT_X, AABB_EXTENT_Y, AABB_EXTENT_Z,
+		FIELD_COUNT
+	};
+
+	uint32_t _chunkSize;
+	uint32_t _count = 0;
+	std::vector<float> _fields[FIELD_COUNT];
+	float _planes[6][4];
+
+	std::vector<uint32_t> _chunkVisible;
+	std::vector<uint32_t> _chunkCounts;
+	QFrustumCullerStats _stats;
+};
@@ -0,0 +1,167 @@
+#include "QGeometryMerger.h"
+#include "QAllocTracker.h"
+#include "ThrowErr.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+QGeometryMerger::QGeometryMerger(uint32_t vertexStride, uint32_t positionOffset) :
+	_vertexStride{ vertexStride }, _positionOffset{ positionOffset } {
+	if (this->_positionOffset + sizeof(float) * 3 > this->_vertexStride) {
+		ThrowErr::runtime("Geometry merger vertex position does not fit the vertex stride!..");
+	}
+}
+
+uint32_t QGeometryMerger::add(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, uint32_t materialIndex) {
+	QAllocScope allocScope(QAllocTag::LOADING);
+	if (vertexCount == 0 || indexCount == 0) {
+		ThrowErr::runtime("Failed to add a submesh: it has no vertices or indices!..");
+	}
+
+	for (uint32_t i = 0; i < indexCount; i++) {
+		if (indices[i] >= vertexCount) {
+			ThrowErr::runtime("Failed to add a submesh: an index is out of its vertex range!..");
+		}
+	}
+
+	const uint8_t* vertexBytes = static_cast<const uint8_t*>(vertices);
+
+	QMergedSubmesh submesh;
+	submesh.firstIndex = static_cast<uint32_t>(this->_indexData.size());
+	submesh.indexCount = indexCount;
+	submesh.vertexOffset = static_cast<int32_t>(this->_vertexData.size() / this->_vertexStride);
+	submesh.vertexCount = vertexCount;
+	submesh.materialIndex = materialIndex;
+
+	for (uint32_t axis = 0; axis < 3; axis++) {
+		submesh.boundsMin[axis] = INFINITY;
+		submesh.boundsMax[axis] = -INFINITY;
+	}
+
+	for (uint32_t vertex = 0; vertex < vertexCount; vertex++) {
+		float position[3];
+		memcpy(position, vertexBytes + static_cast<size_t>(vertex) * this->_vertexStride + this->_positionOffset, sizeof(position));
+		for (uint32_t axis = 0; axis < 3; axis++) {
+			submesh.boundsMin[axis] = std::min(submesh.boundsMin[axis], position[axis]);
+			submesh.boundsMax[axis] = std::max(submesh.boundsMax[axis], position[axis]);
+		}
+	}
+
+	// The sphere is centred on the box and reaches the farthest vertex, which is tighter than the box's corner.
+	for (uint32_t axis = 0; axis < 3; axis++) {
+		submesh.boundsCenter[axis] = (submesh.boundsMin[axis] + submesh.boundsMax[axis]) * 0.5f;
+	}
+
+	float radiusSquared = 0.0f;
+	for (uint32_t vertex = 0; vertex < vertexCount; vertex++) {
+		float position[3];
+		memcpy(position, vertexBytes + static_cast<size_t>(vertex) * this->_vertexStride + this->_positionOffset, sizeof(position));
+
+		float distanceSquared = 0.0f;
+		for (uint32_t axis = 0; axis < 3; axis++) {
+			float delta = position[axis] - submesh.boundsCenter[axis];
+			distanceSquared += delta * delta;
+		}
+		radiusSquared = std::max(radiusSquared, distanceSquared);
+	}
+	submesh.boundsRadius = std::sqrt(radiusSquared);
+
+	this->_vertexData.insert(this->_vertexData.end(), vertexBytes, vertexBytes + static_cast<size_t>(vertexCount) * this->_vertexStride);
+	this->_indexData.insert(this->_indexData.end(), indices, indices + indexCount);
+	this->_submeshes.push_back(submesh);
+	this->_merged = false;
+
+	return static_cast<uint32_t>(this->_submeshes.size() - 1);
+}
+
+void QGeometryMerger::merge() {
+	QAllocScope allocScope(QAllocTag::LOADING);
+	if (this->_merged) {
+		return;
+	}
+
+	uint32_t submeshCount = static_cast<uint32_t>(this->_submeshes.size());
+	this->_mergedOrder.resize(submeshCount);
+	for (uint32_t i = 0; i < submeshCount; i++) {
+		this->_mergedOrder[i] = i;
+	}
+
+	std::stable_sort(this->_mergedOrder.begin(), this->_mergedOrder.end(), [this](uint32_t a, uint32_t b) {
+		return this->_submeshes[a].materialIndex < this->_submeshes[b].materialIndex;
+	});
+
+	std::vector<uint8_t> vertexData;
+	std::vector<uint32_t> indexData;
+	vertexData.reserve(this->_vertexData.size());
+	indexData.reserve(this->_indexData.size());
+	this->_materials.clear();
+
+	for (uint32_t position = 0; position < submeshCount; position++) {
+		QMergedSubmesh& submesh = this->_submeshes[this->_mergedOrder[position]];
+
+		const uint8_t* vertices = this->_vertexData.data() + static_cast<size_t>(submesh.vertexOffset) * this->_vertexStride;
+		const uint32_t* indices = this->_indexData.data() + submesh.firstIndex;
+
+		submesh.firstIndex = static_cast<uint32_t>(indexData.size());
+		submesh.vertexOffset = static_cast<int32_t>(vertexData.size() / this->_vertexStride);
+		vertexData.insert(vertexData.end(), vertices, vertices + static_cast<size_t>(submesh.vertexCount) * this->_vertexStride);
+		indexData.insert(indexData.end(), indices, indices + submesh.indexCount);
+
+		if (this->_materials.empty() || this->_materials.back().materialIndex != submesh.materialIndex) {
+			QMergedMaterial material;
+			material.materialIndex = submesh.materialIndex;
+			material.firstSubmesh = position;
+			material.firstIndex = submesh.firstIndex;
+			this->_materials.push_back(material);
+		}
+
+		QMergedMaterial& material = this->_materials.back();
+		material.submeshCount++;
+		material.indexCount += submesh.indexCount;
+	}
+
+	this->_vertexData.swap(vertexData);
+	this->_indexData.swap(indexData);
+	this->_merged = true;
+}
+
+void QGeometryMerger::clear() {
+	this->_submeshes.clear();
+	this->_mergedOrder.clear();
+	this->_materials.clear();
+	this->_vertexData.clear();
+	this->_indexData.clear();
+	this->_merged = true;
+}
+
+uint32_t QGeometryMerger::getSubmeshCount() const {
+	return static_cast<uint32_t>(this->_submeshes.size());
+}
+
+const QMergedSubmesh& QGeometryMerger::getSubmesh(uint32_t submeshIndex) const {
+	if (submeshIndex >= this->_submeshes.size()) {
+		ThrowErr::runtime("Invalid merged submesh index!..");
+	}
+
+	return this->_submeshes[submeshIndex];
+}
+
+const std::vector<uint32_t>& QGeometryMerger::getMergedOrder() const {
+	return this->_mergedOrder;
+}
+
+const std::vector<QMergedMaterial>& QGeometryMerger::getMaterials() const {
+	return this->_materials;
+}
+
+const std::vector<uint8_t>& QGeometryMerger::getVertexData() const {
+	return this->_vertexData;
+}
+
+const std::vector<uint32_t>& QGeometryMerger::getIndexData() const {
+	return this->_indexData;
+}
+
+uint32_t QGeometryMerger::getVertexStride() const {
+	return this->_vertexStride;
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Where one added submesh ended up in the merged data, with its bounds for culling. Indices are relative
+// to the submesh's own vertices, so draws pass vertexOffset as the vertex offset.
+struct QMergedSubmesh {
+	float boundsMin[3] = { 0.0f, 0.0f, 0.0f };
+	float boundsMax[3] = { 0.0f, 0.0f, 0.0f };
+	float boundsCenter[3] = { 0.0f, 0.0f, 0.0f };
+	float boundsRadius = 0.0f;
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+	int32_t vertexOffset = 0;
+	uint32_t vertexCount = 0;
+	uint32_t materialIndex = 0;
+};
+
+// A material's contiguous run in the merged data: positions firstSubmesh.. in getMergedOrder(), and the
+// index range its submeshes cover.
+struct QMergedMaterial {
+	uint32_t materialIndex = 0;
+	uint32_t firstSubmesh = 0;
+	uint32_t submeshCount = 0;
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+};
+
+// Load-time merging of unique static geometry into one vertex and one index array. merge() lays the
+// submeshes out grouped by material, in the order they were added within a material, so one pair of
+// buffers holds the whole set and each material is a single contiguous range of draws, which is exactly
+// what one multi-draw-indirect call per material needs. Every submesh keeps its own ranges and bounds,
+// computed from the three floats at positionOffset in each vertex, so it can still be culled alone.
+class QGeometryMerger {
+public:
+	QGeometryMerger(uint32_t vertexStride, uint32_t positionOffset = 0);
+
+	uint32_t add(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount, uint32_t materialIndex);
+	void merge();
+	void clear();
+
+	uint32_t getSubmeshCount() const;
+	const QMergedSubmesh& getSubmesh(uint32_t submeshIndex) const;
+	const std::vector<uint32_t>& getMergedOrder() const;
+	const std::vector<QMergedMaterial>& getMaterials() const;
+	const std::vector<uint8_t>& getVertexData() const;
+	const std::vector<uint32_t>& getIndexData() const;
+	uint32_t getVertexStride() const;
+private:
+	uint32_t _vertexStride;
+	uint32_t _positionOffset;
+	bool _merged = true;
+
+	std::vector<QMergedSubmesh> _submeshes;
+	std::vector<uint32_t> _mergedOrder;
+	std::vector<QMergedMaterial> _materials;
+	std::vector<uint8_t> _vertexData;
+	std::vector<uint32_t> _indexData;
+};
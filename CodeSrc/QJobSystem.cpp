@@ -0,0 +1,155 @@
+#include "QJobSystem.h"
+#include <algorithm>
+
+namespace {
+	// The system whose loop the thread is running batches of, so a nested parallelFor can tell.
+	thread_local const QJobSystem* activeSystem = nullptr;
+	thread_local uint32_t activeWorker = 0;
+
+	struct ActiveScope {
+		const QJobSystem* previousSystem;
+		uint32_t previousWorker;
+
+		ActiveScope(const QJobSystem* system, uint32_t workerIndex) : previousSystem{ activeSystem }, previousWorker{ activeWorker } {
+			activeSystem = system;
+			activeWorker = workerIndex;
+		}
+
+		~ActiveScope() {
+			activeSystem = this->previousSystem;
+			activeWorker = this->previousWorker;
+		}
+	};
+}
+
+QJobSystem::QJobSystem(uint32_t threadCount) : _nextIndex{ 0 } {
+	if (threadCount == 0) {
+		uint32_t hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+
+	for (uint32_t i = 0; i < threadCount; i++) {
+		this->_threads.emplace_back(&QJobSystem::_workerLoop, this, i + 1);
+	}
+}
+
+QJobSystem::~QJobSystem() {
+	{
+		std::lock_guard<std::mutex> lock(this->_mutex);
+		this->_quit = true;
+	}
+
+	this->_wake.notify_all();
+	for (std::thread& thread : this->_threads) {
+		thread.join();
+	}
+}
+
+uint32_t QJobSystem::getWorkerCount() const {
+	return static_cast<uint32_t>(this->_threads.size()) + 1;
+}
+
+void QJobSystem::_parallelFor(uint32_t count, uint32_t batchSize, RangeCallback callback, const void* context) {
+	if (count == 0) {
+		return;
+	}
+
+	// Nested inside one of this system's loops: the workers are busy with the outer one.
+	if (activeSystem == this) {
+		callback(context, 0, count, activeWorker);
+		return;
+	}
+
+	batchSize = batchSize > 0 ? batchSize : 1;
+
+	// Not worth waking anyone for a single batch.
+	if (count <= batchSize || this->_threads.empty()) {
+		ActiveScope activeScope(this, 0);
+		callback(context, 0, count, 0);
+		return;
+	}
+
+	std::lock_guard<std::mutex> submitLock(this->_submitMutex);
+
+	{
+		std::lock_guard<std::mutex> lock(this->_mutex);
+		this->_callback = callback;
+		this->_context = context;
+		this->_count = count;
+		this->_batchSize = batchSize;
+		this->_allocTag = QAllocTracker::getCurrentTag();
+		this->_nextIndex.store(0, std::memory_order_relaxed);
+		this->_exception = nullptr;
+		this->_busyWorkers = static_cast<uint32_t>(this->_threads.size());
+		this->_generation++;
+	}
+
+	this->_wake.notify_all();
+	this->_runBatches(0);
+
+	std::exception_ptr exception;
+	{
+		std::unique_lock<std::mutex> lock(this->_mutex);
+		this->_done.wait(lock, [this]() { return this->_busyWorkers == 0; });
+		this->_callback = nullptr;
+		this->_context = nullptr;
+		exception = this->_exception;
+	}
+
+	if (exception) {
+		std::rethrow_exception(exception);
+	}
+}
+
+void QJobSystem::_workerLoop(uint32_t workerIndex) {
+	uint64_t seenGeneration = 0;
+
+	while (true) {
+		QAllocTag allocTag;
+		{
+			std::unique_lock<std::mutex> lock(this->_mutex);
+			this->_wake.wait(lock, [this, seenGeneration]() { return this->_quit || this->_generation != seenGeneration; });
+
+			if (this->_quit) {
+				return;
+			}
+
+			seenGeneration = this->_generation;
+			allocTag = this->_allocTag;
+		}
+
+		{
+			QAllocScope allocScope(allocTag);
+			this->_runBatches(workerIndex);
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(this->_mutex);
+			this->_busyWorkers--;
+		}
+		this->_done.notify_one();
+	}
+}
+
+void QJobSystem::_runBatches(uint32_t workerIndex) {
+	ActiveScope activeScope(this, workerIndex);
+
+	while (true) {
+		uint32_t begin = this->_nextIndex.fetch_add(this->_batchSize, std::memory_order_relaxed);
+		if (begin >= this->_count) {
+			return;
+		}
+
+		uint32_t end = std::min(begin + this->_batchSize, this->_count);
+
+		try {
+			this->_callback(this->_context, begin, end, workerIndex);
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock(this->_mutex);
+			if (!this->_exception) {
+				this->_exception = std::current_exception();
+			}
+		}
+	}
+}
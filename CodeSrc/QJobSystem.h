@@ -0,0 +1,58 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "QAllocTracker.h"
+
+// Fixed pool of worker threads for data-parallel loops. The calling thread joins in as worker 0 and
+// the pool threads are workers 1..N, so per-worker state can be indexed without any locking.
+// Workers run a loop under the submitting thread's allocation tag, so their heap use is counted there.
+// parallelFor takes any callable by reference and hands the workers a function pointer to it, so
+// submitting a loop never allocates. The pool runs one loop at a time: a parallelFor issued from inside
+// a loop body would wait on the workers that are waiting for it, so it runs inline instead, on the
+// calling worker and with that worker's index.
+class QJobSystem {
+public:
+	typedef void (*RangeCallback)(const void* context, uint32_t begin, uint32_t end, uint32_t workerIndex);
+
+	QJobSystem(uint32_t threadCount = 0);
+	~QJobSystem();
+
+	uint32_t getWorkerCount() const;
+
+	template <typename Function>
+	void parallelFor(uint32_t count, uint32_t batchSize, const Function& function) {
+		this->_parallelFor(count, batchSize, &QJobSystem::_invoke<Function>, &function);
+	}
+private:
+	std::vector<std::thread> _threads;
+
+	std::mutex _submitMutex;
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	std::condition_variable _done;
+	bool _quit = false;
+	uint64_t _generation = 0;
+	uint32_t _busyWorkers = 0;
+
+	RangeCallback _callback = nullptr;
+	const void* _context = nullptr;
+	uint32_t _count = 0;
+	uint32_t _batchSize = 1;
+	QAllocTag _allocTag = QAllocTag::UNTAGGED;
+	std::atomic<uint32_t> _nextIndex;
+	std::exception_ptr _exception;
+
+	template <typename Function>
+	static void _invoke(const void* context, uint32_t begin, uint32_t end, uint32_t workerIndex) {
+		(*static_cast<const Function*>(context))(begin, end, workerIndex);
+	}
+
+	void _parallelFor(uint32_t count, uint32_t batchSize, RangeCallback callback, const void* context);
+	void _workerLoop(uint32_t workerIndex);
+	void _runBatches(uint32_t workerIndex);
+};
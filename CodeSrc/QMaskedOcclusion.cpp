@@ -0,0 +1,730 @@
+#include "QMaskedOcclusion.h"
+#include "ThrowErr.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(_M_X64) || defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+const uint32_t SUBTILE_COUNT = 8;
+const uint32_t SUBTILE_WIDTH = 8;
+const uint32_t SUBTILE_HEIGHT = 4;
+const uint32_t FULL_MASK = 0xFFFFFFFFu;
+
+// The same few operations over WIDTH consecutive subtiles for every instruction set. Comparisons
+// return lane masks that are all ones or all zeros; select picks b where the mask is set.
+struct ScalarSubtileLanes {
+	static const uint32_t WIDTH = 1;
+	typedef float Value;
+	typedef uint32_t Bits;
+
+	static Value load(const float* data) { return *data; }
+	static void store(float* data, Value value) { *data = value; }
+	static Value splat(float value) { return value; }
+	static Value min(Value a, Value b) { return a < b ? a : b; }
+	static Value max(Value a, Value b) { return a > b ? a : b; }
+	static Value sub(Value a, Value b) { return a - b; }
+	static Bits less(Value a, Value b) { return a < b ? FULL_MASK : 0u; }
+	static Bits lessEqual(Value a, Value b) { return a <= b ? FULL_MASK : 0u; }
+	static Bits greater(Value a, Value b) { return a > b ? FULL_MASK : 0u; }
+	static Value select(Bits mask, Value a, Value b) { return mask != 0 ? b : a; }
+
+	static Bits loadBits(const uint32_t* data) { return *data; }
+	static void storeBits(uint32_t* data, Bits value) { *data = value; }
+	static Bits splatBits(uint32_t value) { return value; }
+	static Bits orBits(Bits a, Bits b) { return a | b; }
+	static Bits andNotBits(Bits a, Bits b) { return ~a & b; }
+	static Bits equal(Bits a, Bits b) { return a == b ? FULL_MASK : 0u; }
+	static Bits selectBits(Bits mask, Bits a, Bits b) { return (a & ~mask) | (b & mask); }
+	static bool any(Bits mask) { return mask != 0; }
+};
+
+#if defined(__AVX2__)
+struct SimdSubtileLanes {
+	static const uint32_t WIDTH = 8;
+	typedef __m256 Value;
+	typedef __m256i Bits;
+
+	static Value load(const float* data) { return _mm256_loadu_ps(data); }
+	static void store(float* data, Value value) { _mm256_storeu_ps(data, value); }
+	static Value splat(float value) { return _mm256_set1_ps(value); }
+	static Value min(Value a, Value b) { return _mm256_min_ps(a, b); }
+	static Value max(Value a, Value b) { return _mm256_max_ps(a, b); }
+	static Value sub(Value a, Value b) { return _mm256_sub_ps(a, b); }
+	static Bits less(Value a, Value b) { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_LT_OQ)); }
+	static Bits lessEqual(Value a, Value b) { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_LE_OQ)); }
+	static Bits greater(Value a, Value b) { return _mm256_castps_si256(_mm256_cmp_ps(a, b, _CMP_GT_OQ)); }
+	static Value select(Bits mask, Value a, Value b) { return _mm256_blendv_ps(a, b, _mm256_castsi256_ps(mask)); }
+
+	static Bits loadBits(const uint32_t* data) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data)); }
+	static void storeBits(uint32_t* data, Bits value) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(data), value); }
+	static Bits splatBits(uint32_t value) { return _mm256_set1_epi32(static_cast<int>(value)); }
+	static Bits orBits(Bits a, Bits b) { return _mm256_or_si256(a, b); }
+	static Bits andNotBits(Bits a, Bits b) { return _mm256_andnot_si256(a, b); }
+	static Bits equal(Bits a, Bits b) { return _mm256_cmpeq_epi32(a, b); }
+	static Bits selectBits(Bits mask, Bits a, Bits b) { return _mm256_blendv_epi8(a, b, mask); }
+	static bool any(Bits mask) { return _mm256_movemask_epi8(mask) != 0; }
+};
+#elif defined(_M_X64) || defined(__SSE2__)
+struct SimdSubtileLanes {
+	static const uint32_t WIDTH = 4;
+	typedef __m128 Value;
+	typedef __m128i Bits;
+
+	static Value load(const float* data) { return _mm_loadu_ps(data); }
+	static void store(float* data, Value value) { _mm_storeu_ps(data, value); }
+	static Value splat(float value) { return _mm_set1_ps(value); }
+	static Value min(Value a, Value b) { return _mm_min_ps(a, b); }
+	static Value max(Value a, Value b) { return _mm_max_ps(a, b); }
+	static Value sub(Value a, Value b) { return _mm_sub_ps(a, b); }
+	static Bits less(Value a, Value b) { return _mm_castps_si128(_mm_cmplt_ps(a, b)); }
+	static Bits lessEqual(Value a, Value b) { return _mm_castps_si128(_mm_cmple_ps(a, b)); }
+	static Bits greater(Value a, Value b) { return _mm_castps_si128(_mm_cmpgt_ps(a, b)); }
+	static Value select(Bits mask, Value a, Value b) {
+		__m128 lanes = _mm_castsi128_ps(mask);
+		return _mm_or_ps(_mm_andnot_ps(lanes, a), _mm_and_ps(lanes, b));
+	}
+
+	static Bits loadBits(const uint32_t* data) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(data)); }
+	static void storeBits(uint32_t* data, Bits value) { _mm_storeu_si128(reinterpret_cast<__m128i*>(data), value); }
+	static Bits splatBits(uint32_t value) { return _mm_set1_epi32(static_cast<int>(value)); }
+	static Bits orBits(Bits a, Bits b) { return _mm_or_si128(a, b); }
+	static Bits andNotBits(Bits a, Bits b) { return _mm_andnot_si128(a, b); }
+	static Bits equal(Bits a, Bits b) { return _mm_cmpeq_epi32(a, b); }
+	static Bits selectBits(Bits mask, Bits a, Bits b) { return _mm_or_si128(_mm_andnot_si128(mask, a), _mm_and_si128(mask, b)); }
+	static bool any(Bits mask) { return _mm_movemask_epi8(mask) != 0; }
+};
+#else
+typedef ScalarSubtileLanes SimdSubtileLanes;
+#endif
+
+// Merges a triangle's coverage and farthest depth into the eight subtiles of a tile. A subtile keeps
+// zMax0, a bound for all its pixels, and zMax1, a bound for the pixels in its mask (the working layer).
+template <typename L>
+static void updateSubtiles(uint32_t* tileMask, float* tileZMax0, float* tileZMax1, const uint32_t* coverage, const float* depth) {
+	const typename L::Bits zero = L::splatBits(0);
+	const typename L::Bits full = L::splatBits(FULL_MASK);
+
+	for (uint32_t s = 0; s < SUBTILE_COUNT; s += L::WIDTH) {
+		typename L::Bits covered = L::loadBits(coverage + s);
+		typename L::Value triangleZ = L::load(depth + s);
+		typename L::Bits mask = L::loadBits(tileMask + s);
+		typename L::Value zMax0 = L::load(tileZMax0 + s);
+		typename L::Value zMax1 = L::load(tileZMax1 + s);
+
+		// Subtiles the triangle misses or where it lies behind the whole-subtile bound stay as they are.
+		typename L::Bits live = L::andNotBits(L::equal(covered, zero), L::less(triangleZ, zMax0));
+		if (!L::any(live)) {
+			continue;
+		}
+
+		// Merging widens the working layer to the farther of the two depths. When the triangle is closer
+		// to the reference bound than to the working layer, the old working layer is dropped instead;
+		// its pixels fall back to zMax0, which still bounds them.
+		typename L::Value distance0 = L::sub(zMax0, triangleZ);
+		typename L::Value distance1 = L::max(L::sub(zMax1, triangleZ), L::sub(triangleZ, zMax1));
+		typename L::Bits discard = L::andNotBits(L::equal(mask, zero), L::greater(distance1, distance0));
+
+		typename L::Bits workingMask = L::andNotBits(discard, mask);
+		typename L::Value workingZ = L::select(L::equal(workingMask, zero), L::max(zMax1, triangleZ), triangleZ);
+		workingMask = L::orBits(workingMask, covered);
+
+		// A fully covered subtile folds the working layer into the reference bound and starts a new one.
+		typename L::Bits complete = L::equal(workingMask, full);
+		typename L::Value newZMax0 = L::select(complete, zMax0, L::min(zMax0, workingZ));
+		workingZ = L::select(complete, workingZ, L::splat(0.0f));
+		workingMask = L::andNotBits(complete, workingMask);
+
+		L::storeBits(tileMask + s, L::selectBits(live, mask, workingMask));
+		L::store(tileZMax0 + s, L::select(live, zMax0, newZMax0));
+		L::store(tileZMax1 + s, L::select(live, zMax1, workingZ));
+	}
+}
+
+// True when some pixel of the rect masks may show an object whose nearest depth is nearestZ.
+template <typename L>
+static bool anySubtileVisible(
+	const uint32_t* tileMask, const float* tileZMax0, const float* tileZMax1, const uint32_t* rectMask, float nearestZ) {
+	const typename L::Bits zero = L::splatBits(0);
+	const typename L::Value objectZ = L::splat(nearestZ);
+
+	for (uint32_t s = 0; s < SUBTILE_COUNT; s += L::WIDTH) {
+		typename L::Bits rect = L::loadBits(rectMask + s);
+		typename L::Bits mask = L::loadBits(tileMask + s);
+		typename L::Value zMax0 = L::load(tileZMax0 + s);
+		typename L::Value zMax1 = L::load(tileZMax1 + s);
+
+		// Only when every touched pixel is in the working layer does its nearer bound apply.
+		typename L::Bits onlyMasked = L::equal(L::andNotBits(mask, rect), zero);
+		typename L::Value bound = L::select(onlyMasked, zMax0, L::min(zMax0, zMax1));
+		typename L::Bits visible = L::andNotBits(L::equal(rect, zero), L::lessEqual(objectZ, bound));
+
+		if (L::any(visible)) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Turns the pixel spans of a tile's eight rows, relative to the tile, into its subtile masks.
+// Bit (row % 4) * 8 + column of a subtile's mask is one pixel.
+static void buildCoverage(const int32_t spanStart[MASKED_OCCLUSION_TILE_HEIGHT], const int32_t spanEnd[MASKED_OCCLUSION_TILE_HEIGHT], uint32_t coverage[SUBTILE_COUNT]) {
+	for (uint32_t s = 0; s < SUBTILE_COUNT; s++) {
+		coverage[s] = 0;
+	}
+
+	for (uint32_t row = 0; row < MASKED_OCCLUSION_TILE_HEIGHT; row++) {
+		int32_t start = std::max(spanStart[row], 0);
+		int32_t end = std::min(spanEnd[row], static_cast<int32_t>(MASKED_OCCLUSION_TILE_WIDTH));
+		if (start >= end) {
+			continue;
+		}
+
+		uint32_t bits = (end == 32 ? FULL_MASK : (1u << end) - 1u) & ~((1u << start) - 1u);
+		uint32_t* rowCoverage = coverage + (row / SUBTILE_HEIGHT) * (MASKED_OCCLUSION_TILE_WIDTH / SUBTILE_WIDTH);
+		uint32_t shift = (row % SUBTILE_HEIGHT) * SUBTILE_WIDTH;
+		for (uint32_t column = 0; column < MASKED_OCCLUSION_TILE_WIDTH / SUBTILE_WIDTH; column++) {
+			rowCoverage[column] |= ((bits >> (column * SUBTILE_WIDTH)) & 0xFFu) << shift;
+		}
+	}
+}
+
+static void transformPoint(const float matrix[16], const float point[3], float outClip[4]) {
+	for (uint32_t row = 0; row < 4; row++) {
+		const float* m = matrix + row * 4;
+		outClip[row] = m[0] * point[0] + m[1] * point[1] + m[2] * point[2] + m[3];
+	}
+}
+
+QMaskedOcclusion::QMaskedOcclusion(uint32_t width, uint32_t height) {
+	// Nothing is culled until a view is set.
+	for (uint32_t i = 0; i < 16; i++) {
+		this->_viewProjection[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+	}
+
+	this->resize(width, height);
+}
+
+void QMaskedOcclusion::resize(uint32_t width, uint32_t height) {
+	if (width == 0 || height == 0 || width % MASKED_OCCLUSION_TILE_WIDTH != 0 || height % MASKED_OCCLUSION_TILE_HEIGHT != 0) {
+		ThrowErr::runtime("Masked occlusion size must be a non-zero multiple of the 32x8 tile!..");
+	}
+
+	this->_width = width;
+	this->_height = height;
+	this->_tilesX = width / MASKED_OCCLUSION_TILE_WIDTH;
+	this->_tilesY = height / MASKED_OCCLUSION_TILE_HEIGHT;
+	this->_tiles.resize(this->_tilesX * this->_tilesY);
+
+	this->clear();
+}
+
+void QMaskedOcclusion::setViewProjection(const float viewProjection[16]) {
+	memcpy(this->_viewProjection, viewProjection, sizeof(this->_viewProjection));
+}
+
+void QMaskedOcclusion::clear() {
+	for (Tile& tile : this->_tiles) {
+		for (uint32_t s = 0; s < SUBTILE_COUNT; s++) {
+			tile.mask[s] = 0;
+			tile.zMax0[s] = 1.0f;
+			tile.zMax1[s] = 0.0f;
+		}
+		tile.zMin = 1.0f;
+		tile.zMax = 1.0f;
+	}
+
+	this->_occluders.clear();
+	this->_triangleCount = 0;
+}
+
+void QMaskedOcclusion::addOccluder(
+	const float* positions, const uint32_t* indices, uint32_t triangleCount, const float* transform, bool backfaceCull) {
+	if (triangleCount == 0) {
+		return;
+	}
+
+	Occluder occluder;
+	occluder.positions = positions;
+	occluder.indices = indices;
+	occluder.triangleCount = triangleCount;
+	occluder.firstTriangle = this->_triangleCount;
+	occluder.backfaceCull = backfaceCull;
+
+	// The view-projection is folded into the object's 3x4 transform (row-major, like VulkanGpuInstance).
+	if (transform == nullptr) {
+		memcpy(occluder.transform, this->_viewProjection, sizeof(occluder.transform));
+	}
+	else {
+		for (uint32_t row = 0; row < 4; row++) {
+			for (uint32_t column = 0; column < 4; column++) {
+				float value = column == 3 ? this->_viewProjection[row * 4 + 3] : 0.0f;
+				for (uint32_t k = 0; k < 3; k++) {
+					value += this->_viewProjection[row * 4 + k] * transform[k * 4 + column];
+				}
+				occluder.transform[row * 4 + column] = value;
+			}
+		}
+	}
+
+	this->_occluders.push_back(occluder);
+	this->_triangleCount += triangleCount;
+}
+
+void QMaskedOcclusion::render(QJobSystem* jobSystem) {
+	QAllocScope allocScope(QAllocTag::CULLING);
+	auto start = std::chrono::steady_clock::now();
+
+	this->_chunkCount = (this->_triangleCount + MASKED_OCCLUSION_SETUP_CHUNK - 1) / MASKED_OCCLUSION_SETUP_CHUNK;
+	if (this->_chunks.size() < this->_chunkCount) {
+		this->_chunks.resize(this->_chunkCount);
+	}
+
+	// Setup and binning per chunk of triangles, then rasterization per tile row: a row only ever sees
+	// its own tiles, and it visits the chunks in order, so the merge order matches a serial render.
+	jobSystem->parallelFor(this->_chunkCount, 1, [this](uint32_t begin, uint32_t end, uint32_t) {
+		for (uint32_t chunk = begin; chunk < end; chunk++) {
+			this->_setupChunk(chunk);
+		}
+	});
+
+	jobSystem->parallelFor(this->_tilesY, 1, [this](uint32_t begin, uint32_t end, uint32_t) {
+		for (uint32_t tileRow = begin; tileRow < end; tileRow++) {
+			this->_rasterizeRow(tileRow);
+		}
+	});
+
+	uint32_t rasterizedTriangles = 0;
+	for (uint32_t chunk = 0; chunk < this->_chunkCount; chunk++) {
+		rasterizedTriangles += static_cast<uint32_t>(this->_chunks[chunk].triangles.size());
+	}
+
+	std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+	this->_stats.occluderTriangles = this->_triangleCount;
+	this->_stats.rasterizedTriangles = rasterizedTriangles;
+	this->_stats.workerCount = jobSystem->getWorkerCount();
+	this->_stats.simdWidth = SimdSubtileLanes::WIDTH;
+	this->_stats.renderMs = elapsed.count();
+
+	// The depth stays; the next render() adds to it until clear().
+	this->_occluders.clear();
+	this->_triangleCount = 0;
+}
+
+QOcclusionResult QMaskedOcclusion::testAabb(const QBVHBounds& bounds) const {
+	float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f;
+	float nearestZ = 1e30f;
+
+	// The projection is linear, so each corner is the min corner plus the edges it reaches along.
+	float base[4];
+	float edges[3][4];
+	transformPoint(this->_viewProjection, bounds.min, base);
+	for (uint32_t axis = 0; axis < 3; axis++) {
+		float extent = bounds.max[axis] - bounds.min[axis];
+		for (uint32_t row = 0; row < 4; row++) {
+			edges[axis][row] = this->_viewProjection[row * 4 + axis] * extent;
+		}
+	}
+
+	for (uint32_t corner = 0; corner < 8; corner++) {
+		float clip[4];
+		for (uint32_t row = 0; row < 4; row++) {
+			clip[row] = base[row] + ((corner & 1) ? edges[0][row] : 0.0f) + ((corner & 2) ? edges[1][row] : 0.0f) +
+				((corner & 4) ? edges[2][row] : 0.0f);
+		}
+
+		// Reaches in front of the near plane: nothing rasterized there can hide it.
+		if (clip[2] < 0.0f || clip[3] <= 0.0f) {
+			return QOcclusionResult::VISIBLE;
+		}
+
+		float inverseW = 1.0f / clip[3];
+		minX = std::min(minX, clip[0] * inverseW);
+		maxX = std::max(maxX, clip[0] * inverseW);
+		minY = std::min(minY, clip[1] * inverseW);
+		maxY = std::max(maxY, clip[1] * inverseW);
+		nearestZ = std::min(nearestZ, clip[2] * inverseW);
+	}
+
+	if (maxX < -1.0f || minX > 1.0f || maxY < -1.0f || minY > 1.0f || nearestZ > 1.0f) {
+		return QOcclusionResult::VIEW_CULLED;
+	}
+
+	// Every pixel the box overlaps, not only those whose centers it covers.
+	float width = static_cast<float>(this->_width);
+	float height = static_cast<float>(this->_height);
+	int32_t pixelX0 = static_cast<int32_t>(std::floor(std::min(std::max((minX * 0.5f + 0.5f) * width, 0.0f), width)));
+	int32_t pixelX1 = static_cast<int32_t>(std::ceil(std::min(std::max((maxX * 0.5f + 0.5f) * width, 0.0f), width)));
+	int32_t pixelY0 = static_cast<int32_t>(std::floor(std::min(std::max((minY * 0.5f + 0.5f) * height, 0.0f), height)));
+	int32_t pixelY1 = static_cast<int32_t>(std::ceil(std::min(std::max((maxY * 0.5f + 0.5f) * height, 0.0f), height)));
+
+	int32_t screenWidth = static_cast<int32_t>(this->_width);
+	int32_t screenHeight = static_cast<int32_t>(this->_height);
+	pixelX0 = std::min(pixelX0, screenWidth - 1);
+	pixelY0 = std::min(pixelY0, screenHeight - 1);
+	pixelX1 = std::max(pixelX1, pixelX0 + 1);
+	pixelY1 = std::max(pixelY1, pixelY0 + 1);
+
+	const int32_t tileWidth = static_cast<int32_t>(MASKED_OCCLUSION_TILE_WIDTH);
+	const int32_t tileHeight = static_cast<int32_t>(MASKED_OCCLUSION_TILE_HEIGHT);
+
+	for (int32_t tileRow = pixelY0 / tileHeight; tileRow <= (pixelY1 - 1) / tileHeight; tileRow++) {
+		int32_t tileY = tileRow * tileHeight;
+
+		for (int32_t tileColumn = pixelX0 / tileWidth; tileColumn <= (pixelX1 - 1) / tileWidth; tileColumn++) {
+			int32_t tileX = tileColumn * tileWidth;
+
+			// Every tile visited holds at least one pixel of the box.
+			const Tile& tile = this->_tiles[tileRow * this->_tilesX + tileColumn];
+			if (nearestZ > tile.zMax) {
+				continue;
+			}
+			if (nearestZ <= tile.zMin) {
+				return QOcclusionResult::VISIBLE;
+			}
+
+			int32_t spanStart[MASKED_OCCLUSION_TILE_HEIGHT];
+			int32_t spanEnd[MASKED_OCCLUSION_TILE_HEIGHT];
+			for (int32_t row = 0; row < tileHeight; row++) {
+				bool inside = tileY + row >= pixelY0 && tileY + row < pixelY1;
+				spanStart[row] = inside ? pixelX0 - tileX : 0;
+				spanEnd[row] = inside ? pixelX1 - tileX : 0;
+			}
+
+			uint32_t rectMask[SUBTILE_COUNT];
+			buildCoverage(spanStart, spanEnd, rectMask);
+
+			if (anySubtileVisible<SimdSubtileLanes>(tile.mask, tile.zMax0, tile.zMax1, rectMask, nearestZ)) {
+				return QOcclusionResult::VISIBLE;
+			}
+		}
+	}
+
+	return QOcclusionResult::OCCLUDED;
+}
+
+void QMaskedOcclusion::testAabbs(const QBVHBounds* bounds, uint32_t count, QJobSystem* jobSystem, std::vector<uint32_t>& outVisible) {
+	QAllocScope allocScope(QAllocTag::CULLING);
+	auto start = std::chrono::steady_clock::now();
+
+	uint32_t chunkCount = (count + MASKED_OCCLUSION_TEST_CHUNK - 1) / MASKED_OCCLUSION_TEST_CHUNK;
+	this->_testVisible.resize(count);
+	this->_testCounts.assign(chunkCount, 0);
+	this->_testOccluded.assign(chunkCount, 0);
+
+	// Each chunk writes its visible indices at its own offset, so no two workers share anything.
+	jobSystem->parallelFor(chunkCount, 1, [this, bounds, count](uint32_t begin, uint32_t end, uint32_t) {
+		for (uint32_t chunk = begin; chunk < end; chunk++) {
+			uint32_t first = chunk * MASKED_OCCLUSION_TEST_CHUNK;
+			uint32_t last = std::min(first + MASKED_OCCLUSION_TEST_CHUNK, count);
+			uint32_t* out = this->_testVisible.data() + first;
+
+			uint32_t visibleCount = 0;
+			uint32_t occludedCount = 0;
+			for (uint32_t i = first; i < last; i++) {
+				QOcclusionResult result = this->testAabb(bounds[i]);
+				if (result == QOcclusionResult::VISIBLE) {
+					out[visibleCount++] = i;
+				}
+				else if (result == QOcclusionResult::OCCLUDED) {
+					occludedCount++;
+				}
+			}
+
+			this->_testCounts[chunk] = visibleCount;
+			this->_testOccluded[chunk] = occludedCount;
+		}
+	});
+
+	outVisible.clear();
+	uint32_t occludedCount = 0;
+	for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+		const uint32_t* first = this->_testVisible.data() + chunk * MASKED_OCCLUSION_TEST_CHUNK;
+		outVisible.insert(outVisible.end(), first, first + this->_testCounts[chunk]);
+		occludedCount += this->_testOccluded[chunk];
+	}
+
+	std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+	this->_stats.testedObjects = count;
+	this->_stats.visibleObjects = static_cast<uint32_t>(outVisible.size());
+	this->_stats.occludedObjects = occludedCount;
+	this->_stats.workerCount = jobSystem->getWorkerCount();
+	this->_stats.simdWidth = SimdSubtileLanes::WIDTH;
+	this->_stats.testMs = elapsed.count();
+}
+
+void QMaskedOcclusion::readDepth(std::vector<float>& outDepth) const {
+	// The bound each pixel is tested against, row by row; 1 where nothing was rasterized.
+	outDepth.resize(this->_width * this->_height);
+
+	for (uint32_t y = 0; y < this->_height; y++) {
+		for (uint32_t x = 0; x < this->_width; x++) {
+			const Tile& tile = this->_tiles[(y / MASKED_OCCLUSION_TILE_HEIGHT) * this->_tilesX + x / MASKED_OCCLUSION_TILE_WIDTH];
+			uint32_t localX = x % MASKED_OCCLUSION_TILE_WIDTH;
+			uint32_t localY = y % MASKED_OCCLUSION_TILE_HEIGHT;
+			uint32_t subtile = (localY / SUBTILE_HEIGHT) * (MASKED_OCCLUSION_TILE_WIDTH / SUBTILE_WIDTH) + localX / SUBTILE_WIDTH;
+			uint32_t bit = (localY % SUBTILE_HEIGHT) * SUBTILE_WIDTH + localX % SUBTILE_WIDTH;
+
+			bool masked = (tile.mask[subtile] >> bit) & 1u;
+			outDepth[y * this->_width + x] = masked ? std::min(tile.zMax0[subtile], tile.zMax1[subtile]) : tile.zMax0[subtile];
+		}
+	}
+}
+
+uint32_t QMaskedOcclusion::getWidth() const {
+	return this->_width;
+}
+
+uint32_t QMaskedOcclusion::getHeight() const {
+	return this->_height;
+}
+
+QMaskedOcclusionStats QMaskedOcclusion::getStats() const {
+	return this->_stats;
+}
+
+uint32_t QMaskedOcclusion::getSimdWidth() {
+	return SimdSubtileLanes::WIDTH;
+}
+
+void QMaskedOcclusion::_setupChunk(uint32_t chunk) {
+	SetupChunk& out = this->_chunks[chunk];
+	out.triangles.clear();
+	out.bins.resize(this->_tilesY);
+	for (std::vector<uint32_t>& bin : out.bins) {
+		bin.clear();
+	}
+
+	uint32_t first = chunk * MASKED_OCCLUSION_SETUP_CHUNK;
+	uint32_t last = std::min(first + MASKED_OCCLUSION_SETUP_CHUNK, this->_triangleCount);
+
+	// The occluder holding the chunk's first triangle; later ones follow in order.
+	auto occluder = std::upper_bound(this->_occluders.begin(), this->_occluders.end(), first,
+		[](uint32_t triangle, const Occluder& candidate) { return triangle < candidate.firstTriangle; }) - 1;
+
+	for (uint32_t triangle = first; triangle < last; triangle++) {
+		while (triangle >= occluder->firstTriangle + occluder->triangleCount) {
+			++occluder;
+		}
+
+		const uint32_t* indices = occluder->indices + (triangle - occluder->firstTriangle) * 3;
+		float clip[3][4];
+		for (uint32_t vertex = 0; vertex < 3; vertex++) {
+			transformPoint(occluder->transform, occluder->positions + indices[vertex] * 3, clip[vertex]);
+		}
+
+		this->_setupTriangle(clip, occluder->backfaceCull, out);
+	}
+}
+
+void QMaskedOcclusion::_setupTriangle(const float clip[3][4], bool backfaceCull, SetupChunk& outChunk) {
+	// Clip against the near plane (z >= 0); one plane turns a triangle into at most a quad.
+	float polygon[4][4];
+	uint32_t vertexCount = 0;
+	for (uint32_t vertex = 0; vertex < 3; vertex++) {
+		const float* current = clip[vertex];
+		const float* next = clip[(vertex + 1) % 3];
+		bool currentInside = current[2] >= 0.0f;
+		bool nextInside = next[2] >= 0.0f;
+
+		if (currentInside) {
+			memcpy(polygon[vertexCount++], current, sizeof(float) * 4);
+		}
+		if (currentInside != nextInside) {
+			float t = current[2] / (current[2] - next[2]);
+			for (uint32_t i = 0; i < 4; i++) {
+				polygon[vertexCount][i] = current[i] + (next[i] - current[i]) * t;
+			}
+			vertexCount++;
+		}
+	}
+
+	const float width = static_cast<float>(this->_width);
+	const float height = static_cast<float>(this->_height);
+
+	for (uint32_t fan = 1; fan + 1 < vertexCount; fan++) {
+		const float* vertices[3] = { polygon[0], polygon[fan], polygon[fan + 1] };
+
+		float x[3], y[3], z[3];
+		bool behind = false;
+		for (uint32_t vertex = 0; vertex < 3; vertex++) {
+			float w = vertices[vertex][3];
+			behind = behind || w <= 0.0f;
+			float inverseW = w > 0.0f ? 1.0f / w : 0.0f;
+			x[vertex] = (vertices[vertex][0] * inverseW * 0.5f + 0.5f) * width;
+			y[vertex] = (vertices[vertex][1] * inverseW * 0.5f + 0.5f) * height;
+			z[vertex] = vertices[vertex][2] * inverseW;
+		}
+		if (behind) {
+			continue;
+		}
+
+		// Positive area is clockwise on a y-down screen, the pipeline's front face.
+		float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+		if (area <= 0.0f) {
+			if (backfaceCull || area == 0.0f) {
+				continue;
+			}
+			std::swap(x[1], x[2]);
+			std::swap(y[1], y[2]);
+			std::swap(z[1], z[2]);
+			area = -area;
+		}
+
+		float nearestZ = std::min(z[0], std::min(z[1], z[2]));
+		if (nearestZ > 1.0f) {
+			continue;
+		}
+
+		// Pixels whose centers can fall inside, clamped before the conversion so huge guard-band values stay valid.
+		float boundsMinX = std::min(x[0], std::min(x[1], x[2]));
+		float boundsMaxX = std::max(x[0], std::max(x[1], x[2]));
+		float boundsMinY = std::min(y[0], std::min(y[1], y[2]));
+		float boundsMaxY = std::max(y[0], std::max(y[1], y[2]));
+
+		SetupTriangle setup;
+		setup.minX = static_cast<int32_t>(std::ceil(std::min(std::max(boundsMinX - 0.5f, 0.0f), width)));
+		setup.maxX = static_cast<int32_t>(std::floor(std::min(std::max(boundsMaxX - 0.5f, -1.0f), width - 1.0f))) + 1;
+		setup.minY = static_cast<int32_t>(std::ceil(std::min(std::max(boundsMinY - 0.5f, 0.0f), height)));
+		setup.maxY = static_cast<int32_t>(std::floor(std::min(std::max(boundsMaxY - 0.5f, -1.0f), height - 1.0f))) + 1;
+		if (setup.minX >= setup.maxX || setup.minY >= setup.maxY) {
+			continue;
+		}
+
+		// Edge i runs from vertex i to the next one; a*x + b*y + c is positive inside.
+		for (uint32_t edge = 0; edge < 3; edge++) {
+			uint32_t next = (edge + 1) % 3;
+			setup.edgeA[edge] = y[edge] - y[next];
+			setup.edgeB[edge] = x[next] - x[edge];
+			setup.edgeC[edge] = -(setup.edgeA[edge] * x[edge] + setup.edgeB[edge] * y[edge]);
+		}
+
+		setup.depthOrigin[0] = x[0];
+		setup.depthOrigin[1] = y[0];
+		setup.depthOrigin[2] = z[0];
+		setup.depthDx = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+		setup.depthDy = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+		setup.depthMax = std::max(z[0], std::max(z[1], z[2]));
+
+		uint32_t index = static_cast<uint32_t>(outChunk.triangles.size());
+		outChunk.triangles.push_back(setup);
+
+		uint32_t firstRow = static_cast<uint32_t>(setup.minY) / MASKED_OCCLUSION_TILE_HEIGHT;
+		uint32_t lastRow = static_cast<uint32_t>(setup.maxY - 1) / MASKED_OCCLUSION_TILE_HEIGHT;
+		for (uint32_t row = firstRow; row <= lastRow; row++) {
+			outChunk.bins[row].push_back(index);
+		}
+	}
+}
+
+void QMaskedOcclusion::_rasterizeRow(uint32_t tileRow) {
+	for (uint32_t chunk = 0; chunk < this->_chunkCount; chunk++) {
+		const SetupChunk& setup = this->_chunks[chunk];
+		for (uint32_t index : setup.bins[tileRow]) {
+			this->_rasterizeTriangle(setup.triangles[index], tileRow);
+		}
+	}
+
+	// A pixel outside the working layer is bounded by zMax0, one inside it by the nearer of the two.
+	for (uint32_t tileColumn = 0; tileColumn < this->_tilesX; tileColumn++) {
+		Tile& tile = this->_tiles[tileRow * this->_tilesX + tileColumn];
+		tile.zMin = 1.0f;
+		tile.zMax = 0.0f;
+		for (uint32_t s = 0; s < SUBTILE_COUNT; s++) {
+			float nearest = tile.mask[s] != 0 ? std::min(tile.zMax0[s], tile.zMax1[s]) : tile.zMax0[s];
+			tile.zMin = std::min(tile.zMin, nearest);
+			tile.zMax = std::max(tile.zMax, tile.zMax0[s]);
+		}
+	}
+}
+
+void QMaskedOcclusion::_rasterizeTriangle(const SetupTriangle& triangle, uint32_t tileRow) {
+	const int32_t tileWidth = static_cast<int32_t>(MASKED_OCCLUSION_TILE_WIDTH);
+	const int32_t tileY = static_cast<int32_t>(tileRow * MASKED_OCCLUSION_TILE_HEIGHT);
+
+	// The covered pixel span of each row, sampled at pixel centers.
+	int32_t spanStart[MASKED_OCCLUSION_TILE_HEIGHT];
+	int32_t spanEnd[MASKED_OCCLUSION_TILE_HEIGHT];
+	bool anySpan = false;
+
+	for (uint32_t row = 0; row < MASKED_OCCLUSION_TILE_HEIGHT; row++) {
+		int32_t y = tileY + static_cast<int32_t>(row);
+		spanStart[row] = 0;
+		spanEnd[row] = 0;
+		if (y < triangle.minY || y >= triangle.maxY) {
+			continue;
+		}
+
+		float centerY = static_cast<float>(y) + 0.5f;
+		float left = static_cast<float>(triangle.minX);
+		float right = static_cast<float>(triangle.maxX);
+		bool empty = false;
+
+		for (uint32_t edge = 0; edge < 3; edge++) {
+			float a = triangle.edgeA[edge];
+			float offset = triangle.edgeB[edge] * centerY + triangle.edgeC[edge];
+			if (a > 0.0f) {
+				left = std::max(left, std::ceil(-offset / a - 0.5f));
+			}
+			else if (a < 0.0f) {
+				right = std::min(right, std::floor(-offset / a - 0.5f) + 1.0f);
+			}
+			else {
+				empty = empty || offset < 0.0f;
+			}
+		}
+
+		if (!empty && left < right) {
+			spanStart[row] = static_cast<int32_t>(left);
+			spanEnd[row] = static_cast<int32_t>(right);
+			anySpan = true;
+		}
+	}
+
+	if (!anySpan) {
+		return;
+	}
+
+	// The plane's farthest point over each subtile's pixel centers is at the corner its slopes point to.
+	float cornerX = triangle.depthDx > 0.0f ? SUBTILE_WIDTH - 0.5f : 0.5f;
+	float cornerY = triangle.depthDy > 0.0f ? SUBTILE_HEIGHT - 0.5f : 0.5f;
+
+	for (int32_t tileColumn = triangle.minX / tileWidth; tileColumn <= (triangle.maxX - 1) / tileWidth; tileColumn++) {
+		int32_t tileX = tileColumn * tileWidth;
+
+		int32_t localStart[MASKED_OCCLUSION_TILE_HEIGHT];
+		int32_t localEnd[MASKED_OCCLUSION_TILE_HEIGHT];
+		for (uint32_t row = 0; row < MASKED_OCCLUSION_TILE_HEIGHT; row++) {
+			localStart[row] = spanStart[row] - tileX;
+			localEnd[row] = spanEnd[row] - tileX;
+		}
+
+		uint32_t coverage[SUBTILE_COUNT];
+		buildCoverage(localStart, localEnd, coverage);
+
+		uint32_t anyCoverage = 0;
+		float depth[SUBTILE_COUNT];
+		for (uint32_t s = 0; s < SUBTILE_COUNT; s++) {
+			float x = static_cast<float>(tileX + (s % 4) * SUBTILE_WIDTH) + cornerX;
+			float y = static_cast<float>(tileY + (s / 4) * SUBTILE_HEIGHT) + cornerY;
+			float z = triangle.depthOrigin[2] + triangle.depthDx * (x - triangle.depthOrigin[0]) + triangle.depthDy * (y - triangle.depthOrigin[1]);
+			depth[s] = std::min(z, triangle.depthMax);
+			anyCoverage |= coverage[s];
+		}
+
+		if (anyCoverage == 0) {
+			continue;
+		}
+
+		Tile& tile = this->_tiles[tileRow * this->_tilesX + tileColumn];
+		updateSubtiles<SimdSubtileLanes>(tile.mask, tile.zMax0, tile.zMax1, coverage, depth);
+	}
+}
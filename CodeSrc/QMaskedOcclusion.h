@@ -0,0 +1,131 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "QJobSystem.h"
+#include "QBVH.h"
+
+const uint32_t MASKED_OCCLUSION_WIDTH = 512;
+const uint32_t MASKED_OCCLUSION_HEIGHT = 256;
+const uint32_t MASKED_OCCLUSION_TILE_WIDTH = 32;
+const uint32_t MASKED_OCCLUSION_TILE_HEIGHT = 8;
+const uint32_t MASKED_OCCLUSION_SETUP_CHUNK = 1024;
+const uint32_t MASKED_OCCLUSION_TEST_CHUNK = 1024;
+
+enum class QOcclusionResult : uint8_t {
+	VISIBLE = 0,
+	OCCLUDED,
+	VIEW_CULLED
+};
+
+struct QMaskedOcclusionStats {
+	uint32_t occluderTriangles = 0;
+	uint32_t rasterizedTriangles = 0;
+	uint32_t testedObjects = 0;
+	uint32_t visibleObjects = 0;
+	uint32_t occludedObjects = 0;
+	uint32_t workerCount = 0;
+	uint32_t simdWidth = 0;
+	float renderMs = 0.0f;
+	float testMs = 0.0f;
+};
+
+// CPU occlusion culling in the style of masked occlusion culling: a few large occluders are rasterized
+// into a small depth buffer, then object AABBs are tested against it. The buffer is split into 32x8
+// tiles of eight 8x4 subtiles, and a subtile stores no per-pixel depth. It keeps a coverage bit per
+// pixel plus two farthest-depth bounds: one for the whole subtile and one for the pixels in the mask.
+// A triangle is merged into a subtile with a handful of mask and min/max operations, done for several
+// subtiles at once in SIMD registers: eight with AVX2, four with SSE2. MSVC only emits AVX2 with
+// msbuild /p:QEngineAvx2=true. Every bound only ever covers real occluder depth, so the test is
+// conservative: an object is reported occluded only if its nearest depth is behind the bound of every
+// pixel it touches.
+//
+// Depth follows the renderer: clip z in [0, w], far is 1, the matrix is row-major and applies to column
+// vectors, and screen y grows downwards. Front faces are clockwise on screen, as in the graphics pipeline.
+// render() sets up triangles in parallel chunks and bins them to tile rows. Each tile row is then
+// rasterized by one worker in submission order, so the result does not depend on the thread count.
+// Occluder data is referenced, not copied, and must stay alive until render() returns.
+class QMaskedOcclusion {
+public:
+	QMaskedOcclusion(uint32_t width = MASKED_OCCLUSION_WIDTH, uint32_t height = MASKED_OCCLUSION_HEIGHT);
+
+	void resize(uint32_t width, uint32_t height);
+	void setViewProjection(const float viewProjection[16]);
+
+	void clear();
+	void addOccluder(
+		const float* positions, const uint32_t* indices, uint32_t triangleCount,
+		const float* transform = nullptr, bool backfaceCull = true);
+	void render(QJobSystem* jobSystem);
+
+	QOcclusionResult testAabb(const QBVHBounds& bounds) const;
+	void testAabbs(const QBVHBounds* bounds, uint32_t count, QJobSystem* jobSystem, std::vector<uint32_t>& outVisible);
+
+	void readDepth(std::vector<float>& outDepth) const;
+	uint32_t getWidth() const;
+	uint32_t getHeight() const;
+	QMaskedOcclusionStats getStats() const;
+
+	static uint32_t getSimdWidth();
+private:
+	// Structure of arrays so one load fetches the same field of consecutive subtiles. zMin and zMax
+	// bound every pixel's depth bound in the tile, so most object tests never look at the subtiles.
+	struct Tile {
+		uint32_t mask[8];
+		float zMax0[8];
+		float zMax1[8];
+		float zMin;
+		float zMax;
+	};
+
+	struct Occluder {
+		const float* positions;
+		const uint32_t* indices;
+		uint32_t triangleCount;
+		uint32_t firstTriangle;
+		float transform[16];
+		bool backfaceCull;
+	};
+
+	// A screen-space triangle ready to rasterize: edge functions that are positive inside, the depth
+	// plane, and the pixel rectangle it can touch.
+	struct SetupTriangle {
+		float edgeA[3];
+		float edgeB[3];
+		float edgeC[3];
+		float depthOrigin[3];
+		float depthDx;
+		float depthDy;
+		float depthMax;
+		int32_t minX;
+		int32_t maxX;
+		int32_t minY;
+		int32_t maxY;
+	};
+
+	struct SetupChunk {
+		std::vector<SetupTriangle> triangles;
+		std::vector<std::vector<uint32_t>> bins;
+	};
+
+	uint32_t _width = 0;
+	uint32_t _height = 0;
+	uint32_t _tilesX = 0;
+	uint32_t _tilesY = 0;
+	float _viewProjection[16];
+
+	std::vector<Tile> _tiles;
+	std::vector<Occluder> _occluders;
+	uint32_t _triangleCount = 0;
+
+	std::vector<SetupChunk> _chunks;
+	uint32_t _chunkCount = 0;
+	std::vector<uint32_t> _testVisible;
+	std::vector<uint32_t> _testCounts;
+	std::vector<uint32_t> _testOccluded;
+	QMaskedOcclusionStats _stats;
+
+	void _setupChunk(uint32_t chunk);
+	void _setupTriangle(const float clip[3][4], bool backfaceCull, SetupChunk& outChunk);
+	void _rasterizeRow(uint32_t tileRow);
+	void _rasterizeTriangle(const SetupTriangle& triangle, uint32_t tileRow);
+};
@@ -0,0 +1,138 @@
+#include "QMeshDeduplicator.h"
+#include "QAllocTracker.h"
+#include "ThrowErr.h"
+#include <cstring>
+
+const uint64_t MESH_HASH_SEED = 14695981039346656037ull;
+const uint64_t MESH_HASH_PRIME = 1099511628211ull;
+
+// FNV-1a over 8-byte words, with the byte tail folded in one at a time.
+static uint64_t hashBytes(uint64_t hash, const void* data, size_t size) {
+	const uint8_t* bytes = static_cast<const uint8_t*>(data);
+
+	size_t wordCount = size / sizeof(uint64_t);
+	for (size_t i = 0; i < wordCount; i++) {
+		uint64_t word;
+		memcpy(&word, bytes + i * sizeof(uint64_t), sizeof(word));
+		hash ^= word;
+		hash *= MESH_HASH_PRIME;
+	}
+
+	for (size_t i = wordCount * sizeof(uint64_t); i < size; i++) {
+		hash ^= bytes[i];
+		hash *= MESH_HASH_PRIME;
+	}
+
+	return hash;
+}
+
+QMeshDeduplicator::QMeshDeduplicator(uint32_t vertexStride) : _vertexStride{ vertexStride } {
+	if (this->_vertexStride == 0) {
+		ThrowErr::runtime("Mesh deduplicator vertex stride must not be zero!..");
+	}
+}
+
+uint32_t QMeshDeduplicator::add(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount) {
+	QAllocScope allocScope(QAllocTag::LOADING);
+	if (vertexCount == 0 || indexCount == 0) {
+		ThrowErr::runtime("Failed to add a mesh: it has no vertices or indices!..");
+	}
+
+	uint32_t vertexBytes = vertexCount * this->_vertexStride;
+	uint64_t hash = QMeshDeduplicator::hashMesh(vertices, vertexBytes, indices, indexCount);
+
+	this->_stats.addedMeshes++;
+	this->_stats.addedBytes += vertexBytes + sizeof(uint32_t) * indexCount;
+
+	auto range = this->_meshesByHash.equal_range(hash);
+	for (auto it = range.first; it != range.second; ++it) {
+		QUniqueMesh& mesh = this->_meshes[it->second];
+		if (this->_matches(mesh, vertices, vertexCount, indices, indexCount)) {
+			mesh.referenceCount++;
+			return it->second;
+		}
+	}
+
+	for (uint32_t i = 0; i < indexCount; i++) {
+		if (indices[i] >= vertexCount) {
+			ThrowErr::runtime("Failed to add a mesh: an index is out of its vertex range!..");
+		}
+	}
+
+	QUniqueMesh mesh;
+	mesh.firstVertex = static_cast<uint32_t>(this->_vertexData.size() / this->_vertexStride);
+	mesh.vertexCount = vertexCount;
+	mesh.firstIndex = static_cast<uint32_t>(this->_indexData.size());
+	mesh.indexCount = indexCount;
+	mesh.hash = hash;
+	mesh.referenceCount = 1;
+
+	const uint8_t* vertexBytesBegin = static_cast<const uint8_t*>(vertices);
+	this->_vertexData.insert(this->_vertexData.end(), vertexBytesBegin, vertexBytesBegin + vertexBytes);
+	this->_indexData.insert(this->_indexData.end(), indices, indices + indexCount);
+
+	uint32_t meshIndex = static_cast<uint32_t>(this->_meshes.size());
+	this->_meshes.push_back(mesh);
+	this->_meshesByHash.emplace(hash, meshIndex);
+
+	this->_stats.uniqueMeshes++;
+	this->_stats.storedBytes += vertexBytes + sizeof(uint32_t) * indexCount;
+
+	return meshIndex;
+}
+
+void QMeshDeduplicator::clear() {
+	this->_vertexData.clear();
+	this->_indexData.clear();
+	this->_meshes.clear();
+	this->_meshesByHash.clear();
+	this->_stats = QMeshDeduplicatorStats();
+}
+
+uint32_t QMeshDeduplicator::getMeshCount() const {
+	return static_cast<uint32_t>(this->_meshes.size());
+}
+
+const QUniqueMesh& QMeshDeduplicator::getMesh(uint32_t meshIndex) const {
+	if (meshIndex >= this->_meshes.size()) {
+		ThrowErr::runtime("Invalid deduplicated mesh index!..");
+	}
+
+	return this->_meshes[meshIndex];
+}
+
+const std::vector<uint8_t>& QMeshDeduplicator::getVertexData() const {
+	return this->_vertexData;
+}
+
+const std::vector<uint32_t>& QMeshDeduplicator::getIndexData() const {
+	return this->_indexData;
+}
+
+uint32_t QMeshDeduplicator::getVertexStride() const {
+	return this->_vertexStride;
+}
+
+QMeshDeduplicatorStats QMeshDeduplicator::getStats() const {
+	return this->_stats;
+}
+
+uint64_t QMeshDeduplicator::hashMesh(const void* vertices, uint32_t vertexBytes, const uint32_t* indices, uint32_t indexCount) {
+	// The sizes go in first so the same bytes split differently between vertices and indices hash apart.
+	uint64_t sizes[2] = { vertexBytes, indexCount };
+
+	uint64_t hash = hashBytes(MESH_HASH_SEED, sizes, sizeof(sizes));
+	hash = hashBytes(hash, vertices, vertexBytes);
+	return hashBytes(hash, indices, sizeof(uint32_t) * indexCount);
+}
+
+bool QMeshDeduplicator::_matches(
+	const QUniqueMesh& mesh, const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount) const {
+	if (mesh.vertexCount != vertexCount || mesh.indexCount != indexCount) {
+		return false;
+	}
+
+	const uint8_t* storedVertices = this->_vertexData.data() + static_cast<size_t>(mesh.firstVertex) * this->_vertexStride;
+	return memcmp(storedVertices, vertices, static_cast<size_t>(vertexCount) * this->_vertexStride) == 0 &&
+		memcmp(this->_indexData.data() + mesh.firstIndex, indices, sizeof(uint32_t) * indexCount) == 0;
+}
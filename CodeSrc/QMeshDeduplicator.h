@@ -0,0 +1,55 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// One distinct mesh in the deduplicator's packed data. Indices are relative to firstVertex, so a draw
+// uses firstVertex as its vertex offset.
+struct QUniqueMesh {
+	uint32_t firstVertex = 0;
+	uint32_t vertexCount = 0;
+	uint32_t firstIndex = 0;
+	uint32_t indexCount = 0;
+	uint64_t hash = 0;
+	uint32_t referenceCount = 0;
+};
+
+struct QMeshDeduplicatorStats {
+	uint32_t addedMeshes = 0;
+	uint32_t uniqueMeshes = 0;
+	uint64_t addedBytes = 0;
+	uint64_t storedBytes = 0;
+};
+
+// Load-time geometry deduplication: submeshes with byte-identical vertex and index data are stored once
+// and every later copy gets the first one's index, so a scene can place the shared mesh with one
+// transform per copy instead of repeating its geometry. Meshes are found by a 64-bit content hash and
+// confirmed by comparing the data, so a hash collision never merges two different meshes. All meshes
+// share one vertex layout of vertexStride bytes; the packed vertex and index data are ready to upload
+// as a single pair of buffers.
+class QMeshDeduplicator {
+public:
+	QMeshDeduplicator(uint32_t vertexStride);
+
+	uint32_t add(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+	void clear();
+
+	uint32_t getMeshCount() const;
+	const QUniqueMesh& getMesh(uint32_t meshIndex) const;
+	const std::vector<uint8_t>& getVertexData() const;
+	const std::vector<uint32_t>& getIndexData() const;
+	uint32_t getVertexStride() const;
+	QMeshDeduplicatorStats getStats() const;
+
+	static uint64_t hashMesh(const void* vertices, uint32_t vertexBytes, const uint32_t* indices, uint32_t indexCount);
+private:
+	uint32_t _vertexStride;
+
+	std::vector<uint8_t> _vertexData;
+	std::vector<uint32_t> _indexData;
+	std::vector<QUniqueMesh> _meshes;
+	std::unordered_multimap<uint64_t, uint32_t> _meshesByHash;
+	QMeshDeduplicatorStats _stats;
+
+	bool _matches(const QUniqueMesh& mesh, const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount) const;
+};
@@ -0,0 +1,106 @@
+#include "QRadixSort.h"
+#include <algorithm>
+#include <cstring>
+
+QRadixSort::QRadixSort(uint32_t minBlockSize) : _minBlockSize{ std::max<uint32_t>(minBlockSize, 1) } {}
+
+void QRadixSort::sort(uint64_t* keys, uint32_t* values, uint32_t count, QJobSystem* jobSystem) {
+	this->_lastPassCount = 0;
+	if (count < 2) {
+		return;
+	}
+
+	// Small inputs stay in one block; larger ones get one block per worker but never tiny ones.
+	uint32_t workerCount = jobSystem->getWorkerCount();
+	uint32_t blockSize = std::max(this->_minBlockSize, (count + workerCount - 1) / workerCount);
+	uint32_t blockCount = (count + blockSize - 1) / blockSize;
+
+	this->_keyScratch.resize(count);
+	this->_valueScratch.resize(count);
+	this->_histograms.resize(blockCount * RADIX_SORT_BUCKETS);
+	this->_blockDifferences.resize(blockCount);
+
+	// Bits that differ from the first key anywhere; a byte with none of them set needs no pass.
+	const uint64_t firstKey = keys[0];
+	jobSystem->parallelFor(blockCount, 1, [&](uint32_t begin, uint32_t end, uint32_t) {
+		for (uint32_t block = begin; block < end; block++) {
+			uint32_t first = block * blockSize;
+			uint32_t last = std::min(first + blockSize, count);
+
+			uint64_t differences = 0;
+			for (uint32_t i = first; i < last; i++) {
+				differences |= keys[i] ^ firstKey;
+			}
+			this->_blockDifferences[block] = differences;
+		}
+	});
+
+	uint64_t differences = 0;
+	for (uint64_t blockDifferences : this->_blockDifferences) {
+		differences |= blockDifferences;
+	}
+
+	uint64_t* sourceKeys = keys;
+	uint32_t* sourceValues = values;
+	uint64_t* destinationKeys = this->_keyScratch.data();
+	uint32_t* destinationValues = this->_valueScratch.data();
+
+	for (uint32_t shift = 0; shift < 64; shift += RADIX_SORT_DIGIT_BITS) {
+		if (((differences >> shift) & (RADIX_SORT_BUCKETS - 1)) == 0) {
+			continue;
+		}
+
+		jobSystem->parallelFor(blockCount, 1, [&](uint32_t begin, uint32_t end, uint32_t) {
+			for (uint32_t block = begin; block < end; block++) {
+				uint32_t first = block * blockSize;
+				uint32_t last = std::min(first + blockSize, count);
+
+				uint32_t* histogram = this->_histograms.data() + block * RADIX_SORT_BUCKETS;
+				memset(histogram, 0, sizeof(uint32_t) * RADIX_SORT_BUCKETS);
+				for (uint32_t i = first; i < last; i++) {
+					histogram[(sourceKeys[i] >> shift) & (RADIX_SORT_BUCKETS - 1)]++;
+				}
+			}
+		});
+
+		// Digit-major, block-minor: a block's keys land after every smaller digit and after the same
+		// digit from earlier blocks, which is what keeps the sort stable.
+		uint32_t offset = 0;
+		for (uint32_t digit = 0; digit < RADIX_SORT_BUCKETS; digit++) {
+			for (uint32_t block = 0; block < blockCount; block++) {
+				uint32_t& bucket = this->_histograms[block * RADIX_SORT_BUCKETS + digit];
+				uint32_t bucketCount = bucket;
+				bucket = offset;
+				offset += bucketCount;
+			}
+		}
+
+		jobSystem->parallelFor(blockCount, 1, [&](uint32_t begin, uint32_t end, uint32_t) {
+			for (uint32_t block = begin; block < end; block++) {
+				uint32_t first = block * blockSize;
+				uint32_t last = std::min(first + blockSize, count);
+
+				uint32_t* offsets = this->_histograms.data() + block * RADIX_SORT_BUCKETS;
+				for (uint32_t i = first; i < last; i++) {
+					uint32_t destination = offsets[(sourceKeys[i] >> shift) & (RADIX_SORT_BUCKETS - 1)]++;
+					destinationKeys[destination] = sourceKeys[i];
+					destinationValues[destination] = sourceValues[i];
+				}
+			}
+		});
+
+		std::swap(sourceKeys, destinationKeys);
+		std::swap(sourceValues, destinationValues);
+		this->_lastPassCount++;
+	}
+
+	// An odd number of passes leaves the result in scratch.
+	if (sourceKeys != keys) {
+		memcpy(keys, sourceKeys, sizeof(uint64_t) * count);
+		memcpy(values, sourceValues, sizeof(uint32_t) * count);
+	}
+}
+
+uint32_t QRadixSort::getLastPassCount() const {
+	return this->_lastPassCount;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "QJobSystem.h"
+
+const uint32_t RADIX_SORT_MIN_BLOCK_SIZE = 16384;
+const uint32_t RADIX_SORT_DIGIT_BITS = 8;
+const uint32_t RADIX_SORT_BUCKETS = 1u << RADIX_SORT_DIGIT_BITS;
+
+// Stable LSD radix sort of 64-bit keys carrying 32-bit values, one byte per pass. Each pass splits the
+// keys into contiguous blocks: every block counts its digits, one prefix sum over (digit, block) gives
+// each block its output ranges, and the blocks scatter in parallel without sharing a cache line of
+// counters. Bytes that are equal in every key are found up front and their passes skipped, so keys
+// with few distinct fields cost only the passes they need. Scratch memory is kept between sorts.
+class QRadixSort {
+public:
+	QRadixSort(uint32_t minBlockSize = RADIX_SORT_MIN_BLOCK_SIZE);
+
+	void sort(uint64_t* keys, uint32_t* values, uint32_t count, QJobSystem* jobSystem);
+
+	uint32_t getLastPassCount() const;
+private:
+	uint32_t _minBlockSize;
+	uint32_t _lastPassCount = 0;
+
+	std::vector<uint64_t> _keyScratch;
+	std::vector<uint32_t> _valueScratch;
+	std::vector<uint32_t> _histograms;
+	std::vector<uint64_t> _blockDifferences;
+};
@@ -0,0 +1,60 @@
+#include "QSlotAllocator.h"
+#include "ThrowErr.h"
+
+QSlotAllocator::QSlotAllocator(uint32_t capacity, uint32_t frameCount) : _capacity{ capacity } {
+	if (frameCount == 0) {
+		ThrowErr::runtime("Slot allocator needs at least one frame slot!..");
+	}
+
+	this->_pendingSlots.resize(frameCount);
+}
+
+uint32_t QSlotAllocator::allocate() {
+	uint32_t slot = INVALID_SLOT;
+
+	// Recycled slots go first so the live range stays dense at the bottom of the array.
+	if (!this->_freeSlots.empty()) {
+		slot = this->_freeSlots.back();
+		this->_freeSlots.pop_back();
+	}
+	else if (this->_nextUnused < this->_capacity) {
+		slot = this->_nextUnused++;
+	}
+	else {
+		return INVALID_SLOT;
+	}
+
+	this->_usedCount++;
+	return slot;
+}
+
+void QSlotAllocator::release(uint32_t slot) {
+	if (slot >= this->_nextUnused) {
+		ThrowErr::runtime("Released slot was never allocated!..");
+	}
+
+	this->_pendingSlots[this->_frameIndex].push_back(slot);
+	this->_pendingCount++;
+	this->_usedCount--;
+}
+
+void QSlotAllocator::beginFrame(uint32_t frameIndex) {
+	this->_frameIndex = frameIndex % static_cast<uint32_t>(this->_pendingSlots.size());
+
+	std::vector<uint32_t>& retired = this->_pendingSlots[this->_frameIndex];
+	this->_freeSlots.insert(this->_freeSlots.end(), retired.begin(), retired.end());
+	this->_pendingCount -= static_cast<uint32_t>(retired.size());
+	retired.clear();
+}
+
+uint32_t QSlotAllocator::getCapacity() const {
+	return this->_capacity;
+}
+
+uint32_t QSlotAllocator::getUsedCount() const {
+	return this->_usedCount;
+}
+
+uint32_t QSlotAllocator::getPendingCount() const {
+	return this->_pendingCount;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Hands out indices from [0, capacity). Released indices are parked on the frame slot that released
+// them and only return to the free list when that slot comes around again, i.e. after its fence,
+// so an index still referenced by in-flight command buffers is never handed out twice.
+class QSlotAllocator {
+public:
+	static const uint32_t INVALID_SLOT = UINT32_MAX;
+
+	QSlotAllocator(uint32_t capacity, uint32_t frameCount);
+
+	uint32_t allocate();
+	void release(uint32_t slot);
+	void beginFrame(uint32_t frameIndex);
+
+	uint32_t getCapacity() const;
+	uint32_t getUsedCount() const;
+	uint32_t getPendingCount() const;
+private:
+	uint32_t _capacity;
+	uint32_t _nextUnused = 0;
+	uint32_t _usedCount = 0;
+	uint32_t _pendingCount = 0;
+	uint32_t _frameIndex = 0;
+
+	std::vector<uint32_t> _freeSlots;
+	std::vector<std::vector<uint32_t>> _pendingSlots;
+};
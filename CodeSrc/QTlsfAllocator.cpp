@@ -0,0 +1,441 @@
+#include "QTlsfAllocator.h"
+#include "ThrowErr.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+static uint32_t lowestBit(uint64_t value) {
+#if defined(_MSC_VER)
+	unsigned long index;
+	if (_BitScanForward(&index, static_cast<unsigned long>(value))) {
+		return index;
+	}
+	_BitScanForward(&index, static_cast<unsigned long>(value >> 32));
+	return index + 32;
+#else
+	return static_cast<uint32_t>(__builtin_ctzll(value));
+#endif
+}
+
+static uint32_t highestBit(uint64_t value) {
+#if defined(_MSC_VER)
+	unsigned long index;
+	if (_BitScanReverse(&index, static_cast<unsigned long>(value >> 32))) {
+		return index + 32;
+	}
+	_BitScanReverse(&index, static_cast<unsigned long>(value));
+	return index;
+#else
+	return 63 - static_cast<uint32_t>(__builtin_clzll(value));
+#endif
+}
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment) {
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+QTlsfAllocator::QTlsfAllocator(uint64_t size, uint64_t granularity) : _size{ size }, _granularity{ granularity } {
+	if (size == 0) {
+		ThrowErr::runtime("TLSF allocator cannot manage an empty range!..");
+	}
+
+	if (this->_granularity == 0 || (this->_granularity & (this->_granularity - 1)) != 0) {
+		ThrowErr::runtime("TLSF allocator granularity must be a power of two!..");
+	}
+
+	for (uint32_t fl = 0; fl < FL_INDEX_COUNT; fl++) {
+		for (uint32_t sl = 0; sl < SL_INDEX_COUNT; sl++) {
+			this->_freeHeads[fl][sl] = INVALID_HANDLE;
+		}
+	}
+
+	this->_nodes.reserve(64);
+
+	uint32_t root = this->_createNode();
+	this->_nodes[root].offset = 0;
+	this->_nodes[root].size = size;
+	this->_insertFree(root);
+}
+
+QTlsfAllocator::~QTlsfAllocator() {}
+
+uint32_t QTlsfAllocator::allocate(uint64_t size, uint64_t alignment, QTlsfResourceKind kind, void* userData) {
+	if (size == 0 || size > this->_size || kind == QTlsfResourceKind::FREE) {
+		return INVALID_HANDLE;
+	}
+
+	if (alignment == 0) {
+		alignment = 1;
+	}
+
+	// Round the request up so that any range in the first matching list is guaranteed to fit,
+	// then fall back to scanning from the exact size class to catch ranges the rounding skipped.
+	uint64_t searchSize = size + alignment - 1;
+	if (this->_granularity > alignment) {
+		searchSize += this->_granularity - 1;
+	}
+
+	if (searchSize >= SMALL_SIZE) {
+		searchSize += (1ull << (highestBit(searchSize) - SL_INDEX_COUNT_LOG2)) - 1;
+	}
+	else {
+		searchSize += (SMALL_SIZE / SL_INDEX_COUNT) - 1;
+	}
+
+	uint64_t offset = 0;
+	uint32_t roundedFl, roundedSl;
+	this->_mapping(searchSize, roundedFl, roundedSl);
+	uint32_t index = INVALID_HANDLE;
+	if (roundedFl < FL_INDEX_COUNT) {
+		index = this->_searchFrom(roundedFl, roundedSl, FL_INDEX_COUNT, 0, size, alignment, kind, offset);
+	}
+
+	if (index == INVALID_HANDLE) {
+		uint32_t fl, sl;
+		this->_mapping(size, fl, sl);
+		index = this->_searchFrom(fl, sl, roundedFl, roundedSl, size, alignment, kind, offset);
+	}
+
+	if (index == INVALID_HANDLE) {
+		return INVALID_HANDLE;
+	}
+
+	index = this->_take(index, offset, size);
+	this->_nodes[index].kind = kind;
+	this->_nodes[index].userData = userData;
+
+	return index;
+}
+
+void QTlsfAllocator::free(uint32_t handle) {
+	if (handle >= this->_nodes.size() || this->_nodes[handle].kind == QTlsfResourceKind::FREE) {
+		ThrowErr::runtime("TLSF allocator got an invalid handle to free!..");
+	}
+
+	this->_usedBytes -= this->_nodes[handle].size;
+	this->_allocationCount--;
+
+	this->_nodes[handle].kind = QTlsfResourceKind::FREE;
+	this->_nodes[handle].userData = nullptr;
+
+	uint32_t prev = this->_nodes[handle].prevPhysical;
+	if (prev != INVALID_HANDLE && this->_nodes[prev].kind == QTlsfResourceKind::FREE) {
+		this->_removeFree(prev);
+
+		this->_nodes[prev].size += this->_nodes[handle].size;
+		this->_nodes[prev].nextPhysical = this->_nodes[handle].nextPhysical;
+		if (this->_nodes[prev].nextPhysical != INVALID_HANDLE) {
+			this->_nodes[this->_nodes[prev].nextPhysical].prevPhysical = prev;
+		}
+
+		this->_releaseNode(handle);
+		handle = prev;
+	}
+
+	uint32_t next = this->_nodes[handle].nextPhysical;
+	if (next != INVALID_HANDLE && this->_nodes[next].kind == QTlsfResourceKind::FREE) {
+		this->_removeFree(next);
+
+		this->_nodes[handle].size += this->_nodes[next].size;
+		this->_nodes[handle].nextPhysical = this->_nodes[next].nextPhysical;
+		if (this->_nodes[handle].nextPhysical != INVALID_HANDLE) {
+			this->_nodes[this->_nodes[handle].nextPhysical].prevPhysical = handle;
+		}
+
+		this->_releaseNode(next);
+	}
+
+	this->_insertFree(handle);
+}
+
+uint64_t QTlsfAllocator::getOffset(uint32_t handle) const {
+	return this->_nodes[handle].offset;
+}
+
+uint64_t QTlsfAllocator::getSize(uint32_t handle) const {
+	return this->_nodes[handle].size;
+}
+
+void* QTlsfAllocator::getUserData(uint32_t handle) const {
+	return this->_nodes[handle].userData;
+}
+
+void QTlsfAllocator::setUserData(uint32_t handle, void* userData) {
+	this->_nodes[handle].userData = userData;
+}
+
+bool QTlsfAllocator::isEmpty() const {
+	return this->_allocationCount == 0;
+}
+
+uint64_t QTlsfAllocator::getCapacity() const {
+	return this->_size;
+}
+
+uint64_t QTlsfAllocator::getUsedBytes() const {
+	return this->_usedBytes;
+}
+
+QTlsfStats QTlsfAllocator::getStats() const {
+	QTlsfStats stats;
+	stats.size = this->_size;
+	stats.usedBytes = this->_usedBytes;
+	stats.freeBytes = this->_size - this->_usedBytes;
+	stats.allocationCount = this->_allocationCount;
+	stats.freeRangeCount = this->_freeRangeCount;
+
+	if (this->_flBitmap != 0) {
+		uint32_t fl = highestBit(this->_flBitmap);
+		uint32_t sl = highestBit(this->_slBitmaps[fl]);
+
+		for (uint32_t index = this->_freeHeads[fl][sl]; index != INVALID_HANDLE; index = this->_nodes[index].nextFree) {
+			if (this->_nodes[index].size > stats.largestFreeRange) {
+				stats.largestFreeRange = this->_nodes[index].size;
+			}
+		}
+	}
+
+	return stats;
+}
+
+void QTlsfAllocator::getAllocations(std::vector<QTlsfAllocationInfo>& outAllocations) const {
+	outAllocations.clear();
+	outAllocations.reserve(this->_allocationCount);
+
+	for (uint32_t i = 0; i < this->_nodes.size(); i++) {
+		const Node& node = this->_nodes[i];
+		if (node.kind == QTlsfResourceKind::FREE || node.size == 0) {
+			continue;
+		}
+
+		QTlsfAllocationInfo info;
+		info.handle = i;
+		info.offset = node.offset;
+		info.size = node.size;
+		info.kind = node.kind;
+		info.userData = node.userData;
+
+		outAllocations.push_back(info);
+	}
+}
+
+uint32_t QTlsfAllocator::_createNode() {
+	uint32_t index;
+
+	if (!this->_unusedNodes.empty()) {
+		index = this->_unusedNodes.back();
+		this->_unusedNodes.pop_back();
+	}
+	else {
+		index = static_cast<uint32_t>(this->_nodes.size());
+		this->_nodes.push_back(Node());
+	}
+
+	Node& node = this->_nodes[index];
+	node.offset = 0;
+	node.size = 0;
+	node.prevPhysical = INVALID_HANDLE;
+	node.nextPhysical = INVALID_HANDLE;
+	node.prevFree = INVALID_HANDLE;
+	node.nextFree = INVALID_HANDLE;
+	node.kind = QTlsfResourceKind::FREE;
+	node.userData = nullptr;
+
+	return index;
+}
+
+void QTlsfAllocator::_releaseNode(uint32_t index) {
+	// Zero size marks the slot as recycled so getAllocations skips it.
+	this->_nodes[index].size = 0;
+	this->_nodes[index].kind = QTlsfResourceKind::FREE;
+	this->_unusedNodes.push_back(index);
+}
+
+void QTlsfAllocator::_mapping(uint64_t size, uint32_t& fl, uint32_t& sl) const {
+	if (size < SMALL_SIZE) {
+		fl = 0;
+		sl = static_cast<uint32_t>(size / (SMALL_SIZE / SL_INDEX_COUNT));
+	}
+	else {
+		uint32_t log2 = highestBit(size);
+		fl = log2 - SMALL_SIZE_LOG2 + 1;
+		sl = static_cast<uint32_t>((size >> (log2 - SL_INDEX_COUNT_LOG2)) ^ SL_INDEX_COUNT);
+	}
+}
+
+void QTlsfAllocator::_insertFree(uint32_t index) {
+	uint32_t fl, sl;
+	this->_mapping(this->_nodes[index].size, fl, sl);
+
+	uint32_t head = this->_freeHeads[fl][sl];
+	this->_nodes[index].prevFree = INVALID_HANDLE;
+	this->_nodes[index].nextFree = head;
+	if (head != INVALID_HANDLE) {
+		this->_nodes[head].prevFree = index;
+	}
+
+	this->_freeHeads[fl][sl] = index;
+	this->_flBitmap |= 1ull << fl;
+	this->_slBitmaps[fl] |= 1u << sl;
+	this->_freeRangeCount++;
+}
+
+void QTlsfAllocator::_removeFree(uint32_t index) {
+	uint32_t fl, sl;
+	this->_mapping(this->_nodes[index].size, fl, sl);
+
+	uint32_t prev = this->_nodes[index].prevFree;
+	uint32_t next = this->_nodes[index].nextFree;
+
+	if (prev != INVALID_HANDLE) {
+		this->_nodes[prev].nextFree = next;
+	}
+	else {
+		this->_freeHeads[fl][sl] = next;
+	}
+
+	if (next != INVALID_HANDLE) {
+		this->_nodes[next].prevFree = prev;
+	}
+
+	if (this->_freeHeads[fl][sl] == INVALID_HANDLE) {
+		this->_slBitmaps[fl] &= ~(1u << sl);
+		if (this->_slBitmaps[fl] == 0) {
+			this->_flBitmap &= ~(1ull << fl);
+		}
+	}
+
+	this->_nodes[index].prevFree = INVALID_HANDLE;
+	this->_nodes[index].nextFree = INVALID_HANDLE;
+	this->_freeRangeCount--;
+}
+
+uint32_t QTlsfAllocator::_findFreeList(uint32_t& fl, uint32_t& sl) const {
+	uint32_t slMap = this->_slBitmaps[fl] & (~0u << sl);
+
+	if (slMap == 0) {
+		if (fl + 1 >= FL_INDEX_COUNT) {
+			return INVALID_HANDLE;
+		}
+
+		uint64_t flMap = this->_flBitmap & (~0ull << (fl + 1));
+		if (flMap == 0) {
+			return INVALID_HANDLE;
+		}
+
+		fl = lowestBit(flMap);
+		slMap = this->_slBitmaps[fl];
+	}
+
+	sl = lowestBit(slMap);
+	return this->_freeHeads[fl][sl];
+}
+
+bool QTlsfAllocator::_tryFit(uint32_t index, uint64_t size, uint64_t alignment, QTlsfResourceKind kind, uint64_t& outOffset) const {
+	const Node& node = this->_nodes[index];
+	uint64_t offset = alignUp(node.offset, alignment);
+
+	if (this->_granularity > 1 && node.prevPhysical != INVALID_HANDLE) {
+		const Node& prev = this->_nodes[node.prevPhysical];
+		if (this->_conflicts(prev.kind, kind) && this->_samePage(prev.offset + prev.size - 1, offset)) {
+			offset = alignUp(offset, this->_granularity);
+		}
+	}
+
+	if (offset + size > node.offset + node.size) {
+		return false;
+	}
+
+	if (this->_granularity > 1 && node.nextPhysical != INVALID_HANDLE) {
+		const Node& next = this->_nodes[node.nextPhysical];
+		if (this->_conflicts(kind, next.kind) && this->_samePage(offset + size - 1, next.offset)) {
+			return false;
+		}
+	}
+
+	outOffset = offset;
+	return true;
+}
+
+uint32_t QTlsfAllocator::_searchFrom(
+	uint32_t fl, uint32_t sl, uint32_t endFl, uint32_t endSl, uint64_t size, uint64_t alignment, QTlsfResourceKind kind, uint64_t& outOffset) const {
+	while (true) {
+		uint32_t head = this->_findFreeList(fl, sl);
+		if (head == INVALID_HANDLE || fl > endFl || (fl == endFl && sl >= endSl)) {
+			return INVALID_HANDLE;
+		}
+
+		for (uint32_t index = head; index != INVALID_HANDLE; index = this->_nodes[index].nextFree) {
+			if (this->_tryFit(index, size, alignment, kind, outOffset)) {
+				return index;
+			}
+		}
+
+		sl++;
+		if (sl >= SL_INDEX_COUNT) {
+			sl = 0;
+			fl++;
+
+			if (fl >= FL_INDEX_COUNT) {
+				return INVALID_HANDLE;
+			}
+		}
+	}
+}
+
+uint32_t QTlsfAllocator::_take(uint32_t index, uint64_t offset, uint64_t size) {
+	this->_removeFree(index);
+
+	if (offset > this->_nodes[index].offset) {
+		uint32_t front = this->_createNode();
+		uint32_t prev = this->_nodes[index].prevPhysical;
+
+		this->_nodes[front].offset = this->_nodes[index].offset;
+		this->_nodes[front].size = offset - this->_nodes[index].offset;
+		this->_nodes[front].prevPhysical = prev;
+		this->_nodes[front].nextPhysical = index;
+		if (prev != INVALID_HANDLE) {
+			this->_nodes[prev].nextPhysical = front;
+		}
+
+		this->_nodes[index].prevPhysical = front;
+		this->_nodes[index].size -= this->_nodes[front].size;
+		this->_nodes[index].offset = offset;
+
+		this->_insertFree(front);
+	}
+
+	if (this->_nodes[index].size > size) {
+		uint32_t back = this->_createNode();
+		uint32_t next = this->_nodes[index].nextPhysical;
+
+		this->_nodes[back].offset = offset + size;
+		this->_nodes[back].size = this->_nodes[index].size - size;
+		this->_nodes[back].prevPhysical = index;
+		this->_nodes[back].nextPhysical = next;
+		if (next != INVALID_HANDLE) {
+			this->_nodes[next].prevPhysical = back;
+		}
+
+		this->_nodes[index].nextPhysical = back;
+		this->_nodes[index].size = size;
+
+		this->_insertFree(back);
+	}
+
+	this->_usedBytes += size;
+	this->_allocationCount++;
+
+	return index;
+}
+
+bool QTlsfAllocator::_conflicts(QTlsfResourceKind a, QTlsfResourceKind b) const {
+	return (a == QTlsfResourceKind::LINEAR && b == QTlsfResourceKind::OPTIMAL) ||
+		(a == QTlsfResourceKind::OPTIMAL && b == QTlsfResourceKind::LINEAR);
+}
+
+bool QTlsfAllocator::_samePage(uint64_t endOfFirst, uint64_t startOfSecond) const {
+	uint64_t pageMask = ~(this->_granularity - 1);
+	return (endOfFirst & pageMask) == (startOfSecond & pageMask);
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Two-level segregated fit sub-allocator over an abstract [0, size) range.
+// Knows nothing about Vulkan so the placement logic can be exercised on CPU only.
+
+enum class QTlsfResourceKind : uint8_t {
+	FREE = 0,
+	LINEAR,
+	OPTIMAL,
+};
+
+struct QTlsfStats {
+	uint64_t size = 0;
+	uint64_t usedBytes = 0;
+	uint64_t freeBytes = 0;
+	uint64_t largestFreeRange = 0;
+	uint32_t allocationCount = 0;
+	uint32_t freeRangeCount = 0;
+};
+
+struct QTlsfAllocationInfo {
+	uint32_t handle;
+	uint64_t offset;
+	uint64_t size;
+	QTlsfResourceKind kind;
+	void* userData;
+};
+
+class QTlsfAllocator {
+public:
+	static const uint32_t INVALID_HANDLE = UINT32_MAX;
+
+	QTlsfAllocator(uint64_t size, uint64_t granularity = 1);
+	~QTlsfAllocator();
+
+	uint32_t allocate(uint64_t size, uint64_t alignment, QTlsfResourceKind kind, void* userData = nullptr);
+	void free(uint32_t handle);
+
+	uint64_t getOffset(uint32_t handle) const;
+	uint64_t getSize(uint32_t handle) const;
+	void* getUserData(uint32_t handle) const;
+	void setUserData(uint32_t handle, void* userData);
+
+	bool isEmpty() const;
+	uint64_t getCapacity() const;
+	uint64_t getUsedBytes() const;
+	QTlsfStats getStats() const;
+	void getAllocations(std::vector<QTlsfAllocationInfo>& outAllocations) const;
+
+private:
+	static const uint32_t SL_INDEX_COUNT_LOG2 = 4;
+	static const uint32_t SL_INDEX_COUNT = 1 << SL_INDEX_COUNT_LOG2;
+	static const uint32_t SMALL_SIZE_LOG2 = 8;
+	static const uint64_t SMALL_SIZE = 1ull << SMALL_SIZE_LOG2;
+	static const uint32_t FL_INDEX_COUNT = 64 - SMALL_SIZE_LOG2 + 1;
+
+	struct Node {
+		uint64_t offset;
+		uint64_t size;
+		uint32_t prevPhysical;
+		uint32_t nextPhysical;
+		uint32_t prevFree;
+		uint32_t nextFree;
+		QTlsfResourceKind kind;
+		void* userData;
+	};
+
+	uint64_t _size;
+	uint64_t _granularity;
+	uint64_t _usedBytes = 0;
+	uint32_t _allocationCount = 0;
+	uint32_t _freeRangeCount = 0;
+
+	uint64_t _flBitmap = 0;
+	uint32_t _slBitmaps[FL_INDEX_COUNT] = {};
+	uint32_t _freeHeads[FL_INDEX_COUNT][SL_INDEX_COUNT];
+
+	std::vector<Node> _nodes;
+	std::vector<uint32_t> _unusedNodes;
+
+	uint32_t _createNode();
+	void _releaseNode(uint32_t index);
+	void _mapping(uint64_t size, uint32_t& fl, uint32_t& sl) const;
+	void _insertFree(uint32_t index);
+	void _removeFree(uint32_t index);
+	uint32_t _findFreeList(uint32_t& fl, uint32_t& sl) const;
+	bool _tryFit(uint32_t index, uint64_t size, uint64_t alignment, QTlsfResourceKind kind, uint64_t& outOffset) const;
+	uint32_t _searchFrom(uint32_t fl, uint32_t sl, uint32_t endFl, uint32_t endSl, uint64_t size, uint64_t alignment, QTlsfResourceKind kind, uint64_t& outOffset) const;
+	uint32_t _take(uint32_t index, uint64_t offset, uint64_t size);
+	bool _conflicts(QTlsfResourceKind a, QTlsfResourceKind b) const;
+	bool _samePage(uint64_t endOfFirst, uint64_t startOfSecond) const;
+};
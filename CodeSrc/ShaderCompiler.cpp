@@ -8,6 +8,10 @@ VkShaderModule ShaderCompiler::VkCompileFragShaderGLSL(VkDevice logicalDevice, c
 	return createModuleGLSL(logicalDevice, path, "frag");
 }
 
+VkShaderModule ShaderCompiler::VkCompileCompShaderGLSL(VkDevice logicalDevice, const char* path) {
+	return createModuleGLSL(logicalDevice, path, "comp");
+}
+
 VkShaderModule ShaderCompiler::createModuleGLSL(VkDevice logicalDevice, const char* path, std::string shaderType) {
 	std::string dirname = QString::getDirname(std::string(path));
 
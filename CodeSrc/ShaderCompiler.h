@@ -5,6 +5,7 @@ class ShaderCompiler {
 public:
 	static VkShaderModule VkCompileVertShaderGLSL(VkDevice logicalDevice, const char* path);
 	static VkShaderModule VkCompileFragShaderGLSL(VkDevice logicalDevice, const char* path);
+	static VkShaderModule VkCompileCompShaderGLSL(VkDevice logicalDevice, const char* path);
 private:
 	static VkShaderModule createModuleGLSL(VkDevice logicalDevice, const char* path, std::string shaderType);
 };
\ No newline at end of file
@@ -0,0 +1,214 @@
+#include "VulkanBindlessDescriptors.h"
+
+static VkPhysicalDeviceVulkan12Properties getVulkan12Properties(VkPhysicalDevice physicalDevice) {
+	VkPhysicalDeviceVulkan12Properties vulkan12Properties = {};
+	vulkan12Properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+
+	VkPhysicalDeviceProperties2 deviceProperties = {};
+	deviceProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+	deviceProperties.pNext = &vulkan12Properties;
+
+	vkGetPhysicalDeviceProperties2(physicalDevice, &deviceProperties);
+	vulkan12Properties.pNext = nullptr;
+
+	return vulkan12Properties;
+}
+
+static uint32_t maxTextureSlots(VkPhysicalDevice physicalDevice, uint32_t requested) {
+	VkPhysicalDeviceVulkan12Properties limits = getVulkan12Properties(physicalDevice);
+	return std::min(requested, std::min(limits.maxDescriptorSetUpdateAfterBindSampledImages, limits.maxPerStageDescriptorUpdateAfterBindSampledImages));
+}
+
+static uint32_t maxBufferSlots(VkPhysicalDevice physicalDevice, uint32_t requested) {
+	VkPhysicalDeviceVulkan12Properties limits = getVulkan12Properties(physicalDevice);
+	return std::min(requested, std::min(limits.maxDescriptorSetUpdateAfterBindStorageBuffers, limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers));
+}
+
+VulkanBindlessDescriptors::VulkanBindlessDescriptors(
+	VkPhysicalDevice physicalDevice, VkDevice logicalDevice, VulkanDescriptorAllocator* descriptorAllocator,
+	VkDescriptorSetLayout uniformSetLayout, uint32_t maxTextures, uint32_t maxBuffers) :
+	_logicalDevice{ logicalDevice },
+	_textureSlots{ maxTextureSlots(physicalDevice, maxTextures), MAX_FRAME_DRAWS },
+	_bufferSlots{ maxBufferSlots(physicalDevice, maxBuffers), MAX_FRAME_DRAWS } {
+	if (this->_textureSlots.getCapacity() == 0 || this->_bufferSlots.getCapacity() == 0) {
+		ThrowErr::runtime("Device has no room for update-after-bind descriptors!..");
+	}
+
+	this->_createDescriptorSet(descriptorAllocator);
+	this->_createPipelineLayout(uniformSetLayout);
+}
+
+VulkanBindlessDescriptors::~VulkanBindlessDescriptors() {
+	vkDestroyPipelineLayout(this->_logicalDevice, this->_pipelineLayout, nullptr);
+	vkDestroyDescriptorSetLayout(this->_logicalDevice, this->_descriptorSetLayout, nullptr);
+}
+
+uint32_t VulkanBindlessDescriptors::registerTexture(VkImageView imageView, VkSampler sampler, VkImageLayout layout) {
+	std::lock_guard<std::mutex> lock(this->_mutex);
+
+	uint32_t slot = this->_textureSlots.allocate();
+	if (slot == QSlotAllocator::INVALID_SLOT) {
+		ThrowErr::runtime("Bindless texture array is full!..");
+	}
+
+	VkDescriptorImageInfo imageInfo = {};
+	imageInfo.sampler = sampler;
+	imageInfo.imageView = imageView;
+	imageInfo.imageLayout = layout;
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = this->_descriptorSet;
+	write.dstBinding = BINDLESS_TEXTURE_BINDING;
+	write.dstArrayElement = slot;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	write.pImageInfo = &imageInfo;
+
+	// Update-unused-while-pending makes this legal while earlier frames still execute with the set bound.
+	vkUpdateDescriptorSets(this->_logicalDevice, 1, &write, 0, nullptr);
+
+	return slot;
+}
+
+uint32_t VulkanBindlessDescriptors::registerBuffer(VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+	std::lock_guard<std::mutex> lock(this->_mutex);
+
+	uint32_t slot = this->_bufferSlots.allocate();
+	if (slot == QSlotAllocator::INVALID_SLOT) {
+		ThrowErr::runtime("Bindless buffer array is full!..");
+	}
+
+	VkDescriptorBufferInfo bufferInfo = {};
+	bufferInfo.buffer = buffer;
+	bufferInfo.offset = offset;
+	bufferInfo.range = range;
+
+	VkWriteDescriptorSet write = {};
+	write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	write.dstSet = this->_descriptorSet;
+	write.dstBinding = BINDLESS_BUFFER_BINDING;
+	write.dstArrayElement = slot;
+	write.descriptorCount = 1;
+	write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	write.pBufferInfo = &bufferInfo;
+
+	vkUpdateDescriptorSets(this->_logicalDevice, 1, &write, 0, nullptr);
+
+	return slot;
+}
+
+void VulkanBindlessDescriptors::releaseTexture(uint32_t slot) {
+	std::lock_guard<std::mutex> lock(this->_mutex);
+	this->_textureSlots.release(slot);
+}
+
+void VulkanBindlessDescriptors::releaseBuffer(uint32_t slot) {
+	std::lock_guard<std::mutex> lock(this->_mutex);
+	this->_bufferSlots.release(slot);
+}
+
+void VulkanBindlessDescriptors::beginFrame(uint32_t frameIndex) {
+	// The slot's fence has signalled, so slots released the last time it was current are unreferenced.
+	std::lock_guard<std::mutex> lock(this->_mutex);
+	this->_textureSlots.beginFrame(frameIndex);
+	this->_bufferSlots.beginFrame(frameIndex);
+}
+
+void VulkanBindlessDescriptors::bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint) {
+	vkCmdBindDescriptorSets(commandBuffer, bindPoint, this->_pipelineLayout, 0, 1, &this->_descriptorSet, 0, nullptr);
+}
+
+void VulkanBindlessDescriptors::pushConstants(VkCommandBuffer commandBuffer, const void* data, uint32_t size, uint32_t offset) {
+	if (offset + size > BINDLESS_PUSH_CONSTANT_SIZE) {
+		ThrowErr::runtime("Push constants exceed the bindless range!..");
+	}
+
+	vkCmdPushConstants(
+		commandBuffer, this->_pipelineLayout, VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT, offset, size, data);
+}
+
+VkDescriptorSetLayout VulkanBindlessDescriptors::getDescriptorSetLayout() {
+	return this->_descriptorSetLayout;
+}
+
+VkPipelineLayout VulkanBindlessDescriptors::getPipelineLayout() {
+	return this->_pipelineLayout;
+}
+
+VkDescriptorSet VulkanBindlessDescriptors::getDescriptorSet() {
+	return this->_descriptorSet;
+}
+
+uint32_t VulkanBindlessDescriptors::getTextureCapacity() {
+	return this->_textureSlots.getCapacity();
+}
+
+uint32_t VulkanBindlessDescriptors::getBufferCapacity() {
+	return this->_bufferSlots.getCapacity();
+}
+
+void VulkanBindlessDescriptors::_createDescriptorSet(VulkanDescriptorAllocator* descriptorAllocator) {
+	std::array<VkDescriptorSetLayoutBinding, 2> bindings = {};
+	bindings[0].binding = BINDLESS_TEXTURE_BINDING;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	bindings[0].descriptorCount = this->_textureSlots.getCapacity();
+	bindings[0].stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT;
+
+	bindings[1].binding = BINDLESS_BUFFER_BINDING;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bindings[1].descriptorCount = this->_bufferSlots.getCapacity();
+	bindings[1].stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT;
+
+	// Slots are written while the set is bound and never all filled, so every binding is partially bound.
+	VkDescriptorBindingFlags bindingFlag =
+		VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT;
+	std::array<VkDescriptorBindingFlags, 2> bindingFlags = { bindingFlag, bindingFlag };
+
+	VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCreateInfo = {};
+	bindingFlagsCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+	bindingFlagsCreateInfo.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+	bindingFlagsCreateInfo.pBindingFlags = bindingFlags.data();
+
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.pNext = &bindingFlagsCreateInfo;
+	layoutCreateInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+	layoutCreateInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+	layoutCreateInfo.pBindings = bindings.data();
+
+	VkResult result = vkCreateDescriptorSetLayout(this->_logicalDevice, &layoutCreateInfo, nullptr, &this->_descriptorSetLayout);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to create a bindless descriptor set layout!..");
+	}
+
+	// The descriptor allocator owns the update-after-bind pool, sized for every slot up front.
+	std::vector<VkDescriptorPoolSize> poolSizes(2);
+	poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+	poolSizes[0].descriptorCount = this->_textureSlots.getCapacity();
+	poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	poolSizes[1].descriptorCount = this->_bufferSlots.getCapacity();
+
+	this->_descriptorSet = descriptorAllocator->allocateUpdateAfterBind(this->_descriptorSetLayout, poolSizes);
+}
+
+void VulkanBindlessDescriptors::_createPipelineLayout(VkDescriptorSetLayout uniformSetLayout) {
+	std::array<VkDescriptorSetLayout, 2> setLayouts = { this->_descriptorSetLayout, uniformSetLayout };
+
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = BINDLESS_PUSH_CONSTANT_SIZE;
+
+	VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo = {};
+	pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutCreateInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+	pipelineLayoutCreateInfo.pSetLayouts = setLayouts.data();
+	pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+	pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
+
+	VkResult result = vkCreatePipelineLayout(this->_logicalDevice, &pipelineLayoutCreateInfo, nullptr, &this->_pipelineLayout);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to create the bindless pipeline layout!..");
+	}
+}
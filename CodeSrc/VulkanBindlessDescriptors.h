@@ -0,0 +1,62 @@
+#pragma once
+#include <mutex>
+#include "QEngine.h"
+#include "VulkanUtilities.h"
+#include "QSlotAllocator.h"
+#include "VulkanDescriptorAllocator.h"
+
+const uint32_t BINDLESS_MAX_TEXTURES = 16384;
+const uint32_t BINDLESS_MAX_BUFFERS = 4096;
+const uint32_t BINDLESS_PUSH_CONSTANT_SIZE = 128;
+
+const uint32_t BINDLESS_TEXTURE_BINDING = 0;
+const uint32_t BINDLESS_BUFFER_BINDING = 1;
+
+// One update-after-bind set holding every sampled image and storage buffer the renderer knows about.
+// Shaders index it with slots passed through push constants (or read from a material buffer slot):
+//   layout(set = 0, binding = 0) uniform sampler2D textures[];
+//   layout(set = 0, binding = 1) readonly buffer Buffers { uint data[]; } buffers[];
+// Pipelines share getPipelineLayout(), so the set is bound once per command buffer, not per material.
+// The layout's set 1 is the per-frame dynamic uniform buffer whose set layout is passed in.
+class VulkanBindlessDescriptors {
+public:
+	VulkanBindlessDescriptors(
+		VkPhysicalDevice physicalDevice, VkDevice logicalDevice, VulkanDescriptorAllocator* descriptorAllocator,
+		VkDescriptorSetLayout uniformSetLayout,
+		uint32_t maxTextures = BINDLESS_MAX_TEXTURES, uint32_t maxBuffers = BINDLESS_MAX_BUFFERS);
+	~VulkanBindlessDescriptors();
+
+	uint32_t registerTexture(VkImageView imageView, VkSampler sampler, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	uint32_t registerBuffer(VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+	void releaseTexture(uint32_t slot);
+	void releaseBuffer(uint32_t slot);
+
+	void beginFrame(uint32_t frameIndex);
+	void bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint);
+	void pushConstants(VkCommandBuffer commandBuffer, const void* data, uint32_t size, uint32_t offset = 0);
+
+	template <typename T>
+	void pushConstants(VkCommandBuffer commandBuffer, const T& data) {
+		static_assert(sizeof(T) <= BINDLESS_PUSH_CONSTANT_SIZE, "Push constants exceed the bindless range");
+		this->pushConstants(commandBuffer, &data, sizeof(T));
+	}
+
+	VkDescriptorSetLayout getDescriptorSetLayout();
+	VkPipelineLayout getPipelineLayout();
+	VkDescriptorSet getDescriptorSet();
+	uint32_t getTextureCapacity();
+	uint32_t getBufferCapacity();
+private:
+	VkDevice _logicalDevice;
+
+	VkDescriptorSetLayout _descriptorSetLayout = VK_NULL_HANDLE;
+	VkPipelineLayout _pipelineLayout = VK_NULL_HANDLE;
+	VkDescriptorSet _descriptorSet = VK_NULL_HANDLE;
+
+	std::mutex _mutex;
+	QSlotAllocator _textureSlots;
+	QSlotAllocator _bufferSlots;
+
+	void _createDescriptorSet(VulkanDescriptorAllocator* descriptorAllocator);
+	void _createPipelineLayout(VkDescriptorSetLayout uniformSetLayout);
+};
@@ -0,0 +1,248 @@
+#include "VulkanCommandCache.h"
+#include "VulkanParallelRecorder.h"
+#include "QAllocTracker.h"
+
+template <typename T>
+static void hashCombine(uint64_t& hash, T value) {
+	uint64_t bits = 0;
+	memcpy(&bits, &value, std::min(sizeof(T), sizeof(bits)));
+
+	// FNV-1a over the eight bytes of the value.
+	for (uint32_t i = 0; i < 8; i++) {
+		hash ^= (bits >> (i * 8)) & 0xff;
+		hash *= 1099511628211ull;
+	}
+}
+
+static const uint64_t HASH_SEED = 14695981039346656037ull;
+
+bool VulkanCommandCache::BatchKey::operator==(const BatchKey& other) const {
+	return this->pipeline == other.pipeline && this->materialIndex == other.materialIndex &&
+		this->vertexBuffer == other.vertexBuffer && this->indexBuffer == other.indexBuffer;
+}
+
+VulkanCommandCache::VulkanCommandCache(
+	VkDevice logicalDevice, uint32_t queueFamilyIndex, VulkanBindlessDescriptors* bindlessDescriptors,
+	VulkanUniformAllocator* uniformAllocator, uint32_t evictFrames) :
+	_logicalDevice{ logicalDevice }, _bindlessDescriptors{ bindlessDescriptors }, _uniformAllocator{ uniformAllocator }, _evictFrames{ std::max<uint32_t>(evictFrames, 1) } {
+	// Not TRANSIENT and never reset as a whole: buffers here live for many frames and are reset one at a time.
+	VkCommandPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+
+	VkResult result = vkCreateCommandPool(this->_logicalDevice, &poolCreateInfo, nullptr, &this->_commandPool);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to create a command cache pool!..");
+	}
+}
+
+VulkanCommandCache::~VulkanCommandCache() {
+	vkDestroyCommandPool(this->_logicalDevice, this->_commandPool, nullptr);
+}
+
+void VulkanCommandCache::beginFrame(uint32_t frameIndex) {
+	this->_frameIndex = frameIndex % MAX_FRAME_DRAWS;
+	this->_frameNumber++;
+
+	std::vector<VkCommandBuffer>& retired = this->_retired[this->_frameIndex];
+	this->_freeBuffers.insert(this->_freeBuffers.end(), retired.begin(), retired.end());
+	retired.clear();
+}
+
+QSpan<const VkCommandBuffer> VulkanCommandCache::update(
+	QSpan<const VkFormat> colorFormats, VkFormat depthFormat,
+	const VkViewport& viewport, const VkRect2D& scissor, QSpan<const VulkanDrawCommand> staticDraws) {
+	QAllocScope allocScope(QAllocTag::RECORDING);
+	this->_stats.batchCount = 0;
+	this->_stats.reusedBatches = 0;
+	this->_stats.recordedBatches = 0;
+	this->_stats.evictedBatches = 0;
+	this->_frameBuffers.clear();
+
+	// Everything the inherited state and the recorded viewport depend on; a change re-records every batch.
+	uint64_t targetHash = HASH_SEED;
+	for (VkFormat format : colorFormats) {
+		hashCombine(targetHash, format);
+	}
+	hashCombine(targetHash, depthFormat);
+	hashCombine(targetHash, viewport.x);
+	hashCombine(targetHash, viewport.y);
+	hashCombine(targetHash, viewport.width);
+	hashCombine(targetHash, viewport.height);
+	hashCombine(targetHash, viewport.minDepth);
+	hashCombine(targetHash, viewport.maxDepth);
+	hashCombine(targetHash, scissor.offset.x);
+	hashCombine(targetHash, scissor.offset.y);
+	hashCombine(targetHash, scissor.extent.width);
+	hashCombine(targetHash, scissor.extent.height);
+
+	VkCommandBufferInheritanceRenderingInfo inheritanceRenderingInfo = {};
+	inheritanceRenderingInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+	inheritanceRenderingInfo.colorAttachmentCount = static_cast<uint32_t>(colorFormats.size());
+	inheritanceRenderingInfo.pColorAttachmentFormats = colorFormats.data();
+	inheritanceRenderingInfo.depthAttachmentFormat = depthFormat;
+	inheritanceRenderingInfo.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+	inheritanceRenderingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	VkCommandBufferInheritanceInfo inheritanceInfo = {};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.pNext = &inheritanceRenderingInfo;
+
+	// Group by key with a stable order: draws of a batch keep their submission order, batches their key order.
+	this->_keyHashes.resize(staticDraws.size());
+	this->_order.resize(staticDraws.size());
+	for (uint32_t i = 0; i < staticDraws.size(); i++) {
+		const VulkanDrawCommand& draw = staticDraws[i];
+
+		uint64_t keyHash = HASH_SEED;
+		hashCombine(keyHash, draw.pipeline);
+		hashCombine(keyHash, draw.materialIndex);
+		hashCombine(keyHash, draw.vertexBuffer);
+		hashCombine(keyHash, draw.indexBuffer);
+
+		this->_keyHashes[i] = keyHash;
+		this->_order[i] = i;
+	}
+
+	std::sort(this->_order.begin(), this->_order.end(), [this](uint32_t a, uint32_t b) {
+		return this->_keyHashes[a] != this->_keyHashes[b] ? this->_keyHashes[a] < this->_keyHashes[b] : a < b;
+	});
+
+	uint32_t runBegin = 0;
+	while (runBegin < this->_order.size()) {
+		uint64_t keyHash = this->_keyHashes[this->_order[runBegin]];
+		const VulkanDrawCommand& first = staticDraws[this->_order[runBegin]];
+		BatchKey key = { first.pipeline, first.materialIndex, first.vertexBuffer, first.indexBuffer };
+
+		// The visible draws are the batch's content, so culling a draw in or out changes the hash too.
+		uint64_t contentHash = HASH_SEED;
+		this->_batchDraws.clear();
+
+		uint32_t runEnd = runBegin;
+		while (runEnd < this->_order.size() && this->_keyHashes[this->_order[runEnd]] == keyHash) {
+			const VulkanDrawCommand& draw = staticDraws[this->_order[runEnd]];
+			hashCombine(contentHash, draw.elementCount);
+			hashCombine(contentHash, draw.instanceCount);
+			hashCombine(contentHash, draw.firstElement);
+			hashCombine(contentHash, draw.vertexOffset);
+			hashCombine(contentHash, draw.firstInstance);
+			hashCombine(contentHash, draw.objectIndex);
+			hashCombine(contentHash, draw.indirectBuffer);
+			hashCombine(contentHash, draw.indirectOffset);
+			hashCombine(contentHash, draw.countBuffer);
+			hashCombine(contentHash, draw.countOffset);
+			hashCombine(contentHash, draw.maxDrawCount);
+			hashCombine(contentHash, draw.uniformOffset);
+
+			this->_batchDraws.push_back(draw);
+			runEnd++;
+		}
+		runBegin = runEnd;
+
+		CachedBatch& batch = this->_batches[keyHash];
+		bool reusable = batch.commandBuffer != VK_NULL_HANDLE && batch.key == key &&
+			batch.contentHash == contentHash && batch.targetHash == targetHash;
+
+		if (reusable) {
+			this->_stats.reusedBatches++;
+		}
+		else {
+			// The old buffer may still be executing for an earlier frame, so record into a fresh one.
+			if (batch.commandBuffer != VK_NULL_HANDLE) {
+				this->_retireBuffer(batch.commandBuffer);
+			}
+
+			batch.key = key;
+			batch.contentHash = contentHash;
+			batch.targetHash = targetHash;
+			batch.commandBuffer = this->_acquireBuffer();
+			this->_recordBatch(batch.commandBuffer, inheritanceInfo, viewport, scissor);
+
+			this->_stats.recordedBatches++;
+		}
+
+		batch.lastUsedFrame = this->_frameNumber;
+		this->_frameBuffers.push_back(batch.commandBuffer);
+		this->_stats.batchCount++;
+	}
+
+	for (auto it = this->_batches.begin(); it != this->_batches.end();) {
+		if (it->second.lastUsedFrame + this->_evictFrames < this->_frameNumber) {
+			this->_retireBuffer(it->second.commandBuffer);
+			it = this->_batches.erase(it);
+			this->_stats.evictedBatches++;
+		}
+		else {
+			++it;
+		}
+	}
+
+	this->_stats.cachedBuffers = static_cast<uint32_t>(this->_batches.size());
+
+	return QSpan<const VkCommandBuffer>(this->_frameBuffers.data(), this->_frameBuffers.size());
+}
+
+void VulkanCommandCache::clear() {
+	for (auto& entry : this->_batches) {
+		this->_retireBuffer(entry.second.commandBuffer);
+	}
+
+	this->_batches.clear();
+	this->_stats.cachedBuffers = 0;
+}
+
+VulkanCommandCacheStats VulkanCommandCache::getStats() {
+	return this->_stats;
+}
+
+VkCommandBuffer VulkanCommandCache::_acquireBuffer() {
+	if (!this->_freeBuffers.empty()) {
+		VkCommandBuffer commandBuffer = this->_freeBuffers.back();
+		this->_freeBuffers.pop_back();
+		return commandBuffer;
+	}
+
+	VkCommandBufferAllocateInfo cbAllocInfo = {};
+	cbAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	cbAllocInfo.commandPool = this->_commandPool;
+	cbAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+	cbAllocInfo.commandBufferCount = 1;
+
+	VkCommandBuffer commandBuffer;
+	VkResult result = vkAllocateCommandBuffers(this->_logicalDevice, &cbAllocInfo, &commandBuffer);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to allocate a cached command buffer!..");
+	}
+
+	return commandBuffer;
+}
+
+void VulkanCommandCache::_retireBuffer(VkCommandBuffer commandBuffer) {
+	this->_retired[this->_frameIndex].push_back(commandBuffer);
+}
+
+void VulkanCommandCache::_recordBatch(
+	VkCommandBuffer commandBuffer, const VkCommandBufferInheritanceInfo& inheritanceInfo,
+	const VkViewport& viewport, const VkRect2D& scissor) {
+	// SIMULTANEOUS_USE: the same buffer is executed by consecutive frames that can be in flight together.
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	// Beginning a buffer from a RESET_COMMAND_BUFFER pool implicitly resets it.
+	VkResult result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to start recording a cached command buffer!..");
+	}
+
+	VulkanParallelRecorder::recordDraws(
+		commandBuffer, this->_bindlessDescriptors, this->_uniformAllocator, viewport, scissor,
+		QSpan<const VulkanDrawCommand>(this->_batchDraws.data(), this->_batchDraws.size()));
+
+	result = vkEndCommandBuffer(commandBuffer);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to stop recording a cached command buffer!..");
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <algorithm>
+#include <unordered_map>
+#include "QEngine.h"
+#include "VulkanUtilities.h"
+#include "VulkanDrawCommand.h"
+#include "VulkanBindlessDescriptors.h"
+#include "VulkanUniformAllocator.h"
+#include "QArenaContainers.h"
+
+const uint32_t COMMAND_CACHE_EVICT_FRAMES = 60;
+
+struct VulkanCommandCacheStats {
+	uint32_t batchCount = 0;
+	uint32_t reusedBatches = 0;
+	uint32_t recordedBatches = 0;
+	uint32_t evictedBatches = 0;
+	uint32_t cachedBuffers = 0;
+};
+
+// Keeps static draws in secondary command buffers that survive across frames. Draws are grouped into
+// batches by pipeline, material and geometry; a batch is re-recorded only when the hash of its visible
+// draws or of the render target changes. Replaced and evicted buffers may still be executing, so they
+// are parked on the current frame slot and only reused once that slot's fence has signalled again.
+class VulkanCommandCache {
+public:
+	VulkanCommandCache(
+		VkDevice logicalDevice, uint32_t queueFamilyIndex, VulkanBindlessDescriptors* bindlessDescriptors,
+		VulkanUniformAllocator* uniformAllocator, uint32_t evictFrames = COMMAND_CACHE_EVICT_FRAMES);
+	~VulkanCommandCache();
+
+	void beginFrame(uint32_t frameIndex);
+	QSpan<const VkCommandBuffer> update(
+		QSpan<const VkFormat> colorFormats, VkFormat depthFormat,
+		const VkViewport& viewport, const VkRect2D& scissor, QSpan<const VulkanDrawCommand> staticDraws);
+	void clear();
+
+	VulkanCommandCacheStats getStats();
+private:
+	struct BatchKey {
+		VkPipeline pipeline;
+		uint32_t materialIndex;
+		VkBuffer vertexBuffer;
+		VkBuffer indexBuffer;
+
+		bool operator==(const BatchKey& other) const;
+	};
+
+	struct CachedBatch {
+		BatchKey key;
+		uint64_t contentHash = 0;
+		uint64_t targetHash = 0;
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		uint64_t lastUsedFrame = 0;
+	};
+
+	VkDevice _logicalDevice;
+	VkCommandPool _commandPool = VK_NULL_HANDLE;
+	VulkanBindlessDescriptors* _bindlessDescriptors;
+	VulkanUniformAllocator* _uniformAllocator;
+	uint32_t _evictFrames;
+	uint32_t _frameIndex = 0;
+	uint64_t _frameNumber = 0;
+	VulkanCommandCacheStats _stats;
+
+	std::unordered_map<uint64_t, CachedBatch> _batches;
+	std::vector<VkCommandBuffer> _freeBuffers;
+	std::vector<VkCommandBuffer> _retired[MAX_FRAME_DRAWS];
+
+	std::vector<uint32_t> _order;
+	std::vector<uint64_t> _keyHashes;
+	std::vector<VulkanDrawCommand> _batchDraws;
+	std::vector<VkCommandBuffer> _frameBuffers;
+
+	VkCommandBuffer _acquireBuffer();
+	void _retireBuffer(VkCommandBuffer commandBuffer);
+	void _recordBatch(
+		VkCommandBuffer commandBuffer, const VkCommandBufferInheritanceInfo& inheritanceInfo,
+		const VkViewport& viewport, const VkRect2D& scissor);
+};
@@ -0,0 +1,116 @@
+#include "VulkanCommandPoolManager.h"
+
+VulkanCommandPoolManager::VulkanCommandPoolManager(VkDevice logicalDevice, uint32_t threadCount) :
+	_logicalDevice{ logicalDevice } {
+	for (uint32_t frame = 0; frame < MAX_FRAME_DRAWS; frame++) {
+		this->_pools[frame].resize(std::max<uint32_t>(threadCount, 1));
+	}
+}
+
+VulkanCommandPoolManager::~VulkanCommandPoolManager() {
+	for (uint32_t frame = 0; frame < MAX_FRAME_DRAWS; frame++) {
+		for (std::vector<FamilyPool>& threadPools : this->_pools[frame]) {
+			for (FamilyPool& familyPool : threadPools) {
+				vkDestroyCommandPool(this->_logicalDevice, familyPool.commandPool, nullptr);
+			}
+		}
+	}
+}
+
+void VulkanCommandPoolManager::beginFrame(uint32_t frameIndex) {
+	this->_frameIndex = frameIndex % MAX_FRAME_DRAWS;
+
+	for (std::vector<FamilyPool>& threadPools : this->_pools[this->_frameIndex]) {
+		for (FamilyPool& familyPool : threadPools) {
+			if (familyPool.primaries.usedCount == 0 && familyPool.secondaries.usedCount == 0) {
+				continue;
+			}
+
+			// One reset returns every buffer of the pool to the initial state; the handles stay valid.
+			VkResult result = vkResetCommandPool(this->_logicalDevice, familyPool.commandPool, 0);
+			if (result != VK_SUCCESS) {
+				ThrowErr::runtime("Failed to reset a command pool!..");
+			}
+
+			familyPool.primaries.usedCount = 0;
+			familyPool.secondaries.usedCount = 0;
+		}
+	}
+}
+
+VkCommandBuffer VulkanCommandPoolManager::acquire(uint32_t threadIndex, uint32_t queueFamilyIndex, VkCommandBufferLevel level) {
+	FamilyPool& familyPool = this->_getFamilyPool(threadIndex, queueFamilyIndex);
+	LevelBuffers& levelBuffers = level == VK_COMMAND_BUFFER_LEVEL_PRIMARY ? familyPool.primaries : familyPool.secondaries;
+
+	if (levelBuffers.usedCount == levelBuffers.commandBuffers.size()) {
+		VkCommandBufferAllocateInfo cbAllocInfo = {};
+		cbAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		cbAllocInfo.commandPool = familyPool.commandPool;
+		cbAllocInfo.level = level;
+		cbAllocInfo.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer;
+		VkResult result = vkAllocateCommandBuffers(this->_logicalDevice, &cbAllocInfo, &commandBuffer);
+		if (result != VK_SUCCESS) {
+			ThrowErr::runtime("Failed to allocate command buffers!..");
+		}
+
+		levelBuffers.commandBuffers.push_back(commandBuffer);
+	}
+
+	return levelBuffers.commandBuffers[levelBuffers.usedCount++];
+}
+
+uint32_t VulkanCommandPoolManager::getThreadCount() {
+	return static_cast<uint32_t>(this->_pools[0].size());
+}
+
+VulkanCommandPoolStats VulkanCommandPoolManager::getStats() {
+	VulkanCommandPoolStats stats = {};
+
+	for (uint32_t frame = 0; frame < MAX_FRAME_DRAWS; frame++) {
+		for (std::vector<FamilyPool>& threadPools : this->_pools[frame]) {
+			for (FamilyPool& familyPool : threadPools) {
+				stats.poolCount++;
+				stats.allocatedBuffers += static_cast<uint32_t>(
+					familyPool.primaries.commandBuffers.size() + familyPool.secondaries.commandBuffers.size());
+
+				if (frame == this->_frameIndex) {
+					stats.acquiredLastFrame += familyPool.primaries.usedCount + familyPool.secondaries.usedCount;
+				}
+			}
+		}
+	}
+
+	return stats;
+}
+
+VulkanCommandPoolManager::FamilyPool& VulkanCommandPoolManager::_getFamilyPool(uint32_t threadIndex, uint32_t queueFamilyIndex) {
+	if (threadIndex >= this->_pools[this->_frameIndex].size()) {
+		ThrowErr::runtime("Command pool requested for an unknown thread!..");
+	}
+
+	std::vector<FamilyPool>& threadPools = this->_pools[this->_frameIndex][threadIndex];
+	for (FamilyPool& familyPool : threadPools) {
+		if (familyPool.queueFamilyIndex == queueFamilyIndex) {
+			return familyPool;
+		}
+	}
+
+	// Created lazily by the owning thread, which is the only one that ever reads this list.
+	VkCommandPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+	poolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+
+	FamilyPool familyPool;
+	familyPool.queueFamilyIndex = queueFamilyIndex;
+
+	VkResult result = vkCreateCommandPool(this->_logicalDevice, &poolCreateInfo, nullptr, &familyPool.commandPool);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to create a command pool!..");
+	}
+
+	threadPools.push_back(familyPool);
+	return threadPools.back();
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <algorithm>
+#include "QEngine.h"
+#include "VulkanUtilities.h"
+
+struct VulkanCommandPoolStats {
+	uint32_t poolCount = 0;
+	uint32_t allocatedBuffers = 0;
+	uint32_t acquiredLastFrame = 0;
+};
+
+// Hands out command buffers from TRANSIENT pools keyed by (thread, frame slot, queue family).
+// A thread only ever touches its own pools, so acquire takes no locks; beginFrame resets a slot's
+// pools in one call once its fence has signalled, and the buffers are reused instead of freed.
+class VulkanCommandPoolManager {
+public:
+	VulkanCommandPoolManager(VkDevice logicalDevice, uint32_t threadCount);
+	~VulkanCommandPoolManager();
+
+	void beginFrame(uint32_t frameIndex);
+	VkCommandBuffer acquire(uint32_t threadIndex, uint32_t queueFamilyIndex, VkCommandBufferLevel level);
+
+	uint32_t getThreadCount();
+	VulkanCommandPoolStats getStats();
+private:
+	struct LevelBuffers {
+		std::vector<VkCommandBuffer> commandBuffers;
+		uint32_t usedCount = 0;
+	};
+
+	struct FamilyPool {
+		uint32_t queueFamilyIndex = 0;
+		VkCommandPool commandPool = VK_NULL_HANDLE;
+		LevelBuffers primaries;
+		LevelBuffers secondaries;
+	};
+
+	VkDevice _logicalDevice;
+	uint32_t _frameIndex = 0;
+
+	// Indexed [frame][thread]; each thread's list is short, so the family lookup is a linear scan.
+	std::vector<std::vector<FamilyPool>> _pools[MAX_FRAME_DRAWS];
+
+	FamilyPool& _getFamilyPool(uint32_t threadIndex, uint32_t queueFamilyIndex);
+};
@@ -0,0 +1,155 @@
+#include "VulkanDeletionQueue.h"
+
+VulkanDeletionQueue::VulkanDeletionQueue(VkDevice logicalDevice, VulkanMemoryAllocator* allocator, VulkanFrameSync* frameSync) :
+	_logicalDevice{ logicalDevice }, _allocator{ allocator }, _frameSync{ frameSync } {}
+
+VulkanDeletionQueue::~VulkanDeletionQueue() {
+	// Like every other subsystem, the owner waits for the device before destroying the queue.
+	this->flush();
+}
+
+void VulkanDeletionQueue::destroyBuffer(VkBuffer buffer, VulkanAllocation* allocation, uint64_t lastUsedFrame) {
+	Entry entry = {};
+	entry.type = ObjectType::BUFFER;
+	entry.buffer = buffer;
+	entry.allocation = allocation;
+	this->_push(entry, lastUsedFrame);
+}
+
+void VulkanDeletionQueue::destroyImage(VkImage image, VulkanAllocation* allocation, uint64_t lastUsedFrame) {
+	Entry entry = {};
+	entry.type = ObjectType::IMAGE;
+	entry.image = image;
+	entry.allocation = allocation;
+	this->_push(entry, lastUsedFrame);
+}
+
+void VulkanDeletionQueue::destroyImageView(VkImageView imageView, uint64_t lastUsedFrame) {
+	Entry entry = {};
+	entry.type = ObjectType::IMAGE_VIEW;
+	entry.imageView = imageView;
+	this->_push(entry, lastUsedFrame);
+}
+
+void VulkanDeletionQueue::destroyPipeline(VkPipeline pipeline, uint64_t lastUsedFrame) {
+	Entry entry = {};
+	entry.type = ObjectType::PIPELINE;
+	entry.pipeline = pipeline;
+	this->_push(entry, lastUsedFrame);
+}
+
+void VulkanDeletionQueue::destroyDescriptorPool(VkDescriptorPool descriptorPool, uint64_t lastUsedFrame) {
+	Entry entry = {};
+	entry.type = ObjectType::DESCRIPTOR_POOL;
+	entry.descriptorPool = descriptorPool;
+	this->_push(entry, lastUsedFrame);
+}
+
+void VulkanDeletionQueue::destroySwapchain(VkSwapchainKHR swapchain, uint64_t lastUsedFrame) {
+	Entry entry = {};
+	entry.type = ObjectType::SWAPCHAIN;
+	entry.swapchain = swapchain;
+	this->_push(entry, lastUsedFrame);
+}
+
+void VulkanDeletionQueue::destroySemaphore(VkSemaphore semaphore, uint64_t lastUsedFrame) {
+	Entry entry = {};
+	entry.type = ObjectType::SEMAPHORE;
+	entry.semaphore = semaphore;
+	this->_push(entry, lastUsedFrame);
+}
+
+void VulkanDeletionQueue::freeMemory(VulkanAllocation* allocation, uint64_t lastUsedFrame) {
+	Entry entry = {};
+	entry.type = ObjectType::MEMORY;
+	entry.allocation = allocation;
+	this->_push(entry, lastUsedFrame);
+}
+
+void VulkanDeletionQueue::collect() {
+	if (this->_entries.empty()) {
+		this->_stats.destroyedLastCollect = 0;
+		return;
+	}
+
+	uint64_t completedFrame = this->_frameSync->getCompletedFrame();
+
+	size_t count = 0;
+	while (count < this->_entries.size() && this->_entries[count].frame <= completedFrame) {
+		this->_destroy(this->_entries[count]);
+		count++;
+	}
+
+	this->_entries.erase(this->_entries.begin(), this->_entries.begin() + count);
+
+	this->_stats.pending = static_cast<uint32_t>(this->_entries.size());
+	this->_stats.destroyedLastCollect = static_cast<uint32_t>(count);
+	this->_stats.destroyedTotal += count;
+}
+
+void VulkanDeletionQueue::flush() {
+	// Only valid once the device is idle: everything goes regardless of its frame.
+	for (const Entry& entry : this->_entries) {
+		this->_destroy(entry);
+	}
+
+	this->_stats.destroyedTotal += this->_entries.size();
+	this->_stats.pending = 0;
+	this->_entries.clear();
+}
+
+VulkanDeletionStats VulkanDeletionQueue::getStats() {
+	return this->_stats;
+}
+
+void VulkanDeletionQueue::_push(Entry& entry, uint64_t lastUsedFrame) {
+	// The frame being recorded may still reference the object, so that is the default.
+	entry.frame = lastUsedFrame > 0 ? lastUsedFrame : this->_frameSync->getFrameNumber();
+
+	// Keep the queue sorted; an older explicit frame is held as long as the newest entry, which is safe.
+	if (!this->_entries.empty()) {
+		entry.frame = std::max(entry.frame, this->_entries.back().frame);
+	}
+
+	this->_entries.push_back(entry);
+	this->_stats.pending = static_cast<uint32_t>(this->_entries.size());
+}
+
+void VulkanDeletionQueue::_destroy(const Entry& entry) {
+	switch (entry.type) {
+	case ObjectType::BUFFER:
+		if (entry.allocation != nullptr) {
+			this->_allocator->destroyBuffer(entry.buffer, entry.allocation);
+		}
+		else {
+			vkDestroyBuffer(this->_logicalDevice, entry.buffer, nullptr);
+		}
+		break;
+	case ObjectType::IMAGE:
+		if (entry.allocation != nullptr) {
+			this->_allocator->destroyImage(entry.image, entry.allocation);
+		}
+		else {
+			vkDestroyImage(this->_logicalDevice, entry.image, nullptr);
+		}
+		break;
+	case ObjectType::IMAGE_VIEW:
+		vkDestroyImageView(this->_logicalDevice, entry.imageView, nullptr);
+		break;
+	case ObjectType::PIPELINE:
+		vkDestroyPipeline(this->_logicalDevice, entry.pipeline, nullptr);
+		break;
+	case ObjectType::DESCRIPTOR_POOL:
+		vkDestroyDescriptorPool(this->_logicalDevice, entry.descriptorPool, nullptr);
+		break;
+	case ObjectType::SWAPCHAIN:
+		vkDestroySwapchainKHR(this->_logicalDevice, entry.swapchain, nullptr);
+		break;
+	case ObjectType::SEMAPHORE:
+		vkDestroySemaphore(this->_logicalDevice, entry.semaphore, nullptr);
+		break;
+	case ObjectType::MEMORY:
+		this->_allocator->free(entry.allocation);
+		break;
+	}
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include "QEngine.h"
+#include "VulkanUtilities.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanFrameSync.h"
+
+struct VulkanDeletionStats {
+	uint32_t pending = 0;
+	uint32_t destroyedLastCollect = 0;
+	uint64_t destroyedTotal = 0;
+};
+
+// Destroys GPU objects once the last frame that could reference them has retired on the frame
+// timeline, so teardown during a session (hot reload, streaming eviction, swapchain recreation) never
+// waits for the device. Objects are tagged with the current frame unless the caller knows better;
+// frames only grow, so the queue stays sorted and collect() pops from the front.
+class VulkanDeletionQueue {
+public:
+	VulkanDeletionQueue(VkDevice logicalDevice, VulkanMemoryAllocator* allocator, VulkanFrameSync* frameSync);
+	~VulkanDeletionQueue();
+
+	void destroyBuffer(VkBuffer buffer, VulkanAllocation* allocation, uint64_t lastUsedFrame = 0);
+	void destroyImage(VkImage image, VulkanAllocation* allocation, uint64_t lastUsedFrame = 0);
+	void destroyImageView(VkImageView imageView, uint64_t lastUsedFrame = 0);
+	void destroyPipeline(VkPipeline pipeline, uint64_t lastUsedFrame = 0);
+	void destroyDescriptorPool(VkDescriptorPool descriptorPool, uint64_t lastUsedFrame = 0);
+	void destroySwapchain(VkSwapchainKHR swapchain, uint64_t lastUsedFrame = 0);
+	void destroySemaphore(VkSemaphore semaphore, uint64_t lastUsedFrame = 0);
+	void freeMemory(VulkanAllocation* allocation, uint64_t lastUsedFrame = 0);
+
+	void collect();
+	void flush();
+
+	VulkanDeletionStats getStats();
+private:
+	enum class ObjectType : uint8_t {
+		BUFFER,
+		IMAGE,
+		IMAGE_VIEW,
+		PIPELINE,
+		DESCRIPTOR_POOL,
+		SWAPCHAIN,
+		SEMAPHORE,
+		MEMORY
+	};
+
+	struct Entry {
+		uint64_t frame;
+		ObjectType type;
+		union {
+			VkBuffer buffer;
+			VkImage image;
+			VkImageView imageView;
+			VkPipeline pipeline;
+			VkDescriptorPool descriptorPool;
+			VkSwapchainKHR swapchain;
+			VkSemaphore semaphore;
+		};
+		VulkanAllocation* allocation;
+	};
+
+	VkDevice _logicalDevice;
+	VulkanMemoryAllocator* _allocator;
+	VulkanFrameSync* _frameSync;
+
+	std::vector<Entry> _entries;
+	VulkanDeletionStats _stats;
+
+	void _push(Entry& entry, uint64_t lastUsedFrame);
+	void _destroy(const Entry& entry);
+};
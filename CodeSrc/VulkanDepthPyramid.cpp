@@ -0,0 +1,242 @@
+#include "VulkanDepthPyramid.h"
+
+static uint32_t previousPowerOfTwo(uint32_t value) {
+	uint32_t result = 1;
+	while (result * 2 <= value) {
+		result *= 2;
+	}
+
+	return result;
+}
+
+VulkanDepthPyramid::VulkanDepthPyramid(
+	VkDevice logicalDevice, VulkanMemoryAllocator* allocator, VulkanDeletionQueue* deletionQueue,
+	VulkanBindlessDescriptors* bindlessDescriptors, VkExtent2D extent) :
+	_logicalDevice{ logicalDevice }, _allocator{ allocator }, _deletionQueue{ deletionQueue },
+	_bindlessDescriptors{ bindlessDescriptors } {
+	this->_createPipeline();
+	this->_createSampler();
+	this->_createResources(extent);
+}
+
+VulkanDepthPyramid::~VulkanDepthPyramid() {
+	// The device is idle by now, so nothing has to wait for the deletion queue.
+	this->_bindlessDescriptors->releaseTexture(this->_depthSlot);
+	this->_bindlessDescriptors->releaseBuffer(this->_pyramidSlot);
+
+	vkDestroyImageView(this->_logicalDevice, this->_depthImageView, nullptr);
+	this->_allocator->destroyImage(this->_depthImage, this->_depthAllocation);
+	this->_allocator->destroyBuffer(this->_pyramidBuffer, this->_pyramidAllocation);
+
+	vkDestroySampler(this->_logicalDevice, this->_sampler, nullptr);
+	vkDestroyPipeline(this->_logicalDevice, this->_pipeline, nullptr);
+}
+
+void VulkanDepthPyramid::resize(VkExtent2D extent) {
+	if (extent.width == this->_depthExtent.width && extent.height == this->_depthExtent.height) {
+		return;
+	}
+
+	this->_destroyResources();
+	this->_createResources(extent);
+}
+
+void VulkanDepthPyramid::recordBuild(VkCommandBuffer commandBuffer) {
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, this->_pipeline);
+	this->_bindlessDescriptors->bind(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE);
+
+	// Each level reads the one the previous dispatch wrote; the graph only orders whole passes.
+	VkBufferMemoryBarrier2 levelBarrier = {};
+	levelBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+	levelBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	levelBarrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+	levelBarrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+	levelBarrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+	levelBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	levelBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	levelBarrier.buffer = this->_pyramidBuffer;
+	levelBarrier.offset = 0;
+	levelBarrier.size = VK_WHOLE_SIZE;
+
+	VkDependencyInfo dependencyInfo = {};
+	dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependencyInfo.bufferMemoryBarrierCount = 1;
+	dependencyInfo.pBufferMemoryBarriers = &levelBarrier;
+
+	uint32_t sourceWidth = this->_depthExtent.width;
+	uint32_t sourceHeight = this->_depthExtent.height;
+	uint32_t width = this->_pyramidExtent.width;
+	uint32_t height = this->_pyramidExtent.height;
+
+	for (uint32_t level = 0; level < this->_levelCount; level++) {
+		if (level > 0) {
+			vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+		}
+
+		VulkanDepthPyramidPushConstants pushConstants = {};
+		pushConstants.depthTexture = this->_depthSlot;
+		pushConstants.pyramidSlot = this->_pyramidSlot;
+		pushConstants.sourceOffset = level > 0 ? this->_levelOffsets[level - 1] : 0;
+		pushConstants.destinationOffset = this->_levelOffsets[level];
+		pushConstants.sourceSize[0] = sourceWidth;
+		pushConstants.sourceSize[1] = sourceHeight;
+		pushConstants.destinationSize[0] = width;
+		pushConstants.destinationSize[1] = height;
+		pushConstants.fromDepth = level == 0 ? 1 : 0;
+		this->_bindlessDescriptors->pushConstants(commandBuffer, pushConstants);
+
+		vkCmdDispatch(commandBuffer, (width + 7) / 8, (height + 7) / 8, 1);
+
+		sourceWidth = width;
+		sourceHeight = height;
+		width = std::max(width / 2, 1u);
+		height = std::max(height / 2, 1u);
+	}
+}
+
+VkImage VulkanDepthPyramid::getDepthImage() {
+	return this->_depthImage;
+}
+
+VkImageView VulkanDepthPyramid::getDepthImageView() {
+	return this->_depthImageView;
+}
+
+VkFormat VulkanDepthPyramid::getDepthFormat() {
+	return DEPTH_PYRAMID_DEPTH_FORMAT;
+}
+
+VkExtent2D VulkanDepthPyramid::getDepthExtent() {
+	return this->_depthExtent;
+}
+
+VkBuffer VulkanDepthPyramid::getPyramidBuffer() {
+	return this->_pyramidBuffer;
+}
+
+uint32_t VulkanDepthPyramid::getPyramidSlot() {
+	return this->_pyramidSlot;
+}
+
+VkExtent2D VulkanDepthPyramid::getPyramidExtent() {
+	return this->_pyramidExtent;
+}
+
+uint32_t VulkanDepthPyramid::getLevelCount() {
+	return this->_levelCount;
+}
+
+void VulkanDepthPyramid::_createPipeline() {
+	VkShaderModule computeShaderModule = ShaderCompiler::VkCompileCompShaderGLSL(this->_logicalDevice, "C:/Users/rdlit/QEngine/Shaders/hiz_build.comp");
+
+	VkComputePipelineCreateInfo pipelineCreateInfo = {};
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineCreateInfo.stage.module = computeShaderModule;
+	pipelineCreateInfo.stage.pName = "main";
+	pipelineCreateInfo.layout = this->_bindlessDescriptors->getPipelineLayout();
+
+	VkResult result = vkCreateComputePipelines(this->_logicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &this->_pipeline);
+
+	vkDestroyShaderModule(this->_logicalDevice, computeShaderModule, nullptr);
+
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to create the depth pyramid pipeline!..");
+	}
+}
+
+void VulkanDepthPyramid::_createSampler() {
+	// The build uses texelFetch; the sampler only completes the bindless texture descriptor.
+	VkSamplerCreateInfo samplerCreateInfo = {};
+	samplerCreateInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerCreateInfo.magFilter = VK_FILTER_NEAREST;
+	samplerCreateInfo.minFilter = VK_FILTER_NEAREST;
+	samplerCreateInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerCreateInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerCreateInfo.maxLod = 0.0f;
+
+	if (vkCreateSampler(this->_logicalDevice, &samplerCreateInfo, nullptr, &this->_sampler) != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to create the depth pyramid sampler!..");
+	}
+}
+
+void VulkanDepthPyramid::_createResources(VkExtent2D extent) {
+	this->_depthExtent = extent;
+
+	VkImageCreateInfo imageCreateInfo = {};
+	imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageCreateInfo.format = DEPTH_PYRAMID_DEPTH_FORMAT;
+	imageCreateInfo.extent = { extent.width, extent.height, 1 };
+	imageCreateInfo.mipLevels = 1;
+	imageCreateInfo.arrayLayers = 1;
+	imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageCreateInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+	imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	this->_depthAllocation = this->_allocator->createImage(imageCreateInfo, VulkanMemoryUsage::GPU_ONLY, &this->_depthImage);
+
+	VkImageViewCreateInfo viewCreateInfo = {};
+	viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewCreateInfo.image = this->_depthImage;
+	viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewCreateInfo.format = DEPTH_PYRAMID_DEPTH_FORMAT;
+	viewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+	viewCreateInfo.subresourceRange.levelCount = 1;
+	viewCreateInfo.subresourceRange.layerCount = 1;
+
+	if (vkCreateImageView(this->_logicalDevice, &viewCreateInfo, nullptr, &this->_depthImageView) != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to create the depth image view!..");
+	}
+
+	this->_depthSlot = this->_bindlessDescriptors->registerTexture(this->_depthImageView, this->_sampler);
+
+	this->_pyramidExtent.width = previousPowerOfTwo(extent.width);
+	this->_pyramidExtent.height = previousPowerOfTwo(extent.height);
+
+	uint32_t width = this->_pyramidExtent.width;
+	uint32_t height = this->_pyramidExtent.height;
+	uint32_t texelCount = 0;
+
+	this->_levelCount = 0;
+	while (this->_levelCount < DEPTH_PYRAMID_MAX_LEVELS) {
+		this->_levelOffsets[this->_levelCount++] = texelCount;
+		texelCount += width * height;
+		if (width == 1 && height == 1) {
+			break;
+		}
+
+		width = std::max(width / 2, 1u);
+		height = std::max(height / 2, 1u);
+	}
+
+	VkBufferCreateInfo bufferCreateInfo = {};
+	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferCreateInfo.size = sizeof(float) * texelCount;
+	bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	this->_pyramidAllocation = this->_allocator->createBuffer(bufferCreateInfo, VulkanMemoryUsage::GPU_ONLY, &this->_pyramidBuffer);
+	this->_pyramidSlot = this->_bindlessDescriptors->registerBuffer(this->_pyramidBuffer);
+}
+
+void VulkanDepthPyramid::_destroyResources() {
+	// Frames still in flight may read either one; both go once those frames retire.
+	this->_bindlessDescriptors->releaseTexture(this->_depthSlot);
+	this->_bindlessDescriptors->releaseBuffer(this->_pyramidSlot);
+
+	this->_deletionQueue->destroyImageView(this->_depthImageView);
+	this->_deletionQueue->destroyImage(this->_depthImage, this->_depthAllocation);
+	this->_deletionQueue->destroyBuffer(this->_pyramidBuffer, this->_pyramidAllocation);
+
+	this->_depthImageView = VK_NULL_HANDLE;
+	this->_depthImage = VK_NULL_HANDLE;
+	this->_depthAllocation = nullptr;
+	this->_pyramidBuffer = VK_NULL_HANDLE;
+	this->_pyramidAllocation = nullptr;
+}
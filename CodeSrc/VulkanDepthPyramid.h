@@ -0,0 +1,73 @@
+#pragma once
+#include "QEngine.h"
+#include "VulkanUtilities.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanDeletionQueue.h"
+#include "VulkanBindlessDescriptors.h"
+#include "ShaderCompiler.h"
+
+const VkFormat DEPTH_PYRAMID_DEPTH_FORMAT = VK_FORMAT_D32_SFLOAT;
+const uint32_t DEPTH_PYRAMID_MAX_LEVELS = 16;
+
+struct VulkanDepthPyramidPushConstants {
+	uint32_t depthTexture;
+	uint32_t pyramidSlot;
+	uint32_t sourceOffset;
+	uint32_t destinationOffset;
+	uint32_t sourceSize[2];
+	uint32_t destinationSize[2];
+	uint32_t fromDepth;
+};
+
+// The frame's depth buffer and its hierarchical-Z pyramid. Every pyramid texel holds the farthest depth
+// of the texels it covers one level down, so a bounding box whose nearest depth lies behind one texel is
+// hidden by whatever was drawn there. Level 0 is the depth extent rounded down to powers of two, which
+// lets every later level halve exactly; the first reduction reads the up to 3x3 depth texels each
+// texel covers so nothing is skipped. The levels are packed one after another in a storage buffer that
+// the cull shader reads through a bindless slot. Both are render graph imports; resize() replaces
+// them with the swapchain and retires the old ones through the deletion queue.
+class VulkanDepthPyramid {
+public:
+	VulkanDepthPyramid(
+		VkDevice logicalDevice, VulkanMemoryAllocator* allocator, VulkanDeletionQueue* deletionQueue,
+		VulkanBindlessDescriptors* bindlessDescriptors, VkExtent2D extent);
+	~VulkanDepthPyramid();
+
+	void resize(VkExtent2D extent);
+	void recordBuild(VkCommandBuffer commandBuffer);
+
+	VkImage getDepthImage();
+	VkImageView getDepthImageView();
+	VkFormat getDepthFormat();
+	VkExtent2D getDepthExtent();
+	VkBuffer getPyramidBuffer();
+	uint32_t getPyramidSlot();
+	VkExtent2D getPyramidExtent();
+	uint32_t getLevelCount();
+private:
+	VkDevice _logicalDevice;
+	VulkanMemoryAllocator* _allocator;
+	VulkanDeletionQueue* _deletionQueue;
+	VulkanBindlessDescriptors* _bindlessDescriptors;
+
+	VkPipeline _pipeline = VK_NULL_HANDLE;
+	VkSampler _sampler = VK_NULL_HANDLE;
+
+	VkExtent2D _depthExtent = { 0, 0 };
+	VkImage _depthImage = VK_NULL_HANDLE;
+	VulkanAllocation* _depthAllocation = nullptr;
+	VkImageView _depthImageView = VK_NULL_HANDLE;
+	uint32_t _depthSlot = QSlotAllocator::INVALID_SLOT;
+
+	VkExtent2D _pyramidExtent = { 0, 0 };
+	uint32_t _levelCount = 0;
+	uint32_t _levelOffsets[DEPTH_PYRAMID_MAX_LEVELS];
+	VkBuffer _pyramidBuffer = VK_NULL_HANDLE;
+	VulkanAllocation* _pyramidAllocation = nullptr;
+	uint32_t _pyramidSlot = QSlotAllocator::INVALID_SLOT;
+
+	void _createPipeline();
+	void _createSampler();
+	void _createResources(VkExtent2D extent);
+	void _destroyResources();
+};
@@ -0,0 +1,324 @@
+#include "VulkanDescriptorAllocator.h"
+
+static bool isBufferDescriptor(VkDescriptorType type) {
+	return type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER ||
+		type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC || type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+}
+
+template <typename T>
+static void hashCombine(uint64_t& hash, T value) {
+	uint64_t bits = 0;
+	memcpy(&bits, &value, std::min(sizeof(T), sizeof(bits)));
+
+	// FNV-1a over the eight bytes of the value.
+	for (uint32_t i = 0; i < 8; i++) {
+		hash ^= (bits >> (i * 8)) & 0xff;
+		hash *= 1099511628211ull;
+	}
+}
+
+static uint64_t hashWrites(VkDescriptorSetLayout layout, const std::vector<VulkanDescriptorWrite>& writes) {
+	uint64_t hash = 14695981039346656037ull;
+	hashCombine(hash, layout);
+
+	for (const VulkanDescriptorWrite& write : writes) {
+		hashCombine(hash, write.binding);
+		hashCombine(hash, write.type);
+		hashCombine(hash, write.buffer);
+		hashCombine(hash, write.offset);
+		hashCombine(hash, write.range);
+		hashCombine(hash, write.sampler);
+		hashCombine(hash, write.imageView);
+		hashCombine(hash, write.imageLayout);
+	}
+
+	return hash;
+}
+
+VulkanDescriptorWrite VulkanDescriptorWrite::forBuffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset, VkDeviceSize range) {
+	VulkanDescriptorWrite write;
+	write.binding = binding;
+	write.type = type;
+	write.buffer = buffer;
+	write.offset = offset;
+	write.range = range;
+	return write;
+}
+
+VulkanDescriptorWrite VulkanDescriptorWrite::forImage(
+	uint32_t binding, VkDescriptorType type, VkImageView imageView, VkSampler sampler, VkImageLayout imageLayout) {
+	VulkanDescriptorWrite write;
+	write.binding = binding;
+	write.type = type;
+	write.imageView = imageView;
+	write.sampler = sampler;
+	write.imageLayout = imageLayout;
+	return write;
+}
+
+bool VulkanDescriptorWrite::operator==(const VulkanDescriptorWrite& other) const {
+	return this->binding == other.binding && this->type == other.type &&
+		this->buffer == other.buffer && this->offset == other.offset && this->range == other.range &&
+		this->sampler == other.sampler && this->imageView == other.imageView && this->imageLayout == other.imageLayout;
+}
+
+VulkanDescriptorAllocator::VulkanDescriptorAllocator(VkDevice logicalDevice) : _logicalDevice{ logicalDevice } {
+}
+
+VulkanDescriptorAllocator::~VulkanDescriptorAllocator() {
+	for (PoolGroup& group : this->_transient) {
+		this->_destroyGroup(group);
+	}
+
+	this->_destroyGroup(this->_persistent);
+
+	for (VkDescriptorPool pool : this->_updateAfterBindPools) {
+		vkDestroyDescriptorPool(this->_logicalDevice, pool, nullptr);
+	}
+}
+
+void VulkanDescriptorAllocator::beginFrame(uint32_t frameIndex) {
+	std::lock_guard<std::mutex> lock(this->_mutex);
+
+	// The slot's fence has signalled, so none of the sets handed out the last time it was current are in use.
+	this->_frameIndex = frameIndex % MAX_FRAME_DRAWS;
+	this->_resetGroup(this->_transient[this->_frameIndex]);
+	this->_stats.transientSetsLastFrame = 0;
+}
+
+VkDescriptorSet VulkanDescriptorAllocator::allocateTransient(VkDescriptorSetLayout layout, const std::vector<VulkanDescriptorWrite>& writes) {
+	std::lock_guard<std::mutex> lock(this->_mutex);
+
+	VkDescriptorSet set = this->_allocate(this->_transient[this->_frameIndex], layout, writes);
+	this->_writeSet(set, writes);
+	this->_stats.transientSetsLastFrame++;
+
+	return set;
+}
+
+VkDescriptorSet VulkanDescriptorAllocator::getPersistent(VkDescriptorSetLayout layout, const std::vector<VulkanDescriptorWrite>& writes) {
+	std::lock_guard<std::mutex> lock(this->_mutex);
+
+	std::vector<PersistentSet>& bucket = this->_persistentSets[hashWrites(layout, writes)];
+	for (const PersistentSet& entry : bucket) {
+		if (entry.layout == layout && entry.writes == writes) {
+			this->_stats.persistentHits++;
+			return entry.set;
+		}
+	}
+
+	PersistentSet entry;
+	entry.layout = layout;
+	entry.writes = writes;
+	entry.set = this->_allocate(this->_persistent, layout, writes);
+	this->_writeSet(entry.set, writes);
+	bucket.push_back(entry);
+	this->_stats.persistentSets++;
+
+	return entry.set;
+}
+
+void VulkanDescriptorAllocator::resetPersistent() {
+	// Without FREE_DESCRIPTOR_SET_BIT sets cannot be returned one by one; the caller guarantees the GPU is idle.
+	std::lock_guard<std::mutex> lock(this->_mutex);
+
+	this->_resetGroup(this->_persistent);
+	this->_persistentSets.clear();
+	this->_stats.persistentSets = 0;
+}
+
+VkDescriptorSet VulkanDescriptorAllocator::allocateUpdateAfterBind(
+	VkDescriptorSetLayout layout, const std::vector<VkDescriptorPoolSize>& poolSizes) {
+	std::lock_guard<std::mutex> lock(this->_mutex);
+
+	VkDescriptorPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+	poolCreateInfo.maxSets = 1;
+	poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolCreateInfo.pPoolSizes = poolSizes.data();
+
+	VkDescriptorPool pool;
+	VkResult result = vkCreateDescriptorPool(this->_logicalDevice, &poolCreateInfo, nullptr, &pool);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to create an update-after-bind descriptor pool!..");
+	}
+
+	this->_updateAfterBindPools.push_back(pool);
+
+	VkDescriptorSetAllocateInfo setAllocInfo = {};
+	setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setAllocInfo.descriptorPool = pool;
+	setAllocInfo.descriptorSetCount = 1;
+	setAllocInfo.pSetLayouts = &layout;
+
+	VkDescriptorSet set;
+	result = vkAllocateDescriptorSets(this->_logicalDevice, &setAllocInfo, &set);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to allocate an update-after-bind descriptor set!..");
+	}
+
+	return set;
+}
+
+VulkanDescriptorAllocatorStats VulkanDescriptorAllocator::getStats() {
+	std::lock_guard<std::mutex> lock(this->_mutex);
+
+	VulkanDescriptorAllocatorStats stats = this->_stats;
+	for (const PoolGroup& group : this->_transient) {
+		stats.transientPools += static_cast<uint32_t>(group.usedPools.size() + group.freePools.size());
+	}
+	stats.persistentPools = static_cast<uint32_t>(this->_persistent.usedPools.size() + this->_persistent.freePools.size());
+	stats.updateAfterBindPools = static_cast<uint32_t>(this->_updateAfterBindPools.size());
+
+	return stats;
+}
+
+VkDescriptorSet VulkanDescriptorAllocator::_allocate(
+	PoolGroup& group, VkDescriptorSetLayout layout, const std::vector<VulkanDescriptorWrite>& writes) {
+	// Record usage first so a pool created for this request already has room for its descriptor types.
+	group.observedSets++;
+	for (const VulkanDescriptorWrite& write : writes) {
+		group.observedDescriptors[write.type]++;
+	}
+
+	VkDescriptorSetAllocateInfo setAllocInfo = {};
+	setAllocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+	setAllocInfo.descriptorSetCount = 1;
+	setAllocInfo.pSetLayouts = &layout;
+
+	VkDescriptorSet set = VK_NULL_HANDLE;
+	if (group.current != VK_NULL_HANDLE) {
+		setAllocInfo.descriptorPool = group.current;
+		if (vkAllocateDescriptorSets(this->_logicalDevice, &setAllocInfo, &set) == VK_SUCCESS) {
+			return set;
+		}
+	}
+
+	// Recycled pools were sized for older usage and may lack a type, so keep going until a fresh pool also fails.
+	while (true) {
+		bool freshPool = group.freePools.empty();
+		setAllocInfo.descriptorPool = this->_nextPool(group);
+
+		VkResult result = vkAllocateDescriptorSets(this->_logicalDevice, &setAllocInfo, &set);
+		if (result == VK_SUCCESS) {
+			return set;
+		}
+
+		if (freshPool || (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL)) {
+			ThrowErr::runtime("Failed to allocate a descriptor set!..");
+		}
+	}
+}
+
+VkDescriptorPool VulkanDescriptorAllocator::_nextPool(PoolGroup& group) {
+	VkDescriptorPool pool;
+
+	if (!group.freePools.empty()) {
+		pool = group.freePools.back();
+		group.freePools.pop_back();
+	}
+	else {
+		pool = this->_createPool(group);
+	}
+
+	group.usedPools.push_back(pool);
+	group.current = pool;
+
+	return pool;
+}
+
+VkDescriptorPool VulkanDescriptorAllocator::_createPool(PoolGroup& group) {
+	uint32_t setCount = group.setsPerPool;
+	group.setsPerPool = std::min(group.setsPerPool * 2, DESCRIPTOR_POOL_MAX_SETS);
+
+	std::vector<VkDescriptorPoolSize> poolSizes;
+	for (uint32_t type = 0; type < DESCRIPTOR_TYPE_COUNT; type++) {
+		if (group.observedDescriptors[type] == 0) {
+			continue;
+		}
+
+		uint64_t perPool = (group.observedDescriptors[type] * setCount + group.observedSets - 1) / group.observedSets;
+
+		VkDescriptorPoolSize poolSize = {};
+		poolSize.type = static_cast<VkDescriptorType>(type);
+		poolSize.descriptorCount = static_cast<uint32_t>(std::max<uint64_t>(perPool, 1));
+		poolSizes.push_back(poolSize);
+	}
+
+	VkDescriptorPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolCreateInfo.maxSets = setCount;
+	poolCreateInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+	poolCreateInfo.pPoolSizes = poolSizes.data();
+
+	VkDescriptorPool pool;
+	VkResult result = vkCreateDescriptorPool(this->_logicalDevice, &poolCreateInfo, nullptr, &pool);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to create a descriptor pool!..");
+	}
+
+	return pool;
+}
+
+void VulkanDescriptorAllocator::_resetGroup(PoolGroup& group) {
+	for (VkDescriptorPool pool : group.usedPools) {
+		vkResetDescriptorPool(this->_logicalDevice, pool, 0);
+		group.freePools.push_back(pool);
+	}
+
+	group.usedPools.clear();
+	group.current = VK_NULL_HANDLE;
+}
+
+void VulkanDescriptorAllocator::_destroyGroup(PoolGroup& group) {
+	this->_resetGroup(group);
+
+	for (VkDescriptorPool pool : group.freePools) {
+		vkDestroyDescriptorPool(this->_logicalDevice, pool, nullptr);
+	}
+
+	group.freePools.clear();
+}
+
+void VulkanDescriptorAllocator::_writeSet(VkDescriptorSet set, const std::vector<VulkanDescriptorWrite>& writes) {
+	this->_vkWrites.clear();
+	this->_bufferInfos.clear();
+	this->_imageInfos.clear();
+
+	// Reserve up front so the info pointers stored in the writes stay valid.
+	this->_bufferInfos.reserve(writes.size());
+	this->_imageInfos.reserve(writes.size());
+
+	for (const VulkanDescriptorWrite& write : writes) {
+		VkWriteDescriptorSet vkWrite = {};
+		vkWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		vkWrite.dstSet = set;
+		vkWrite.dstBinding = write.binding;
+		vkWrite.descriptorCount = 1;
+		vkWrite.descriptorType = write.type;
+
+		if (isBufferDescriptor(write.type)) {
+			VkDescriptorBufferInfo bufferInfo = {};
+			bufferInfo.buffer = write.buffer;
+			bufferInfo.offset = write.offset;
+			bufferInfo.range = write.range;
+			this->_bufferInfos.push_back(bufferInfo);
+			vkWrite.pBufferInfo = &this->_bufferInfos.back();
+		}
+		else {
+			VkDescriptorImageInfo imageInfo = {};
+			imageInfo.sampler = write.sampler;
+			imageInfo.imageView = write.imageView;
+			imageInfo.imageLayout = write.imageLayout;
+			this->_imageInfos.push_back(imageInfo);
+			vkWrite.pImageInfo = &this->_imageInfos.back();
+		}
+
+		this->_vkWrites.push_back(vkWrite);
+	}
+
+	if (!this->_vkWrites.empty()) {
+		vkUpdateDescriptorSets(this->_logicalDevice, static_cast<uint32_t>(this->_vkWrites.size()), this->_vkWrites.data(), 0, nullptr);
+	}
+}
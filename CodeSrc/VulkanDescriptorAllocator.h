@@ -0,0 +1,94 @@
+#pragma once
+#include <mutex>
+#include <unordered_map>
+#include "QEngine.h"
+#include "VulkanUtilities.h"
+
+const uint32_t DESCRIPTOR_POOL_INITIAL_SETS = 64;
+const uint32_t DESCRIPTOR_POOL_MAX_SETS = 4096;
+const uint32_t DESCRIPTOR_TYPE_COUNT = VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT + 1;
+
+// One descriptor of a set; buffer fields are used for buffer types, image fields for the rest.
+struct VulkanDescriptorWrite {
+	uint32_t binding = 0;
+	VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize range = 0;
+	VkSampler sampler = VK_NULL_HANDLE;
+	VkImageView imageView = VK_NULL_HANDLE;
+	VkImageLayout imageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+	static VulkanDescriptorWrite forBuffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+	static VulkanDescriptorWrite forImage(
+		uint32_t binding, VkDescriptorType type, VkImageView imageView, VkSampler sampler,
+		VkImageLayout imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+	bool operator==(const VulkanDescriptorWrite& other) const;
+};
+
+struct VulkanDescriptorAllocatorStats {
+	uint32_t transientPools = 0;
+	uint32_t persistentPools = 0;
+	uint32_t updateAfterBindPools = 0;
+	uint32_t transientSetsLastFrame = 0;
+	uint32_t persistentSets = 0;
+	uint64_t persistentHits = 0;
+};
+
+// Every descriptor set the renderer allocates. Pools are created without FREE_DESCRIPTOR_SET_BIT so
+// allocation stays a bump inside the driver; new pools are sized from the per-type counts observed so
+// far and grow geometrically. Transient sets live for one frame slot and their pools are reset
+// wholesale after its fence. Persistent sets are keyed by layout and writes, so asking twice for the
+// same tuple returns the same set. Update-after-bind sets, like the bindless table, need a pool created
+// with the matching flag and sized up front, so each gets its own pool for the allocator's lifetime.
+class VulkanDescriptorAllocator {
+public:
+	VulkanDescriptorAllocator(VkDevice logicalDevice);
+	~VulkanDescriptorAllocator();
+
+	void beginFrame(uint32_t frameIndex);
+
+	VkDescriptorSet allocateTransient(VkDescriptorSetLayout layout, const std::vector<VulkanDescriptorWrite>& writes);
+	VkDescriptorSet getPersistent(VkDescriptorSetLayout layout, const std::vector<VulkanDescriptorWrite>& writes);
+	void resetPersistent();
+	VkDescriptorSet allocateUpdateAfterBind(VkDescriptorSetLayout layout, const std::vector<VkDescriptorPoolSize>& poolSizes);
+
+	VulkanDescriptorAllocatorStats getStats();
+private:
+	struct PoolGroup {
+		std::vector<VkDescriptorPool> usedPools;
+		std::vector<VkDescriptorPool> freePools;
+		VkDescriptorPool current = VK_NULL_HANDLE;
+		uint32_t setsPerPool = DESCRIPTOR_POOL_INITIAL_SETS;
+		uint64_t observedSets = 0;
+		uint64_t observedDescriptors[DESCRIPTOR_TYPE_COUNT] = {};
+	};
+
+	struct PersistentSet {
+		VkDescriptorSetLayout layout;
+		std::vector<VulkanDescriptorWrite> writes;
+		VkDescriptorSet set;
+	};
+
+	VkDevice _logicalDevice;
+	uint32_t _frameIndex = 0;
+
+	std::mutex _mutex;
+	PoolGroup _transient[MAX_FRAME_DRAWS];
+	PoolGroup _persistent;
+	std::vector<VkDescriptorPool> _updateAfterBindPools;
+	std::unordered_map<uint64_t, std::vector<PersistentSet>> _persistentSets;
+	VulkanDescriptorAllocatorStats _stats;
+
+	std::vector<VkWriteDescriptorSet> _vkWrites;
+	std::vector<VkDescriptorBufferInfo> _bufferInfos;
+	std::vector<VkDescriptorImageInfo> _imageInfos;
+
+	VkDescriptorSet _allocate(PoolGroup& group, VkDescriptorSetLayout layout, const std::vector<VulkanDescriptorWrite>& writes);
+	VkDescriptorPool _nextPool(PoolGroup& group);
+	VkDescriptorPool _createPool(PoolGroup& group);
+	void _resetGroup(PoolGroup& group);
+	void _destroyGroup(PoolGroup& group);
+	void _writeSet(VkDescriptorSet set, const std::vector<VulkanDescriptorWrite>& writes);
+};
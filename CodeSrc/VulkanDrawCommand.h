@@ -0,0 +1,41 @@
+#pragma once
+#include "QEngine.h"
+
+// One draw as the recorders see it. Indexed when indexBuffer is set (32-bit indices), in which case
+// elementCount/firstElement count indices; otherwise they count vertices. With an indirect buffer the
+// draw is GPU-driven: up to maxDrawCount VkDrawIndexedIndirectCommands are read from it, and the count
+// from countBuffer; the element and instance fields are then unused.
+struct VulkanDrawCommand {
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkBuffer vertexBuffer = VK_NULL_HANDLE;
+	VkBuffer indexBuffer = VK_NULL_HANDLE;
+	uint32_t elementCount = 0;
+	uint32_t instanceCount = 1;
+	uint32_t firstElement = 0;
+	int32_t vertexOffset = 0;
+	uint32_t firstInstance = 0;
+	uint32_t materialIndex = 0;
+	uint32_t objectIndex = 0;
+	VkBuffer indirectBuffer = VK_NULL_HANDLE;
+	VkDeviceSize indirectOffset = 0;
+	VkBuffer countBuffer = VK_NULL_HANDLE;
+	VkDeviceSize countOffset = 0;
+	uint32_t maxDrawCount = 0;
+	// Dynamic offset of the draw's constants in the frame's uniform buffer, bound at set 1. A cached
+	// static draw is re-recorded whenever it changes, so those keep a fixed one.
+	uint32_t uniformOffset = 0;
+};
+
+// Pushed before every draw; shaders find the material and object data through the bindless buffers.
+struct VulkanDrawPushConstants {
+	uint32_t materialIndex;
+	uint32_t objectIndex;
+};
+
+// Constants the renderer writes once per frame; its dynamic draws point uniformOffset at them. Layout matches std140.
+struct VulkanFrameUniforms {
+	float viewProjection[16];
+	float viewportSize[2];
+	uint32_t frameNumber;
+	uint32_t padding;
+};
@@ -0,0 +1,163 @@
+#include "VulkanDrawList.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+static const uint32_t GEOMETRY_SHIFT = 0;
+static const uint32_t OPAQUE_DEPTH_SHIFT = GEOMETRY_SHIFT + DRAW_KEY_GEOMETRY_BITS;
+static const uint32_t OPAQUE_MATERIAL_SHIFT = OPAQUE_DEPTH_SHIFT + DRAW_KEY_DEPTH_BITS;
+static const uint32_t OPAQUE_PIPELINE_SHIFT = OPAQUE_MATERIAL_SHIFT + DRAW_KEY_MATERIAL_BITS;
+static const uint32_t TRANSPARENT_MATERIAL_SHIFT = GEOMETRY_SHIFT + DRAW_KEY_GEOMETRY_BITS;
+static const uint32_t TRANSPARENT_PIPELINE_SHIFT = TRANSPARENT_MATERIAL_SHIFT + DRAW_KEY_MATERIAL_BITS;
+static const uint32_t TRANSPARENT_DEPTH_SHIFT = TRANSPARENT_PIPELINE_SHIFT + DRAW_KEY_PIPELINE_BITS;
+static const uint32_t PASS_SHIFT = 64 - DRAW_KEY_PASS_BITS;
+
+bool VulkanDrawList::GeometryKey::operator==(const GeometryKey& other) const {
+	return this->vertexBuffer == other.vertexBuffer && this->indexBuffer == other.indexBuffer;
+}
+
+size_t VulkanDrawList::GeometryKeyHash::operator()(const GeometryKey& key) const {
+	size_t hash = std::hash<VkBuffer>()(key.vertexBuffer);
+	return hash ^ (std::hash<VkBuffer>()(key.indexBuffer) + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2));
+}
+
+VulkanDrawList::VulkanDrawList(QJobSystem* jobSystem) : _jobSystem{ jobSystem } {}
+
+VulkanDrawList::~VulkanDrawList() {}
+
+void VulkanDrawList::clear() {
+	this->_draws.clear();
+	this->_keys.clear();
+	this->_sortedKeys.clear();
+	this->_sortedDraws.clear();
+	this->_sorted = false;
+}
+
+void VulkanDrawList::add(const VulkanDrawCommand& draw, VulkanDrawPass pass, float viewDepth) {
+	if (draw.materialIndex >= (1u << DRAW_KEY_MATERIAL_BITS)) {
+		ThrowErr::runtime("Failed to add a draw: the material index does not fit the sort key!..");
+	}
+
+	uint32_t pipelineId = this->_getPipelineId(draw.pipeline);
+	uint32_t geometryId = this->_getGeometryId(draw.vertexBuffer, draw.indexBuffer);
+
+	this->_draws.push_back(draw);
+	this->_keys.push_back(VulkanDrawList::makeKey(pass, pipelineId, draw.materialIndex, viewDepth, geometryId));
+	this->_sorted = false;
+}
+
+void VulkanDrawList::sort() {
+	auto start = std::chrono::steady_clock::now();
+
+	uint32_t drawCount = static_cast<uint32_t>(this->_draws.size());
+	this->_order.resize(drawCount);
+	for (uint32_t i = 0; i < drawCount; i++) {
+		this->_order[i] = i;
+	}
+
+	// A copy, so the keys stay paired with the draws if more are added and the list sorted again.
+	this->_sortedKeys.assign(this->_keys.begin(), this->_keys.end());
+	this->_radixSort.sort(this->_sortedKeys.data(), this->_order.data(), drawCount, this->_jobSystem);
+
+	this->_sortedDraws.resize(drawCount);
+	for (uint32_t i = 0; i < drawCount; i++) {
+		this->_sortedDraws[i] = this->_draws[this->_order[i]];
+	}
+
+	// Keys are sorted, so each pass is one run; its start is the first key at or above the pass value.
+	for (uint32_t pass = 0; pass <= static_cast<uint32_t>(VulkanDrawPass::COUNT); pass++) {
+		uint64_t passKey = static_cast<uint64_t>(pass) << PASS_SHIFT;
+		this->_passFirst[pass] = static_cast<uint32_t>(
+			std::lower_bound(this->_sortedKeys.begin(), this->_sortedKeys.end(), passKey) - this->_sortedKeys.begin());
+	}
+
+	this->_sorted = true;
+
+	std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+	this->_stats.drawCount = drawCount;
+	this->_stats.pipelineCount = static_cast<uint32_t>(this->_pipelineIds.size());
+	this->_stats.geometryCount = static_cast<uint32_t>(this->_geometryIds.size());
+	this->_stats.sortPasses = this->_radixSort.getLastPassCount();
+	this->_stats.sortMs = elapsed.count();
+}
+
+QSpan<const VulkanDrawCommand> VulkanDrawList::getDraws() const {
+	const std::vector<VulkanDrawCommand>& draws = this->_sorted ? this->_sortedDraws : this->_draws;
+	return QSpan<const VulkanDrawCommand>(draws.data(), draws.size());
+}
+
+QSpan<const VulkanDrawCommand> VulkanDrawList::getDraws(VulkanDrawPass pass) const {
+	if (!this->_sorted) {
+		ThrowErr::runtime("Failed to get the draws of a pass: the draw list is not sorted!..");
+	}
+
+	uint32_t first = this->_passFirst[static_cast<uint32_t>(pass)];
+	uint32_t last = this->_passFirst[static_cast<uint32_t>(pass) + 1];
+	return QSpan<const VulkanDrawCommand>(this->_sortedDraws.data() + first, last - first);
+}
+
+VulkanDrawListStats VulkanDrawList::getStats() {
+	return this->_stats;
+}
+
+uint64_t VulkanDrawList::makeKey(VulkanDrawPass pass, uint32_t pipelineId, uint32_t materialIndex, float viewDepth, uint32_t geometryId) {
+	uint64_t depth = VulkanDrawList::getDepthBucket(viewDepth);
+	uint64_t key = static_cast<uint64_t>(pass) << PASS_SHIFT;
+
+	if (pass == VulkanDrawPass::TRANSPARENT_GEOMETRY) {
+		uint64_t farToNear = ((1ull << DRAW_KEY_DEPTH_BITS) - 1) - depth;
+		key |= farToNear << TRANSPARENT_DEPTH_SHIFT;
+		key |= static_cast<uint64_t>(pipelineId) << TRANSPARENT_PIPELINE_SHIFT;
+		key |= static_cast<uint64_t>(materialIndex) << TRANSPARENT_MATERIAL_SHIFT;
+	}
+	else {
+		key |= static_cast<uint64_t>(pipelineId) << OPAQUE_PIPELINE_SHIFT;
+		key |= static_cast<uint64_t>(materialIndex) << OPAQUE_MATERIAL_SHIFT;
+		key |= depth << OPAQUE_DEPTH_SHIFT;
+	}
+
+	return key | (static_cast<uint64_t>(geometryId) << GEOMETRY_SHIFT);
+}
+
+uint32_t VulkanDrawList::getDepthBucket(float viewDepth) {
+	// Non-negative floats order like their bit patterns; the top bits are a logarithmic bucket.
+	// Negative depths (behind the camera) and NaN go to the nearest bucket.
+	float depth = viewDepth > 0.0f ? viewDepth : 0.0f;
+
+	uint32_t bits = 0;
+	memcpy(&bits, &depth, sizeof(bits));
+	return bits >> (32 - DRAW_KEY_DEPTH_BITS);
+}
+
+uint32_t VulkanDrawList::_getPipelineId(VkPipeline pipeline) {
+	auto it = this->_pipelineIds.find(pipeline);
+	if (it != this->_pipelineIds.end()) {
+		return it->second;
+	}
+
+	uint32_t id = static_cast<uint32_t>(this->_pipelineIds.size());
+	if (id >= (1u << DRAW_KEY_PIPELINE_BITS)) {
+		ThrowErr::runtime("Failed to add a draw: too many pipelines for the sort key!..");
+	}
+
+	this->_pipelineIds.emplace(pipeline, id);
+	return id;
+}
+
+uint32_t VulkanDrawList::_getGeometryId(VkBuffer vertexBuffer, VkBuffer indexBuffer) {
+	GeometryKey key = { vertexBuffer, indexBuffer };
+
+	auto it = this->_geometryIds.find(key);
+	if (it != this->_geometryIds.end()) {
+		return it->second;
+	}
+
+	uint32_t id = static_cast<uint32_t>(this->_geometryIds.size());
+	if (id >= (1u << DRAW_KEY_GEOMETRY_BITS)) {
+		ThrowErr::runtime("Failed to add a draw: too many geometry buffers for the sort key!..");
+	}
+
+	this->_geometryIds.emplace(key, id);
+	return id;
+}
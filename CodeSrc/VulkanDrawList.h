@@ -0,0 +1,82 @@
+#pragma once
+#include <unordered_map>
+#include "QEngine.h"
+#include "VulkanDrawCommand.h"
+#include "QArenaContainers.h"
+#include "QRadixSort.h"
+#include "QJobSystem.h"
+
+enum class VulkanDrawPass : uint8_t {
+	OPAQUE_GEOMETRY = 0,
+	TRANSPARENT_GEOMETRY,
+	COUNT
+};
+
+const uint32_t DRAW_KEY_PASS_BITS = 4;
+const uint32_t DRAW_KEY_PIPELINE_BITS = 12;
+const uint32_t DRAW_KEY_MATERIAL_BITS = 16;
+const uint32_t DRAW_KEY_DEPTH_BITS = 16;
+const uint32_t DRAW_KEY_GEOMETRY_BITS = 16;
+
+struct VulkanDrawListStats {
+	uint32_t drawCount = 0;
+	uint32_t pipelineCount = 0;
+	uint32_t geometryCount = 0;
+	uint32_t sortPasses = 0;
+	float sortMs = 0.0f;
+};
+
+// The frame's draw packets, each with a 64-bit sort key, put in submission order by a parallel radix
+// sort. Keys are laid out so that sorting groups state changes:
+//   opaque:      pass | pipeline | material | depth | geometry
+//   transparent: pass | far-to-near depth | pipeline | material | geometry
+// Opaque draws change pipeline and material as rarely as possible and go front to back within a state,
+// for early depth rejection. Transparent ones must blend back to front, so depth decides first.
+// Pipelines and geometry (vertex and index buffer pairs) get small ids on first sight that stay fixed,
+// so the same scene sorts the same way every frame. Depth buckets are the top bits of the float, which
+// keeps them ordered and gives near draws finer buckets than far ones.
+class VulkanDrawList {
+public:
+	VulkanDrawList(QJobSystem* jobSystem);
+	~VulkanDrawList();
+
+	void clear();
+	void add(const VulkanDrawCommand& draw, VulkanDrawPass pass, float viewDepth);
+	void sort();
+
+	QSpan<const VulkanDrawCommand> getDraws() const;
+	QSpan<const VulkanDrawCommand> getDraws(VulkanDrawPass pass) const;
+	VulkanDrawListStats getStats();
+
+	static uint64_t makeKey(VulkanDrawPass pass, uint32_t pipelineId, uint32_t materialIndex, float viewDepth, uint32_t geometryId);
+	static uint32_t getDepthBucket(float viewDepth);
+private:
+	struct GeometryKey {
+		VkBuffer vertexBuffer;
+		VkBuffer indexBuffer;
+
+		bool operator==(const GeometryKey& other) const;
+	};
+
+	struct GeometryKeyHash {
+		size_t operator()(const GeometryKey& key) const;
+	};
+
+	QJobSystem* _jobSystem;
+	QRadixSort _radixSort;
+	VulkanDrawListStats _stats;
+
+	std::unordered_map<VkPipeline, uint32_t> _pipelineIds;
+	std::unordered_map<GeometryKey, uint32_t, GeometryKeyHash> _geometryIds;
+
+	std::vector<VulkanDrawCommand> _draws;
+	std::vector<uint64_t> _keys;
+	std::vector<uint64_t> _sortedKeys;
+	std::vector<uint32_t> _order;
+	std::vector<VulkanDrawCommand> _sortedDraws;
+	uint32_t _passFirst[static_cast<uint32_t>(VulkanDrawPass::COUNT) + 1] = {};
+	bool _sorted = false;
+
+	uint32_t _getPipelineId(VkPipeline pipeline);
+	uint32_t _getGeometryId(VkBuffer vertexBuffer, VkBuffer indexBuffer);
+};
@@ -0,0 +1,113 @@
+#include "VulkanFrameSync.h"
+#include <algorithm>
+#include <limits>
+
+VulkanFrameSync::VulkanFrameSync(VkDevice logicalDevice, uint32_t framesInFlight) :
+	_logicalDevice{ logicalDevice },
+	_framesInFlight{ std::max<uint32_t>(1, std::min<uint32_t>(framesInFlight, MAX_FRAME_DRAWS)) } {
+	VkSemaphoreTypeCreateInfo typeCreateInfo = {};
+	typeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	typeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeCreateInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreCreateInfo.pNext = &typeCreateInfo;
+
+	if (vkCreateSemaphore(this->_logicalDevice, &semaphoreCreateInfo, nullptr, &this->_timelineSemaphore) != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to create a frame timeline semaphore!..");
+	}
+
+	semaphoreCreateInfo.pNext = nullptr;
+
+	this->_imagesAvailable.resize(this->_framesInFlight);
+
+	for (uint32_t i = 0; i < this->_framesInFlight; i++) {
+		if (vkCreateSemaphore(this->_logicalDevice, &semaphoreCreateInfo, nullptr, &this->_imagesAvailable[i]) != VK_SUCCESS) {
+			ThrowErr::runtime("Failed to create a image available semaphore!..");
+		}
+	}
+}
+
+VulkanFrameSync::~VulkanFrameSync() {
+	for (uint32_t i = 0; i < this->_framesInFlight; i++) {
+		vkDestroySemaphore(this->_logicalDevice, this->_imagesAvailable[i], nullptr);
+	}
+
+	vkDestroySemaphore(this->_logicalDevice, this->_timelineSemaphore, nullptr);
+}
+
+uint32_t VulkanFrameSync::beginFrame() {
+	// The slot is free once the frame that used it last has retired. A frame that is abandoned before
+	// its submit keeps its number, so a skipped frame never leaves a value nobody will signal.
+	uint64_t frame = this->getFrameNumber();
+	if (frame > this->_framesInFlight) {
+		this->waitForFrame(frame - this->_framesInFlight);
+	}
+
+	return this->getFrameSlot();
+}
+
+void VulkanFrameSync::endFrame() {
+	this->_submittedFrame++;
+}
+
+bool VulkanFrameSync::isFrameRetired(uint64_t frame) {
+	if (frame <= this->_completedFrame) {
+		return true;
+	}
+
+	return this->getCompletedFrame() >= frame;
+}
+
+void VulkanFrameSync::waitForFrame(uint64_t frame) {
+	if (this->isFrameRetired(frame)) {
+		return;
+	}
+
+	if (frame > this->_submittedFrame) {
+		ThrowErr::runtime("Waiting for a frame that was never submitted!..");
+	}
+
+	VkSemaphoreWaitInfo waitInfo = {};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &this->_timelineSemaphore;
+	waitInfo.pValues = &frame;
+
+	VkResult result = vkWaitSemaphores(this->_logicalDevice, &waitInfo, std::numeric_limits<uint64_t>::max());
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to wait for the frame timeline semaphore!..");
+	}
+
+	this->_completedFrame = std::max(this->_completedFrame, frame);
+}
+
+uint64_t VulkanFrameSync::getFrameNumber() {
+	return this->_submittedFrame + 1;
+}
+
+uint64_t VulkanFrameSync::getSubmittedFrame() {
+	return this->_submittedFrame;
+}
+
+uint64_t VulkanFrameSync::getCompletedFrame() {
+	vkGetSemaphoreCounterValue(this->_logicalDevice, this->_timelineSemaphore, &this->_completedFrame);
+	return this->_completedFrame;
+}
+
+uint32_t VulkanFrameSync::getFrameSlot() {
+	return static_cast<uint32_t>(this->getFrameNumber() % this->_framesInFlight);
+}
+
+uint32_t VulkanFrameSync::getFramesInFlight() {
+	return this->_framesInFlight;
+}
+
+VkSemaphore VulkanFrameSync::getTimelineSemaphore() {
+	return this->_timelineSemaphore;
+}
+
+VkSemaphore VulkanFrameSync::getImageAvailable() {
+	return this->_imagesAvailable[this->getFrameSlot()];
+}
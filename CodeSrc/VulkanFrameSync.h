@@ -0,0 +1,42 @@
+#pragma once
+#include <algorithm>
+#include "QEngine.h"
+#include "VulkanUtilities.h"
+
+const uint32_t DEFAULT_FRAMES_IN_FLIGHT = 2;
+
+// Frame pacing on one timeline semaphore for the graphics queue: frame N signals value N when its
+// submission completes, so "has frame N retired" is a counter compare for every subsystem instead of
+// a fence per slot. The number of frames in flight is picked at runtime (1..MAX_FRAME_DRAWS) and
+// frame N records into slot N % framesInFlight. Acquire still needs a binary semaphore, kept per slot
+// here as well; the one present waits on belongs to the swapchain image, since an image can be acquired
+// again by a later slot before its previous present has consumed the semaphore.
+class VulkanFrameSync {
+public:
+	VulkanFrameSync(VkDevice logicalDevice, uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT);
+	~VulkanFrameSync();
+
+	uint32_t beginFrame();
+	void endFrame();
+
+	bool isFrameRetired(uint64_t frame);
+	void waitForFrame(uint64_t frame);
+
+	uint64_t getFrameNumber();
+	uint64_t getSubmittedFrame();
+	uint64_t getCompletedFrame();
+	uint32_t getFrameSlot();
+	uint32_t getFramesInFlight();
+
+	VkSemaphore getTimelineSemaphore();
+	VkSemaphore getImageAvailable();
+private:
+	VkDevice _logicalDevice;
+	uint32_t _framesInFlight;
+
+	VkSemaphore _timelineSemaphore = VK_NULL_HANDLE;
+	std::vector<VkSemaphore> _imagesAvailable;
+
+	uint64_t _submittedFrame = 0;
+	uint64_t _completedFrame = 0;
+};
@@ -0,0 +1,225 @@
+#include "VulkanGpuCuller.h"
+#include "QAllocTracker.h"
+
+VulkanGpuCuller::VulkanGpuCuller(
+	VkDevice logicalDevice, VulkanMemoryAllocator* allocator, VulkanBindlessDescriptors* bindlessDescriptors,
+	VulkanGpuScene* scene, uint32_t frameCount) :
+	_logicalDevice{ logicalDevice }, _allocator{ allocator }, _bindlessDescriptors{ bindlessDescriptors }, _scene{ scene },
+	_frameCount{ frameCount } {
+	if (this->_frameCount == 0 || this->_frameCount > MAX_FRAME_DRAWS) {
+		ThrowErr::runtime("Invalid GPU culler frame count!..");
+	}
+
+	this->_createPipeline();
+	this->_createBuffers();
+}
+
+VulkanGpuCuller::~VulkanGpuCuller() {
+	for (PhaseBuffers& phase : this->_phases) {
+		this->_bindlessDescriptors->releaseBuffer(phase.drawSlot);
+		this->_bindlessDescriptors->releaseBuffer(phase.countSlot);
+
+		this->_allocator->destroyBuffer(phase.drawBuffer, phase.drawAllocation);
+		this->_allocator->destroyBuffer(phase.countBuffer, phase.countAllocation);
+	}
+
+	for (uint32_t i = 0; i < this->_frameCount; i++) {
+		this->_bindlessDescriptors->releaseBuffer(this->_frameStats[i].slot);
+		this->_allocator->destroyBuffer(this->_frameStats[i].buffer, this->_frameStats[i].allocation);
+	}
+
+	this->_bindlessDescriptors->releaseBuffer(this->_visibilitySlot);
+	this->_allocator->destroyBuffer(this->_visibilityBuffer, this->_visibilityAllocation);
+
+	vkDestroyPipeline(this->_logicalDevice, this->_pipeline, nullptr);
+}
+
+void VulkanGpuCuller::beginFrame(uint32_t frameIndex) {
+	// The frame that last wrote this slot's statistics has retired, and its readback barrier made them visible.
+	this->_frameIndex = frameIndex;
+	FrameStats& frame = this->_frameStats[frameIndex];
+
+	if (frame.pending) {
+		memcpy(&this->_stats, frame.allocation->mapped, sizeof(VulkanGpuCullStats));
+		frame.pending = false;
+	}
+}
+
+void VulkanGpuCuller::recordCull(VkCommandBuffer commandBuffer, VulkanGpuCullPhase phase) {
+	QAllocScope allocScope(QAllocTag::CULLING);
+	PhaseBuffers& buffers = this->_phases[static_cast<uint32_t>(phase)];
+	FrameStats& frame = this->_frameStats[this->_frameIndex];
+
+	// Counters start from zero: the phase's draw count, and the statistics once per frame in the early phase.
+	VkBufferMemoryBarrier2 clearBarriers[2] = {};
+	uint32_t clearBarrierCount = 0;
+
+	vkCmdFillBuffer(commandBuffer, buffers.countBuffer, 0, sizeof(uint32_t), 0);
+	clearBarriers[clearBarrierCount++].buffer = buffers.countBuffer;
+
+	if (phase == VulkanGpuCullPhase::EARLY) {
+		vkCmdFillBuffer(commandBuffer, frame.buffer, 0, sizeof(VulkanGpuCullStats), 0);
+		clearBarriers[clearBarrierCount++].buffer = frame.buffer;
+	}
+
+	// The cleared counters must land before the shader's atomics; the graph only orders whole passes.
+	for (uint32_t i = 0; i < clearBarrierCount; i++) {
+		VkBufferMemoryBarrier2& barrier = clearBarriers[i];
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+		barrier.srcStageMask = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+		barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+		barrier.dstStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+		barrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+	}
+
+	VkDependencyInfo dependencyInfo = {};
+	dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependencyInfo.bufferMemoryBarrierCount = clearBarrierCount;
+	dependencyInfo.pBufferMemoryBarriers = clearBarriers;
+	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+
+	uint32_t instanceCount = this->_scene->getInstanceCount();
+	if (instanceCount > 0) {
+		vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, this->_pipeline);
+		this->_bindlessDescriptors->bind(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE);
+
+		// Both phases see the visibility the previous frame's late phase left, so they agree on what
+		// the early phase drew. Entries past its instance count were never written and count as hidden.
+		VulkanGpuCullPushConstants pushConstants = {
+			this->_scene->getParamsSlot(), this->_scene->getSubmeshSlot(), this->_scene->getInstanceSlot(),
+			buffers.drawSlot, buffers.countSlot, this->_visibilitySlot, frame.slot,
+			static_cast<uint32_t>(phase), this->_visibilityCount };
+		this->_bindlessDescriptors->pushConstants(commandBuffer, pushConstants);
+
+		vkCmdDispatch(commandBuffer, (instanceCount + 63) / 64, 1, 1);
+	}
+
+	if (phase == VulkanGpuCullPhase::LATE) {
+		this->_visibilityCount = instanceCount;
+		this->_recordStatsReadback(commandBuffer);
+		frame.pending = true;
+	}
+}
+
+VulkanDrawCommand VulkanGpuCuller::getDrawCommand(VulkanGpuCullPhase phase) {
+	// One instance per indirect command, identified by firstInstance; the push constants carry the
+	// slots the vertex shader needs to fetch the instance and its submesh.
+	PhaseBuffers& buffers = this->_phases[static_cast<uint32_t>(phase)];
+
+	VulkanDrawCommand draw = {};
+	draw.pipeline = this->_scene->getPipeline();
+	draw.vertexBuffer = this->_scene->getVertexBuffer();
+	draw.indexBuffer = this->_scene->getIndexBuffer();
+	draw.materialIndex = this->_scene->getSubmeshSlot();
+	draw.objectIndex = this->_scene->getInstanceSlot();
+	draw.indirectBuffer = buffers.drawBuffer;
+	draw.countBuffer = buffers.countBuffer;
+	draw.maxDrawCount = this->_scene->getInstanceCount();
+
+	return draw;
+}
+
+VkBuffer VulkanGpuCuller::getDrawBuffer(VulkanGpuCullPhase phase) {
+	return this->_phases[static_cast<uint32_t>(phase)].drawBuffer;
+}
+
+VkBuffer VulkanGpuCuller::getCountBuffer(VulkanGpuCullPhase phase) {
+	return this->_phases[static_cast<uint32_t>(phase)].countBuffer;
+}
+
+VkBuffer VulkanGpuCuller::getVisibilityBuffer() {
+	return this->_visibilityBuffer;
+}
+
+VkBuffer VulkanGpuCuller::getStatsBuffer() {
+	return this->_frameStats[this->_frameIndex].buffer;
+}
+
+VulkanGpuCullStats VulkanGpuCuller::getStats() {
+	return this->_stats;
+}
+
+void VulkanGpuCuller::_createPipeline() {
+	VkShaderModule computeShaderModule = ShaderCompiler::VkCompileCompShaderGLSL(this->_logicalDevice, "C:/Users/rdlit/QEngine/Shaders/gpu_cull.comp");
+
+	VkComputePipelineCreateInfo pipelineCreateInfo = {};
+	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineCreateInfo.stage.module = computeShaderModule;
+	pipelineCreateInfo.stage.pName = "main";
+	pipelineCreateInfo.layout = this->_bindlessDescriptors->getPipelineLayout();
+
+	VkResult result = vkCreateComputePipelines(this->_logicalDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &this->_pipeline);
+
+	vkDestroyShaderModule(this->_logicalDevice, computeShaderModule, nullptr);
+
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to create the GPU cull pipeline!..");
+	}
+}
+
+void VulkanGpuCuller::_createBuffers() {
+	// Exclusive to one family at a time; the render graph transfers ownership between the cull and draw passes.
+	VkBufferCreateInfo bufferCreateInfo = {};
+	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	for (PhaseBuffers& phase : this->_phases) {
+		bufferCreateInfo.size = sizeof(VkDrawIndexedIndirectCommand) * this->_scene->getMaxInstances();
+		bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+
+		phase.drawAllocation = this->_allocator->createBuffer(bufferCreateInfo, VulkanMemoryUsage::GPU_ONLY, &phase.drawBuffer);
+		phase.drawSlot = this->_bindlessDescriptors->registerBuffer(phase.drawBuffer);
+
+		bufferCreateInfo.size = sizeof(uint32_t);
+		bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+		phase.countAllocation = this->_allocator->createBuffer(bufferCreateInfo, VulkanMemoryUsage::GPU_ONLY, &phase.countBuffer);
+		phase.countSlot = this->_bindlessDescriptors->registerBuffer(phase.countBuffer);
+	}
+
+	bufferCreateInfo.size = sizeof(uint32_t) * this->_scene->getMaxInstances();
+	bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+
+	this->_visibilityAllocation = this->_allocator->createBuffer(bufferCreateInfo, VulkanMemoryUsage::GPU_ONLY, &this->_visibilityBuffer);
+	this->_visibilitySlot = this->_bindlessDescriptors->registerBuffer(this->_visibilityBuffer);
+
+	bufferCreateInfo.size = sizeof(VulkanGpuCullStats);
+	bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+	for (uint32_t i = 0; i < this->_frameCount; i++) {
+		FrameStats& frame = this->_frameStats[i];
+		frame.allocation = this->_allocator->createBuffer(bufferCreateInfo, VulkanMemoryUsage::GPU_TO_CPU, &frame.buffer);
+		if (frame.allocation->mapped == nullptr) {
+			ThrowErr::runtime("GPU cull statistics memory is not host visible!..");
+		}
+
+		frame.slot = this->_bindlessDescriptors->registerBuffer(frame.buffer);
+	}
+}
+
+void VulkanGpuCuller::_recordStatsReadback(VkCommandBuffer commandBuffer) {
+	// Device writes reach the host only through a barrier to the host stage; the frame fence then orders the read.
+	VkBufferMemoryBarrier2 hostBarrier = {};
+	hostBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+	hostBarrier.srcStageMask = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+	hostBarrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT;
+	hostBarrier.dstStageMask = VK_PIPELINE_STAGE_2_HOST_BIT;
+	hostBarrier.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+	hostBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	hostBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	hostBarrier.buffer = this->_frameStats[this->_frameIndex].buffer;
+	hostBarrier.offset = 0;
+	hostBarrier.size = VK_WHOLE_SIZE;
+
+	VkDependencyInfo dependencyInfo = {};
+	dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependencyInfo.bufferMemoryBarrierCount = 1;
+	dependencyInfo.pBufferMemoryBarriers = &hostBarrier;
+	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include "QEngine.h"
+#include "VulkanUtilities.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanBindlessDescriptors.h"
+#include "VulkanDrawCommand.h"
+#include "VulkanGpuScene.h"
+#include "ShaderCompiler.h"
+
+enum class VulkanGpuCullPhase : uint8_t {
+	EARLY = 0,
+	LATE,
+	COUNT
+};
+
+struct VulkanGpuCullPushConstants {
+	uint32_t paramsSlot;
+	uint32_t submeshSlot;
+	uint32_t instanceSlot;
+	uint32_t drawSlot;
+	uint32_t countSlot;
+	uint32_t visibilitySlot;
+	uint32_t statsSlot;
+	uint32_t phase;
+	uint32_t visibilityCount;
+};
+
+// What one frame's culling did. The four instance counts add up to the scene's instance count; the
+// triangle counts are the same split weighted by each submesh's triangles. Layout matches gpu_cull.comp.
+struct VulkanGpuCullStats {
+	uint32_t earlyInstances = 0;
+	uint32_t earlyTriangles = 0;
+	uint32_t lateInstances = 0;
+	uint32_t lateTriangles = 0;
+	uint32_t frustumCulledInstances = 0;
+	uint32_t frustumCulledTriangles = 0;
+	uint32_t occlusionCulledInstances = 0;
+	uint32_t occlusionCulledTriangles = 0;
+};
+
+// Culls the GPU scene in compute dispatches that write the surviving instances straight into indirect
+// draw buffers and draw counts, so the CPU never sees per-instance visibility. Culling runs in two
+// phases around the depth pyramid build. The early phase draws what was visible last frame and is
+// still inside the frustum; the late phase tests every instance against the pyramid built from that
+// depth, records the result for the next frame and draws only the newly visible ones. Whatever was
+// visible is drawn in one of the two, so nothing pops in when the camera moves.
+//
+// The draw, count and visibility buffers and the current frame's statistics buffer are render graph
+// imports: the graph orders the cull passes against the draws and moves the buffers between queue
+// families when the early phase runs on async compute. Statistics are read back once their frame slot
+// comes around again, so getStats() lags by the number of frames in flight.
+class VulkanGpuCuller {
+public:
+	VulkanGpuCuller(
+		VkDevice logicalDevice, VulkanMemoryAllocator* allocator, VulkanBindlessDescriptors* bindlessDescriptors,
+		VulkanGpuScene* scene, uint32_t frameCount);
+	~VulkanGpuCuller();
+
+	void beginFrame(uint32_t frameIndex);
+	void recordCull(VkCommandBuffer commandBuffer, VulkanGpuCullPhase phase);
+	VulkanDrawCommand getDrawCommand(VulkanGpuCullPhase phase);
+
+	VkBuffer getDrawBuffer(VulkanGpuCullPhase phase);
+	VkBuffer getCountBuffer(VulkanGpuCullPhase phase);
+	VkBuffer getVisibilityBuffer();
+	VkBuffer getStatsBuffer();
+	VulkanGpuCullStats getStats();
+private:
+	struct PhaseBuffers {
+		VkBuffer drawBuffer = VK_NULL_HANDLE;
+		VulkanAllocation* drawAllocation = nullptr;
+		uint32_t drawSlot = QSlotAllocator::INVALID_SLOT;
+		VkBuffer countBuffer = VK_NULL_HANDLE;
+		VulkanAllocation* countAllocation = nullptr;
+		uint32_t countSlot = QSlotAllocator::INVALID_SLOT;
+	};
+
+	struct FrameStats {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VulkanAllocation* allocation = nullptr;
+		uint32_t slot = QSlotAllocator::INVALID_SLOT;
+		bool pending = false;
+	};
+
+	VkDevice _logicalDevice;
+	VulkanMemoryAllocator* _allocator;
+	VulkanBindlessDescriptors* _bindlessDescriptors;
+	VulkanGpuScene* _scene;
+	uint32_t _frameCount;
+	uint32_t _frameIndex = 0;
+
+	VkPipeline _pipeline = VK_NULL_HANDLE;
+
+	PhaseBuffers _phases[static_cast<uint32_t>(VulkanGpuCullPhase::COUNT)];
+
+	VkBuffer _visibilityBuffer = VK_NULL_HANDLE;
+	VulkanAllocation* _visibilityAllocation = nullptr;
+	uint32_t _visibilitySlot = QSlotAllocator::INVALID_SLOT;
+	uint32_t _visibilityCount = 0;
+
+	FrameStats _frameStats[MAX_FRAME_DRAWS];
+	VulkanGpuCullStats _stats;
+
+	void _createPipeline();
+	void _createBuffers();
+	void _recordStatsReadback(VkCommandBuffer commandBuffer);
+};
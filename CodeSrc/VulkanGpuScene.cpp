@@ -0,0 +1,217 @@
+#include "VulkanGpuScene.h"
+#include <cmath>
+
+// The largest minStorageBufferOffsetAlignment the spec allows, so the ranges suit every device.
+const VkDeviceSize GPU_SCENE_RANGE_ALIGNMENT = 256;
+
+static VkDeviceSize alignRange(VkDeviceSize size) {
+	return (size + GPU_SCENE_RANGE_ALIGNMENT - 1) / GPU_SCENE_RANGE_ALIGNMENT * GPU_SCENE_RANGE_ALIGNMENT;
+}
+
+VulkanGpuScene::VulkanGpuScene(
+	VulkanMemoryAllocator* allocator, VulkanBindlessDescriptors* bindlessDescriptors, uint32_t frameCount,
+	uint32_t graphicsFamily, uint32_t computeFamily, uint32_t maxInstances, uint32_t maxSubmeshes) :
+	_allocator{ allocator }, _bindlessDescriptors{ bindlessDescriptors }, _frameCount{ frameCount },
+	_maxInstances{ maxInstances }, _maxSubmeshes{ maxSubmeshes } {
+	if (this->_frameCount == 0 || this->_frameCount > MAX_FRAME_DRAWS) {
+		ThrowErr::runtime("Invalid GPU scene frame count!..");
+	}
+
+	for (uint32_t i = 0; i < 16; i++) {
+		this->_viewProjection[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+	}
+
+	this->_submeshes.reserve(this->_maxSubmeshes);
+	this->_instances.reserve(this->_maxInstances);
+
+	this->_createFrameBuffers(graphicsFamily, computeFamily);
+}
+
+VulkanGpuScene::~VulkanGpuScene() {
+	for (uint32_t i = 0; i < this->_frameCount; i++) {
+		FrameBuffers& frame = this->_frames[i];
+		this->_bindlessDescriptors->releaseBuffer(frame.paramsSlot);
+		this->_bindlessDescriptors->releaseBuffer(frame.submeshSlot);
+		this->_bindlessDescriptors->releaseBuffer(frame.instanceSlot);
+		this->_allocator->destroyBuffer(frame.buffer, frame.allocation);
+	}
+}
+
+uint32_t VulkanGpuScene::addSubmesh(const VulkanGpuSubmesh& submesh) {
+	if (this->_submeshes.size() >= this->_maxSubmeshes) {
+		ThrowErr::runtime("GPU scene submesh capacity exceeded!..");
+	}
+
+	this->_submeshes.push_back(submesh);
+	for (uint32_t i = 0; i < this->_frameCount; i++) {
+		this->_frames[i].submeshesDirty = true;
+	}
+
+	return static_cast<uint32_t>(this->_submeshes.size() - 1);
+}
+
+uint32_t VulkanGpuScene::addInstance(const VulkanGpuInstance& instance) {
+	if (this->_instances.size() >= this->_maxInstances) {
+		ThrowErr::runtime("GPU scene instance capacity exceeded!..");
+	}
+
+	this->_instances.emplace_back();
+	uint32_t index = static_cast<uint32_t>(this->_instances.size() - 1);
+	this->setInstance(index, instance);
+
+	return index;
+}
+
+void VulkanGpuScene::setInstance(uint32_t index, const VulkanGpuInstance& instance) {
+	if (index >= this->_instances.size() || instance.submeshIndex >= this->_submeshes.size()) {
+		ThrowErr::runtime("Invalid GPU scene instance!..");
+	}
+
+	// The cull shader scales the bounding radius by the longest basis vector instead of decomposing the matrix.
+	VulkanGpuInstance& stored = this->_instances[index];
+	stored = instance;
+
+	float maxScaleSquared = 0.0f;
+	for (uint32_t column = 0; column < 3; column++) {
+		float lengthSquared = 0.0f;
+		for (uint32_t row = 0; row < 3; row++) {
+			float value = instance.transform[row * 4 + column];
+			lengthSquared += value * value;
+		}
+		maxScaleSquared = std::max(maxScaleSquared, lengthSquared);
+	}
+	stored.maxScale = std::sqrt(maxScaleSquared);
+
+	this->_markInstancesDirty();
+}
+
+void VulkanGpuScene::clearInstances() {
+	this->_instances.clear();
+	this->_markInstancesDirty();
+}
+
+void VulkanGpuScene::setGeometry(VkPipeline pipeline, VkBuffer vertexBuffer, VkBuffer indexBuffer) {
+	this->_pipeline = pipeline;
+	this->_vertexBuffer = vertexBuffer;
+	this->_indexBuffer = indexBuffer;
+}
+
+void VulkanGpuScene::setViewProjection(const float viewProjection[16]) {
+	memcpy(this->_viewProjection, viewProjection, sizeof(this->_viewProjection));
+}
+
+void VulkanGpuScene::setDepthPyramid(uint32_t bufferSlot, VkExtent2D extent, uint32_t levelCount) {
+	this->_pyramidBuffer = bufferSlot;
+	this->_pyramidExtent = extent;
+	this->_pyramidLevelCount = levelCount;
+}
+
+void VulkanGpuScene::beginFrame(uint32_t frameIndex) {
+	// Called once the frame that last used the slot has retired, so its buffer can be rewritten in place.
+	this->_frameIndex = frameIndex;
+	FrameBuffers& frame = this->_frames[frameIndex];
+	char* mapped = static_cast<char*>(frame.allocation->mapped);
+
+	if (frame.submeshesDirty) {
+		if (!this->_submeshes.empty()) {
+			memcpy(mapped + this->_submeshOffset, this->_submeshes.data(), sizeof(VulkanGpuSubmesh) * this->_submeshes.size());
+		}
+		frame.submeshesDirty = false;
+	}
+	if (frame.instancesDirty) {
+		if (!this->_instances.empty()) {
+			memcpy(mapped + this->_instanceOffset, this->_instances.data(), sizeof(VulkanGpuInstance) * this->_instances.size());
+		}
+		frame.instancesDirty = false;
+	}
+
+	this->_writeParams(*reinterpret_cast<VulkanGpuCullParams*>(mapped));
+}
+
+uint32_t VulkanGpuScene::getInstanceCount() {
+	return static_cast<uint32_t>(this->_instances.size());
+}
+
+uint32_t VulkanGpuScene::getMaxInstances() {
+	return this->_maxInstances;
+}
+
+uint32_t VulkanGpuScene::getParamsSlot() {
+	return this->_frames[this->_frameIndex].paramsSlot;
+}
+
+uint32_t VulkanGpuScene::getSubmeshSlot() {
+	return this->_frames[this->_frameIndex].submeshSlot;
+}
+
+uint32_t VulkanGpuScene::getInstanceSlot() {
+	return this->_frames[this->_frameIndex].instanceSlot;
+}
+
+VkPipeline VulkanGpuScene::getPipeline() {
+	return this->_pipeline;
+}
+
+VkBuffer VulkanGpuScene::getVertexBuffer() {
+	return this->_vertexBuffer;
+}
+
+VkBuffer VulkanGpuScene::getIndexBuffer() {
+	return this->_indexBuffer;
+}
+
+void VulkanGpuScene::_createFrameBuffers(uint32_t graphicsFamily, uint32_t computeFamily) {
+	VkDeviceSize paramsSize = alignRange(sizeof(VulkanGpuCullParams));
+	VkDeviceSize submeshSize = alignRange(sizeof(VulkanGpuSubmesh) * this->_maxSubmeshes);
+	VkDeviceSize instanceSize = alignRange(sizeof(VulkanGpuInstance) * this->_maxInstances);
+
+	this->_submeshOffset = paramsSize;
+	this->_instanceOffset = paramsSize + submeshSize;
+
+	uint32_t queueFamilies[] = { graphicsFamily, computeFamily };
+
+	VkBufferCreateInfo bufferCreateInfo = {};
+	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferCreateInfo.size = paramsSize + submeshSize + instanceSize;
+	bufferCreateInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+	if (graphicsFamily != computeFamily) {
+		bufferCreateInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+		bufferCreateInfo.queueFamilyIndexCount = 2;
+		bufferCreateInfo.pQueueFamilyIndices = queueFamilies;
+	}
+	else {
+		bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+	}
+
+	for (uint32_t i = 0; i < this->_frameCount; i++) {
+		FrameBuffers& frame = this->_frames[i];
+		frame.allocation = this->_allocator->createBuffer(bufferCreateInfo, VulkanMemoryUsage::CPU_TO_GPU, &frame.buffer);
+		if (frame.allocation->mapped == nullptr) {
+			ThrowErr::runtime("GPU scene memory is not host visible!..");
+		}
+
+		frame.paramsSlot = this->_bindlessDescriptors->registerBuffer(frame.buffer, 0, paramsSize);
+		frame.submeshSlot = this->_bindlessDescriptors->registerBuffer(frame.buffer, this->_submeshOffset, submeshSize);
+		frame.instanceSlot = this->_bindlessDescriptors->registerBuffer(frame.buffer, this->_instanceOffset, instanceSize);
+	}
+}
+
+void VulkanGpuScene::_markInstancesDirty() {
+	for (uint32_t i = 0; i < this->_frameCount; i++) {
+		this->_frames[i].instancesDirty = true;
+	}
+}
+
+void VulkanGpuScene::_writeParams(VulkanGpuCullParams& params) {
+	QFrustumCuller::extractPlanes(this->_viewProjection, params.frustumPlanes);
+
+	memcpy(params.viewProjection, this->_viewProjection, sizeof(params.viewProjection));
+	params.pyramidSize[0] = this->_pyramidExtent.width;
+	params.pyramidSize[1] = this->_pyramidExtent.height;
+	params.pyramidBuffer = this->_pyramidBuffer;
+	params.pyramidLevelCount = this->_pyramidLevelCount;
+	params.instanceCount = static_cast<uint32_t>(this->_instances.size());
+	params.maxDraws = this->_maxInstances;
+	params.padding[0] = 0;
+	params.padding[1] = 0;
+}
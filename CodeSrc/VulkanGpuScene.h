@@ -0,0 +1,117 @@
+#pragma once
+#include "QEngine.h"
+#include "VulkanUtilities.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanBindlessDescriptors.h"
+#include "QFrustumCuller.h"
+
+const uint32_t GPU_SCENE_MAX_INSTANCES = 65536;
+const uint32_t GPU_SCENE_MAX_SUBMESHES = 4096;
+
+// A range of the shared index buffer with its object-space bounding sphere. Layout matches gpu_cull.comp (std430).
+struct VulkanGpuSubmesh {
+	float boundsCenter[3] = { 0.0f, 0.0f, 0.0f };
+	float boundsRadius = 0.0f;
+	uint32_t indexCount = 0;
+	uint32_t firstIndex = 0;
+	int32_t vertexOffset = 0;
+	uint32_t materialIndex = 0;
+};
+
+// One placed submesh. The transform is the top three rows of a row-major affine matrix.
+struct VulkanGpuInstance {
+	float transform[12] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f };
+	uint32_t submeshIndex = 0;
+	uint32_t objectIndex = 0;
+	float maxScale = 1.0f;
+	uint32_t padding = 0;
+};
+
+// Per-frame culling inputs: world-space frustum planes (xyz normal pointing inside, w distance) and what
+// the late occlusion test needs to project into this frame's depth pyramid. Occlusion is off while
+// pyramidBuffer is INVALID.
+struct VulkanGpuCullParams {
+	float frustumPlanes[6][4];
+	float viewProjection[16];
+	uint32_t pyramidSize[2];
+	uint32_t pyramidBuffer;
+	uint32_t pyramidLevelCount;
+	uint32_t instanceCount;
+	uint32_t maxDraws;
+	uint32_t padding[2];
+};
+
+// Instances and submeshes of the GPU-driven path, kept in host-visible storage buffers with one copy per
+// frame in flight so the CPU never writes what an earlier frame is still reading. A change is copied into
+// each copy as its frame comes around; an unchanged scene costs one small parameter write per frame.
+// Buffers are shared by the graphics and compute families. Shaders reach everything through the
+// bindless slots of the current frame: the cull pass through its push constants, vertex shaders through
+// gl_InstanceIndex (the instance index) plus the instance buffer slot in VulkanDrawPushConstants::objectIndex.
+// The pipeline given to setGeometry() must render with a depth attachment of VulkanDepthPyramid's format.
+class VulkanGpuScene {
+public:
+	static const uint32_t INVALID = UINT32_MAX;
+
+	VulkanGpuScene(
+		VulkanMemoryAllocator* allocator, VulkanBindlessDescriptors* bindlessDescriptors, uint32_t frameCount,
+		uint32_t graphicsFamily, uint32_t computeFamily,
+		uint32_t maxInstances = GPU_SCENE_MAX_INSTANCES, uint32_t maxSubmeshes = GPU_SCENE_MAX_SUBMESHES);
+	~VulkanGpuScene();
+
+	uint32_t addSubmesh(const VulkanGpuSubmesh& submesh);
+	uint32_t addInstance(const VulkanGpuInstance& instance);
+	void setInstance(uint32_t index, const VulkanGpuInstance& instance);
+	void clearInstances();
+
+	void setGeometry(VkPipeline pipeline, VkBuffer vertexBuffer, VkBuffer indexBuffer);
+	void setViewProjection(const float viewProjection[16]);
+	void setDepthPyramid(uint32_t bufferSlot, VkExtent2D extent, uint32_t levelCount);
+
+	void beginFrame(uint32_t frameIndex);
+
+	uint32_t getInstanceCount();
+	uint32_t getMaxInstances();
+	uint32_t getParamsSlot();
+	uint32_t getSubmeshSlot();
+	uint32_t getInstanceSlot();
+	VkPipeline getPipeline();
+	VkBuffer getVertexBuffer();
+	VkBuffer getIndexBuffer();
+private:
+	struct FrameBuffers {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VulkanAllocation* allocation = nullptr;
+		uint32_t paramsSlot = INVALID;
+		uint32_t submeshSlot = INVALID;
+		uint32_t instanceSlot = INVALID;
+		bool submeshesDirty = true;
+		bool instancesDirty = true;
+	};
+
+	VulkanMemoryAllocator* _allocator;
+	VulkanBindlessDescriptors* _bindlessDescriptors;
+	uint32_t _frameCount;
+	uint32_t _maxInstances;
+	uint32_t _maxSubmeshes;
+	uint32_t _frameIndex = 0;
+
+	VkDeviceSize _submeshOffset = 0;
+	VkDeviceSize _instanceOffset = 0;
+	FrameBuffers _frames[MAX_FRAME_DRAWS];
+
+	std::vector<VulkanGpuSubmesh> _submeshes;
+	std::vector<VulkanGpuInstance> _instances;
+
+	VkPipeline _pipeline = VK_NULL_HANDLE;
+	VkBuffer _vertexBuffer = VK_NULL_HANDLE;
+	VkBuffer _indexBuffer = VK_NULL_HANDLE;
+
+	float _viewProjection[16];
+	uint32_t _pyramidBuffer = INVALID;
+	VkExtent2D _pyramidExtent = { 0, 0 };
+	uint32_t _pyramidLevelCount = 0;
+
+	void _createFrameBuffers(uint32_t graphicsFamily, uint32_t computeFamily);
+	void _markInstancesDirty();
+	void _writeParams(VulkanGpuCullParams& params);
+};
@@ -0,0 +1,206 @@
+#include "VulkanGraphSubmitter.h"
+
+VulkanGraphSubmitter::VulkanGraphSubmitter(
+	VkDevice logicalDevice, VulkanCommandPoolManager* commandPoolManager, VulkanQueueProfiler* profiler,
+	VkQueue graphicsQueue, uint32_t graphicsFamily, VkQueue computeQueue, uint32_t computeFamily) :
+	_logicalDevice{ logicalDevice }, _commandPoolManager{ commandPoolManager }, _profiler{ profiler } {
+	this->_queues[static_cast<uint32_t>(VulkanGraphQueue::GRAPHICS)].queue = graphicsQueue;
+	this->_queues[static_cast<uint32_t>(VulkanGraphQueue::GRAPHICS)].family = graphicsFamily;
+	this->_queues[static_cast<uint32_t>(VulkanGraphQueue::ASYNC_COMPUTE)].queue = computeQueue;
+	this->_queues[static_cast<uint32_t>(VulkanGraphQueue::ASYNC_COMPUTE)].family = computeFamily;
+
+	VkSemaphoreTypeCreateInfo typeCreateInfo = {};
+	typeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	typeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeCreateInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreCreateInfo.pNext = &typeCreateInfo;
+
+	for (QueueSlot& slot : this->_queues) {
+		if (vkCreateSemaphore(this->_logicalDevice, &semaphoreCreateInfo, nullptr, &slot.timeline) != VK_SUCCESS) {
+			ThrowErr::runtime("Failed to create a queue timeline semaphore!..");
+		}
+	}
+}
+
+VulkanGraphSubmitter::~VulkanGraphSubmitter() {
+	for (QueueSlot& slot : this->_queues) {
+		vkDestroySemaphore(this->_logicalDevice, slot.timeline, nullptr);
+	}
+}
+
+void VulkanGraphSubmitter::submit(VulkanRenderGraph* graph, const VulkanGraphFrameSubmit& frame) {
+	uint32_t batchCount = graph->getBatchCount();
+
+	bool hasCompute = false;
+	for (uint32_t i = 0; i < batchCount; i++) {
+		hasCompute = hasCompute || graph->getBatchQueue(i) == VulkanGraphQueue::ASYNC_COMPUTE;
+	}
+
+	// Graphics-only frames keep the prefix in the first batch's submission, as before async compute.
+	bool prefixPending = true;
+	bool frameWaitsPending = true;
+	uint64_t prefixValue = 0;
+
+	if (hasCompute || batchCount == 0) {
+		this->_beginSubmission();
+		this->_addPrefix(frame);
+		if (batchCount == 0) {
+			this->_addFrameWaits(frame);
+			this->_addFrameSignals(frame);
+		}
+
+		prefixValue = this->_flush(VulkanGraphQueue::GRAPHICS);
+		prefixPending = false;
+	}
+
+	this->_batchValues.assign(batchCount, 0);
+	bool firstCompute = true;
+
+	for (uint32_t i = 0; i < batchCount; i++) {
+		VulkanGraphQueue queue = graph->getBatchQueue(i);
+		this->_beginSubmission();
+
+		if (queue == VulkanGraphQueue::GRAPHICS) {
+			if (prefixPending) {
+				this->_addPrefix(frame);
+				prefixPending = false;
+			}
+			if (frameWaitsPending) {
+				this->_addFrameWaits(frame);
+				frameWaitsPending = false;
+			}
+		}
+		else if (firstCompute) {
+			this->_addWait(
+				this->_queues[static_cast<uint32_t>(VulkanGraphQueue::GRAPHICS)].timeline, prefixValue,
+				VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+			firstCompute = false;
+		}
+
+		// Batches wait on the whole other queue; finer stages would need the producer's stage per resource.
+		uint32_t wait = graph->getBatchWait(i);
+		if (wait != VulkanRenderGraph::INVALID) {
+			this->_addWait(
+				this->_queues[static_cast<uint32_t>(graph->getBatchQueue(wait))].timeline, this->_batchValues[wait],
+				VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+		}
+
+		this->_submission.commandBuffers.push_back(this->_recordBatch(graph, i));
+
+		if (i == batchCount - 1) {
+			this->_addFrameSignals(frame);
+		}
+
+		this->_batchValues[i] = this->_flush(queue);
+	}
+}
+
+VkSemaphore VulkanGraphSubmitter::getTimelineSemaphore(VulkanGraphQueue queue) {
+	return this->_queues[static_cast<uint32_t>(queue)].timeline;
+}
+
+uint64_t VulkanGraphSubmitter::getTimelineValue(VulkanGraphQueue queue) {
+	return this->_queues[static_cast<uint32_t>(queue)].value;
+}
+
+void VulkanGraphSubmitter::_beginSubmission() {
+	this->_submission.waitSemaphores.clear();
+	this->_submission.waitValues.clear();
+	this->_submission.waitStages.clear();
+	this->_submission.commandBuffers.clear();
+	this->_submission.signalSemaphores.clear();
+	this->_submission.signalValues.clear();
+}
+
+void VulkanGraphSubmitter::_addWait(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags stages) {
+	this->_submission.waitSemaphores.push_back(semaphore);
+	this->_submission.waitValues.push_back(value);
+	this->_submission.waitStages.push_back(stages);
+}
+
+void VulkanGraphSubmitter::_addPrefix(const VulkanGraphFrameSubmit& frame) {
+	for (size_t i = 0; i < frame.prefixWaitSemaphores.size(); i++) {
+		if (frame.prefixWaitValues[i] > 0) {
+			this->_addWait(frame.prefixWaitSemaphores[i], frame.prefixWaitValues[i], VK_PIPELINE_STAGE_ALL_COMMANDS_BIT);
+		}
+	}
+
+	for (VkCommandBuffer commandBuffer : frame.prefixCommandBuffers) {
+		this->_submission.commandBuffers.push_back(commandBuffer);
+	}
+}
+
+void VulkanGraphSubmitter::_addFrameWaits(const VulkanGraphFrameSubmit& frame) {
+	for (size_t i = 0; i < frame.waitSemaphores.size(); i++) {
+		this->_addWait(frame.waitSemaphores[i], 0, frame.waitStages[i]);
+	}
+}
+
+void VulkanGraphSubmitter::_addFrameSignals(const VulkanGraphFrameSubmit& frame) {
+	for (size_t i = 0; i < frame.signalSemaphores.size(); i++) {
+		this->_submission.signalSemaphores.push_back(frame.signalSemaphores[i]);
+		this->_submission.signalValues.push_back(frame.signalValues[i]);
+	}
+}
+
+VkCommandBuffer VulkanGraphSubmitter::_recordBatch(VulkanRenderGraph* graph, uint32_t batch) {
+	VulkanGraphQueue queue = graph->getBatchQueue(batch);
+	VkCommandBuffer commandBuffer = this->_commandPoolManager->acquire(
+		0, this->_queues[static_cast<uint32_t>(queue)].family, VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+
+	VkCommandBufferBeginInfo commandBufferBeginInfo = {};
+	commandBufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	commandBufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	VkResult result = vkBeginCommandBuffer(commandBuffer, &commandBufferBeginInfo);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to start recording a render graph batch!..");
+	}
+
+	this->_profiler->beginBatch(commandBuffer, queue);
+	graph->executeBatch(batch, commandBuffer);
+	this->_profiler->endBatch(commandBuffer, queue);
+
+	result = vkEndCommandBuffer(commandBuffer);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to stop recording a render graph batch!..");
+	}
+
+	return commandBuffer;
+}
+
+uint64_t VulkanGraphSubmitter::_flush(VulkanGraphQueue queue) {
+	QueueSlot& slot = this->_queues[static_cast<uint32_t>(queue)];
+
+	slot.value++;
+	this->_submission.signalSemaphores.push_back(slot.timeline);
+	this->_submission.signalValues.push_back(slot.value);
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(this->_submission.waitValues.size());
+	timelineInfo.pWaitSemaphoreValues = this->_submission.waitValues.data();
+	timelineInfo.signalSemaphoreValueCount = static_cast<uint32_t>(this->_submission.signalValues.size());
+	timelineInfo.pSignalSemaphoreValues = this->_submission.signalValues.data();
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.waitSemaphoreCount = static_cast<uint32_t>(this->_submission.waitSemaphores.size());
+	submitInfo.pWaitSemaphores = this->_submission.waitSemaphores.data();
+	submitInfo.pWaitDstStageMask = this->_submission.waitStages.data();
+	submitInfo.commandBufferCount = static_cast<uint32_t>(this->_submission.commandBuffers.size());
+	submitInfo.pCommandBuffers = this->_submission.commandBuffers.data();
+	submitInfo.signalSemaphoreCount = static_cast<uint32_t>(this->_submission.signalSemaphores.size());
+	submitInfo.pSignalSemaphores = this->_submission.signalSemaphores.data();
+
+	VkResult result = vkQueueSubmit(slot.queue, 1, &submitInfo, VK_NULL_HANDLE);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to submit a render graph batch!..");
+	}
+
+	return slot.value;
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "QEngine.h"
+#include "VulkanUtilities.h"
+#include "VulkanRenderGraph.h"
+#include "VulkanCommandPoolManager.h"
+#include "VulkanQueueProfiler.h"
+#include "QArenaContainers.h"
+
+// What the frame adds around the graph. The prefix command buffers (upload acquires, defrag copies) run
+// on graphics ahead of every batch after waiting on the prefix timelines; the binary wait semaphores
+// (image acquire) gate the first graphics batch and the signals go with the last one.
+struct VulkanGraphFrameSubmit {
+	QSpan<const VkCommandBuffer> prefixCommandBuffers;
+	QSpan<const VkSemaphore> prefixWaitSemaphores;
+	QSpan<const uint64_t> prefixWaitValues;
+	QSpan<const VkSemaphore> waitSemaphores;
+	QSpan<const VkPipelineStageFlags> waitStages;
+	QSpan<const VkSemaphore> signalSemaphores;
+	QSpan<const uint64_t> signalValues;
+};
+
+// Records and submits a compiled render graph batch by batch on the graphics and compute queues.
+// Every batch signals its queue's timeline semaphore; a batch that depends on the other queue waits
+// for that batch's value. With compute work in the frame, the prefix gets a graphics submission of its
+// own which the first compute batch waits for, so compute never sees resources the prefix has not
+// handed over yet, nor overtakes the previous frame's graphics work.
+class VulkanGraphSubmitter {
+public:
+	VulkanGraphSubmitter(
+		VkDevice logicalDevice, VulkanCommandPoolManager* commandPoolManager, VulkanQueueProfiler* profiler,
+		VkQueue graphicsQueue, uint32_t graphicsFamily, VkQueue computeQueue, uint32_t computeFamily);
+	~VulkanGraphSubmitter();
+
+	void submit(VulkanRenderGraph* graph, const VulkanGraphFrameSubmit& frame);
+
+	VkSemaphore getTimelineSemaphore(VulkanGraphQueue queue);
+	uint64_t getTimelineValue(VulkanGraphQueue queue);
+private:
+	struct QueueSlot {
+		VkQueue queue = VK_NULL_HANDLE;
+		uint32_t family = 0;
+		VkSemaphore timeline = VK_NULL_HANDLE;
+		uint64_t value = 0;
+	};
+
+	struct Submission {
+		std::vector<VkSemaphore> waitSemaphores;
+		std::vector<uint64_t> waitValues;
+		std::vector<VkPipelineStageFlags> waitStages;
+		std::vector<VkCommandBuffer> commandBuffers;
+		std::vector<VkSemaphore> signalSemaphores;
+		std::vector<uint64_t> signalValues;
+	};
+
+	VkDevice _logicalDevice;
+	VulkanCommandPoolManager* _commandPoolManager;
+	VulkanQueueProfiler* _profiler;
+	QueueSlot _queues[static_cast<uint32_t>(VulkanGraphQueue::COUNT)];
+
+	std::vector<uint64_t> _batchValues;
+	Submission _submission;
+
+	void _beginSubmission();
+	void _addWait(VkSemaphore semaphore, uint64_t value, VkPipelineStageFlags stages);
+	void _addPrefix(const VulkanGraphFrameSubmit& frame);
+	void _addFrameWaits(const VulkanGraphFrameSubmit& frame);
+	void _addFrameSignals(const VulkanGraphFrameSubmit& frame);
+	VkCommandBuffer _recordBatch(VulkanRenderGraph* graph, uint32_t batch);
+	uint64_t _flush(VulkanGraphQueue queue);
+};
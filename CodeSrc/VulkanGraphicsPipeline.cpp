@@ -1,9 +1,8 @@
 #include "VulkanGraphicsPipeline.h"
 
 VulkanGraphicsPipeline::VulkanGraphicsPipeline(
-	VkDevice logicalDevice, VkExtent2D swapchainExtent, VkFormat swapchainImageFormat) : _logicalDevice{ logicalDevice }, _swapchainImageFormat{ swapchainImageFormat } {
-	this->_createRenderPass();
-
+	VkDevice logicalDevice, VkFormat colorFormat, VkPipelineLayout pipelineLayout, VkFormat depthFormat) :
+	_logicalDevice{ logicalDevice }, _pipelineLayout{ pipelineLayout }, _colorFormat{ colorFormat }, _depthFormat{ depthFormat } {
 	VkShaderModule vertexShaderModule = ShaderCompiler::VkCompileVertShaderGLSL(this->_logicalDevice, "C:/Users/rdlit/QEngine/Shaders/test_shader.vert");
 	VkShaderModule fragmentShaderModule = ShaderCompiler::VkCompileFragShaderGLSL(this->_logicalDevice, "C:/Users/rdlit/QEngine/Shaders/test_shader.frag");
 
@@ -33,24 +32,12 @@ VulkanGraphicsPipeline::VulkanGraphicsPipeline(
 	inputAssemblyCreateInfo.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
 	inputAssemblyCreateInfo.primitiveRestartEnable = VK_FALSE;
 
-	VkViewport viewport = {};
-	viewport.x = 0.0f;
-	viewport.y = 0.0f;
-	viewport.width = swapchainExtent.width;
-	viewport.height = swapchainExtent.height;
-	viewport.minDepth = 0.0f;
-	viewport.maxDepth = 1.0f;
-
-	VkRect2D scissor = {};
-	scissor.offset = { 0, 0 };
-	scissor.extent = swapchainExtent;
-
 	VkPipelineViewportStateCreateInfo viewportStateCreateInfo = {};
 	viewportStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 	viewportStateCreateInfo.viewportCount = 1;
-	viewportStateCreateInfo.pViewports = &viewport;
+	viewportStateCreateInfo.pViewports = nullptr;
 	viewportStateCreateInfo.scissorCount = 1;
-	viewportStateCreateInfo.pScissors = &scissor;
+	viewportStateCreateInfo.pScissors = nullptr;
 
 	std::vector<VkDynamicState> dynamicStateEnables;
 	dynamicStateEnables.push_back(VK_DYNAMIC_STATE_VIEWPORT);
@@ -96,38 +83,43 @@ VulkanGraphicsPipeline::VulkanGraphicsPipeline(
 	colorBlendingCreateInfo.attachmentCount = 1;
 	colorBlendingCreateInfo.pAttachments = &colorBlendAttachmentState;
 
-	VkPipelineLayoutCreateInfo pipelineCreateInfo = {};
-	pipelineCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-	pipelineCreateInfo.setLayoutCount = 0;
-	pipelineCreateInfo.pSetLayouts = nullptr;
-	pipelineCreateInfo.pushConstantRangeCount = 0;
-	pipelineCreateInfo.pPushConstantRanges = nullptr;
-
-	VkResult result = vkCreatePipelineLayout(this->_logicalDevice, &pipelineCreateInfo, nullptr, &this->_pipelineLayout);
-	if (result != VK_SUCCESS) {
-		ThrowErr::runtime("Failed to create pipeline layout!..");
-	}
+	// Attachment formats replace the render pass, so neither resizing nor a new render target needs one.
+	VkPipelineRenderingCreateInfo renderingCreateInfo = {};
+	renderingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+	renderingCreateInfo.colorAttachmentCount = 1;
+	renderingCreateInfo.pColorAttachmentFormats = &this->_colorFormat;
+	renderingCreateInfo.depthAttachmentFormat = this->_depthFormat;
+	renderingCreateInfo.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+
+	// Standard depth (far is 1), which is what the depth pyramid's farthest-depth reduction assumes.
+	VkPipelineDepthStencilStateCreateInfo depthStencilCreateInfo = {};
+	depthStencilCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+	depthStencilCreateInfo.depthTestEnable = VK_TRUE;
+	depthStencilCreateInfo.depthWriteEnable = VK_TRUE;
+	depthStencilCreateInfo.depthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+	depthStencilCreateInfo.depthBoundsTestEnable = VK_FALSE;
+	depthStencilCreateInfo.stencilTestEnable = VK_FALSE;
 
 	VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo = {};
 	graphicsPipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+	graphicsPipelineCreateInfo.pNext = &renderingCreateInfo;
 	graphicsPipelineCreateInfo.stageCount = 2;
 	graphicsPipelineCreateInfo.pStages = shaderStages;
 	graphicsPipelineCreateInfo.pVertexInputState = &vectexInputCreateInfo;
 	graphicsPipelineCreateInfo.pInputAssemblyState = &inputAssemblyCreateInfo;
 	graphicsPipelineCreateInfo.pViewportState = &viewportStateCreateInfo;
-	//graphicsPipelineCreateInfo.pDynamicState = &dynamicStateCreateInfo;
-	graphicsPipelineCreateInfo.pDynamicState = nullptr;
+	graphicsPipelineCreateInfo.pDynamicState = &dynamicStateCreateInfo;
 	graphicsPipelineCreateInfo.pRasterizationState = &rasterizerCreateInfo;
 	graphicsPipelineCreateInfo.pMultisampleState = &multisamplingCreateInfo;
 	graphicsPipelineCreateInfo.pColorBlendState = &colorBlendingCreateInfo;
-	graphicsPipelineCreateInfo.pDepthStencilState = nullptr;
+	graphicsPipelineCreateInfo.pDepthStencilState = this->_depthFormat != VK_FORMAT_UNDEFINED ? &depthStencilCreateInfo : nullptr;
 	graphicsPipelineCreateInfo.layout = this->_pipelineLayout;
-	graphicsPipelineCreateInfo.renderPass = this->_renderPass;
+	graphicsPipelineCreateInfo.renderPass = VK_NULL_HANDLE;
 	graphicsPipelineCreateInfo.subpass = 0;
 	graphicsPipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
 	graphicsPipelineCreateInfo.basePipelineIndex = -1;
 
-	result = vkCreateGraphicsPipelines(
+	VkResult result = vkCreateGraphicsPipelines(
 		this->_logicalDevice,
 		VK_NULL_HANDLE,
 		1,
@@ -146,18 +138,16 @@ VulkanGraphicsPipeline::VulkanGraphicsPipeline(
 
 VulkanGraphicsPipeline::~VulkanGraphicsPipeline() { 
 	vkDestroyPipeline(this->_logicalDevice, this->_graphicsPipeline, nullptr);
-	vkDestroyPipelineLayout(this->_logicalDevice, this->_pipelineLayout, nullptr);
-	vkDestroyRenderPass(this->_logicalDevice, this->_renderPass, nullptr);
-}
-
-VkRenderPass VulkanGraphicsPipeline::getRenderPass() {
-	return this->_renderPass;
 }
 
 VkPipeline VulkanGraphicsPipeline::getPipeline() {
 	return this->_graphicsPipeline;
 }
 
+VkPipelineLayout VulkanGraphicsPipeline::getPipelineLayout() {
+	return this->_pipelineLayout;
+}
+
 VkShaderModule VulkanGraphicsPipeline::_createShaderModule(const std::vector<char>& code) {
 	VkShaderModuleCreateInfo shaderModuleCreateInfo = {};
 	shaderModuleCreateInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
@@ -172,55 +162,3 @@ VkShaderModule VulkanGraphicsPipeline::_createShaderModule(const std::vector<cha
 
 	return shaderModule;
 }
-
-void VulkanGraphicsPipeline::_createRenderPass() {
-	VkAttachmentDescription colorAttachment = {};
-	colorAttachment.format = this->_swapchainImageFormat;
-	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
-	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
-	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
-	VkAttachmentReference colorAttachmentReference = {};
-	colorAttachmentReference.attachment = 0;
-	colorAttachmentReference.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-	VkSubpassDescription subpass = {};
-	subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-	subpass.colorAttachmentCount = 1;
-	subpass.pColorAttachments = &colorAttachmentReference;
-
-	std::array<VkSubpassDependency, 2> subpassDependencies = {};
-	subpassDependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
-	subpassDependencies[0].srcStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-	subpassDependencies[0].srcAccessMask = VK_ACCESS_MEMORY_READ_BIT;
-	subpassDependencies[0].dstSubpass = 0;
-	subpassDependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	subpassDependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	subpassDependencies[0].dependencyFlags = 0;
-
-	subpassDependencies[1].srcSubpass = 0;
-	subpassDependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-	subpassDependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-	subpassDependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
-	subpassDependencies[1].dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
-	subpassDependencies[1].dstAccessMask = VK_ACCESS_MEMORY_READ_BIT ;
-	subpassDependencies[1].dependencyFlags = 0;
-
-	VkRenderPassCreateInfo renderPassCreateInfo = {};
-	renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-	renderPassCreateInfo.attachmentCount = 1;
-	renderPassCreateInfo.pAttachments = &colorAttachment;
-	renderPassCreateInfo.subpassCount = 1;
-	renderPassCreateInfo.pSubpasses = &subpass;
-	renderPassCreateInfo.dependencyCount = static_cast<uint32_t>(subpassDependencies.size());
-	renderPassCreateInfo.pDependencies = subpassDependencies.data();
-
-	VkResult result = vkCreateRenderPass(this->_logicalDevice, &renderPassCreateInfo, nullptr, &this->_renderPass);
-	if (result != VK_SUCCESS) {
-		ThrowErr::runtime("Failed to create a render pass!..");
-	}
-}
\ No newline at end of file
@@ -4,17 +4,17 @@
 
 class VulkanGraphicsPipeline {
 public:
-	VulkanGraphicsPipeline(VkDevice logicalDevice, VkExtent2D swapchainExtent, VkFormat swapchainImageFormat);
+	VulkanGraphicsPipeline(
+		VkDevice logicalDevice, VkFormat colorFormat, VkPipelineLayout pipelineLayout, VkFormat depthFormat = VK_FORMAT_UNDEFINED);
 	~VulkanGraphicsPipeline();
-	VkRenderPass getRenderPass();
 	VkPipeline getPipeline();
+	VkPipelineLayout getPipelineLayout();
 private:
 	VkPipeline _graphicsPipeline;
 	VkDevice _logicalDevice;
 	VkPipelineLayout _pipelineLayout;
-	VkFormat _swapchainImageFormat;
-	VkRenderPass _renderPass;
+	VkFormat _colorFormat;
+	VkFormat _depthFormat;
 	
 	VkShaderModule _createShaderModule(const std::vector<char>& code);
-	void _createRenderPass();
 };
\ No newline at end of file
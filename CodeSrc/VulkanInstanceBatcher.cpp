@@ -0,0 +1,254 @@
+#include "VulkanInstanceBatcher.h"
+#include "QAllocTracker.h"
+#include <chrono>
+
+VulkanInstanceBatcher::VulkanInstanceBatcher(
+	VulkanMemoryAllocator* allocator, VulkanUploadQueue* uploadQueue, VulkanBindlessDescriptors* bindlessDescriptors,
+	QJobSystem* jobSystem, uint32_t frameCount, uint32_t maxInstances) :
+	_allocator{ allocator }, _uploadQueue{ uploadQueue }, _bindlessDescriptors{ bindlessDescriptors }, _jobSystem{ jobSystem },
+	_frameCount{ frameCount }, _maxInstances{ maxInstances } {
+	if (this->_frameCount == 0 || this->_frameCount > MAX_FRAME_DRAWS) {
+		ThrowErr::runtime("Invalid instance batcher frame count!..");
+	}
+
+	this->_instances.reserve(this->_maxInstances);
+	this->_keys.reserve(this->_maxInstances);
+	this->_order.reserve(this->_maxInstances);
+
+	this->_createFrameBuffers();
+}
+
+VulkanInstanceBatcher::~VulkanInstanceBatcher() {
+	for (GeometryBuffers& geometry : this->_geometry) {
+		this->_allocator->destroyBuffer(geometry.indexBuffer, geometry.indexAllocation);
+		this->_allocator->destroyBuffer(geometry.vertexBuffer, geometry.vertexAllocation);
+	}
+
+	for (uint32_t i = 0; i < this->_frameCount; i++) {
+		FrameBuffers& frame = this->_frames[i];
+		this->_bindlessDescriptors->releaseBuffer(frame.slot);
+		this->_allocator->destroyBuffer(frame.buffer, frame.allocation);
+	}
+}
+
+uint32_t VulkanInstanceBatcher::addMesh(const VulkanInstancedMesh& mesh) {
+	this->_meshes.push_back(mesh);
+	return static_cast<uint32_t>(this->_meshes.size() - 1);
+}
+
+uint32_t VulkanInstanceBatcher::addMeshes(const QMeshDeduplicator& meshes, VkPipeline pipeline) {
+	QAllocScope allocScope(QAllocTag::LOADING);
+	if (meshes.getMeshCount() == 0) {
+		ThrowErr::runtime("Failed to add instanced meshes: there are no meshes!..");
+	}
+
+	const std::vector<uint8_t>& vertexData = meshes.getVertexData();
+	const std::vector<uint32_t>& indexData = meshes.getIndexData();
+	VkDeviceSize indexSize = sizeof(uint32_t) * indexData.size();
+
+	// Transfer source too, so the defragmenter can copy them out. They are only marked movable in
+	// beginFrame(), once the upload queue has handed them to graphics.
+	VkBufferUsageFlags transfer = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+	GeometryBuffers geometry;
+	geometry.vertexAllocation = this->_allocator->createBuffer(
+		vertexData.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | transfer, VulkanMemoryUsage::GPU_ONLY, &geometry.vertexBuffer);
+	geometry.indexAllocation = this->_allocator->createBuffer(
+		indexSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | transfer, VulkanMemoryUsage::GPU_ONLY, &geometry.indexBuffer);
+
+	this->_upload(geometry.vertexBuffer, vertexData.data(), vertexData.size());
+	uint64_t uploadTicket = this->_upload(geometry.indexBuffer, indexData.data(), indexSize);
+	this->_uploadQueue->submit();
+
+	geometry.uploadTicket = uploadTicket;
+	this->_geometry.push_back(geometry);
+
+	// The deduplicator's mesh i becomes batcher mesh firstMesh + i.
+	uint32_t firstMesh = static_cast<uint32_t>(this->_meshes.size());
+	for (uint32_t i = 0; i < meshes.getMeshCount(); i++) {
+		const QUniqueMesh& unique = meshes.getMesh(i);
+
+		VulkanInstancedMesh mesh;
+		mesh.pipeline = pipeline;
+		mesh.vertexBuffer = geometry.vertexBuffer;
+		mesh.indexBuffer = geometry.indexBuffer;
+		mesh.indexCount = unique.indexCount;
+		mesh.firstIndex = unique.firstIndex;
+		mesh.vertexOffset = static_cast<int32_t>(unique.firstVertex);
+		mesh.uploadTicket = uploadTicket;
+		this->_meshes.push_back(mesh);
+	}
+
+	return firstMesh;
+}
+
+void VulkanInstanceBatcher::moveBuffer(VulkanAllocation* allocation, VkBuffer oldBuffer) {
+	// The allocation already holds the new handle; every mesh drawing from the old one follows it.
+	for (VulkanInstancedMesh& mesh : this->_meshes) {
+		if (mesh.vertexBuffer == oldBuffer) {
+			mesh.vertexBuffer = allocation->buffer;
+		}
+		if (mesh.indexBuffer == oldBuffer) {
+			mesh.indexBuffer = allocation->buffer;
+		}
+	}
+
+	for (GeometryBuffers& geometry : this->_geometry) {
+		if (geometry.vertexAllocation == allocation) {
+			geometry.vertexBuffer = allocation->buffer;
+		}
+		if (geometry.indexAllocation == allocation) {
+			geometry.indexBuffer = allocation->buffer;
+		}
+	}
+}
+
+void VulkanInstanceBatcher::add(const VulkanBatchInstance& instance) {
+	if (instance.meshIndex >= this->_meshes.size()) {
+		ThrowErr::runtime("Invalid instance batcher mesh index!..");
+	}
+
+	if (this->_frameInstanceCount + this->_instances.size() + 1 > this->_maxInstances) {
+		ThrowErr::runtime("Instance batcher capacity exceeded!..");
+	}
+
+	this->_instances.push_back(instance);
+}
+
+void VulkanInstanceBatcher::beginFrame(uint32_t frameIndex) {
+	// The frame that last used this slot has retired, so build() may overwrite its instance data.
+	this->_frameIndex = frameIndex;
+	this->_frameInstanceCount = 0;
+	this->_stats = VulkanInstanceBatcherStats();
+
+	for (GeometryBuffers& geometry : this->_geometry) {
+		if (!geometry.movable && this->_uploadQueue->isReady(geometry.uploadTicket)) {
+			geometry.vertexAllocation->movable = true;
+			geometry.indexAllocation->movable = true;
+			geometry.movable = true;
+		}
+	}
+}
+
+void VulkanInstanceBatcher::build(VulkanDrawList* drawList, VulkanDrawPass pass, uint32_t uniformOffset) {
+	auto start = std::chrono::steady_clock::now();
+
+	uint32_t instanceCount = static_cast<uint32_t>(this->_instances.size());
+	this->_keys.resize(instanceCount);
+	this->_order.resize(instanceCount);
+	for (uint32_t i = 0; i < instanceCount; i++) {
+		const VulkanBatchInstance& instance = this->_instances[i];
+		this->_keys[i] = (static_cast<uint64_t>(instance.meshIndex) << 32) | instance.materialIndex;
+		this->_order[i] = i;
+	}
+
+	this->_radixSort.sort(this->_keys.data(), this->_order.data(), instanceCount, this->_jobSystem);
+
+	FrameBuffers& frame = this->_frames[this->_frameIndex];
+	uint32_t firstInstance = this->_frameInstanceCount;
+	VulkanInstanceData* instanceData = static_cast<VulkanInstanceData*>(frame.allocation->mapped) + firstInstance;
+
+	uint32_t chunkCount = (instanceCount + INSTANCE_BATCHER_WRITE_CHUNK - 1) / INSTANCE_BATCHER_WRITE_CHUNK;
+	this->_jobSystem->parallelFor(chunkCount, 1, [this, instanceData, instanceCount](uint32_t begin, uint32_t end, uint32_t) {
+		uint32_t first = begin * INSTANCE_BATCHER_WRITE_CHUNK;
+		uint32_t last = std::min(end * INSTANCE_BATCHER_WRITE_CHUNK, instanceCount);
+
+		for (uint32_t i = first; i < last; i++) {
+			const VulkanBatchInstance& instance = this->_instances[this->_order[i]];
+			VulkanInstanceData& data = instanceData[i];
+
+			memcpy(data.transform, instance.transform, sizeof(data.transform));
+			data.objectIndex = instance.objectIndex;
+			data.padding[0] = 0;
+			data.padding[1] = 0;
+			data.padding[2] = 0;
+		}
+	});
+
+	bool transparent = pass == VulkanDrawPass::TRANSPARENT_GEOMETRY;
+	uint32_t batchCount = 0;
+	uint32_t drawnCount = 0;
+
+	uint32_t runBegin = 0;
+	while (runBegin < instanceCount) {
+		uint64_t key = this->_keys[runBegin];
+		const VulkanBatchInstance& first = this->_instances[this->_order[runBegin]];
+		float depth = first.viewDepth;
+
+		uint32_t runEnd = runBegin + 1;
+		while (runEnd < instanceCount && this->_keys[runEnd] == key) {
+			float instanceDepth = this->_instances[this->_order[runEnd]].viewDepth;
+			depth = transparent ? std::max(depth, instanceDepth) : std::min(depth, instanceDepth);
+			runEnd++;
+		}
+
+		const VulkanInstancedMesh& mesh = this->_meshes[first.meshIndex];
+		if (!this->_uploadQueue->isReady(mesh.uploadTicket)) {
+			runBegin = runEnd;
+			continue;
+		}
+
+		VulkanDrawCommand draw = {};
+		draw.pipeline = mesh.pipeline;
+		draw.vertexBuffer = mesh.vertexBuffer;
+		draw.indexBuffer = mesh.indexBuffer;
+		draw.elementCount = mesh.indexCount;
+		draw.instanceCount = runEnd - runBegin;
+		draw.firstElement = mesh.firstIndex;
+		draw.vertexOffset = mesh.vertexOffset;
+		draw.firstInstance = firstInstance + runBegin;
+		draw.materialIndex = first.materialIndex;
+		draw.objectIndex = frame.slot;
+		draw.uniformOffset = uniformOffset;
+		drawList->add(draw, pass, depth);
+
+		batchCount++;
+		drawnCount += runEnd - runBegin;
+		runBegin = runEnd;
+	}
+
+	this->_instances.clear();
+	this->_frameInstanceCount += instanceCount;
+
+	std::chrono::duration<float, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+
+	this->_stats.instanceCount += instanceCount;
+	this->_stats.batchCount += batchCount;
+	this->_stats.drawsSaved += drawnCount - batchCount;
+	this->_stats.buildMs += elapsed.count();
+}
+
+uint32_t VulkanInstanceBatcher::getInstanceSlot() {
+	return this->_frames[this->_frameIndex].slot;
+}
+
+VulkanInstanceBatcherStats VulkanInstanceBatcher::getStats() {
+	return this->_stats;
+}
+
+void VulkanInstanceBatcher::_createFrameBuffers() {
+	VkDeviceSize bufferSize = sizeof(VulkanInstanceData) * std::max<uint32_t>(this->_maxInstances, 1);
+
+	for (uint32_t i = 0; i < this->_frameCount; i++) {
+		FrameBuffers& frame = this->_frames[i];
+		frame.allocation = this->_allocator->createBuffer(
+			bufferSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VulkanMemoryUsage::CPU_TO_GPU, &frame.buffer);
+		if (frame.allocation->mapped == nullptr) {
+			ThrowErr::runtime("Instance batcher memory is not host visible!..");
+		}
+
+		frame.slot = this->_bindlessDescriptors->registerBuffer(frame.buffer);
+	}
+}
+
+uint64_t VulkanInstanceBatcher::_upload(VkBuffer buffer, const void* data, VkDeviceSize size) {
+	// Chunks keep any one copy well inside the staging ring.
+	const char* bytes = static_cast<const char*>(data);
+	uint64_t ticket = 0;
+	for (VkDeviceSize offset = 0; offset < size; offset += INSTANCE_BATCHER_UPLOAD_CHUNK) {
+		VkDeviceSize chunkSize = std::min(INSTANCE_BATCHER_UPLOAD_CHUNK, size - offset);
+		ticket = this->_uploadQueue->uploadBuffer(buffer, offset, bytes + offset, chunkSize);
+	}
+
+	return ticket;
+}
@@ -0,0 +1,117 @@
+#pragma once
+#include "QEngine.h"
+#include "VulkanUtilities.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanUploadQueue.h"
+#include "VulkanBindlessDescriptors.h"
+#include "VulkanDrawList.h"
+#include "QRadixSort.h"
+#include "QJobSystem.h"
+#include "QMeshDeduplicator.h"
+
+const uint32_t INSTANCE_BATCHER_MAX_INSTANCES = 65536;
+const uint32_t INSTANCE_BATCHER_WRITE_CHUNK = 4096;
+const VkDeviceSize INSTANCE_BATCHER_UPLOAD_CHUNK = 8ull * 1024 * 1024;
+
+// A mesh that can be drawn instanced: a range of shared geometry buffers and the pipeline drawing it.
+// Its batches are left out of the draw list until the upload queue reports uploadTicket ready.
+struct VulkanInstancedMesh {
+	VkPipeline pipeline = VK_NULL_HANDLE;
+	VkBuffer vertexBuffer = VK_NULL_HANDLE;
+	VkBuffer indexBuffer = VK_NULL_HANDLE;
+	uint32_t indexCount = 0;
+	uint32_t firstIndex = 0;
+	int32_t vertexOffset = 0;
+	uint64_t uploadTicket = 0;
+};
+
+// One visible placement of a mesh this frame. The transform is the top three rows of a row-major affine matrix.
+struct VulkanBatchInstance {
+	float transform[12] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f };
+	uint32_t meshIndex = 0;
+	uint32_t materialIndex = 0;
+	uint32_t objectIndex = 0;
+	float viewDepth = 0.0f;
+};
+
+// What a vertex shader reads for gl_InstanceIndex. Layout matches std430.
+struct VulkanInstanceData {
+	float transform[12];
+	uint32_t objectIndex;
+	uint32_t padding[3];
+};
+
+// Totals over every build() of the current frame.
+struct VulkanInstanceBatcherStats {
+	uint32_t instanceCount = 0;
+	uint32_t batchCount = 0;
+	uint32_t drawsSaved = 0;
+	float buildMs = 0.0f;
+};
+
+// Merges the frame's visible instances of the same mesh and material into one instanced draw. Instances
+// are grouped with a radix sort on (mesh, material), their transforms are written contiguously into the
+// frame's host-visible instance buffer on the job system, and each group becomes one draw whose
+// firstInstance points at its range. As in VulkanGpuScene, the draw's objectIndex is the bindless slot
+// of the instance buffer, and shaders index it with gl_InstanceIndex.
+// addMeshes() takes a deduplicator's packed geometry, uploads it once into buffers the batcher owns
+// and registers every unique mesh, so copies found at load time are drawn from one mesh. Those buffers
+// become movable for the defragmenter once their upload has landed; moveBuffer() is its callback.
+// build() consumes what was added since the previous build; several builds in one frame, say one per
+// pass, fill consecutive ranges of the frame's buffer. An opaque batch sorts by its nearest
+// instance; a transparent one by its farthest, with no order inside the batch.
+class VulkanInstanceBatcher {
+public:
+	VulkanInstanceBatcher(
+		VulkanMemoryAllocator* allocator, VulkanUploadQueue* uploadQueue, VulkanBindlessDescriptors* bindlessDescriptors,
+		QJobSystem* jobSystem, uint32_t frameCount, uint32_t maxInstances = INSTANCE_BATCHER_MAX_INSTANCES);
+	~VulkanInstanceBatcher();
+
+	uint32_t addMesh(const VulkanInstancedMesh& mesh);
+	uint32_t addMeshes(const QMeshDeduplicator& meshes, VkPipeline pipeline);
+	void moveBuffer(VulkanAllocation* allocation, VkBuffer oldBuffer);
+	void add(const VulkanBatchInstance& instance);
+
+	void beginFrame(uint32_t frameIndex);
+	void build(VulkanDrawList* drawList, VulkanDrawPass pass, uint32_t uniformOffset = 0);
+
+	uint32_t getInstanceSlot();
+	VulkanInstanceBatcherStats getStats();
+private:
+	struct FrameBuffers {
+		VkBuffer buffer = VK_NULL_HANDLE;
+		VulkanAllocation* allocation = nullptr;
+		uint32_t slot = QSlotAllocator::INVALID_SLOT;
+	};
+
+	struct GeometryBuffers {
+		VkBuffer vertexBuffer = VK_NULL_HANDLE;
+		VulkanAllocation* vertexAllocation = nullptr;
+		VkBuffer indexBuffer = VK_NULL_HANDLE;
+		VulkanAllocation* indexAllocation = nullptr;
+		uint64_t uploadTicket = 0;
+		bool movable = false;
+	};
+
+	VulkanMemoryAllocator* _allocator;
+	VulkanUploadQueue* _uploadQueue;
+	VulkanBindlessDescriptors* _bindlessDescriptors;
+	QJobSystem* _jobSystem;
+	uint32_t _frameCount;
+	uint32_t _maxInstances;
+	uint32_t _frameIndex = 0;
+	uint32_t _frameInstanceCount = 0;
+
+	FrameBuffers _frames[MAX_FRAME_DRAWS];
+	QRadixSort _radixSort;
+	VulkanInstanceBatcherStats _stats;
+
+	std::vector<VulkanInstancedMesh> _meshes;
+	std::vector<GeometryBuffers> _geometry;
+	std::vector<VulkanBatchInstance> _instances;
+	std::vector<uint64_t> _keys;
+	std::vector<uint32_t> _order;
+
+	void _createFrameBuffers();
+	uint64_t _upload(VkBuffer buffer, const void* data, VkDeviceSize size);
+};
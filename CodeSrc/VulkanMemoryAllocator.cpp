@@ -0,0 +1,522 @@
+#include "VulkanMemoryAllocator.h"
+#include <algorithm>
+
+VulkanDeviceMemory::VulkanDeviceMemory(VkDevice logicalDevice) : _logicalDevice{ logicalDevice } {}
+
+VkResult VulkanDeviceMemory::allocate(
+	uint32_t memoryTypeIndex, VkDeviceSize size, VkBuffer dedicatedBuffer, VkImage dedicatedImage, VkDeviceMemory* outMemory) {
+	VkMemoryAllocateInfo allocateInfo = {};
+	allocateInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocateInfo.allocationSize = size;
+	allocateInfo.memoryTypeIndex = memoryTypeIndex;
+
+	VkMemoryDedicatedAllocateInfo dedicatedInfo = {};
+	if (dedicatedBuffer != VK_NULL_HANDLE || dedicatedImage != VK_NULL_HANDLE) {
+		dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+		dedicatedInfo.buffer = dedicatedBuffer;
+		dedicatedInfo.image = dedicatedImage;
+		allocateInfo.pNext = &dedicatedInfo;
+	}
+
+	return vkAllocateMemory(this->_logicalDevice, &allocateInfo, nullptr, outMemory);
+}
+
+void VulkanDeviceMemory::free(VkDeviceMemory memory) {
+	vkFreeMemory(this->_logicalDevice, memory, nullptr);
+}
+
+void* VulkanDeviceMemory::map(VkDeviceMemory memory) {
+	void* data = nullptr;
+
+	VkResult result = vkMapMemory(this->_logicalDevice, memory, 0, VK_WHOLE_SIZE, 0, &data);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to map a device memory block!..");
+	}
+
+	return data;
+}
+
+VulkanMemoryAllocator::VulkanMemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice logicalDevice) : _logicalDevice{ logicalDevice } {
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+	this->_backend = new VulkanDeviceMemory(logicalDevice);
+	this->_ownsBackend = true;
+
+	this->_init(memoryProperties, deviceProperties.limits);
+}
+
+VulkanMemoryAllocator::VulkanMemoryAllocator(
+	const VkPhysicalDeviceMemoryProperties& memoryProperties, const VkPhysicalDeviceLimits& limits, VulkanDeviceMemoryBackend* backend) {
+	this->_backend = backend;
+	this->_ownsBackend = false;
+
+	this->_init(memoryProperties, limits);
+}
+
+VulkanMemoryAllocator::~VulkanMemoryAllocator() {
+	for (VulkanAllocation* allocation : this->_dedicatedAllocations) {
+		this->_backend->free(allocation->memory);
+		delete allocation;
+	}
+
+	for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; i++) {
+		for (VulkanMemoryBlock* block : this->_blocks[i]) {
+			// Sub-allocations still alive here are leaks of their owners; the memory goes away with the block.
+			this->_destroyBlock(block);
+		}
+
+		this->_blocks[i].clear();
+	}
+
+	if (this->_ownsBackend) {
+		delete this->_backend;
+	}
+}
+
+VulkanAllocation* VulkanMemoryAllocator::allocate(
+	const VkMemoryRequirements& requirements, VulkanMemoryUsage usage, QTlsfResourceKind kind, bool dedicated,
+	VkBuffer dedicatedBuffer, VkImage dedicatedImage) {
+	std::lock_guard<std::mutex> lock(this->_mutex);
+
+	std::vector<uint32_t> memoryTypes;
+	this->_findMemoryTypes(requirements.memoryTypeBits, usage, memoryTypes);
+
+	if (memoryTypes.empty()) {
+		ThrowErr::runtime("Failed to find a suitable memory type!..");
+	}
+
+	for (uint32_t memoryTypeIndex : memoryTypes) {
+		bool useDedicated = dedicated || requirements.size > this->_getBlockSize(memoryTypeIndex) / 2;
+
+		VulkanAllocation* allocation = useDedicated ?
+			this->_allocateDedicated(memoryTypeIndex, requirements.size, dedicatedBuffer, dedicatedImage) :
+			this->_allocateFromBlocks(memoryTypeIndex, requirements, kind);
+
+		if (allocation != nullptr) {
+			return allocation;
+		}
+	}
+
+	ThrowErr::runtime("Out of device memory!..");
+	return nullptr;
+}
+
+void VulkanMemoryAllocator::free(VulkanAllocation* allocation) {
+	if (allocation == nullptr) {
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(this->_mutex);
+
+	if (allocation->block == nullptr) {
+		for (size_t i = 0; i < this->_dedicatedAllocations.size(); i++) {
+			if (this->_dedicatedAllocations[i] == allocation) {
+				this->_dedicatedAllocations[i] = this->_dedicatedAllocations.back();
+				this->_dedicatedAllocations.pop_back();
+				break;
+			}
+		}
+
+		this->_backend->free(allocation->memory);
+		this->_deviceAllocationCount--;
+		delete allocation;
+		return;
+	}
+
+	VulkanMemoryBlock* block = allocation->block;
+	uint32_t handle = allocation->blockHandle;
+	delete allocation;
+
+	this->_freeBlockRange(block, handle);
+}
+
+VulkanAllocation* VulkanMemoryAllocator::createBuffer(
+	VkDeviceSize size, VkBufferUsageFlags usage, VulkanMemoryUsage memoryUsage, VkBuffer* outBuffer, bool movable) {
+	VkBufferCreateInfo bufferCreateInfo = {};
+	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferCreateInfo.size = size;
+	bufferCreateInfo.usage = usage;
+	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	// Only device local buffers whose owner handles the defragmenter's move callback may be relocated:
+	// every copy of the old handle (descriptors, recorded commands) goes stale when the buffer moves.
+	movable = movable && memoryUsage == VulkanMemoryUsage::GPU_ONLY;
+	if (movable) {
+		bufferCreateInfo.usage |= VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	}
+
+	VulkanAllocation* allocation = this->createBuffer(bufferCreateInfo, memoryUsage, outBuffer);
+	allocation->buffer = *outBuffer;
+	allocation->bufferSize = bufferCreateInfo.size;
+	allocation->bufferUsage = bufferCreateInfo.usage;
+	allocation->movable = movable;
+
+	return allocation;
+}
+
+VulkanAllocation* VulkanMemoryAllocator::createBuffer(const VkBufferCreateInfo& createInfo, VulkanMemoryUsage memoryUsage, VkBuffer* outBuffer) {
+	// The allocation is never movable, so the defragmenter leaves it alone. Meant for buffers whose handle
+	// is held elsewhere (render graph imports) or that are shared between queue families.
+	VkResult result = vkCreateBuffer(this->_logicalDevice, &createInfo, nullptr, outBuffer);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to create a buffer!..");
+	}
+
+	VkBufferMemoryRequirementsInfo2 requirementsInfo = {};
+	requirementsInfo.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+	requirementsInfo.buffer = *outBuffer;
+
+	VkMemoryDedicatedRequirements dedicatedRequirements = {};
+	dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+	VkMemoryRequirements2 requirements = {};
+	requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+	requirements.pNext = &dedicatedRequirements;
+
+	vkGetBufferMemoryRequirements2(this->_logicalDevice, &requirementsInfo, &requirements);
+
+	bool dedicated = dedicatedRequirements.requiresDedicatedAllocation || dedicatedRequirements.prefersDedicatedAllocation;
+
+	// Nothing owns the buffer until it is returned, so every failure from here on destroys it first.
+	VulkanAllocation* allocation = nullptr;
+	try {
+		allocation = this->allocate(
+			requirements.memoryRequirements, memoryUsage, QTlsfResourceKind::LINEAR, dedicated, *outBuffer, VK_NULL_HANDLE);
+	}
+	catch (...) {
+		vkDestroyBuffer(this->_logicalDevice, *outBuffer, nullptr);
+		*outBuffer = VK_NULL_HANDLE;
+		throw;
+	}
+
+	result = vkBindBufferMemory(this->_logicalDevice, *outBuffer, allocation->memory, allocation->offset);
+	if (result != VK_SUCCESS) {
+		this->destroyBuffer(*outBuffer, allocation);
+		*outBuffer = VK_NULL_HANDLE;
+		ThrowErr::runtime("Failed to bind buffer memory!..");
+	}
+
+	return allocation;
+}
+
+VulkanAllocation* VulkanMemoryAllocator::createImage(const VkImageCreateInfo& createInfo, VulkanMemoryUsage memoryUsage, VkImage* outImage) {
+	VkResult result = vkCreateImage(this->_logicalDevice, &createInfo, nullptr, outImage);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to create an image!..");
+	}
+
+	VkImageMemoryRequirementsInfo2 requirementsInfo = {};
+	requirementsInfo.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+	requirementsInfo.image = *outImage;
+
+	VkMemoryDedicatedRequirements dedicatedRequirements = {};
+	dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+
+	VkMemoryRequirements2 requirements = {};
+	requirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+	requirements.pNext = &dedicatedRequirements;
+
+	vkGetImageMemoryRequirements2(this->_logicalDevice, &requirementsInfo, &requirements);
+
+	bool renderTarget = (createInfo.usage & (VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)) != 0;
+	bool dedicated = dedicatedRequirements.requiresDedicatedAllocation || dedicatedRequirements.prefersDedicatedAllocation ||
+		(renderTarget && requirements.memoryRequirements.size >= DEDICATED_RENDER_TARGET_MIN_SIZE);
+
+	QTlsfResourceKind kind = createInfo.tiling == VK_IMAGE_TILING_LINEAR ? QTlsfResourceKind::LINEAR : QTlsfResourceKind::OPTIMAL;
+
+	// Nothing owns the image until it is returned, so every failure from here on destroys it first.
+	VulkanAllocation* allocation = nullptr;
+	try {
+		allocation = this->allocate(
+			requirements.memoryRequirements, memoryUsage, kind, dedicated, VK_NULL_HANDLE, *outImage);
+	}
+	catch (...) {
+		vkDestroyImage(this->_logicalDevice, *outImage, nullptr);
+		*outImage = VK_NULL_HANDLE;
+		throw;
+	}
+	allocation->image = *outImage;
+
+	result = vkBindImageMemory(this->_logicalDevice, *outImage, allocation->memory, allocation->offset);
+	if (result != VK_SUCCESS) {
+		this->destroyImage(*outImage, allocation);
+		*outImage = VK_NULL_HANDLE;
+		ThrowErr::runtime("Failed to bind image memory!..");
+	}
+
+	return allocation;
+}
+
+void VulkanMemoryAllocator::destroyBuffer(VkBuffer buffer, VulkanAllocation* allocation) {
+	vkDestroyBuffer(this->_logicalDevice, buffer, nullptr);
+	this->free(allocation);
+}
+
+void VulkanMemoryAllocator::destroyImage(VkImage image, VulkanAllocation* allocation) {
+	vkDestroyImage(this->_logicalDevice, image, nullptr);
+	this->free(allocation);
+}
+
+VulkanMemoryStats VulkanMemoryAllocator::getStats() {
+	std::lock_guard<std::mutex> lock(this->_mutex);
+
+	VulkanMemoryStats stats;
+	stats.deviceAllocationCount = this->_deviceAllocationCount;
+	stats.dedicatedCount = static_cast<uint32_t>(this->_dedicatedAllocations.size());
+
+	for (VulkanAllocation* allocation : this->_dedicatedAllocations) {
+		stats.dedicatedBytes += allocation->size;
+	}
+
+	for (uint32_t i = 0; i < VK_MAX_MEMORY_TYPES; i++) {
+		for (VulkanMemoryBlock* block : this->_blocks[i]) {
+			QTlsfStats blockStats = block->allocator->getStats();
+
+			stats.blockCount++;
+			stats.blockBytes += blockStats.size;
+			stats.usedBytes += blockStats.usedBytes;
+			stats.allocationCount += blockStats.allocationCount;
+			stats.freeBytes += blockStats.freeBytes;
+			stats.largestFreeRange = std::max<VkDeviceSize>(stats.largestFreeRange, blockStats.largestFreeRange);
+		}
+	}
+
+	stats.allocationCount += stats.dedicatedCount;
+
+	if (stats.freeBytes > 0) {
+		stats.fragmentation = 1.0f - static_cast<float>(stats.largestFreeRange) / static_cast<float>(stats.freeBytes);
+	}
+
+	return stats;
+}
+
+VkDeviceSize VulkanMemoryAllocator::getBufferImageGranularity() {
+	return this->_bufferImageGranularity;
+}
+
+VkDevice VulkanMemoryAllocator::getLogicalDevice() {
+	return this->_logicalDevice;
+}
+
+void VulkanMemoryAllocator::_init(const VkPhysicalDeviceMemoryProperties& memoryProperties, const VkPhysicalDeviceLimits& limits) {
+	this->_memoryProperties = memoryProperties;
+	this->_bufferImageGranularity = limits.bufferImageGranularity > 0 ? limits.bufferImageGranularity : 1;
+	this->_maxAllocationCount = limits.maxMemoryAllocationCount;
+}
+
+void VulkanMemoryAllocator::_findMemoryTypes(uint32_t memoryTypeBits, VulkanMemoryUsage usage, std::vector<uint32_t>& outTypes) {
+	VkMemoryPropertyFlags required = 0;
+	VkMemoryPropertyFlags preferred = 0;
+	VkMemoryPropertyFlags avoided = 0;
+
+	switch (usage) {
+	case VulkanMemoryUsage::GPU_ONLY:
+		required = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+		avoided = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+		break;
+	case VulkanMemoryUsage::CPU_TO_GPU:
+		required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		avoided = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+		break;
+	case VulkanMemoryUsage::GPU_TO_CPU:
+		required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+		preferred = VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+		break;
+	}
+
+	// Lower cost first: every preferred bit missing and every avoided bit present costs one.
+	std::vector<std::pair<uint32_t, uint32_t>> candidates;
+
+	for (uint32_t i = 0; i < this->_memoryProperties.memoryTypeCount; i++) {
+		if ((memoryTypeBits & (1u << i)) == 0) {
+			continue;
+		}
+
+		VkMemoryPropertyFlags flags = this->_memoryProperties.memoryTypes[i].propertyFlags;
+		if ((flags & required) != required) {
+			continue;
+		}
+
+		uint32_t cost = 0;
+		for (uint32_t bit = 0; bit < 32; bit++) {
+			VkMemoryPropertyFlags mask = 1u << bit;
+			if ((preferred & mask) && !(flags & mask)) {
+				cost++;
+			}
+
+			if ((avoided & mask) && (flags & mask)) {
+				cost++;
+			}
+		}
+
+		candidates.push_back(std::make_pair(cost, i));
+	}
+
+	std::stable_sort(candidates.begin(), candidates.end(),
+		[](const std::pair<uint32_t, uint32_t>& a, const std::pair<uint32_t, uint32_t>& b) { return a.first < b.first; });
+
+	outTypes.clear();
+	for (const auto& candidate : candidates) {
+		outTypes.push_back(candidate.second);
+	}
+}
+
+VkDeviceSize VulkanMemoryAllocator::_getBlockSize(uint32_t memoryTypeIndex) {
+	uint32_t heapIndex = this->_memoryProperties.memoryTypes[memoryTypeIndex].heapIndex;
+	VkDeviceSize heapSize = this->_memoryProperties.memoryHeaps[heapIndex].size;
+
+	// Small heaps (integrated GPUs, the 256 MiB BAR window) get proportionally smaller blocks.
+	if (heapSize <= 1024ull * 1024 * 1024) {
+		return heapSize / 8;
+	}
+
+	return MEMORY_BLOCK_SIZE;
+}
+
+VulkanAllocation* VulkanMemoryAllocator::_allocateFromBlocks(
+	uint32_t memoryTypeIndex, const VkMemoryRequirements& requirements, QTlsfResourceKind kind) {
+	std::vector<VulkanMemoryBlock*>& blocks = this->_blocks[memoryTypeIndex];
+
+	VulkanMemoryBlock* target = nullptr;
+	uint32_t handle = QTlsfAllocator::INVALID_HANDLE;
+
+	for (VulkanMemoryBlock* block : blocks) {
+		handle = block->allocator->allocate(requirements.size, requirements.alignment, kind);
+		if (handle != QTlsfAllocator::INVALID_HANDLE) {
+			target = block;
+			break;
+		}
+	}
+
+	if (target == nullptr) {
+		target = this->_createBlock(memoryTypeIndex, requirements.size);
+		if (target == nullptr) {
+			return nullptr;
+		}
+
+		handle = target->allocator->allocate(requirements.size, requirements.alignment, kind);
+		if (handle == QTlsfAllocator::INVALID_HANDLE) {
+			return nullptr;
+		}
+	}
+
+	VulkanAllocation* allocation = new VulkanAllocation();
+	allocation->memory = target->memory;
+	allocation->offset = target->allocator->getOffset(handle);
+	allocation->size = requirements.size;
+	allocation->alignment = requirements.alignment;
+	allocation->memoryTypeIndex = memoryTypeIndex;
+	allocation->block = target;
+	allocation->blockHandle = handle;
+	allocation->mapped = target->mapped != nullptr ? static_cast<char*>(target->mapped) + allocation->offset : nullptr;
+
+	target->allocator->setUserData(handle, allocation);
+
+	return allocation;
+}
+
+VulkanAllocation* VulkanMemoryAllocator::_allocateDedicated(
+	uint32_t memoryTypeIndex, VkDeviceSize size, VkBuffer dedicatedBuffer, VkImage dedicatedImage) {
+	if (this->_maxAllocationCount != 0 && this->_deviceAllocationCount >= this->_maxAllocationCount) {
+		ThrowErr::runtime("Reached maxMemoryAllocationCount!..");
+	}
+
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkResult result = this->_backend->allocate(memoryTypeIndex, size, dedicatedBuffer, dedicatedImage, &memory);
+	if (result != VK_SUCCESS) {
+		return nullptr;
+	}
+
+	this->_deviceAllocationCount++;
+
+	VulkanAllocation* allocation = new VulkanAllocation();
+	allocation->memory = memory;
+	allocation->offset = 0;
+	allocation->size = size;
+	allocation->memoryTypeIndex = memoryTypeIndex;
+	allocation->mapped = this->_mapIfHostVisible(memoryTypeIndex, memory);
+
+	this->_dedicatedAllocations.push_back(allocation);
+
+	return allocation;
+}
+
+VulkanMemoryBlock* VulkanMemoryAllocator::_createBlock(uint32_t memoryTypeIndex, VkDeviceSize minSize) {
+	if (this->_maxAllocationCount != 0 && this->_deviceAllocationCount >= this->_maxAllocationCount) {
+		ThrowErr::runtime("Reached maxMemoryAllocationCount!..");
+	}
+
+	VkDeviceSize blockSize = this->_getBlockSize(memoryTypeIndex);
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkResult result = VK_ERROR_OUT_OF_DEVICE_MEMORY;
+
+	// Under memory pressure retry with smaller blocks before giving up on this memory type.
+	while (blockSize >= minSize) {
+		result = this->_backend->allocate(memoryTypeIndex, blockSize, VK_NULL_HANDLE, VK_NULL_HANDLE, &memory);
+		if (result == VK_SUCCESS) {
+			break;
+		}
+
+		blockSize /= 2;
+	}
+
+	if (result != VK_SUCCESS) {
+		return nullptr;
+	}
+
+	this->_deviceAllocationCount++;
+
+	VulkanMemoryBlock* block = new VulkanMemoryBlock();
+	block->memory = memory;
+	block->memoryTypeIndex = memoryTypeIndex;
+	block->mapped = this->_mapIfHostVisible(memoryTypeIndex, memory);
+	block->allocator = new QTlsfAllocator(blockSize, this->_bufferImageGranularity);
+
+	this->_blocks[memoryTypeIndex].push_back(block);
+
+	return block;
+}
+
+void VulkanMemoryAllocator::_destroyBlock(VulkanMemoryBlock* block) {
+	this->_backend->free(block->memory);
+	this->_deviceAllocationCount--;
+
+	delete block->allocator;
+	delete block;
+}
+
+void VulkanMemoryAllocator::_freeBlockRange(VulkanMemoryBlock* block, uint32_t handle) {
+	block->allocator->free(handle);
+
+	if (!block->allocator->isEmpty()) {
+		return;
+	}
+
+	// Keep a single empty block per memory type around so streaming does not thrash vkAllocateMemory.
+	std::vector<VulkanMemoryBlock*>& blocks = this->_blocks[block->memoryTypeIndex];
+	for (VulkanMemoryBlock* other : blocks) {
+		if (other != block && other->allocator->isEmpty()) {
+			for (size_t i = 0; i < blocks.size(); i++) {
+				if (blocks[i] == block) {
+					blocks.erase(blocks.begin() + i);
+					break;
+				}
+			}
+
+			this->_destroyBlock(block);
+			return;
+		}
+	}
+}
+
+void* VulkanMemoryAllocator::_mapIfHostVisible(uint32_t memoryTypeIndex, VkDeviceMemory memory) {
+	if (this->_memoryProperties.memoryTypes[memoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		return this->_backend->map(memory);
+	}
+
+	return nullptr;
+}
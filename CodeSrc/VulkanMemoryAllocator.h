@@ -0,0 +1,121 @@
+#pragma once
+#include <mutex>
+#include "QEngine.h"
+#include "QTlsfAllocator.h"
+
+const VkDeviceSize MEMORY_BLOCK_SIZE = 256ull * 1024 * 1024;
+const VkDeviceSize DEDICATED_RENDER_TARGET_MIN_SIZE = 8ull * 1024 * 1024;
+
+enum class VulkanMemoryUsage {
+	GPU_ONLY,
+	CPU_TO_GPU,
+	GPU_TO_CPU,
+};
+
+struct VulkanMemoryBlock {
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	uint32_t memoryTypeIndex = 0;
+	void* mapped = nullptr;
+	QTlsfAllocator* allocator = nullptr;
+};
+
+struct VulkanAllocation {
+	VkDeviceMemory memory = VK_NULL_HANDLE;
+	VkDeviceSize offset = 0;
+	VkDeviceSize size = 0;
+	VkDeviceSize alignment = 1;
+	void* mapped = nullptr;
+	uint32_t memoryTypeIndex = 0;
+	VulkanMemoryBlock* block = nullptr;
+	uint32_t blockHandle = QTlsfAllocator::INVALID_HANDLE;
+	VkBuffer buffer = VK_NULL_HANDLE;
+	VkDeviceSize bufferSize = 0;
+	VkBufferUsageFlags bufferUsage = 0;
+	VkImage image = VK_NULL_HANDLE;
+	bool movable = false;
+};
+
+struct VulkanMemoryStats {
+	uint32_t blockCount = 0;
+	uint32_t dedicatedCount = 0;
+	uint32_t allocationCount = 0;
+	uint32_t deviceAllocationCount = 0;
+	VkDeviceSize blockBytes = 0;
+	VkDeviceSize usedBytes = 0;
+	VkDeviceSize dedicatedBytes = 0;
+	VkDeviceSize freeBytes = 0;
+	VkDeviceSize largestFreeRange = 0;
+	// 0 when all free block memory is one contiguous range, approaching 1 as it splinters.
+	float fragmentation = 0.0f;
+};
+
+// Device memory entry points the allocator depends on, so the sub-allocation logic
+// can run against a mock device without a GPU.
+class VulkanDeviceMemoryBackend {
+public:
+	virtual ~VulkanDeviceMemoryBackend() {}
+	virtual VkResult allocate(
+		uint32_t memoryTypeIndex, VkDeviceSize size, VkBuffer dedicatedBuffer, VkImage dedicatedImage, VkDeviceMemory* outMemory) = 0;
+	virtual void free(VkDeviceMemory memory) = 0;
+	virtual void* map(VkDeviceMemory memory) = 0;
+};
+
+class VulkanDeviceMemory : public VulkanDeviceMemoryBackend {
+public:
+	VulkanDeviceMemory(VkDevice logicalDevice);
+	VkResult allocate(
+		uint32_t memoryTypeIndex, VkDeviceSize size, VkBuffer dedicatedBuffer, VkImage dedicatedImage, VkDeviceMemory* outMemory) override;
+	void free(VkDeviceMemory memory) override;
+	void* map(VkDeviceMemory memory) override;
+private:
+	VkDevice _logicalDevice;
+};
+
+class VulkanMemoryAllocator {
+	friend class VulkanMemoryDefragmenter;
+public:
+	VulkanMemoryAllocator(VkPhysicalDevice physicalDevice, VkDevice logicalDevice);
+	VulkanMemoryAllocator(
+		const VkPhysicalDeviceMemoryProperties& memoryProperties, const VkPhysicalDeviceLimits& limits, VulkanDeviceMemoryBackend* backend);
+	~VulkanMemoryAllocator();
+
+	VulkanAllocation* allocate(
+		const VkMemoryRequirements& requirements, VulkanMemoryUsage usage, QTlsfResourceKind kind, bool dedicated = false,
+		VkBuffer dedicatedBuffer = VK_NULL_HANDLE, VkImage dedicatedImage = VK_NULL_HANDLE);
+	void free(VulkanAllocation* allocation);
+
+	VulkanAllocation* createBuffer(
+		VkDeviceSize size, VkBufferUsageFlags usage, VulkanMemoryUsage memoryUsage, VkBuffer* outBuffer, bool movable = false);
+	VulkanAllocation* createBuffer(const VkBufferCreateInfo& createInfo, VulkanMemoryUsage memoryUsage, VkBuffer* outBuffer);
+	VulkanAllocation* createImage(const VkImageCreateInfo& createInfo, VulkanMemoryUsage memoryUsage, VkImage* outImage);
+	void destroyBuffer(VkBuffer buffer, VulkanAllocation* allocation);
+	void destroyImage(VkImage image, VulkanAllocation* allocation);
+
+	VulkanMemoryStats getStats();
+	VkDeviceSize getBufferImageGranularity();
+	VkDevice getLogicalDevice();
+private:
+	VkDevice _logicalDevice = VK_NULL_HANDLE;
+	VulkanDeviceMemoryBackend* _backend = nullptr;
+	bool _ownsBackend = false;
+
+	VkPhysicalDeviceMemoryProperties _memoryProperties;
+	VkDeviceSize _bufferImageGranularity = 1;
+	uint32_t _maxAllocationCount = 0;
+	uint32_t _deviceAllocationCount = 0;
+
+	std::mutex _mutex;
+	std::vector<VulkanMemoryBlock*> _blocks[VK_MAX_MEMORY_TYPES];
+	std::vector<VulkanAllocation*> _dedicatedAllocations;
+
+	void _init(const VkPhysicalDeviceMemoryProperties& memoryProperties, const VkPhysicalDeviceLimits& limits);
+	void _findMemoryTypes(uint32_t memoryTypeBits, VulkanMemoryUsage usage, std::vector<uint32_t>& outTypes);
+	VkDeviceSize _getBlockSize(uint32_t memoryTypeIndex);
+	VulkanAllocation* _allocateFromBlocks(uint32_t memoryTypeIndex, const VkMemoryRequirements& requirements, QTlsfResourceKind kind);
+	VulkanAllocation* _allocateDedicated(
+		uint32_t memoryTypeIndex, VkDeviceSize size, VkBuffer dedicatedBuffer, VkImage dedicatedImage);
+	VulkanMemoryBlock* _createBlock(uint32_t memoryTypeIndex, VkDeviceSize minSize);
+	void _destroyBlock(VulkanMemoryBlock* block);
+	void _freeBlockRange(VulkanMemoryBlock* block, uint32_t handle);
+	void* _mapIfHostVisible(uint32_t memoryTypeIndex, VkDeviceMemory memory);
+};
@@ -0,0 +1,280 @@
+#include "VulkanMemoryDefragmenter.h"
+#include <algorithm>
+
+VulkanMemoryDefragmenter::VulkanMemoryDefragmenter(
+	VulkanMemoryAllocator* allocator, uint32_t queueFamilyIndex, uint32_t maxMovesPerFrame, VkDeviceSize maxBytesPerFrame) :
+	_allocator{ allocator }, _maxMovesPerFrame{ maxMovesPerFrame }, _maxBytesPerFrame{ maxBytesPerFrame } {
+	this->_logicalDevice = allocator->getLogicalDevice();
+
+	// An allocator running on a mock backend has no device, only the planning side is usable then.
+	if (this->_logicalDevice != VK_NULL_HANDLE) {
+		this->_createCommandBuffers(queueFamilyIndex);
+	}
+}
+
+VulkanMemoryDefragmenter::~VulkanMemoryDefragmenter() {
+	for (uint32_t i = 0; i < MAX_FRAME_DRAWS; i++) {
+		this->releaseFrame(i);
+	}
+
+	if (this->_commandPool != VK_NULL_HANDLE) {
+		vkDestroyCommandPool(this->_logicalDevice, this->_commandPool, nullptr);
+	}
+}
+
+void VulkanMemoryDefragmenter::setMoveCallback(MoveCallback callback) {
+	this->_moveCallback = callback;
+}
+
+uint32_t VulkanMemoryDefragmenter::planMoves(std::vector<VulkanDefragMove>& outMoves) {
+	outMoves.clear();
+
+	std::lock_guard<std::mutex> lock(this->_allocator->_mutex);
+
+	VkDeviceSize plannedBytes = 0;
+
+	for (uint32_t memoryTypeIndex = 0; memoryTypeIndex < VK_MAX_MEMORY_TYPES; memoryTypeIndex++) {
+		// Scratch vectors are members so steady-state frames reuse their capacity instead of allocating.
+		std::vector<VulkanMemoryBlock*>& blocks = this->_sortedBlocks;
+		blocks.assign(this->_allocator->_blocks[memoryTypeIndex].begin(), this->_allocator->_blocks[memoryTypeIndex].end());
+		if (blocks.size() < 2) {
+			continue;
+		}
+
+		std::sort(blocks.begin(), blocks.end(), [](VulkanMemoryBlock* a, VulkanMemoryBlock* b) {
+			return a->allocator->getUsedBytes() < b->allocator->getUsedBytes();
+		});
+
+		// Blocks that already received data this pass are never drained again in the same pass.
+		std::vector<uint8_t>& receivedMoves = this->_receivedMoves;
+		receivedMoves.assign(blocks.size(), 0);
+
+		for (size_t src = 0; src + 1 < blocks.size(); src++) {
+			QTlsfAllocator* srcAllocator = blocks[src]->allocator;
+			float usage = static_cast<float>(srcAllocator->getUsedBytes()) / static_cast<float>(srcAllocator->getCapacity());
+
+			if (usage >= DEFRAG_SPARSE_BLOCK_USAGE) {
+				break;
+			}
+
+			if (receivedMoves[src] || srcAllocator->isEmpty()) {
+				continue;
+			}
+
+			srcAllocator->getAllocations(this->_allocationInfos);
+
+			for (const QTlsfAllocationInfo& info : this->_allocationInfos) {
+				VulkanAllocation* allocation = static_cast<VulkanAllocation*>(info.userData);
+				if (allocation == nullptr || !this->_isMovable(allocation)) {
+					continue;
+				}
+
+				if (outMoves.size() >= this->_maxMovesPerFrame || plannedBytes + allocation->size > this->_maxBytesPerFrame) {
+					return static_cast<uint32_t>(outMoves.size());
+				}
+
+				// Densest destinations first so the remaining sparse blocks drain completely.
+				for (size_t dst = blocks.size() - 1; dst > src; dst--) {
+					uint32_t handle = blocks[dst]->allocator->allocate(allocation->size, allocation->alignment, info.kind);
+					if (handle == QTlsfAllocator::INVALID_HANDLE) {
+						continue;
+					}
+
+					VulkanDefragMove move;
+					move.allocation = allocation;
+					move.srcBlock = blocks[src];
+					move.srcHandle = info.handle;
+					move.srcOffset = info.offset;
+					move.dstBlock = blocks[dst];
+					move.dstHandle = handle;
+					move.dstOffset = blocks[dst]->allocator->getOffset(handle);
+					move.size = allocation->size;
+
+					outMoves.push_back(move);
+					plannedBytes += allocation->size;
+					receivedMoves[dst] = 1;
+					break;
+				}
+			}
+		}
+	}
+
+	return static_cast<uint32_t>(outMoves.size());
+}
+
+void VulkanMemoryDefragmenter::commitMove(const VulkanDefragMove& move, VkBuffer newBuffer, uint32_t frameIndex) {
+	VulkanAllocation* allocation = move.allocation;
+	VkBuffer oldBuffer = allocation->buffer;
+
+	{
+		std::lock_guard<std::mutex> lock(this->_allocator->_mutex);
+
+		allocation->memory = move.dstBlock->memory;
+		allocation->offset = move.dstOffset;
+		allocation->block = move.dstBlock;
+		allocation->blockHandle = move.dstHandle;
+		allocation->mapped = move.dstBlock->mapped != nullptr ? static_cast<char*>(move.dstBlock->mapped) + move.dstOffset : nullptr;
+		allocation->buffer = newBuffer;
+
+		move.dstBlock->allocator->setUserData(move.dstHandle, allocation);
+		move.srcBlock->allocator->setUserData(move.srcHandle, nullptr);
+
+		// The old range stays allocated until this frame slot's fence proves the copy and every reader are done.
+		RetiredRange retired;
+		retired.block = move.srcBlock;
+		retired.handle = move.srcHandle;
+		retired.buffer = oldBuffer;
+		this->_retired[frameIndex].push_back(retired);
+
+		this->_stats.movesTotal++;
+		this->_stats.bytesMovedTotal += move.size;
+		this->_stats.movesLastFrame++;
+		this->_stats.bytesMovedLastFrame += move.size;
+		this->_stats.pendingReleases++;
+	}
+
+	if (this->_moveCallback) {
+		this->_moveCallback(allocation, oldBuffer);
+	}
+}
+
+void VulkanMemoryDefragmenter::cancelMove(const VulkanDefragMove& move) {
+	std::lock_guard<std::mutex> lock(this->_allocator->_mutex);
+	this->_allocator->_freeBlockRange(move.dstBlock, move.dstHandle);
+}
+
+void VulkanMemoryDefragmenter::releaseFrame(uint32_t frameIndex) {
+	std::lock_guard<std::mutex> lock(this->_allocator->_mutex);
+
+	for (const RetiredRange& retired : this->_retired[frameIndex]) {
+		if (retired.buffer != VK_NULL_HANDLE && this->_logicalDevice != VK_NULL_HANDLE) {
+			vkDestroyBuffer(this->_logicalDevice, retired.buffer, nullptr);
+		}
+
+		this->_allocator->_freeBlockRange(retired.block, retired.handle);
+	}
+
+	this->_stats.pendingReleases -= static_cast<uint32_t>(this->_retired[frameIndex].size());
+	this->_retired[frameIndex].clear();
+}
+
+VkCommandBuffer VulkanMemoryDefragmenter::recordFrame(uint32_t frameIndex) {
+	this->releaseFrame(frameIndex);
+
+	this->_stats.movesLastFrame = 0;
+	this->_stats.bytesMovedLastFrame = 0;
+
+	if (this->_commandPool == VK_NULL_HANDLE || this->planMoves(this->_moves) == 0) {
+		return VK_NULL_HANDLE;
+	}
+
+	VkCommandBuffer commandBuffer = this->_commandBuffers[frameIndex];
+	vkResetCommandBuffer(commandBuffer, 0);
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	VkResult result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to start recording a defragmentation command buffer!..");
+	}
+
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_MEMORY_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+	vkCmdPipelineBarrier(
+		commandBuffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	for (const VulkanDefragMove& move : this->_moves) {
+		VkBuffer newBuffer = this->_createMovedBuffer(move);
+
+		VkBufferCopy region = {};
+		region.size = move.allocation->bufferSize;
+		vkCmdCopyBuffer(commandBuffer, move.allocation->buffer, newBuffer, 1, &region);
+
+		this->commitMove(move, newBuffer, frameIndex);
+	}
+
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+	vkCmdPipelineBarrier(
+		commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	result = vkEndCommandBuffer(commandBuffer);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to stop recording a defragmentation command buffer!..");
+	}
+
+	return commandBuffer;
+}
+
+VulkanDefragStats VulkanMemoryDefragmenter::getStats() {
+	std::lock_guard<std::mutex> lock(this->_allocator->_mutex);
+	return this->_stats;
+}
+
+float VulkanMemoryDefragmenter::getFragmentation() {
+	return this->_allocator->getStats().fragmentation;
+}
+
+void VulkanMemoryDefragmenter::_createCommandBuffers(uint32_t queueFamilyIndex) {
+	VkCommandPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolCreateInfo.queueFamilyIndex = queueFamilyIndex;
+
+	VkResult result = vkCreateCommandPool(this->_logicalDevice, &poolCreateInfo, nullptr, &this->_commandPool);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to create a defragmentation command pool!..");
+	}
+
+	this->_commandBuffers.resize(MAX_FRAME_DRAWS);
+
+	VkCommandBufferAllocateInfo cbAllocInfo = {};
+	cbAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	cbAllocInfo.commandPool = this->_commandPool;
+	cbAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	cbAllocInfo.commandBufferCount = static_cast<uint32_t>(this->_commandBuffers.size());
+
+	result = vkAllocateCommandBuffers(this->_logicalDevice, &cbAllocInfo, this->_commandBuffers.data());
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to allocate defragmentation command buffers!..");
+	}
+}
+
+bool VulkanMemoryDefragmenter::_isMovable(const VulkanAllocation* allocation) {
+	// Without a callback nobody would learn about the new handle, so nothing moves at all.
+	if (!this->_moveCallback) {
+		return false;
+	}
+
+	VkBufferUsageFlags transfer = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+	return allocation->movable && allocation->buffer != VK_NULL_HANDLE && allocation->image == VK_NULL_HANDLE &&
+		(allocation->bufferUsage & transfer) == transfer;
+}
+
+VkBuffer VulkanMemoryDefragmenter::_createMovedBuffer(const VulkanDefragMove& move) {
+	VkBufferCreateInfo bufferCreateInfo = {};
+	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferCreateInfo.size = move.allocation->bufferSize;
+	bufferCreateInfo.usage = move.allocation->bufferUsage;
+	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	VkBuffer buffer;
+	VkResult result = vkCreateBuffer(this->_logicalDevice, &bufferCreateInfo, nullptr, &buffer);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to create a relocated buffer!..");
+	}
+
+	result = vkBindBufferMemory(this->_logicalDevice, buffer, move.dstBlock->memory, move.dstOffset);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to bind relocated buffer memory!..");
+	}
+
+	return buffer;
+}
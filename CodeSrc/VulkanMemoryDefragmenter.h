@@ -0,0 +1,82 @@
+#pragma once
+#include <functional>
+#include "QEngine.h"
+#include "VulkanUtilities.h"
+#include "VulkanMemoryAllocator.h"
+
+const uint32_t DEFRAG_MAX_MOVES_PER_FRAME = 64;
+const VkDeviceSize DEFRAG_MAX_BYTES_PER_FRAME = 32ull * 1024 * 1024;
+const float DEFRAG_SPARSE_BLOCK_USAGE = 0.5f;
+
+struct VulkanDefragMove {
+	VulkanAllocation* allocation = nullptr;
+	VulkanMemoryBlock* srcBlock = nullptr;
+	uint32_t srcHandle = QTlsfAllocator::INVALID_HANDLE;
+	VkDeviceSize srcOffset = 0;
+	VulkanMemoryBlock* dstBlock = nullptr;
+	uint32_t dstHandle = QTlsfAllocator::INVALID_HANDLE;
+	VkDeviceSize dstOffset = 0;
+	VkDeviceSize size = 0;
+};
+
+struct VulkanDefragStats {
+	uint64_t movesTotal = 0;
+	uint64_t bytesMovedTotal = 0;
+	uint32_t movesLastFrame = 0;
+	VkDeviceSize bytesMovedLastFrame = 0;
+	uint32_t pendingReleases = 0;
+};
+
+// Incrementally empties sparsely used blocks by relocating buffers into denser ones.
+// Planning and bookkeeping only touch the allocator, so they run against a mock device;
+// recordFrame is the only part that talks to the GPU. Images are never moved: relocating
+// them would also mean recreating views and descriptors the allocator knows nothing about.
+// Only buffers created with movable set are candidates, and only once a move callback is
+// registered: the callback is where the owner swaps in the new handle.
+class VulkanMemoryDefragmenter {
+public:
+	typedef std::function<void(VulkanAllocation* allocation, VkBuffer oldBuffer)> MoveCallback;
+
+	VulkanMemoryDefragmenter(
+		VulkanMemoryAllocator* allocator, uint32_t queueFamilyIndex,
+		uint32_t maxMovesPerFrame = DEFRAG_MAX_MOVES_PER_FRAME, VkDeviceSize maxBytesPerFrame = DEFRAG_MAX_BYTES_PER_FRAME);
+	~VulkanMemoryDefragmenter();
+
+	void setMoveCallback(MoveCallback callback);
+
+	uint32_t planMoves(std::vector<VulkanDefragMove>& outMoves);
+	void commitMove(const VulkanDefragMove& move, VkBuffer newBuffer, uint32_t frameIndex);
+	void cancelMove(const VulkanDefragMove& move);
+	void releaseFrame(uint32_t frameIndex);
+
+	VkCommandBuffer recordFrame(uint32_t frameIndex);
+
+	VulkanDefragStats getStats();
+	float getFragmentation();
+private:
+	struct RetiredRange {
+		VulkanMemoryBlock* block;
+		uint32_t handle;
+		VkBuffer buffer;
+	};
+
+	VulkanMemoryAllocator* _allocator;
+	VkDevice _logicalDevice = VK_NULL_HANDLE;
+	VkCommandPool _commandPool = VK_NULL_HANDLE;
+	std::vector<VkCommandBuffer> _commandBuffers;
+
+	uint32_t _maxMovesPerFrame;
+	VkDeviceSize _maxBytesPerFrame;
+	MoveCallback _moveCallback;
+	VulkanDefragStats _stats;
+
+	std::vector<RetiredRange> _retired[MAX_FRAME_DRAWS];
+	std::vector<VulkanDefragMove> _moves;
+	std::vector<QTlsfAllocationInfo> _allocationInfos;
+	std::vector<VulkanMemoryBlock*> _sortedBlocks;
+	std::vector<uint8_t> _receivedMoves;
+
+	void _createCommandBuffers(uint32_t queueFamilyIndex);
+	bool _isMovable(const VulkanAllocation* allocation);
+	VkBuffer _createMovedBuffer(const VulkanDefragMove& move);
+};
@@ -0,0 +1,198 @@
+#include "VulkanParallelRecorder.h"
+
+VulkanParallelRecorder::VulkanParallelRecorder(
+	VulkanCommandPoolManager* commandPools, uint32_t queueFamilyIndex, QJobSystem* jobSystem,
+	VulkanBindlessDescriptors* bindlessDescriptors, VulkanUniformAllocator* uniformAllocator, uint32_t minDrawsPerTask) :
+	_commandPools{ commandPools }, _queueFamilyIndex{ queueFamilyIndex }, _jobSystem{ jobSystem },
+	_bindlessDescriptors{ bindlessDescriptors }, _uniformAllocator{ uniformAllocator }, _minDrawsPerTask{ std::max<uint32_t>(minDrawsPerTask, 1) } {
+	if (this->_commandPools->getThreadCount() < this->_jobSystem->getWorkerCount()) {
+		ThrowErr::runtime("Failed to create a parallel recorder: fewer command pool threads than workers!..");
+	}
+
+	this->_workerUsed.resize(this->_jobSystem->getWorkerCount());
+}
+
+VulkanParallelRecorder::~VulkanParallelRecorder() {}
+
+void VulkanParallelRecorder::beginFrame() {
+	this->_stats = VulkanRecordStats();
+	std::fill(this->_workerUsed.begin(), this->_workerUsed.end(), 0);
+}
+
+void VulkanParallelRecorder::record(
+	VkCommandBuffer primary, const VkRenderingInfo& renderingInfo, QSpan<const VkFormat> colorFormats, VkFormat depthFormat,
+	const VkViewport& viewport, const VkRect2D& scissor, QSpan<const VulkanDrawCommand> draws,
+	QSpan<const VkCommandBuffer> prerecorded) {
+	QAllocScope allocScope(QAllocTag::RECORDING);
+	uint32_t drawCount = static_cast<uint32_t>(draws.size());
+	uint32_t workerCount = this->_jobSystem->getWorkerCount();
+
+	// Two chunks per worker evens out uneven draws without shrinking chunks below the useful minimum.
+	uint32_t drawsPerChunk = std::max(this->_minDrawsPerTask, (drawCount + workerCount * 2 - 1) / (workerCount * 2));
+	uint32_t chunkCount = (drawCount + drawsPerChunk - 1) / drawsPerChunk;
+
+	VkCommandBufferInheritanceRenderingInfo inheritanceRenderingInfo = {};
+	inheritanceRenderingInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+	inheritanceRenderingInfo.colorAttachmentCount = static_cast<uint32_t>(colorFormats.size());
+	inheritanceRenderingInfo.pColorAttachmentFormats = colorFormats.data();
+	inheritanceRenderingInfo.depthAttachmentFormat = depthFormat;
+	inheritanceRenderingInfo.stencilAttachmentFormat = VK_FORMAT_UNDEFINED;
+	inheritanceRenderingInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+	VkCommandBufferInheritanceInfo inheritanceInfo = {};
+	inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+	inheritanceInfo.pNext = &inheritanceRenderingInfo;
+
+	// Prerecorded secondaries (cached static batches) run first, then the chunks in draw order.
+	this->_secondaries.assign(prerecorded.begin(), prerecorded.end());
+	this->_secondaries.resize(prerecorded.size() + chunkCount, VK_NULL_HANDLE);
+	this->_chunkBinds.assign(chunkCount, VulkanBindCounts());
+
+	this->_jobSystem->parallelFor(chunkCount, 1, [&](uint32_t begin, uint32_t end, uint32_t workerIndex) {
+		for (uint32_t chunk = begin; chunk < end; chunk++) {
+			uint32_t first = chunk * drawsPerChunk;
+			uint32_t count = std::min(drawsPerChunk, drawCount - first);
+
+			VkCommandBuffer secondary = this->_commandPools->acquire(workerIndex, this->_queueFamilyIndex, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+			this->_chunkBinds[chunk] = this->_recordChunk(secondary, inheritanceInfo, viewport, scissor, draws.subspan(first, count));
+
+			this->_secondaries[prerecorded.size() + chunk] = secondary;
+			this->_workerUsed[workerIndex] = 1;
+		}
+	});
+
+	VkRenderingInfo primaryRenderingInfo = renderingInfo;
+	primaryRenderingInfo.flags |= VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+
+	vkCmdBeginRendering(primary, &primaryRenderingInfo);
+	if (!this->_secondaries.empty()) {
+		vkCmdExecuteCommands(primary, static_cast<uint32_t>(this->_secondaries.size()), this->_secondaries.data());
+	}
+	vkCmdEndRendering(primary);
+
+	this->_stats.drawCount += drawCount;
+	this->_stats.secondaryCount += static_cast<uint32_t>(this->_secondaries.size());
+	this->_stats.workersUsed = static_cast<uint32_t>(std::count(this->_workerUsed.begin(), this->_workerUsed.end(), 1));
+	for (const VulkanBindCounts& binds : this->_chunkBinds) {
+		this->_stats.binds.pipelineBinds += binds.pipelineBinds;
+		this->_stats.binds.vertexBufferBinds += binds.vertexBufferBinds;
+		this->_stats.binds.indexBufferBinds += binds.indexBufferBinds;
+		this->_stats.binds.uniformBinds += binds.uniformBinds;
+		this->_stats.binds.bindsAvoided += binds.bindsAvoided;
+	}
+}
+
+VulkanRecordStats VulkanParallelRecorder::getStats() {
+	return this->_stats;
+}
+
+VulkanBindCounts VulkanParallelRecorder::_recordChunk(
+	VkCommandBuffer commandBuffer, const VkCommandBufferInheritanceInfo& inheritanceInfo,
+	const VkViewport& viewport, const VkRect2D& scissor, QSpan<const VulkanDrawCommand> draws) {
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+	VkResult result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to start recording a secondary command buffer!..");
+	}
+
+	VulkanBindCounts binds = VulkanParallelRecorder::recordDraws(
+		commandBuffer, this->_bindlessDescriptors, this->_uniformAllocator, viewport, scissor, draws);
+
+	result = vkEndCommandBuffer(commandBuffer);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to stop recording a secondary command buffer!..");
+	}
+
+	return binds;
+}
+
+VulkanBindCounts VulkanParallelRecorder::recordDraws(
+	VkCommandBuffer commandBuffer, VulkanBindlessDescriptors* bindlessDescriptors, VulkanUniformAllocator* uniformAllocator,
+	const VkViewport& viewport, const VkRect2D& scissor, QSpan<const VulkanDrawCommand> draws) {
+	// Secondaries inherit no state, so every one sets its own viewport and descriptors.
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+	bindlessDescriptors->bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS);
+
+	VkPipeline boundPipeline = VK_NULL_HANDLE;
+	VkBuffer boundVertexBuffer = VK_NULL_HANDLE;
+	VkBuffer boundIndexBuffer = VK_NULL_HANDLE;
+	uint32_t boundUniformOffset = 0;
+	bool uniformsBound = false;
+	VulkanDrawPushConstants pushedConstants = {};
+	bool pushed = false;
+	VulkanBindCounts binds;
+
+	for (const VulkanDrawCommand& draw : draws) {
+		if (draw.pipeline != boundPipeline) {
+			vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, draw.pipeline);
+			boundPipeline = draw.pipeline;
+			binds.pipelineBinds++;
+		}
+		else {
+			binds.bindsAvoided++;
+		}
+
+		if (draw.vertexBuffer != VK_NULL_HANDLE) {
+			if (draw.vertexBuffer != boundVertexBuffer) {
+				VkDeviceSize offset = 0;
+				vkCmdBindVertexBuffers(commandBuffer, 0, 1, &draw.vertexBuffer, &offset);
+				boundVertexBuffer = draw.vertexBuffer;
+				binds.vertexBufferBinds++;
+			}
+			else {
+				binds.bindsAvoided++;
+			}
+		}
+
+		if (draw.indexBuffer != VK_NULL_HANDLE) {
+			if (draw.indexBuffer != boundIndexBuffer) {
+				vkCmdBindIndexBuffer(commandBuffer, draw.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+				boundIndexBuffer = draw.indexBuffer;
+				binds.indexBufferBinds++;
+			}
+			else {
+				binds.bindsAvoided++;
+			}
+		}
+
+		// Rebinding set 1 only moves its dynamic offset; draws sharing constants skip it.
+		if (!uniformsBound || draw.uniformOffset != boundUniformOffset) {
+			uniformAllocator->bind(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, bindlessDescriptors->getPipelineLayout(), draw.uniformOffset);
+			boundUniformOffset = draw.uniformOffset;
+			uniformsBound = true;
+			binds.uniformBinds++;
+		}
+		else {
+			binds.bindsAvoided++;
+		}
+
+		// Every pipeline shares the bindless layout, so pushed values survive pipeline binds.
+		if (!pushed || draw.materialIndex != pushedConstants.materialIndex || draw.objectIndex != pushedConstants.objectIndex) {
+			pushedConstants = { draw.materialIndex, draw.objectIndex };
+			bindlessDescriptors->pushConstants(commandBuffer, pushedConstants);
+			pushed = true;
+		}
+		else {
+			binds.bindsAvoided++;
+		}
+
+		if (draw.indirectBuffer != VK_NULL_HANDLE) {
+			vkCmdDrawIndexedIndirectCount(
+				commandBuffer, draw.indirectBuffer, draw.indirectOffset, draw.countBuffer, draw.countOffset,
+				draw.maxDrawCount, sizeof(VkDrawIndexedIndirectCommand));
+		}
+		else if (draw.indexBuffer != VK_NULL_HANDLE) {
+			vkCmdDrawIndexed(commandBuffer, draw.elementCount, draw.instanceCount, draw.firstElement, draw.vertexOffset, draw.firstInstance);
+		}
+		else {
+			vkCmdDraw(commandBuffer, draw.elementCount, draw.instanceCount, draw.firstElement, draw.firstInstance);
+		}
+	}
+
+	return binds;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "QEngine.h"
+#include "VulkanUtilities.h"
+#include "VulkanDrawCommand.h"
+#include "VulkanBindlessDescriptors.h"
+#include "VulkanUniformAllocator.h"
+#include "VulkanCommandPoolManager.h"
+#include "QArenaContainers.h"
+#include "QJobSystem.h"
+
+const uint32_t RECORD_MIN_DRAWS_PER_TASK = 256;
+
+// Binds actually recorded, and binds skipped because the previous draw in the same command buffer had
+// already bound that pipeline or buffer. Sorted draw lists are what make the skipped count large.
+struct VulkanBindCounts {
+	uint32_t pipelineBinds = 0;
+	uint32_t vertexBufferBinds = 0;
+	uint32_t indexBufferBinds = 0;
+	uint32_t uniformBinds = 0;
+	uint32_t bindsAvoided = 0;
+};
+
+// Totals over every record() since beginFrame().
+struct VulkanRecordStats {
+	uint32_t drawCount = 0;
+	uint32_t secondaryCount = 0;
+	uint32_t workersUsed = 0;
+	VulkanBindCounts binds;
+};
+
+// Splits a draw list into contiguous chunks recorded on the job system into secondary command buffers,
+// which the primary then executes in order inside one dynamic rendering scope. Secondaries come from
+// the recording worker's own pool in the manager, so recording takes no locks.
+class VulkanParallelRecorder {
+public:
+	VulkanParallelRecorder(
+		VulkanCommandPoolManager* commandPools, uint32_t queueFamilyIndex, QJobSystem* jobSystem,
+		VulkanBindlessDescriptors* bindlessDescriptors, VulkanUniformAllocator* uniformAllocator,
+		uint32_t minDrawsPerTask = RECORD_MIN_DRAWS_PER_TASK);
+	~VulkanParallelRecorder();
+
+	void beginFrame();
+	void record(
+		VkCommandBuffer primary, const VkRenderingInfo& renderingInfo, QSpan<const VkFormat> colorFormats, VkFormat depthFormat,
+		const VkViewport& viewport, const VkRect2D& scissor, QSpan<const VulkanDrawCommand> draws,
+		QSpan<const VkCommandBuffer> prerecorded = QSpan<const VkCommandBuffer>());
+
+	VulkanRecordStats getStats();
+
+	static VulkanBindCounts recordDraws(
+		VkCommandBuffer commandBuffer, VulkanBindlessDescriptors* bindlessDescriptors, VulkanUniformAllocator* uniformAllocator,
+		const VkViewport& viewport, const VkRect2D& scissor, QSpan<const VulkanDrawCommand> draws);
+private:
+	VulkanCommandPoolManager* _commandPools;
+	uint32_t _queueFamilyIndex;
+	QJobSystem* _jobSystem;
+	VulkanBindlessDescriptors* _bindlessDescriptors;
+	VulkanUniformAllocator* _uniformAllocator;
+	uint32_t _minDrawsPerTask;
+
+	std::vector<VkCommandBuffer> _secondaries;
+	std::vector<uint8_t> _workerUsed;
+	std::vector<VulkanBindCounts> _chunkBinds;
+	VulkanRecordStats _stats;
+
+	VulkanBindCounts _recordChunk(
+		VkCommandBuffer commandBuffer, const VkCommandBufferInheritanceInfo& inheritanceInfo,
+		const VkViewport& viewport, const VkRect2D& scissor, QSpan<const VulkanDrawCommand> draws);
+};
@@ -0,0 +1,154 @@
+#include "VulkanQueueProfiler.h"
+
+static uint64_t timestampMask(uint32_t validBits) {
+	if (validBits == 0) {
+		return 0;
+	}
+
+	return validBits >= 64 ? UINT64_MAX : (1ull << validBits) - 1;
+}
+
+VulkanQueueProfiler::VulkanQueueProfiler(
+	VkPhysicalDevice physicalDevice, VkDevice logicalDevice, uint32_t frameCount,
+	uint32_t graphicsFamily, uint32_t computeFamily, uint32_t maxBatches) :
+	_logicalDevice{ logicalDevice }, _maxBatches{ maxBatches }, _frameCount{ std::min<uint32_t>(frameCount, MAX_FRAME_DRAWS) } {
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+	this->_timestampPeriod = properties.limits.timestampPeriod;
+
+	uint32_t queueFamilyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+
+	std::vector<VkQueueFamilyProperties> queueFamilyList(queueFamilyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilyList.data());
+
+	this->_validMasks[static_cast<uint32_t>(VulkanGraphQueue::GRAPHICS)] = timestampMask(queueFamilyList[graphicsFamily].timestampValidBits);
+	this->_validMasks[static_cast<uint32_t>(VulkanGraphQueue::ASYNC_COMPUTE)] = timestampMask(queueFamilyList[computeFamily].timestampValidBits);
+
+	VkQueryPoolCreateInfo queryPoolCreateInfo = {};
+	queryPoolCreateInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	queryPoolCreateInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	queryPoolCreateInfo.queryCount = this->_maxBatches * 2;
+
+	for (uint32_t i = 0; i < this->_frameCount; i++) {
+		VkResult result = vkCreateQueryPool(this->_logicalDevice, &queryPoolCreateInfo, nullptr, &this->_frames[i].queryPool);
+		if (result != VK_SUCCESS) {
+			ThrowErr::runtime("Failed to create a queue profiler query pool!..");
+		}
+
+		// Host reset (Vulkan 1.2) keeps resets out of the command buffers of both queues.
+		vkResetQueryPool(this->_logicalDevice, this->_frames[i].queryPool, 0, queryPoolCreateInfo.queryCount);
+		this->_frames[i].queues.reserve(this->_maxBatches);
+	}
+
+	this->_results.reserve(this->_maxBatches * 2);
+	this->_intervals.reserve(this->_maxBatches);
+}
+
+VulkanQueueProfiler::~VulkanQueueProfiler() {
+	for (uint32_t i = 0; i < this->_frameCount; i++) {
+		vkDestroyQueryPool(this->_logicalDevice, this->_frames[i].queryPool, nullptr);
+	}
+}
+
+void VulkanQueueProfiler::beginFrame(uint32_t frameIndex) {
+	// The slot's previous frame has retired by now, so its queries are available without waiting.
+	this->_frameIndex = frameIndex;
+	FrameQueries& frame = this->_frames[frameIndex];
+
+	if (frame.queryCount == 0) {
+		return;
+	}
+
+	this->_readFrame(frame);
+
+	vkResetQueryPool(this->_logicalDevice, frame.queryPool, 0, frame.queryCount);
+	frame.queryCount = 0;
+	frame.queues.clear();
+}
+
+void VulkanQueueProfiler::beginBatch(VkCommandBuffer commandBuffer, VulkanGraphQueue queue) {
+	FrameQueries& frame = this->_frames[this->_frameIndex];
+
+	if (this->_validMasks[static_cast<uint32_t>(queue)] == 0 || frame.queues.size() >= this->_maxBatches) {
+		return;
+	}
+
+	vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, frame.queryPool, frame.queryCount);
+	frame.queues.push_back(queue);
+	frame.queryCount++;
+}
+
+void VulkanQueueProfiler::endBatch(VkCommandBuffer commandBuffer, VulkanGraphQueue) {
+	FrameQueries& frame = this->_frames[this->_frameIndex];
+
+	// An odd count means beginBatch wrote the matching start timestamp.
+	if (frame.queryCount % 2 == 0) {
+		return;
+	}
+
+	vkCmdWriteTimestamp2(commandBuffer, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, frame.queryPool, frame.queryCount);
+	frame.queryCount++;
+}
+
+VulkanQueueStats VulkanQueueProfiler::getStats() {
+	return this->_stats;
+}
+
+void VulkanQueueProfiler::_readFrame(FrameQueries& frame) {
+	this->_results.resize(frame.queryCount);
+
+	VkResult result = vkGetQueryPoolResults(
+		this->_logicalDevice, frame.queryPool, 0, frame.queryCount,
+		this->_results.size() * sizeof(uint64_t), this->_results.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+	if (result != VK_SUCCESS) {
+		return;
+	}
+
+	uint64_t busy[static_cast<uint32_t>(VulkanGraphQueue::COUNT)] = {};
+	uint32_t batches[static_cast<uint32_t>(VulkanGraphQueue::COUNT)] = {};
+	this->_intervals.clear();
+
+	for (uint32_t i = 0; i + 1 < frame.queryCount; i += 2) {
+		uint32_t queue = static_cast<uint32_t>(frame.queues[i / 2]);
+		uint64_t start = this->_results[i] & this->_validMasks[queue];
+		uint64_t end = std::max(start, this->_results[i + 1] & this->_validMasks[queue]);
+
+		busy[queue] += end - start;
+		batches[queue]++;
+		this->_intervals.push_back(std::make_pair(start, end));
+	}
+
+	if (this->_intervals.empty()) {
+		return;
+	}
+
+	// Batches on one queue never overlap, so the union of all intervals is the time any queue was busy.
+	std::sort(this->_intervals.begin(), this->_intervals.end());
+
+	uint64_t unionTicks = 0;
+	uint64_t spanStart = this->_intervals.front().first;
+	uint64_t spanEnd = spanStart;
+	uint64_t runStart = spanStart;
+	uint64_t runEnd = spanStart;
+	for (const std::pair<uint64_t, uint64_t>& interval : this->_intervals) {
+		if (interval.first > runEnd) {
+			unionTicks += runEnd - runStart;
+			runStart = interval.first;
+		}
+		runEnd = std::max(runEnd, interval.second);
+		spanEnd = std::max(spanEnd, interval.second);
+	}
+	unionTicks += runEnd - runStart;
+
+	const uint32_t graphics = static_cast<uint32_t>(VulkanGraphQueue::GRAPHICS);
+	const uint32_t compute = static_cast<uint32_t>(VulkanGraphQueue::ASYNC_COMPUTE);
+	const float ticksToMs = this->_timestampPeriod / 1000000.0f;
+
+	this->_stats.graphicsBusyMs = busy[graphics] * ticksToMs;
+	this->_stats.computeBusyMs = busy[compute] * ticksToMs;
+	this->_stats.overlapMs = (busy[graphics] + busy[compute] - unionTicks) * ticksToMs;
+	this->_stats.frameSpanMs = (spanEnd - spanStart) * ticksToMs;
+	this->_stats.graphicsBatches = batches[graphics];
+	this->_stats.computeBatches = batches[compute];
+}
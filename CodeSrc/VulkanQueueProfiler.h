@@ -0,0 +1,53 @@
+#pragma once
+#include "QEngine.h"
+#include "VulkanUtilities.h"
+#include "VulkanRenderGraph.h"
+
+const uint32_t QUEUE_PROFILER_MAX_BATCHES = 32;
+
+struct VulkanQueueStats {
+	float graphicsBusyMs = 0.0f;
+	float computeBusyMs = 0.0f;
+	float overlapMs = 0.0f;
+	float frameSpanMs = 0.0f;
+	uint32_t graphicsBatches = 0;
+	uint32_t computeBatches = 0;
+};
+
+// Per-queue busy time from timestamps written around every submitted batch. Results are read back
+// when a frame slot comes around again, which is after the frame has retired, so reading never stalls.
+// Overlap is the time both queues were busy at once, i.e. what async compute actually bought. Families
+// without timestamp support are skipped, and timestamps of the two queues are assumed to share a clock.
+class VulkanQueueProfiler {
+public:
+	VulkanQueueProfiler(
+		VkPhysicalDevice physicalDevice, VkDevice logicalDevice, uint32_t frameCount,
+		uint32_t graphicsFamily, uint32_t computeFamily, uint32_t maxBatches = QUEUE_PROFILER_MAX_BATCHES);
+	~VulkanQueueProfiler();
+
+	void beginFrame(uint32_t frameIndex);
+	void beginBatch(VkCommandBuffer commandBuffer, VulkanGraphQueue queue);
+	void endBatch(VkCommandBuffer commandBuffer, VulkanGraphQueue queue);
+
+	VulkanQueueStats getStats();
+private:
+	struct FrameQueries {
+		VkQueryPool queryPool = VK_NULL_HANDLE;
+		std::vector<VulkanGraphQueue> queues;
+		uint32_t queryCount = 0;
+	};
+
+	VkDevice _logicalDevice;
+	uint32_t _maxBatches;
+	uint32_t _frameIndex = 0;
+	float _timestampPeriod = 0.0f;
+	uint64_t _validMasks[static_cast<uint32_t>(VulkanGraphQueue::COUNT)] = {};
+	FrameQueries _frames[MAX_FRAME_DRAWS];
+	uint32_t _frameCount;
+
+	std::vector<uint64_t> _results;
+	std::vector<std::pair<uint64_t, uint64_t>> _intervals;
+	VulkanQueueStats _stats;
+
+	void _readFrame(FrameQueries& frame);
+};
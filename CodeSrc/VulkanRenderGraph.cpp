@@ -0,0 +1,982 @@
+#include "VulkanRenderGraph.h"
+#include <sstream>
+
+struct GraphAccessInfo {
+	const char* name;
+	VkPipelineStageFlags2 stages;
+	VkAccessFlags2 access;
+	VkImageLayout layout;
+	VkImageUsageFlags usage;
+	bool write;
+	bool computeQueue;
+};
+
+static const GraphAccessInfo GRAPH_ACCESS_INFO[] = {
+	{ "COLOR_ATTACHMENT", VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+		VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT,
+		VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, true, false },
+	{ "DEPTH_ATTACHMENT", VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+		VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, true, false },
+	{ "DEPTH_READ", VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
+		VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+		VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, false, false },
+	{ "SAMPLED_GRAPHICS", VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT,
+		VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, false, false },
+	{ "SAMPLED_COMPUTE", VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+		VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+		VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, false, true },
+	{ "STORAGE_READ", VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+		VK_ACCESS_2_SHADER_STORAGE_READ_BIT,
+		VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, false, true },
+	{ "STORAGE_WRITE", VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT,
+		VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT,
+		VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, true, true },
+	{ "TRANSFER_SRC", VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+		VK_ACCESS_2_TRANSFER_READ_BIT,
+		VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT, false, true },
+	{ "TRANSFER_DST", VK_PIPELINE_STAGE_2_TRANSFER_BIT,
+		VK_ACCESS_2_TRANSFER_WRITE_BIT,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT, true, true },
+	{ "INDIRECT_READ", VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT,
+		VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT,
+		VK_IMAGE_LAYOUT_UNDEFINED, 0, false, true },
+};
+
+static const GraphAccessInfo& getAccessInfo(VulkanGraphAccess access) {
+	return GRAPH_ACCESS_INFO[static_cast<uint32_t>(access)];
+}
+
+VulkanRenderGraph::VulkanRenderGraph(VulkanMemoryAllocator* allocator, VulkanDeletionQueue* deletionQueue) :
+	_allocator{ allocator }, _deletionQueue{ deletionQueue } {
+	if (this->_allocator != nullptr) {
+		this->_logicalDevice = this->_allocator->getLogicalDevice();
+	}
+}
+
+VulkanRenderGraph::~VulkanRenderGraph() {
+	this->_destroyPhysicalImages();
+}
+
+VulkanRenderGraph::Resource VulkanRenderGraph::createImage(const std::string& name, const VulkanGraphImageDesc& desc) {
+	ResourceNode node;
+	node.name = name;
+	node.desc = desc;
+
+	this->_resources.push_back(node);
+	this->_compiled = false;
+
+	return static_cast<Resource>(this->_resources.size() - 1);
+}
+
+VulkanRenderGraph::Resource VulkanRenderGraph::importImage(
+	const std::string& name, const VulkanGraphImageDesc& desc, VkImage image, VkImageView imageView,
+	VkImageLayout initialLayout, VkImageLayout finalLayout) {
+	ResourceNode node;
+	node.name = name;
+	node.imported = true;
+	node.desc = desc;
+	node.image = image;
+	node.imageView = imageView;
+	node.initialLayout = initialLayout;
+	node.finalLayout = finalLayout;
+
+	this->_resources.push_back(node);
+	this->_compiled = false;
+
+	return static_cast<Resource>(this->_resources.size() - 1);
+}
+
+VulkanRenderGraph::Resource VulkanRenderGraph::importBuffer(const std::string& name, VkBuffer buffer) {
+	ResourceNode node;
+	node.name = name;
+	node.isBuffer = true;
+	node.imported = true;
+	node.buffer = buffer;
+
+	this->_resources.push_back(node);
+	this->_compiled = false;
+
+	return static_cast<Resource>(this->_resources.size() - 1);
+}
+
+void VulkanRenderGraph::updateImport(Resource resource, VkImage image, VkImageView imageView) {
+	this->_resources[resource].image = image;
+	this->_resources[resource].imageView = imageView;
+}
+
+void VulkanRenderGraph::updateImport(Resource resource, VkBuffer buffer) {
+	this->_resources[resource].buffer = buffer;
+}
+
+void VulkanRenderGraph::updateImportDesc(Resource resource, const VulkanGraphImageDesc& desc) {
+	// Imports own no graph memory, so a new size needs no recompile; transients are resized by recompiling.
+	if (!this->_resources[resource].imported) {
+		ThrowErr::runtime("Only imported images can change their description without a recompile!..");
+	}
+
+	this->_resources[resource].desc = desc;
+}
+
+void VulkanRenderGraph::setQueueFamilies(uint32_t graphicsFamily, uint32_t computeFamily) {
+	// Without a dedicated compute family there is nothing to overlap with, so async passes run in line.
+	this->_queueFamilies[static_cast<uint32_t>(VulkanGraphQueue::GRAPHICS)] = graphicsFamily;
+	this->_queueFamilies[static_cast<uint32_t>(VulkanGraphQueue::ASYNC_COMPUTE)] = computeFamily;
+	this->_asyncEnabled = graphicsFamily != computeFamily;
+	this->_compiled = false;
+}
+
+VulkanRenderGraph::Pass VulkanRenderGraph::addPass(const std::string& name, ExecuteCallback callback, bool sideEffects) {
+	PassNode node;
+	node.name = name;
+	node.callback = callback;
+	node.sideEffects = sideEffects;
+
+	this->_passes.push_back(node);
+	this->_compiled = false;
+
+	return static_cast<Pass>(this->_passes.size() - 1);
+}
+
+void VulkanRenderGraph::setAsyncCompute(Pass pass, bool asyncCompute) {
+	if (pass >= this->_passes.size()) {
+		ThrowErr::runtime("Render graph async compute flag refers to an unknown pass!..");
+	}
+
+	this->_passes[pass].asyncCompute = asyncCompute;
+	this->_compiled = false;
+}
+
+void VulkanRenderGraph::read(Pass pass, Resource resource, VulkanGraphAccess access) {
+	this->_addAccess(pass, resource, access, false);
+}
+
+void VulkanRenderGraph::write(Pass pass, Resource resource, VulkanGraphAccess access) {
+	this->_addAccess(pass, resource, access, true);
+}
+
+void VulkanRenderGraph::compile() {
+	this->_destroyPhysicalImages();
+	this->_stats = VulkanGraphStats();
+
+	this->_cullPasses();
+	this->_computeLifetimes();
+	this->_aliasMemory();
+	this->_computeBarriers();
+	this->_buildBatches();
+
+	this->_compiled = true;
+}
+
+void VulkanRenderGraph::execute(VkCommandBuffer commandBuffer) {
+	if (!this->_compiled) {
+		ThrowErr::runtime("Render graph executed before it was compiled!..");
+	}
+
+	if (this->_batches.size() > 1) {
+		ThrowErr::runtime("Render graph spans several queue batches and must be executed per batch!..");
+	}
+
+	for (uint32_t batch = 0; batch < this->_batches.size(); batch++) {
+		this->executeBatch(batch, commandBuffer);
+	}
+}
+
+void VulkanRenderGraph::clear() {
+	this->_destroyPhysicalImages();
+
+	this->_resources.clear();
+	this->_passes.clear();
+	this->_order.clear();
+	this->_finalBarriers.clear();
+	this->_initialReleases.clear();
+	this->_batches.clear();
+	this->_stats = VulkanGraphStats();
+	this->_compiled = false;
+}
+
+uint32_t VulkanRenderGraph::getBatchCount() {
+	return static_cast<uint32_t>(this->_batches.size());
+}
+
+VulkanGraphQueue VulkanRenderGraph::getBatchQueue(uint32_t batch) {
+	return this->_batches[batch].queue;
+}
+
+uint32_t VulkanRenderGraph::getBatchWait(uint32_t batch) {
+	return this->_batches[batch].wait;
+}
+
+void VulkanRenderGraph::executeBatch(uint32_t batch, VkCommandBuffer commandBuffer) {
+	if (!this->_compiled) {
+		ThrowErr::runtime("Render graph executed before it was compiled!..");
+	}
+
+	const Batch& node = this->_batches[batch];
+	this->_emitBarriers(commandBuffer, node.prologue);
+
+	for (uint32_t passIndex : node.passes) {
+		PassNode& pass = this->_passes[passIndex];
+
+		this->_emitBarriers(commandBuffer, pass.barriers);
+		if (pass.callback) {
+			pass.callback(commandBuffer, *this);
+		}
+		this->_emitBarriers(commandBuffer, pass.releases);
+	}
+
+	if (node.finalBarriers) {
+		this->_emitBarriers(commandBuffer, this->_finalBarriers);
+	}
+}
+
+VkImage VulkanRenderGraph::getImage(Resource resource) {
+	return this->_resources[resource].image;
+}
+
+VkImageView VulkanRenderGraph::getImageView(Resource resource) {
+	return this->_resources[resource].imageView;
+}
+
+VkBuffer VulkanRenderGraph::getBuffer(Resource resource) {
+	return this->_resources[resource].buffer;
+}
+
+const VulkanGraphImageDesc& VulkanRenderGraph::getImageDesc(Resource resource) {
+	return this->_resources[resource].desc;
+}
+
+bool VulkanRenderGraph::isCulled(Pass pass) {
+	return this->_passes[pass].culled;
+}
+
+uint32_t VulkanRenderGraph::getMemoryBucket(Resource resource) {
+	return this->_resources[resource].bucket;
+}
+
+VulkanGraphStats VulkanRenderGraph::getStats() {
+	return this->_stats;
+}
+
+std::string VulkanRenderGraph::toDot() {
+	std::ostringstream dot;
+	dot << "digraph RenderGraph {\n";
+	dot << "\trankdir=LR;\n";
+	dot << "\tlabel=\"" << this->_stats.passCount << " passes, " << this->_stats.culledPasses << " culled, "
+		<< this->_stats.barrierCount << " barriers, " << this->_stats.elidedBarriers << " elided, "
+		<< this->_stats.transientImages << " transient images in " << this->_stats.memoryBuckets << " buckets, "
+		<< this->_stats.batchCount << " queue batches\";\n";
+
+	for (size_t i = 0; i < this->_passes.size(); i++) {
+		const PassNode& pass = this->_passes[i];
+		dot << "\tp" << i << " [shape=box, label=\"" << pass.name << "\\n" << pass.barriers.size() << " barriers\"";
+		if (pass.culled) {
+			dot << ", style=dashed, color=gray";
+		}
+		else if (pass.queue == VulkanGraphQueue::ASYNC_COMPUTE) {
+			dot << ", color=blue";
+		}
+		dot << "];\n";
+	}
+
+	for (size_t i = 0; i < this->_resources.size(); i++) {
+		const ResourceNode& resource = this->_resources[i];
+		dot << "\tr" << i << " [shape=ellipse, label=\"" << resource.name;
+		if (resource.bucket != INVALID) {
+			dot << "\\nbucket " << resource.bucket;
+		}
+		dot << "\"" << (resource.imported ? ", style=bold" : "") << "];\n";
+	}
+
+	for (size_t i = 0; i < this->_passes.size(); i++) {
+		for (const AccessNode& access : this->_passes[i].accesses) {
+			if (access.write) {
+				dot << "\tp" << i << " -> r" << access.resource;
+			}
+			else {
+				dot << "\tr" << access.resource << " -> p" << i;
+			}
+			dot << " [label=\"" << getAccessInfo(access.access).name << "\"];\n";
+		}
+	}
+
+	dot << "}\n";
+
+	return dot.str();
+}
+
+void VulkanRenderGraph::_addAccess(Pass pass, Resource resource, VulkanGraphAccess access, bool write) {
+	if (pass >= this->_passes.size() || resource >= this->_resources.size()) {
+		ThrowErr::runtime("Render graph access refers to an unknown pass or resource!..");
+	}
+
+	const GraphAccessInfo& info = getAccessInfo(access);
+	if (info.write != write) {
+		ThrowErr::runtime("Render graph access kind does not match read/write!..");
+	}
+
+	AccessNode node;
+	node.resource = resource;
+	node.access = access;
+	node.write = write;
+
+	this->_passes[pass].accesses.push_back(node);
+	this->_compiled = false;
+}
+
+void VulkanRenderGraph::_cullPasses() {
+	// Imported resources are visible outside the graph; anything else only matters if a live pass reads it.
+	std::vector<uint8_t> needed(this->_resources.size(), 0);
+	for (size_t i = 0; i < this->_resources.size(); i++) {
+		needed[i] = this->_resources[i].imported ? 1 : 0;
+	}
+
+	for (size_t i = this->_passes.size(); i-- > 0;) {
+		PassNode& pass = this->_passes[i];
+
+		bool alive = pass.sideEffects;
+		for (const AccessNode& access : pass.accesses) {
+			alive = alive || (access.write && needed[access.resource]);
+		}
+
+		pass.culled = !alive;
+		if (!alive) {
+			continue;
+		}
+
+		for (const AccessNode& access : pass.accesses) {
+			if (!access.write) {
+				needed[access.resource] = 1;
+			}
+		}
+	}
+
+	this->_order.clear();
+	for (size_t i = 0; i < this->_passes.size(); i++) {
+		PassNode& pass = this->_passes[i];
+		pass.queue = pass.asyncCompute && this->_asyncEnabled ? VulkanGraphQueue::ASYNC_COMPUTE : VulkanGraphQueue::GRAPHICS;
+
+		if (!pass.culled) {
+			this->_order.push_back(static_cast<uint32_t>(i));
+			this->_stats.asyncPasses += pass.queue == VulkanGraphQueue::ASYNC_COMPUTE ? 1 : 0;
+		}
+	}
+
+	this->_stats.passCount = static_cast<uint32_t>(this->_passes.size());
+	this->_stats.culledPasses = static_cast<uint32_t>(this->_passes.size() - this->_order.size());
+}
+
+void VulkanRenderGraph::_computeLifetimes() {
+	for (ResourceNode& resource : this->_resources) {
+		resource.firstPass = INVALID;
+		resource.lastPass = INVALID;
+		resource.bucket = INVALID;
+		resource.asyncAccess = false;
+		resource.usage = resource.desc.usage;
+	}
+
+	std::vector<uint8_t> written(this->_resources.size(), 0);
+
+	for (uint32_t position = 0; position < this->_order.size(); position++) {
+		const PassNode& pass = this->_passes[this->_order[position]];
+
+		for (const AccessNode& access : pass.accesses) {
+			ResourceNode& resource = this->_resources[access.resource];
+
+			if (pass.queue == VulkanGraphQueue::ASYNC_COMPUTE && !getAccessInfo(access.access).computeQueue) {
+				ThrowErr::runtime("Async compute pass '" + pass.name + "' uses a graphics-only access!..");
+			}
+
+			if (!access.write && !resource.imported && !written[access.resource]) {
+				ThrowErr::runtime("Render graph reads transient resource '" + resource.name + "' before it is written!..");
+			}
+
+			written[access.resource] = written[access.resource] || access.write;
+			resource.usage |= getAccessInfo(access.access).usage;
+			resource.asyncAccess = resource.asyncAccess || pass.queue == VulkanGraphQueue::ASYNC_COMPUTE;
+
+			if (resource.firstPass == INVALID) {
+				resource.firstPass = position;
+			}
+			resource.lastPass = position;
+		}
+	}
+}
+
+void VulkanRenderGraph::_aliasMemory() {
+	this->_buckets.clear();
+
+	std::vector<Resource> transients;
+	for (size_t i = 0; i < this->_resources.size(); i++) {
+		ResourceNode& resource = this->_resources[i];
+		if (resource.imported || resource.isBuffer || resource.firstPass == INVALID) {
+			continue;
+		}
+
+		if (this->_allocator != nullptr) {
+			VkImageCreateInfo imageCreateInfo = {};
+			imageCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+			imageCreateInfo.imageType = VK_IMAGE_TYPE_2D;
+			imageCreateInfo.format = resource.desc.format;
+			imageCreateInfo.extent = { resource.desc.extent.width, resource.desc.extent.height, 1 };
+			imageCreateInfo.mipLevels = 1;
+			imageCreateInfo.arrayLayers = 1;
+			imageCreateInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+			imageCreateInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+			imageCreateInfo.usage = resource.usage;
+			imageCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+			imageCreateInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+			VkResult result = vkCreateImage(this->_logicalDevice, &imageCreateInfo, nullptr, &resource.image);
+			if (result != VK_SUCCESS) {
+				ThrowErr::runtime("Failed to create a render graph image!..");
+			}
+
+			vkGetImageMemoryRequirements(this->_logicalDevice, resource.image, &resource.requirements);
+		}
+		else {
+			// CPU-only compile: estimate four bytes per texel so aliasing decisions can still be inspected.
+			resource.requirements.size = static_cast<VkDeviceSize>(resource.desc.extent.width) * resource.desc.extent.height * 4;
+			resource.requirements.alignment = 1;
+			resource.requirements.memoryTypeBits = UINT32_MAX;
+		}
+
+		transients.push_back(static_cast<Resource>(i));
+		this->_stats.transientBytes += resource.requirements.size;
+	}
+
+	// Largest first, so each bucket is sized by its first occupant and later ones only fill gaps in time.
+	std::stable_sort(transients.begin(), transients.end(), [this](Resource a, Resource b) {
+		return this->_resources[a].requirements.size > this->_resources[b].requirements.size;
+	});
+
+	for (Resource index : transients) {
+		ResourceNode& resource = this->_resources[index];
+
+		for (uint32_t b = 0; b < this->_buckets.size() && resource.bucket == INVALID; b++) {
+			MemoryBucket& bucket = this->_buckets[b];
+			if ((bucket.requirements.memoryTypeBits & resource.requirements.memoryTypeBits) == 0) {
+				continue;
+			}
+
+			// Memory shared across queues would need a semaphore between every pair of occupants, so
+			// images touched by async compute keep a bucket to themselves.
+			bool overlaps = resource.asyncAccess;
+			for (Resource occupant : bucket.occupants) {
+				const ResourceNode& other = this->_resources[occupant];
+				overlaps = overlaps || other.asyncAccess || (resource.firstPass <= other.lastPass && other.firstPass <= resource.lastPass);
+			}
+
+			if (!overlaps) {
+				bucket.requirements.memoryTypeBits &= resource.requirements.memoryTypeBits;
+				bucket.requirements.alignment = std::max(bucket.requirements.alignment, resource.requirements.alignment);
+				bucket.occupants.push_back(index);
+				resource.bucket = b;
+			}
+		}
+
+		if (resource.bucket == INVALID) {
+			MemoryBucket bucket;
+			bucket.requirements = resource.requirements;
+			bucket.occupants.push_back(index);
+			resource.bucket = static_cast<uint32_t>(this->_buckets.size());
+			this->_buckets.push_back(bucket);
+		}
+	}
+
+	for (MemoryBucket& bucket : this->_buckets) {
+		std::sort(bucket.occupants.begin(), bucket.occupants.end(), [this](Resource a, Resource b) {
+			return this->_resources[a].firstPass < this->_resources[b].firstPass;
+		});
+
+		this->_stats.allocatedBytes += bucket.requirements.size;
+	}
+
+	this->_stats.transientImages = static_cast<uint32_t>(transients.size());
+	this->_stats.memoryBuckets = static_cast<uint32_t>(this->_buckets.size());
+
+	if (this->_allocator != nullptr) {
+		this->_createPhysicalImages();
+	}
+}
+
+void VulkanRenderGraph::_computeBarriers() {
+	struct ResourceState {
+		VkPipelineStageFlags2 writeStages = VK_PIPELINE_STAGE_2_NONE;
+		VkAccessFlags2 writeAccess = VK_ACCESS_2_NONE;
+		VkPipelineStageFlags2 readStages = VK_PIPELINE_STAGE_2_NONE;
+		VkPipelineStageFlags2 visibleStages = VK_PIPELINE_STAGE_2_NONE;
+		VkAccessFlags2 visibleAccess = VK_ACCESS_2_NONE;
+		VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VulkanGraphQueue queue = VulkanGraphQueue::GRAPHICS;
+		uint32_t lastPass = INVALID;
+		bool touched = false;
+	};
+
+	struct PassUse {
+		Resource resource;
+		VkPipelineStageFlags2 stages;
+		VkAccessFlags2 access;
+		VkImageLayout layout;
+		bool write;
+	};
+
+	struct FirstUse {
+		uint32_t passIndex;
+		size_t barrierIndex;
+	};
+
+	std::vector<ResourceState> states(this->_resources.size());
+	std::vector<FirstUse> aliasFixups;
+	std::vector<Resource> aliasFixupResources;
+	std::vector<PassUse> uses;
+
+	for (size_t i = 0; i < this->_resources.size(); i++) {
+		states[i].layout = this->_resources[i].initialLayout;
+	}
+
+	for (uint32_t passIndex : this->_order) {
+		this->_passes[passIndex].releases.clear();
+		this->_passes[passIndex].dependencies.clear();
+	}
+	this->_initialReleases.clear();
+
+	const uint32_t graphicsFamily = this->_getFamily(VulkanGraphQueue::GRAPHICS);
+
+	// A pass touching one resource several times needs a single barrier covering all of it.
+	auto collectUses = [this, &uses](const PassNode& pass) {
+		uses.clear();
+		for (const AccessNode& access : pass.accesses) {
+			const GraphAccessInfo& info = getAccessInfo(access.access);
+
+			PassUse* use = nullptr;
+			for (PassUse& existing : uses) {
+				use = existing.resource == access.resource ? &existing : use;
+			}
+
+			if (use == nullptr) {
+				PassUse newUse = { access.resource, info.stages, info.access, info.layout, access.write };
+				uses.push_back(newUse);
+				continue;
+			}
+
+			if (!this->_resources[access.resource].isBuffer && use->layout != info.layout) {
+				ThrowErr::runtime("Render graph pass '" + pass.name + "' uses an image in two layouts!..");
+			}
+
+			use->stages |= info.stages;
+			use->access |= info.access;
+			use->write = use->write || access.write;
+		}
+	};
+
+	// Imported buffers outlive the frame, and the same graph runs every frame, so a buffer's first use
+	// follows its last use in the previous frame on the graphics queue. Their states start from where
+	// this frame will leave them; after a transfer back to graphics only the acquire is known.
+	for (uint32_t passIndex : this->_order) {
+		collectUses(this->_passes[passIndex]);
+
+		for (const PassUse& use : uses) {
+			if (!this->_resources[use.resource].imported || !this->_resources[use.resource].isBuffer) {
+				continue;
+			}
+
+			ResourceState& state = states[use.resource];
+			state.writeStages = use.write ? use.stages : state.writeStages;
+			state.writeAccess = use.write ? use.access : state.writeAccess;
+			state.readStages = use.write ? VK_PIPELINE_STAGE_2_NONE : state.readStages | use.stages;
+			state.queue = this->_passes[passIndex].queue;
+		}
+	}
+
+	for (ResourceState& state : states) {
+		if (state.queue != VulkanGraphQueue::GRAPHICS) {
+			state.writeStages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+			state.writeAccess = VK_ACCESS_2_MEMORY_WRITE_BIT;
+			state.readStages = VK_PIPELINE_STAGE_2_NONE;
+			state.queue = VulkanGraphQueue::GRAPHICS;
+		}
+	}
+
+	for (uint32_t passIndex : this->_order) {
+		PassNode& pass = this->_passes[passIndex];
+		pass.barriers.clear();
+
+		collectUses(pass);
+
+		for (const PassUse& use : uses) {
+			const ResourceNode& resource = this->_resources[use.resource];
+			ResourceState& state = states[use.resource];
+
+			VkImageLayout newLayout = resource.isBuffer ? VK_IMAGE_LAYOUT_UNDEFINED : use.layout;
+			bool layoutChange = !resource.isBuffer && state.layout != newLayout;
+
+			Barrier barrier = {
+				use.resource, VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, use.stages, use.access, state.layout, newLayout,
+				VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED };
+			bool needBarrier = false;
+			bool transfer = false;
+
+			// Imports start the frame owned by graphics; their content only moves if it is defined.
+			bool importTransfer = !state.touched && resource.imported && pass.queue != VulkanGraphQueue::GRAPHICS &&
+				(resource.isBuffer || state.layout != VK_IMAGE_LAYOUT_UNDEFINED);
+
+			if ((state.touched && state.queue != pass.queue) || importTransfer) {
+				// Another queue used it last. A semaphore between the two batches orders the work; the
+				// release/acquire pair moves ownership and performs the layout change, so both halves
+				// carry the same layouts. The acquire chains onto the semaphore wait like a first use.
+				Barrier release = barrier;
+				release.srcStages = importTransfer ? VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT : state.writeStages | state.readStages;
+				release.srcAccess = importTransfer ? VK_ACCESS_2_MEMORY_WRITE_BIT : state.writeAccess;
+				release.dstStages = VK_PIPELINE_STAGE_2_NONE;
+				release.dstAccess = VK_ACCESS_2_NONE;
+				release.srcFamily = importTransfer ? graphicsFamily : this->_getFamily(state.queue);
+				release.dstFamily = this->_getFamily(pass.queue);
+
+				if (importTransfer) {
+					this->_initialReleases.push_back(release);
+				}
+				else {
+					this->_passes[state.lastPass].releases.push_back(release);
+				}
+
+				// INVALID stands for the graphics prologue that holds the import releases.
+				uint32_t dependency = importTransfer ? INVALID : state.lastPass;
+				pass.dependencies.push_back(dependency);
+
+				barrier.srcStages = use.stages;
+				barrier.srcFamily = release.srcFamily;
+				barrier.dstFamily = release.dstFamily;
+				needBarrier = true;
+				transfer = true;
+
+				this->_stats.barrierCount++;
+				this->_stats.queueTransfers++;
+			}
+			else if (!state.touched && resource.imported && resource.isBuffer) {
+				// Last frame's access, as set up above. Buffers written only outside the graph start
+				// with no stages and are synchronized by whoever wrote them.
+				barrier.srcStages = use.write ? state.writeStages | state.readStages : state.writeStages;
+				barrier.srcAccess = state.writeAccess;
+				needBarrier = barrier.srcStages != VK_PIPELINE_STAGE_2_NONE;
+			}
+			else if (!state.touched) {
+				// Imported images are synchronized from outside; only their layout may need fixing. The src
+				// stage matches the dst stage so the barrier chains onto a semaphore wait at that stage.
+				// Transients get their src filled in from whichever image last used the same memory.
+				needBarrier = layoutChange || !resource.imported;
+				barrier.srcStages = use.stages;
+				barrier.oldLayout = resource.imported ? state.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+
+				if (needBarrier && !resource.imported) {
+					FirstUse fixup = { passIndex, pass.barriers.size() };
+					aliasFixups.push_back(fixup);
+					aliasFixupResources.push_back(use.resource);
+				}
+			}
+			else if (use.write || layoutChange) {
+				// WAW, WAR or a layout transition: wait for the last write and every read since.
+				barrier.srcStages = state.writeStages | state.readStages;
+				barrier.srcAccess = state.writeAccess;
+				needBarrier = barrier.srcStages != VK_PIPELINE_STAGE_2_NONE || layoutChange;
+			}
+			else if (state.writeStages != VK_PIPELINE_STAGE_2_NONE &&
+				((use.stages & ~state.visibleStages) != 0 || (use.access & ~state.visibleAccess) != 0)) {
+				// RAW where the last write is not yet visible to this stage; read-after-read needs nothing.
+				barrier.srcStages = state.writeStages;
+				barrier.srcAccess = state.writeAccess;
+				needBarrier = true;
+			}
+
+			if (needBarrier) {
+				pass.barriers.push_back(barrier);
+				this->_stats.barrierCount++;
+			}
+			else {
+				this->_stats.elidedBarriers++;
+			}
+
+			if (use.write) {
+				state.writeStages = use.stages;
+				state.writeAccess = use.access;
+				state.readStages = VK_PIPELINE_STAGE_2_NONE;
+				state.visibleStages = VK_PIPELINE_STAGE_2_NONE;
+				state.visibleAccess = VK_ACCESS_2_NONE;
+			}
+			else if (needBarrier && (layoutChange || !state.touched || transfer)) {
+				// The layout transition or acquire acts as a write that only this pass's stages have seen so far.
+				state.writeStages = use.stages;
+				state.writeAccess = VK_ACCESS_2_NONE;
+				state.readStages = use.stages;
+				state.visibleStages = use.stages;
+				state.visibleAccess = use.access;
+			}
+			else {
+				state.readStages |= use.stages;
+				if (needBarrier) {
+					state.visibleStages |= use.stages;
+					state.visibleAccess |= use.access;
+				}
+			}
+
+			state.layout = newLayout;
+			state.queue = pass.queue;
+			state.lastPass = passIndex;
+			state.touched = true;
+		}
+	}
+
+	// The memory's previous occupant is the latest one to finish before this image starts; the first
+	// occupant of a bucket follows the last one of the previous frame on the same queue.
+	for (size_t i = 0; i < aliasFixups.size(); i++) {
+		const ResourceNode& resource = this->_resources[aliasFixupResources[i]];
+		const MemoryBucket& bucket = this->_buckets[resource.bucket];
+
+		Resource previous = INVALID;
+		Resource lastOccupant = bucket.occupants.front();
+		for (Resource occupant : bucket.occupants) {
+			uint32_t lastPass = this->_resources[occupant].lastPass;
+
+			if (lastPass < resource.firstPass && (previous == INVALID || lastPass > this->_resources[previous].lastPass)) {
+				previous = occupant;
+			}
+			if (lastPass > this->_resources[lastOccupant].lastPass) {
+				lastOccupant = occupant;
+			}
+		}
+		previous = previous != INVALID ? previous : lastOccupant;
+
+		Barrier& barrier = this->_passes[aliasFixups[i].passIndex].barriers[aliasFixups[i].barrierIndex];
+		barrier.srcStages = states[previous].writeStages | states[previous].readStages;
+		barrier.srcAccess = states[previous].writeAccess;
+		barrier.srcStages = barrier.srcStages != VK_PIPELINE_STAGE_2_NONE ? barrier.srcStages : barrier.dstStages;
+
+		// Stages of the other queue mean nothing here; the frame's semaphores already order the two.
+		if (states[previous].queue != this->_passes[aliasFixups[i].passIndex].queue) {
+			barrier.srcStages = barrier.dstStages;
+			barrier.srcAccess = VK_ACCESS_2_NONE;
+		}
+	}
+
+	// Imports end the frame back on graphics, in their final layout if they have one.
+	this->_finalBarriers.clear();
+	for (size_t i = 0; i < this->_resources.size(); i++) {
+		const ResourceNode& resource = this->_resources[i];
+		const ResourceState& state = states[i];
+
+		if (!resource.imported || !state.touched) {
+			continue;
+		}
+
+		bool transfer = state.queue != VulkanGraphQueue::GRAPHICS;
+		VkImageLayout finalLayout = resource.isBuffer || resource.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED ?
+			state.layout : resource.finalLayout;
+		if (!transfer && finalLayout == state.layout) {
+			continue;
+		}
+
+		Barrier barrier = {
+			static_cast<Resource>(i), state.writeStages | state.readStages, state.writeAccess,
+			VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE, state.layout, finalLayout,
+			VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED };
+
+		if (transfer) {
+			barrier.srcFamily = this->_getFamily(state.queue);
+			barrier.dstFamily = graphicsFamily;
+			this->_passes[state.lastPass].releases.push_back(barrier);
+
+			// The acquire waits for the release and is what next frame's first use chains onto.
+			barrier.srcStages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+			barrier.srcAccess = VK_ACCESS_2_NONE;
+			barrier.dstStages = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+			this->_stats.barrierCount++;
+			this->_stats.queueTransfers++;
+		}
+
+		this->_finalBarriers.push_back(barrier);
+		this->_stats.barrierCount++;
+	}
+}
+
+void VulkanRenderGraph::_buildBatches() {
+	this->_batches.clear();
+
+	if (!this->_initialReleases.empty()) {
+		Batch prologue;
+		prologue.queue = VulkanGraphQueue::GRAPHICS;
+		prologue.prologue = this->_initialReleases;
+		this->_batches.push_back(prologue);
+	}
+
+	for (uint32_t passIndex : this->_order) {
+		PassNode& pass = this->_passes[passIndex];
+
+		if (this->_batches.empty() || this->_batches.back().queue != pass.queue || this->_batches.back().passes.empty()) {
+			Batch batch;
+			batch.queue = pass.queue;
+			this->_batches.push_back(batch);
+		}
+
+		Batch& batch = this->_batches.back();
+		pass.batch = static_cast<uint32_t>(this->_batches.size() - 1);
+		batch.passes.push_back(passIndex);
+
+		// Batches on one queue run in order, so waiting for the latest producer covers the earlier ones.
+		for (uint32_t dependency : pass.dependencies) {
+			uint32_t wait = dependency == INVALID ? 0 : this->_passes[dependency].batch;
+			batch.wait = batch.wait == INVALID ? wait : std::max(batch.wait, wait);
+		}
+	}
+
+	// The frame ends on graphics, after all compute work, so presenting and retiring the frame cover both.
+	if (!this->_batches.empty() && this->_batches.back().queue != VulkanGraphQueue::GRAPHICS) {
+		Batch epilogue;
+		epilogue.queue = VulkanGraphQueue::GRAPHICS;
+		this->_batches.push_back(epilogue);
+	}
+
+	for (uint32_t i = static_cast<uint32_t>(this->_batches.size()); i-- > 0;) {
+		if (this->_batches[i].queue != VulkanGraphQueue::GRAPHICS) {
+			Batch& last = this->_batches.back();
+			last.wait = last.wait == INVALID ? i : std::max(last.wait, i);
+			break;
+		}
+	}
+
+	if (!this->_batches.empty()) {
+		this->_batches.back().finalBarriers = true;
+	}
+
+	this->_stats.batchCount = static_cast<uint32_t>(this->_batches.size());
+}
+
+uint32_t VulkanRenderGraph::_getFamily(VulkanGraphQueue queue) {
+	return this->_queueFamilies[static_cast<uint32_t>(queue)];
+}
+
+void VulkanRenderGraph::_createPhysicalImages() {
+	for (MemoryBucket& bucket : this->_buckets) {
+		bucket.allocation = this->_allocator->allocate(bucket.requirements, VulkanMemoryUsage::GPU_ONLY, QTlsfResourceKind::OPTIMAL);
+
+		for (Resource occupant : bucket.occupants) {
+			ResourceNode& resource = this->_resources[occupant];
+
+			VkResult result = vkBindImageMemory(this->_logicalDevice, resource.image, bucket.allocation->memory, bucket.allocation->offset);
+			if (result != VK_SUCCESS) {
+				ThrowErr::runtime("Failed to bind render graph image memory!..");
+			}
+
+			VkImageViewCreateInfo viewCreateInfo = {};
+			viewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+			viewCreateInfo.image = resource.image;
+			viewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+			viewCreateInfo.format = resource.desc.format;
+			viewCreateInfo.subresourceRange.aspectMask = resource.desc.aspect;
+			viewCreateInfo.subresourceRange.levelCount = 1;
+			viewCreateInfo.subresourceRange.layerCount = 1;
+
+			result = vkCreateImageView(this->_logicalDevice, &viewCreateInfo, nullptr, &resource.imageView);
+			if (result != VK_SUCCESS) {
+				ThrowErr::runtime("Failed to create a render graph image view!..");
+			}
+		}
+	}
+}
+
+void VulkanRenderGraph::_destroyPhysicalImages() {
+	for (ResourceNode& resource : this->_resources) {
+		if (resource.imported || this->_allocator == nullptr) {
+			continue;
+		}
+
+		if (this->_deletionQueue != nullptr) {
+			if (resource.imageView != VK_NULL_HANDLE) {
+				this->_deletionQueue->destroyImageView(resource.imageView);
+			}
+			if (resource.image != VK_NULL_HANDLE) {
+				this->_deletionQueue->destroyImage(resource.image, nullptr);
+			}
+		}
+		else {
+			if (resource.imageView != VK_NULL_HANDLE) {
+				vkDestroyImageView(this->_logicalDevice, resource.imageView, nullptr);
+			}
+			if (resource.image != VK_NULL_HANDLE) {
+				vkDestroyImage(this->_logicalDevice, resource.image, nullptr);
+			}
+		}
+
+		resource.imageView = VK_NULL_HANDLE;
+		resource.image = VK_NULL_HANDLE;
+	}
+
+	for (MemoryBucket& bucket : this->_buckets) {
+		if (this->_allocator == nullptr) {
+			continue;
+		}
+
+		if (this->_deletionQueue != nullptr) {
+			this->_deletionQueue->freeMemory(bucket.allocation);
+		}
+		else {
+			this->_allocator->free(bucket.allocation);
+		}
+	}
+
+	this->_buckets.clear();
+}
+
+void VulkanRenderGraph::_emitBarriers(VkCommandBuffer commandBuffer, const std::vector<Barrier>& barriers) {
+	if (barriers.empty()) {
+		return;
+	}
+
+	this->_imageBarriers.clear();
+	this->_bufferBarriers.clear();
+
+	for (const Barrier& barrier : barriers) {
+		const ResourceNode& resource = this->_resources[barrier.resource];
+
+		if (resource.isBuffer) {
+			VkBufferMemoryBarrier2 bufferBarrier = {};
+			bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+			bufferBarrier.srcStageMask = barrier.srcStages;
+			bufferBarrier.srcAccessMask = barrier.srcAccess;
+			bufferBarrier.dstStageMask = barrier.dstStages;
+			bufferBarrier.dstAccessMask = barrier.dstAccess;
+			bufferBarrier.srcQueueFamilyIndex = barrier.srcFamily;
+			bufferBarrier.dstQueueFamilyIndex = barrier.dstFamily;
+			bufferBarrier.buffer = resource.buffer;
+			bufferBarrier.offset = 0;
+			bufferBarrier.size = VK_WHOLE_SIZE;
+			this->_bufferBarriers.push_back(bufferBarrier);
+			continue;
+		}
+
+		VkImageMemoryBarrier2 imageBarrier = {};
+		imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+		imageBarrier.srcStageMask = barrier.srcStages;
+		imageBarrier.srcAccessMask = barrier.srcAccess;
+		imageBarrier.dstStageMask = barrier.dstStages;
+		imageBarrier.dstAccessMask = barrier.dstAccess;
+		imageBarrier.oldLayout = barrier.oldLayout;
+		imageBarrier.newLayout = barrier.newLayout;
+		imageBarrier.srcQueueFamilyIndex = barrier.srcFamily;
+		imageBarrier.dstQueueFamilyIndex = barrier.dstFamily;
+		imageBarrier.image = resource.image;
+		imageBarrier.subresourceRange.aspectMask = resource.desc.aspect;
+		imageBarrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+		imageBarrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+		this->_imageBarriers.push_back(imageBarrier);
+	}
+
+	VkDependencyInfo dependencyInfo = {};
+	dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+	dependencyInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(this->_bufferBarriers.size());
+	dependencyInfo.pBufferMemoryBarriers = this->_bufferBarriers.data();
+	dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(this->_imageBarriers.size());
+	dependencyInfo.pImageMemoryBarriers = this->_imageBarriers.data();
+
+	vkCmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+}
@@ -0,0 +1,203 @@
+#pragma once
+#include <functional>
+#include <string>
+#include "QEngine.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanDeletionQueue.h"
+
+enum class VulkanGraphAccess : uint8_t {
+	COLOR_ATTACHMENT = 0,
+	DEPTH_ATTACHMENT,
+	DEPTH_READ,
+	SAMPLED_GRAPHICS,
+	SAMPLED_COMPUTE,
+	STORAGE_READ,
+	STORAGE_WRITE,
+	TRANSFER_SRC,
+	TRANSFER_DST,
+	INDIRECT_READ,
+	COUNT
+};
+
+enum class VulkanGraphQueue : uint8_t {
+	GRAPHICS = 0,
+	ASYNC_COMPUTE,
+	COUNT
+};
+
+struct VulkanGraphImageDesc {
+	VkExtent2D extent = { 0, 0 };
+	VkFormat format = VK_FORMAT_UNDEFINED;
+	VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+	VkImageUsageFlags usage = 0;
+};
+
+struct VulkanGraphStats {
+	uint32_t passCount = 0;
+	uint32_t culledPasses = 0;
+	uint32_t barrierCount = 0;
+	uint32_t elidedBarriers = 0;
+	uint32_t transientImages = 0;
+	uint32_t memoryBuckets = 0;
+	VkDeviceSize transientBytes = 0;
+	VkDeviceSize allocatedBytes = 0;
+	uint32_t asyncPasses = 0;
+	uint32_t batchCount = 0;
+	uint32_t queueTransfers = 0;
+};
+
+// Frame graph: passes are declared in execution order together with the resources they read and write.
+// compile() culls passes whose results nobody consumes, derives the smallest set of synchronization2
+// barriers between the survivors and lets transient images with disjoint lifetimes share memory.
+// The graph is built once and recompiled only when its shape changes (resize, new passes); imported
+// images such as the swapchain image are swapped per frame with updateImport(). Without an allocator
+// compile() does everything except creating images, which keeps it testable on the CPU. With a deletion
+// queue, images dropped by a recompile are released once the frames using them have retired.
+//
+// Passes marked async-compute run on the compute queue when it has its own family. The compiled graph
+// is then split into batches of consecutive passes on one queue; each batch names the batch on the
+// other queue it must wait for, and ownership of shared resources moves with release/acquire pairs.
+// Imported resources belong to the graphics family between frames.
+class VulkanRenderGraph {
+public:
+	typedef uint32_t Resource;
+	typedef uint32_t Pass;
+	typedef std::function<void(VkCommandBuffer commandBuffer, VulkanRenderGraph& graph)> ExecuteCallback;
+
+	static const uint32_t INVALID = UINT32_MAX;
+
+	VulkanRenderGraph(VulkanMemoryAllocator* allocator = nullptr, VulkanDeletionQueue* deletionQueue = nullptr);
+	~VulkanRenderGraph();
+
+	Resource createImage(const std::string& name, const VulkanGraphImageDesc& desc);
+	Resource importImage(
+		const std::string& name, const VulkanGraphImageDesc& desc, VkImage image, VkImageView imageView,
+		VkImageLayout initialLayout, VkImageLayout finalLayout);
+	Resource importBuffer(const std::string& name, VkBuffer buffer);
+	void updateImport(Resource resource, VkImage image, VkImageView imageView);
+	void updateImport(Resource resource, VkBuffer buffer);
+	void updateImportDesc(Resource resource, const VulkanGraphImageDesc& desc);
+
+	void setQueueFamilies(uint32_t graphicsFamily, uint32_t computeFamily);
+
+	Pass addPass(const std::string& name, ExecuteCallback callback, bool sideEffects = false);
+	void setAsyncCompute(Pass pass, bool asyncCompute = true);
+	void read(Pass pass, Resource resource, VulkanGraphAccess access);
+	void write(Pass pass, Resource resource, VulkanGraphAccess access);
+
+	void compile();
+	void execute(VkCommandBuffer commandBuffer);
+	void clear();
+
+	uint32_t getBatchCount();
+	VulkanGraphQueue getBatchQueue(uint32_t batch);
+	uint32_t getBatchWait(uint32_t batch);
+	void executeBatch(uint32_t batch, VkCommandBuffer commandBuffer);
+
+	VkImage getImage(Resource resource);
+	VkImageView getImageView(Resource resource);
+	VkBuffer getBuffer(Resource resource);
+	const VulkanGraphImageDesc& getImageDesc(Resource resource);
+	bool isCulled(Pass pass);
+	uint32_t getMemoryBucket(Resource resource);
+
+	VulkanGraphStats getStats();
+	std::string toDot();
+private:
+	struct ResourceNode {
+		std::string name;
+		bool isBuffer = false;
+		bool imported = false;
+		VulkanGraphImageDesc desc;
+		VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+		VkImage image = VK_NULL_HANDLE;
+		VkImageView imageView = VK_NULL_HANDLE;
+		VkBuffer buffer = VK_NULL_HANDLE;
+
+		uint32_t firstPass = INVALID;
+		uint32_t lastPass = INVALID;
+		uint32_t bucket = INVALID;
+		bool asyncAccess = false;
+		VkImageUsageFlags usage = 0;
+		VkMemoryRequirements requirements = {};
+	};
+
+	struct AccessNode {
+		Resource resource;
+		VulkanGraphAccess access;
+		bool write;
+	};
+
+	// Equal families (the default) mean no ownership transfer.
+	struct Barrier {
+		Resource resource;
+		VkPipelineStageFlags2 srcStages;
+		VkAccessFlags2 srcAccess;
+		VkPipelineStageFlags2 dstStages;
+		VkAccessFlags2 dstAccess;
+		VkImageLayout oldLayout;
+		VkImageLayout newLayout;
+		uint32_t srcFamily;
+		uint32_t dstFamily;
+	};
+
+	struct PassNode {
+		std::string name;
+		ExecuteCallback callback;
+		bool sideEffects = false;
+		bool asyncCompute = false;
+		bool culled = false;
+		VulkanGraphQueue queue = VulkanGraphQueue::GRAPHICS;
+		uint32_t batch = INVALID;
+		std::vector<AccessNode> accesses;
+		std::vector<Barrier> barriers;
+		std::vector<Barrier> releases;
+		std::vector<uint32_t> dependencies;
+	};
+
+	struct Batch {
+		VulkanGraphQueue queue;
+		std::vector<uint32_t> passes;
+		std::vector<Barrier> prologue;
+		uint32_t wait = INVALID;
+		bool finalBarriers = false;
+	};
+
+	struct MemoryBucket {
+		VkMemoryRequirements requirements;
+		std::vector<Resource> occupants;
+		VulkanAllocation* allocation = nullptr;
+	};
+
+	VulkanMemoryAllocator* _allocator;
+	VulkanDeletionQueue* _deletionQueue;
+	VkDevice _logicalDevice = VK_NULL_HANDLE;
+	bool _compiled = false;
+	bool _asyncEnabled = false;
+	uint32_t _queueFamilies[static_cast<uint32_t>(VulkanGraphQueue::COUNT)] = {};
+
+	std::vector<ResourceNode> _resources;
+	std::vector<PassNode> _passes;
+	std::vector<uint32_t> _order;
+	std::vector<Barrier> _finalBarriers;
+	std::vector<Barrier> _initialReleases;
+	std::vector<Batch> _batches;
+	std::vector<MemoryBucket> _buckets;
+	VulkanGraphStats _stats;
+
+	std::vector<VkImageMemoryBarrier2> _imageBarriers;
+	std::vector<VkBufferMemoryBarrier2> _bufferBarriers;
+
+	void _addAccess(Pass pass, Resource resource, VulkanGraphAccess access, bool write);
+	void _cullPasses();
+	void _computeLifetimes();
+	void _aliasMemory();
+	void _computeBarriers();
+	void _buildBatches();
+	uint32_t _getFamily(VulkanGraphQueue queue);
+	void _createPhysicalImages();
+	void _destroyPhysicalImages();
+	void _emitBarriers(VkCommandBuffer commandBuffer, const std::vector<Barrier>& barriers);
+};
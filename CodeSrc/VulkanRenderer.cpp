@@ -1,19 +1,39 @@
 #include "VulkanRenderer.h"
 
-VulkanRenderer::VulkanRenderer(GLFWwindow* newWindow) : _window{newWindow} {
+VulkanRenderer::VulkanRenderer(GLFWwindow* newWindow, uint32_t framesInFlight) :
+	_framesInFlight{framesInFlight}, _window{newWindow} {
+	glfwSetWindowUserPointer(this->_window, this);
+	glfwSetFramebufferSizeCallback(this->_window, VulkanRenderer::_onFramebufferResize);
+
 	try {
 		this->_createInstance();
 		this->_setupDebugMessenger();
 		this->_createSurface();
 		this->_getPhysicalDevice();
 		this->_createLogicalDevice();
+		this->_createSynchronization();
+		this->_createMemoryAllocator();
+		this->_createDeletionQueue();
+		this->_createMemoryDefragmenter();
+		this->_createUploadQueue();
+		this->_createDescriptorAllocator();
+		this->_createUniformAllocator();
+		this->_createBindlessDescriptors();
+		this->_createFrameArena();
+		this->_createJobSystem();
+		this->_createCommandPoolManager();
+		this->_createParallelRecorder();
+		this->_createCommandCache();
+		this->_createDrawList();
+		this->_createInstanceBatcher();
+		this->_createGpuScene();
+		this->_createGpuCuller();
+		this->_createQueueProfiler();
+		this->_createGraphSubmitter();
 		this->_createSwapchain();
+		this->_createDepthPyramid();
 		this->_createGraphicsPipeline();
-		this->_createFramebuffers();
-		this->_createGraphicsCommandPool();
-		this->_createCommandBuffer();
-		this->_recordCommands();
-		this->_createSynchronization();
+		this->_createRenderGraph();
 	}
 	catch (const std::runtime_error& e) {
 		std::string strErr = e.what();
@@ -28,18 +48,32 @@ VulkanRenderer::VulkanRenderer(GLFWwindow* newWindow) : _window{newWindow} {
 VulkanRenderer::~VulkanRenderer() {
 	vkDeviceWaitIdle(this->_mainDevice.logicalDevice);
 
-	for (size_t i = 0; i < MAX_FRAME_DRAWS; i++) {
-		vkDestroyFence(this->_mainDevice.logicalDevice, this->_drawFences[i], nullptr);
-		vkDestroySemaphore(this->_mainDevice.logicalDevice, this->_rendersFinished[i], nullptr);
-		vkDestroySemaphore(this->_mainDevice.logicalDevice, this->_imagesAvailable[i], nullptr);
-	}
-	
-	delete this->_commandBuffer;
-	delete this->_graphicsCommandPool;
-	delete this->_framebuffer;
+	delete this->_renderGraph;
 	delete this->_graphicsPipeline;
+	delete this->_depthPyramid;
+	delete this->_graphSubmitter;
+	delete this->_queueProfiler;
+	delete this->_gpuCuller;
+	delete this->_gpuScene;
+	this->_memoryDefragmenter->setMoveCallback(nullptr);
+	delete this->_instanceBatcher;
+	delete this->_drawList;
+	delete this->_commandCache;
+	delete this->_parallelRecorder;
+	delete this->_commandPoolManager;
+	delete this->_jobSystem;
+	delete this->_frameArena;
+	delete this->_bindlessDescriptors;
+	delete this->_uniformAllocator;
+	delete this->_descriptorAllocator;
+	delete this->_uploadQueue;
+	delete this->_memoryDefragmenter;
+	delete this->_deletionQueue;
+	delete this->_memoryAllocator;
+	delete this->_frameSync;
 
 	for (auto image : this->_swapchainImages) {
+		vkDestroySemaphore(this->_mainDevice.logicalDevice, image.renderFinished, nullptr);
 		vkDestroyImageView(this->_mainDevice.logicalDevice, image.imageView, nullptr);
 	}
 	
@@ -54,64 +88,168 @@ VulkanRenderer::~VulkanRenderer() {
 	vkDestroyInstance(this->_instance, nullptr);
 }
 
+void VulkanRenderer::setViewProjection(const float viewProjection[16]) {
+	memcpy(this->_viewProjection, viewProjection, sizeof(this->_viewProjection));
+	this->_gpuScene->setViewProjection(viewProjection);
+}
+
 void VulkanRenderer::draw() {
-	vkWaitForFences(
-		this->_mainDevice.logicalDevice,
-		1,
-		&this->_drawFences[_currentFrame],
-		VK_TRUE,
-		std::numeric_limits<uint64_t>::max());
+	QAllocTracker::beginFrame();
+	QAllocScope allocScope(QAllocTag::DRAW);
+
+	// Waits on the frame timeline until the frame that last used this slot has retired.
+	this->_currentFrame = this->_frameSync->beginFrame();
+	this->_deletionQueue->collect();
+
+	// A minimized window has nothing to present to, so frames are skipped until it has a size again.
+	if (this->_swapchainOutOfDate && !this->_recreateSwapchain()) {
+		QAllocTracker::endFrame();
+		return;
+	}
 
-	vkResetFences(this->_mainDevice.logicalDevice, 1, &this->_drawFences[_currentFrame]);
-	
 	uint32_t imageIndex;
-	vkAcquireNextImageKHR(
+	VkResult result = vkAcquireNextImageKHR(
 		this->_mainDevice.logicalDevice,
 		this->_swapchain,
 		std::numeric_limits<uint64_t>::max(),
-		this->_imagesAvailable[_currentFrame],
+		this->_frameSync->getImageAvailable(),
 		VK_NULL_HANDLE,
 		&imageIndex);
 
-	VkSubmitInfo submitInfo = {};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.waitSemaphoreCount = 1;
-	submitInfo.pWaitSemaphores = &this->_imagesAvailable[_currentFrame];
-	VkPipelineStageFlags waitStages[] = {
-		VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+	// Nothing was acquired or submitted, so the frame keeps its number and is simply retried.
+	if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+		this->_swapchainOutOfDate = true;
+		QAllocTracker::endFrame();
+		return;
+	}
+
+	if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+		ThrowErr::runtime("Failed to acquire a swapchain image!..");
+	}
+
+	// A suboptimal image still works and has its semaphore signalled; it is replaced after this present.
+	if (result == VK_SUBOPTIMAL_KHR) {
+		this->_swapchainOutOfDate = true;
+	}
+
+	this->_uniformAllocator->beginFrame(this->_currentFrame);
+	this->_bindlessDescriptors->beginFrame(this->_currentFrame);
+	this->_descriptorAllocator->beginFrame(this->_currentFrame);
+	this->_frameArena->beginFrame(this->_currentFrame);
+	this->_commandPoolManager->beginFrame(this->_currentFrame);
+	this->_commandCache->beginFrame(this->_currentFrame);
+	this->_parallelRecorder->beginFrame();
+	this->_instanceBatcher->beginFrame(this->_currentFrame);
+	this->_gpuScene->beginFrame(this->_currentFrame);
+	this->_gpuCuller->beginFrame(this->_currentFrame);
+	this->_queueProfiler->beginFrame(this->_currentFrame);
+
+	// Written once per frame; every dynamic draw of the frame points its set 1 offset here.
+	VulkanFrameUniforms frameUniforms = {};
+	memcpy(frameUniforms.viewProjection, this->_viewProjection, sizeof(frameUniforms.viewProjection));
+	frameUniforms.viewportSize[0] = static_cast<float>(this->_swapchainExtent.width);
+	frameUniforms.viewportSize[1] = static_cast<float>(this->_swapchainExtent.height);
+	frameUniforms.frameNumber = static_cast<uint32_t>(this->_frameSync->getFrameNumber());
+	this->_frameUniformOffset = this->_uniformAllocator->push(frameUniforms);
+
+	// Flush uploads recorded since the last frame and take ownership of whatever the transfer queue finished.
+	this->_uploadQueue->submit();
+
+	uint64_t uploadWaitValue = 0;
+	VkCommandBuffer acquireCommandBuffer = this->_uploadQueue->recordAcquire(this->_currentFrame, &uploadWaitValue);
+
+	VkSemaphore prefixWaitSemaphores[] = { this->_uploadQueue->getTimelineSemaphore() };
+	uint64_t prefixWaitValues[] = { uploadWaitValue };
+	VkSemaphore waitSemaphores[] = { this->_frameSync->getImageAvailable() };
+	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+	VkSemaphore signalSemaphores[] = {
+		this->_swapchainImages[imageIndex].renderFinished,
+		this->_frameSync->getTimelineSemaphore()
 	};
-	auto constBuffs = this->_commandBuffer->getCommandBuffers();
-	submitInfo.pWaitDstStageMask = waitStages;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &constBuffs[imageIndex];
-	submitInfo.signalSemaphoreCount = 1;
-	submitInfo.pSignalSemaphores = &this->_rendersFinished[_currentFrame];
-
-	VkResult result = vkQueueSubmit(this->_graphicsQueue, 1, &submitInfo, this->_drawFences[_currentFrame]);
-	if (result != VK_SUCCESS) {
-		ThrowErr::runtime("Failed to submit command buffer to render queue!..");
+	uint64_t signalValues[] = {
+		0,
+		this->_frameSync->getFrameNumber()
+	};
+
+	QArenaVector<VkCommandBuffer> prefixBuffers(this->_frameArena->local(), 2);
+	if (acquireCommandBuffer != VK_NULL_HANDLE) {
+		prefixBuffers.push_back(acquireCommandBuffer);
+	}
+
+	// Defragmentation copies run ahead of the frame on graphics; the frame timeline retires the old ranges.
+	VkCommandBuffer defragCommandBuffer = this->_memoryDefragmenter->recordFrame(this->_currentFrame);
+	if (defragCommandBuffer != VK_NULL_HANDLE) {
+		prefixBuffers.push_back(defragCommandBuffer);
 	}
 
+	VulkanGraphFrameSubmit frame;
+	frame.prefixCommandBuffers = QSpan<const VkCommandBuffer>(prefixBuffers.data(), prefixBuffers.size());
+	frame.prefixWaitSemaphores = QSpan<const VkSemaphore>(prefixWaitSemaphores, 1);
+	frame.prefixWaitValues = QSpan<const uint64_t>(prefixWaitValues, 1);
+	frame.waitSemaphores = QSpan<const VkSemaphore>(waitSemaphores, 1);
+	frame.waitStages = QSpan<const VkPipelineStageFlags>(waitStages, 1);
+	frame.signalSemaphores = QSpan<const VkSemaphore>(signalSemaphores, 2);
+	frame.signalValues = QSpan<const uint64_t>(signalValues, 2);
+
+	this->_submitCommands(imageIndex, frame);
+
 	VkPresentInfoKHR presentInfo = {};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
 	presentInfo.waitSemaphoreCount = 1;
-	presentInfo.pWaitSemaphores = &this->_rendersFinished[_currentFrame];
+	presentInfo.pWaitSemaphores = &signalSemaphores[0];
 	presentInfo.swapchainCount = 1;
 	presentInfo.pSwapchains = &this->_swapchain;
 	presentInfo.pImageIndices = &imageIndex;
 
 	result = vkQueuePresentKHR(this->_presentationQueue, &presentInfo);
-	if (result != VK_SUCCESS) {
+	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+		this->_swapchainOutOfDate = true;
+	}
+	else if (result != VK_SUCCESS) {
 		ThrowErr::runtime("Failed to present Image!..");
 	}
 
-	this->_currentFrame = (this->_currentFrame + 1) % MAX_FRAME_DRAWS;
+	this->_frameSync->endFrame();
+
+	QAllocTracker::endFrame();
 }
 
 int VulkanRenderer::getInitResult() {
 	return this->_initResult;
 }
 
+VulkanQueueStats VulkanRenderer::getQueueStats() {
+	return this->_queueProfiler->getStats();
+}
+
+VulkanGpuCullStats VulkanRenderer::getCullStats() {
+	return this->_gpuCuller->getStats();
+}
+
+VulkanRecordStats VulkanRenderer::getRecordStats() {
+	return this->_parallelRecorder->getStats();
+}
+
+VulkanDrawListStats VulkanRenderer::getDrawListStats() {
+	return this->_drawList->getStats();
+}
+
+uint32_t VulkanRenderer::addInstancedMesh(const VulkanInstancedMesh& mesh) {
+	return this->_instanceBatcher->addMesh(mesh);
+}
+
+uint32_t VulkanRenderer::addInstancedMeshes(const QMeshDeduplicator& meshes, VkPipeline pipeline) {
+	return this->_instanceBatcher->addMeshes(meshes, pipeline);
+}
+
+void VulkanRenderer::addInstance(const VulkanBatchInstance& instance) {
+	this->_instanceBatcher->add(instance);
+}
+
+VulkanInstanceBatcherStats VulkanRenderer::getInstanceBatcherStats() {
+	return this->_instanceBatcher->getStats();
+}
+
 void VulkanRenderer::_getPhysicalDevice() {
 	uint32_t deviceCount = 0;
 	vkEnumeratePhysicalDevices(this->_instance, &deviceCount, nullptr);
@@ -204,7 +342,7 @@ void VulkanRenderer::_createLogicalDevice() {
 	QueueFamilyIndicies indices = this->_getQueueFamilies(this->_mainDevice.physicalDevice);
 
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
-	std::set<int> queueFamilyIndices = { indices.graphicsFamily, indices.presentationFamily };
+	std::set<int> queueFamilyIndices = { indices.graphicsFamily, indices.presentationFamily, indices.transferFamily, indices.computeFamily };
 
 	for (int queueFamilyIndex : queueFamilyIndices) {
 		VkDeviceQueueCreateInfo queueCreateInfo = {};
@@ -224,8 +362,32 @@ void VulkanRenderer::_createLogicalDevice() {
 	deviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
 	deviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();
 
-	VkPhysicalDeviceFeatures deviceFeatures = {};
-	deviceCreateInfo.pEnabledFeatures = &deviceFeatures;
+	VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	vulkan12Features.timelineSemaphore = VK_TRUE;
+	vulkan12Features.hostQueryReset = VK_TRUE;
+	vulkan12Features.drawIndirectCount = VK_TRUE;
+	vulkan12Features.descriptorIndexing = VK_TRUE;
+	vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+	vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+	vulkan12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+	vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+	vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+	vulkan12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+	vulkan12Features.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+
+	VkPhysicalDeviceVulkan13Features vulkan13Features = {};
+	vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+	vulkan13Features.synchronization2 = VK_TRUE;
+	vulkan13Features.dynamicRendering = VK_TRUE;
+	vulkan12Features.pNext = &vulkan13Features;
+
+	VkPhysicalDeviceFeatures2 deviceFeatures = {};
+	deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	deviceFeatures.pNext = &vulkan12Features;
+	deviceFeatures.features.multiDrawIndirect = VK_TRUE;
+	deviceFeatures.features.drawIndirectFirstInstance = VK_TRUE;
+	deviceCreateInfo.pNext = &deviceFeatures;
 
 	VkResult result = vkCreateDevice(this->_mainDevice.physicalDevice, &deviceCreateInfo, nullptr, &this->_mainDevice.logicalDevice);
 	if (result != VK_SUCCESS) {
@@ -233,7 +395,108 @@ void VulkanRenderer::_createLogicalDevice() {
 	}
 
 	vkGetDeviceQueue(this->_mainDevice.logicalDevice, indices.graphicsFamily, 0, &this->_graphicsQueue);
+	this->_graphicsQueueFamily = static_cast<uint32_t>(indices.graphicsFamily);
 	vkGetDeviceQueue(this->_mainDevice.logicalDevice, indices.presentationFamily, 0, &this->_presentationQueue);
+	vkGetDeviceQueue(this->_mainDevice.logicalDevice, indices.transferFamily, 0, &this->_transferQueue);
+	vkGetDeviceQueue(this->_mainDevice.logicalDevice, indices.computeFamily, 0, &this->_computeQueue);
+	this->_computeQueueFamily = static_cast<uint32_t>(indices.computeFamily);
+}
+
+void VulkanRenderer::_createMemoryAllocator() {
+	this->_memoryAllocator = new VulkanMemoryAllocator(this->_mainDevice.physicalDevice, this->_mainDevice.logicalDevice);
+}
+
+void VulkanRenderer::_createDeletionQueue() {
+	this->_deletionQueue = new VulkanDeletionQueue(this->_mainDevice.logicalDevice, this->_memoryAllocator, this->_frameSync);
+}
+
+void VulkanRenderer::_createMemoryDefragmenter() {
+	QueueFamilyIndicies indices = this->_getQueueFamilies(this->_mainDevice.physicalDevice);
+	this->_memoryDefragmenter = new VulkanMemoryDefragmenter(this->_memoryAllocator, indices.graphicsFamily);
+}
+
+void VulkanRenderer::_createUploadQueue() {
+	this->_uploadQueue = new VulkanUploadQueue(
+		this->_mainDevice.logicalDevice, this->_memoryAllocator, this->_transferQueue,
+		this->_getQueueFamilies(this->_mainDevice.physicalDevice));
+}
+
+void VulkanRenderer::_createDescriptorAllocator() {
+	this->_descriptorAllocator = new VulkanDescriptorAllocator(this->_mainDevice.logicalDevice);
+}
+
+void VulkanRenderer::_createUniformAllocator() {
+	this->_uniformAllocator = new VulkanUniformAllocator(
+		this->_mainDevice.physicalDevice, this->_mainDevice.logicalDevice, this->_memoryAllocator, this->_descriptorAllocator,
+		this->_frameSync->getFramesInFlight());
+}
+
+void VulkanRenderer::_createBindlessDescriptors() {
+	this->_bindlessDescriptors = new VulkanBindlessDescriptors(
+		this->_mainDevice.physicalDevice, this->_mainDevice.logicalDevice, this->_descriptorAllocator,
+		this->_uniformAllocator->getDescriptorSetLayout());
+}
+
+void VulkanRenderer::_createFrameArena() {
+	this->_frameArena = new QFrameArena(this->_frameSync->getFramesInFlight());
+}
+
+void VulkanRenderer::_createJobSystem() {
+	this->_jobSystem = new QJobSystem();
+}
+
+void VulkanRenderer::_createCommandPoolManager() {
+	this->_commandPoolManager = new VulkanCommandPoolManager(this->_mainDevice.logicalDevice, this->_jobSystem->getWorkerCount());
+}
+
+void VulkanRenderer::_createParallelRecorder() {
+	this->_parallelRecorder = new VulkanParallelRecorder(
+		this->_commandPoolManager, this->_graphicsQueueFamily, this->_jobSystem, this->_bindlessDescriptors, this->_uniformAllocator);
+}
+
+void VulkanRenderer::_createCommandCache() {
+	this->_commandCache = new VulkanCommandCache(
+		this->_mainDevice.logicalDevice, this->_graphicsQueueFamily, this->_bindlessDescriptors, this->_uniformAllocator);
+}
+
+void VulkanRenderer::_createDrawList() {
+	this->_drawList = new VulkanDrawList(this->_jobSystem);
+}
+
+void VulkanRenderer::_createInstanceBatcher() {
+	this->_instanceBatcher = new VulkanInstanceBatcher(
+		this->_memoryAllocator, this->_uploadQueue, this->_bindlessDescriptors, this->_jobSystem,
+		this->_frameSync->getFramesInFlight());
+
+	// The batcher's mesh buffers are the renderer's movable resources; it swaps in the new handles.
+	VulkanInstanceBatcher* instanceBatcher = this->_instanceBatcher;
+	this->_memoryDefragmenter->setMoveCallback([instanceBatcher](VulkanAllocation* allocation, VkBuffer oldBuffer) {
+		instanceBatcher->moveBuffer(allocation, oldBuffer);
+	});
+}
+
+void VulkanRenderer::_createGpuScene() {
+	this->_gpuScene = new VulkanGpuScene(
+		this->_memoryAllocator, this->_bindlessDescriptors, this->_frameSync->getFramesInFlight(),
+		this->_graphicsQueueFamily, this->_computeQueueFamily);
+}
+
+void VulkanRenderer::_createGpuCuller() {
+	this->_gpuCuller = new VulkanGpuCuller(
+		this->_mainDevice.logicalDevice, this->_memoryAllocator, this->_bindlessDescriptors, this->_gpuScene,
+		this->_frameSync->getFramesInFlight());
+}
+
+void VulkanRenderer::_createQueueProfiler() {
+	this->_queueProfiler = new VulkanQueueProfiler(
+		this->_mainDevice.physicalDevice, this->_mainDevice.logicalDevice, this->_frameSync->getFramesInFlight(),
+		this->_graphicsQueueFamily, this->_computeQueueFamily);
+}
+
+void VulkanRenderer::_createGraphSubmitter() {
+	this->_graphSubmitter = new VulkanGraphSubmitter(
+		this->_mainDevice.logicalDevice, this->_commandPoolManager, this->_queueProfiler,
+		this->_graphicsQueue, this->_graphicsQueueFamily, this->_computeQueue, this->_computeQueueFamily);
 }
 
 void VulkanRenderer::_createSurface() {
@@ -287,13 +550,29 @@ void VulkanRenderer::_createSwapchain() {
 		swapchainCreateInfo.pQueueFamilyIndices = nullptr;
 	}
 
-	swapchainCreateInfo.oldSwapchain = VK_NULL_HANDLE;
+	// Handing over the old swapchain lets the driver reuse its resources and keeps already acquired images presentable.
+	VkSwapchainKHR oldSwapchain = this->_swapchain;
+	swapchainCreateInfo.oldSwapchain = oldSwapchain;
 
 	VkResult result = vkCreateSwapchainKHR(this->_mainDevice.logicalDevice, &swapchainCreateInfo, nullptr, &this->_swapchain);
 	if (result != VK_SUCCESS) {
 		ThrowErr::runtime("Failed to create a swapchain!..");
 	}
 
+	// Frames already submitted still render to the old images; the frame being recorded uses the new ones.
+	if (oldSwapchain != VK_NULL_HANDLE) {
+		uint64_t lastUsedFrame = this->_frameSync->getSubmittedFrame();
+		for (SwapchainImage& image : this->_swapchainImages) {
+			this->_deletionQueue->destroyImageView(image.imageView, lastUsedFrame);
+		}
+		this->_deletionQueue->destroySwapchain(oldSwapchain, lastUsedFrame);
+
+		// Queued after the swapchain: destroying it is the only point its presents are known to be done.
+		for (SwapchainImage& image : this->_swapchainImages) {
+			this->_deletionQueue->destroySemaphore(image.renderFinished, lastUsedFrame);
+		}
+	}
+
 	this->_swapchainImageFormat = surfaceFormat.format;
 	this->_swapchainExtent = resolution;
 
@@ -302,30 +581,239 @@ void VulkanRenderer::_createSwapchain() {
 	std::vector<VkImage> images(swapchainImageCount);
 	vkGetSwapchainImagesKHR(this->_mainDevice.logicalDevice, this->_swapchain, &swapchainImageCount, images.data());
 
+	VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+	// Present waits on a semaphore per image rather than per frame slot: it is only free again once the
+	// image has been acquired anew.
 	this->_swapchainImages.clear();
 	for (VkImage image : images) {
 		SwapchainImage swapchainImage = {};
 		swapchainImage.image = image;
 		swapchainImage.imageView = this->_createImageView(image, _swapchainImageFormat, VK_IMAGE_ASPECT_COLOR_BIT);
 
+		if (vkCreateSemaphore(this->_mainDevice.logicalDevice, &semaphoreCreateInfo, nullptr, &swapchainImage.renderFinished) != VK_SUCCESS) {
+			ThrowErr::runtime("Failed to create a render semaphore!..");
+		}
+
 		this->_swapchainImages.push_back(swapchainImage);
 	}
 }
 
+bool VulkanRenderer::_recreateSwapchain() {
+	int width = 0, height = 0;
+	glfwGetFramebufferSize(this->_window, &width, &height);
+	if (width == 0 || height == 0) {
+		return false;
+	}
+
+	// Only size-dependent state is rebuilt. The surface format cannot change for the same surface, so the
+	// pipeline stays; the command cache notices the new viewport by itself and re-records its batches.
+	this->_createSwapchain();
+	this->_swapchainOutOfDate = false;
+
+	VulkanGraphImageDesc swapchainDesc = this->_renderGraph->getImageDesc(this->_swapchainResource);
+	swapchainDesc.extent = this->_swapchainExtent;
+	this->_renderGraph->updateImportDesc(this->_swapchainResource, swapchainDesc);
+
+	// The depth buffer and its pyramid follow the swapchain; the old ones retire with the frames using them.
+	this->_depthPyramid->resize(this->_swapchainExtent);
+	this->_gpuScene->setDepthPyramid(
+		this->_depthPyramid->getPyramidSlot(), this->_depthPyramid->getPyramidExtent(), this->_depthPyramid->getLevelCount());
+
+	VulkanGraphImageDesc depthDesc = this->_renderGraph->getImageDesc(this->_depthResource);
+	depthDesc.extent = this->_swapchainExtent;
+	this->_renderGraph->updateImportDesc(this->_depthResource, depthDesc);
+	this->_renderGraph->updateImport(this->_depthResource, this->_depthPyramid->getDepthImage(), this->_depthPyramid->getDepthImageView());
+	this->_renderGraph->updateImport(this->_depthPyramidResource, this->_depthPyramid->getPyramidBuffer());
+
+	return true;
+}
+
+void VulkanRenderer::_onFramebufferResize(GLFWwindow* window, int, int) {
+	VulkanRenderer* renderer = static_cast<VulkanRenderer*>(glfwGetWindowUserPointer(window));
+	renderer->_swapchainOutOfDate = true;
+}
+
+void VulkanRenderer::_createDepthPyramid() {
+	this->_depthPyramid = new VulkanDepthPyramid(
+		this->_mainDevice.logicalDevice, this->_memoryAllocator, this->_deletionQueue, this->_bindlessDescriptors,
+		this->_swapchainExtent);
+
+	this->_gpuScene->setDepthPyramid(
+		this->_depthPyramid->getPyramidSlot(), this->_depthPyramid->getPyramidExtent(), this->_depthPyramid->getLevelCount());
+}
+
 void VulkanRenderer::_createGraphicsPipeline() {
 	this->_graphicsPipeline = new VulkanGraphicsPipeline(
-		this->_mainDevice.logicalDevice, this->_swapchainExtent, this->_swapchainImageFormat);
+		this->_mainDevice.logicalDevice, this->_swapchainImageFormat, this->_bindlessDescriptors->getPipelineLayout(),
+		this->_depthPyramid->getDepthFormat());
+
+	VulkanDrawCommand triangle = {};
+	triangle.pipeline = this->_graphicsPipeline->getPipeline();
+	triangle.elementCount = 3;
+	this->_staticDrawCommands.push_back(triangle);
 }
 
-void VulkanRenderer::_createFramebuffers() {
-	this->_framebuffer = new VulkanFrameBuffer(
-		this->_swapchainImages, this->_graphicsPipeline->getRenderPass(), this->_swapchainExtent,
-		this->_mainDevice.logicalDevice);
+void VulkanRenderer::_createRenderGraph() {
+	this->_renderGraph = new VulkanRenderGraph(this->_memoryAllocator, this->_deletionQueue);
+	this->_renderGraph->setQueueFamilies(this->_graphicsQueueFamily, this->_computeQueueFamily);
+
+	VulkanGraphImageDesc swapchainDesc = {};
+	swapchainDesc.extent = this->_swapchainExtent;
+	swapchainDesc.format = this->_swapchainImageFormat;
+	swapchainDesc.aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+
+	// The image is swapped in per command buffer; the graph transitions it from UNDEFINED and back to present.
+	this->_swapchainResource = this->_renderGraph->importImage(
+		"swapchain", swapchainDesc, VK_NULL_HANDLE, VK_NULL_HANDLE, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+	VulkanGraphImageDesc depthDesc = {};
+	depthDesc.extent = this->_swapchainExtent;
+	depthDesc.format = this->_depthPyramid->getDepthFormat();
+	depthDesc.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+
+	// Depth is cleared every frame, so it starts undefined and is left in whatever layout the last pass used.
+	this->_depthResource = this->_renderGraph->importImage(
+		"depth", depthDesc, this->_depthPyramid->getDepthImage(), this->_depthPyramid->getDepthImageView(),
+		VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_UNDEFINED);
+	this->_depthPyramidResource = this->_renderGraph->importBuffer("depth pyramid", this->_depthPyramid->getPyramidBuffer());
+
+	VulkanRenderGraph::Resource earlyDraws = this->_renderGraph->importBuffer(
+		"gpu draws early", this->_gpuCuller->getDrawBuffer(VulkanGpuCullPhase::EARLY));
+	VulkanRenderGraph::Resource earlyDrawCount = this->_renderGraph->importBuffer(
+		"gpu draw count early", this->_gpuCuller->getCountBuffer(VulkanGpuCullPhase::EARLY));
+	VulkanRenderGraph::Resource lateDraws = this->_renderGraph->importBuffer(
+		"gpu draws late", this->_gpuCuller->getDrawBuffer(VulkanGpuCullPhase::LATE));
+	VulkanRenderGraph::Resource lateDrawCount = this->_renderGraph->importBuffer(
+		"gpu draw count late", this->_gpuCuller->getCountBuffer(VulkanGpuCullPhase::LATE));
+	VulkanRenderGraph::Resource visibility = this->_renderGraph->importBuffer("gpu visibility", this->_gpuCuller->getVisibilityBuffer());
+	this->_gpuCullStatsResource = this->_renderGraph->importBuffer("gpu cull stats", this->_gpuCuller->getStatsBuffer());
+
+	// Two-phase occlusion culling: draw what was visible last frame, build the depth pyramid from it,
+	// then test everything else against the pyramid and draw what turned out visible.
+	// The early cull runs on async compute where there is one, but it does not overlap graphics yet: it
+	// reads the visibility the previous frame's late cull wrote, so its batch waits for the graphics prefix,
+	// and main early waits for its draws. Passes that need neither (light binning, post-processing of the
+	// previous frame) are what the compute queue can run alongside raster work.
+	VulkanRenderGraph::Pass earlyCullPass = this->_renderGraph->addPass("gpu cull early", [this](VkCommandBuffer cb, VulkanRenderGraph& graph) {
+		this->_gpuCuller->recordCull(cb, VulkanGpuCullPhase::EARLY);
+	});
+	this->_renderGraph->setAsyncCompute(earlyCullPass);
+	this->_renderGraph->read(earlyCullPass, visibility, VulkanGraphAccess::STORAGE_READ);
+	this->_renderGraph->write(earlyCullPass, earlyDraws, VulkanGraphAccess::STORAGE_WRITE);
+	this->_renderGraph->write(earlyCullPass, earlyDrawCount, VulkanGraphAccess::TRANSFER_DST);
+	this->_renderGraph->write(earlyCullPass, earlyDrawCount, VulkanGraphAccess::STORAGE_WRITE);
+	this->_renderGraph->write(earlyCullPass, this->_gpuCullStatsResource, VulkanGraphAccess::TRANSFER_DST);
+	this->_renderGraph->write(earlyCullPass, this->_gpuCullStatsResource, VulkanGraphAccess::STORAGE_WRITE);
+
+	VulkanRenderGraph::Pass earlyMainPass = this->_renderGraph->addPass("main early", [this](VkCommandBuffer cb, VulkanRenderGraph& graph) {
+		this->_recordMainPass(cb, graph, VulkanGpuCullPhase::EARLY);
+	});
+	this->_renderGraph->write(earlyMainPass, this->_swapchainResource, VulkanGraphAccess::COLOR_ATTACHMENT);
+	this->_renderGraph->write(earlyMainPass, this->_depthResource, VulkanGraphAccess::DEPTH_ATTACHMENT);
+	this->_renderGraph->read(earlyMainPass, earlyDraws, VulkanGraphAccess::INDIRECT_READ);
+	this->_renderGraph->read(earlyMainPass, earlyDrawCount, VulkanGraphAccess::INDIRECT_READ);
+
+	VulkanRenderGraph::Pass pyramidPass = this->_renderGraph->addPass("depth pyramid", [this](VkCommandBuffer cb, VulkanRenderGraph& graph) {
+		this->_depthPyramid->recordBuild(cb);
+	});
+	this->_renderGraph->read(pyramidPass, this->_depthResource, VulkanGraphAccess::SAMPLED_COMPUTE);
+	this->_renderGraph->write(pyramidPass, this->_depthPyramidResource, VulkanGraphAccess::STORAGE_WRITE);
+
+	// The late cull waits on this frame's depth, so there is nothing to overlap it with.
+	VulkanRenderGraph::Pass lateCullPass = this->_renderGraph->addPass("gpu cull late", [this](VkCommandBuffer cb, VulkanRenderGraph& graph) {
+		this->_gpuCuller->recordCull(cb, VulkanGpuCullPhase::LATE);
+	});
+	this->_renderGraph->read(lateCullPass, this->_depthPyramidResource, VulkanGraphAccess::STORAGE_READ);
+	this->_renderGraph->read(lateCullPass, visibility, VulkanGraphAccess::STORAGE_READ);
+	this->_renderGraph->write(lateCullPass, visibility, VulkanGraphAccess::STORAGE_WRITE);
+	this->_renderGraph->write(lateCullPass, lateDraws, VulkanGraphAccess::STORAGE_WRITE);
+	this->_renderGraph->write(lateCullPass, lateDrawCount, VulkanGraphAccess::TRANSFER_DST);
+	this->_renderGraph->write(lateCullPass, lateDrawCount, VulkanGraphAccess::STORAGE_WRITE);
+	this->_renderGraph->write(lateCullPass, this->_gpuCullStatsResource, VulkanGraphAccess::STORAGE_WRITE);
+
+	VulkanRenderGraph::Pass lateMainPass = this->_renderGraph->addPass("main late", [this](VkCommandBuffer cb, VulkanRenderGraph& graph) {
+		this->_recordMainPass(cb, graph, VulkanGpuCullPhase::LATE);
+	});
+	this->_renderGraph->write(lateMainPass, this->_swapchainResource, VulkanGraphAccess::COLOR_ATTACHMENT);
+	this->_renderGraph->write(lateMainPass, this->_depthResource, VulkanGraphAccess::DEPTH_ATTACHMENT);
+	this->_renderGraph->read(lateMainPass, lateDraws, VulkanGraphAccess::INDIRECT_READ);
+	this->_renderGraph->read(lateMainPass, lateDrawCount, VulkanGraphAccess::INDIRECT_READ);
+
+	this->_renderGraph->compile();
 }
 
-void VulkanRenderer::_createCommandBuffer() {
-	this->_commandBuffer = new VulkanCommandBuffer(
-		this->_mainDevice.logicalDevice, this->_swapchainImages, this->_graphicsCommandPool);
+void VulkanRenderer::_recordMainPass(VkCommandBuffer commandBuffer, VulkanRenderGraph& graph, VulkanGpuCullPhase phase) {
+	// The early pass clears and draws last frame's visible set; the late pass adds to the same targets.
+	bool early = phase == VulkanGpuCullPhase::EARLY;
+
+	VkRenderingAttachmentInfo colorAttachment = {};
+	colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+	colorAttachment.imageView = graph.getImageView(this->_swapchainResource);
+	colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+	colorAttachment.loadOp = early ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+	colorAttachment.clearValue = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+	VkRenderingAttachmentInfo depthAttachment = {};
+	depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+	depthAttachment.imageView = graph.getImageView(this->_depthResource);
+	depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	depthAttachment.loadOp = early ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD;
+	depthAttachment.storeOp = early ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+	depthAttachment.clearValue.depthStencil = { 1.0f, 0 };
+
+	VkRenderingInfo renderingInfo = {};
+	renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+	renderingInfo.renderArea.offset = { 0, 0 };
+	renderingInfo.renderArea.extent = this->_swapchainExtent;
+	renderingInfo.layerCount = 1;
+	renderingInfo.colorAttachmentCount = 1;
+	renderingInfo.pColorAttachments = &colorAttachment;
+	renderingInfo.pDepthAttachment = &depthAttachment;
+
+	VkViewport viewport = {};
+	viewport.width = static_cast<float>(this->_swapchainExtent.width);
+	viewport.height = static_cast<float>(this->_swapchainExtent.height);
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+
+	VkRect2D scissor = {};
+	scissor.offset = { 0, 0 };
+	scissor.extent = this->_swapchainExtent;
+
+	// The GPU-culled scene is one indirect-count draw per phase in the dynamic list, which is sorted by
+	// state so the recorder can skip repeated binds. An indirect draw has no single depth and goes in at 0.
+	this->_drawList->clear();
+	if (this->_gpuScene->getInstanceCount() > 0 && this->_gpuScene->getPipeline() != VK_NULL_HANDLE) {
+		VulkanDrawCommand cullDraw = this->_gpuCuller->getDrawCommand(phase);
+		cullDraw.uniformOffset = this->_frameUniformOffset;
+		this->_drawList->add(cullDraw, VulkanDrawPass::OPAQUE_GEOMETRY, 0.0f);
+	}
+
+	// CPU-placed repeated meshes are drawn once per frame, merged into instanced draws, in the early
+	// pass so they occlude the late one.
+	if (early) {
+		this->_instanceBatcher->build(this->_drawList, VulkanDrawPass::OPAQUE_GEOMETRY, this->_frameUniformOffset);
+	}
+	this->_drawList->sort();
+
+	// Static draws replay cached secondaries in the early pass, so they occlude too; only the dynamic
+	// list is recorded from scratch.
+	VkFormat colorFormatArray[] = { this->_swapchainImageFormat };
+	QSpan<const VkFormat> colorFormats(colorFormatArray, 1);
+	VkFormat depthFormat = this->_depthPyramid->getDepthFormat();
+	QSpan<const VkCommandBuffer> cachedBatches;
+	if (early) {
+		cachedBatches = this->_commandCache->update(
+			colorFormats, depthFormat, viewport, scissor,
+			QSpan<const VulkanDrawCommand>(this->_staticDrawCommands.data(), this->_staticDrawCommands.size()));
+	}
+
+	this->_parallelRecorder->record(
+		commandBuffer, renderingInfo, colorFormats, depthFormat, viewport, scissor,
+		this->_drawList->getDraws(), cachedBatches);
 }
 
 bool VulkanRenderer::_checkInstanceExtensionsSupport(std::vector<const char*>* checkExtensions) {
@@ -360,7 +848,38 @@ bool VulkanRenderer::_checkDeviceSuitable(VkPhysicalDevice device) {
 	SwapchainDetails scDetails = this->_getSwapchainDetails(device);
 	bool swapchainValid = !scDetails.presentationModes.empty() && !scDetails.formats.empty();
 
-	return indices.isValid() && extensionsSupported && swapchainValid;
+	return indices.isValid() && extensionsSupported && swapchainValid && this->_checkDeviceFeaturesSupport(device);
+}
+
+bool VulkanRenderer::_checkDeviceFeaturesSupport(VkPhysicalDevice device) {
+	VkPhysicalDeviceVulkan13Features vulkan13Features = {};
+	vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+
+	VkPhysicalDeviceVulkan12Features vulkan12Features = {};
+	vulkan12Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+	vulkan12Features.pNext = &vulkan13Features;
+
+	VkPhysicalDeviceFeatures2 deviceFeatures = {};
+	deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+	deviceFeatures.pNext = &vulkan12Features;
+
+	vkGetPhysicalDeviceFeatures2(device, &deviceFeatures);
+
+	return vulkan12Features.timelineSemaphore == VK_TRUE &&
+		vulkan12Features.hostQueryReset == VK_TRUE &&
+		vulkan12Features.drawIndirectCount == VK_TRUE &&
+		vulkan12Features.descriptorIndexing == VK_TRUE &&
+		vulkan12Features.runtimeDescriptorArray == VK_TRUE &&
+		vulkan12Features.descriptorBindingPartiallyBound == VK_TRUE &&
+		vulkan12Features.descriptorBindingUpdateUnusedWhilePending == VK_TRUE &&
+		vulkan12Features.descriptorBindingSampledImageUpdateAfterBind == VK_TRUE &&
+		vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind == VK_TRUE &&
+		vulkan12Features.shaderSampledImageArrayNonUniformIndexing == VK_TRUE &&
+		vulkan12Features.shaderStorageBufferArrayNonUniformIndexing == VK_TRUE &&
+		vulkan13Features.synchronization2 == VK_TRUE &&
+		vulkan13Features.dynamicRendering == VK_TRUE &&
+		deviceFeatures.features.multiDrawIndirect == VK_TRUE &&
+		deviceFeatures.features.drawIndirectFirstInstance == VK_TRUE;
 }
 
 int VulkanRenderer::_rateDeviceSuitability(VkPhysicalDevice device) {
@@ -467,49 +986,49 @@ QueueFamilyIndicies VulkanRenderer::_getQueueFamilies(VkPhysicalDevice device) {
 		i++;
 	}
 
-	return indicies;
-}
+	i = 0;
+	for (VkQueueFamilyProperties& queueFamily : queueFamilyList) {
+		bool transferOnly = (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT) &&
+			!(queueFamily.queueFlags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT));
 
-void VulkanRenderer::_recordCommands() {
-	VkCommandBufferBeginInfo bufferBeginInfo = {};
-	bufferBeginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	bufferBeginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-	
-	VkRenderPassBeginInfo renderPassBeginInfo = {};
-	renderPassBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-	renderPassBeginInfo.renderArea.offset = { 0, 0 };
-	renderPassBeginInfo.renderArea.extent = this->_swapchainExtent;
-	VkClearValue clearValue[] = {
-		{0.0f, 0.0f, 0.0f, 1.0f}
-	};
-	renderPassBeginInfo.pClearValues = clearValue;
-	renderPassBeginInfo.renderPass = this->_graphicsPipeline->getRenderPass();
-	renderPassBeginInfo.clearValueCount = 1;
+		if (queueFamily.queueCount > 0 && transferOnly) {
+			indicies.transferFamily = i;
+			break;
+		}
 
-	for (size_t i = 0; i < this->_commandBuffer->getCommandBuffers().size(); i++) {
-		VkCommandBuffer cb = this->_commandBuffer->getCommandBuffers()[i];
+		i++;
+	}
 
-		renderPassBeginInfo.framebuffer = this->_framebuffer->getSwapchainFramebuffers()[i];
+	if (indicies.transferFamily < 0) {
+		indicies.transferFamily = indicies.graphicsFamily;
+	}
+
+	i = 0;
+	for (VkQueueFamilyProperties& queueFamily : queueFamilyList) {
+		bool computeOnly = (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) && !(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT);
 
-		VkResult result = vkBeginCommandBuffer(cb, &bufferBeginInfo);
-		if (result != VK_SUCCESS) {
-			ThrowErr::runtime("Failed to start recording a command buffer!..");
+		if (queueFamily.queueCount > 0 && computeOnly) {
+			indicies.computeFamily = i;
+			break;
 		}
 
-		vkCmdBeginRenderPass(cb, &renderPassBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-		vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, this->_graphicsPipeline->getPipeline());
-		vkCmdDraw(cb, 3, 1, 0, 0);
-		vkCmdEndRenderPass(cb);
+		i++;
+	}
 
-		result = vkEndCommandBuffer(cb);
-		if (result != VK_SUCCESS) {
-			ThrowErr::runtime("Failed to stop recording a command buffer!..");
-		}
+	if (indicies.computeFamily < 0) {
+		indicies.computeFamily = indicies.graphicsFamily;
 	}
+
+	return indicies;
 }
 
-void VulkanRenderer::_createGraphicsCommandPool() {
-	this->_graphicsCommandPool = new VulkanGraphicsCommandPool(this->_mainDevice.logicalDevice, this->_getQueueFamilies(this->_mainDevice.physicalDevice));
+void VulkanRenderer::_submitCommands(uint32_t imageIndex, const VulkanGraphFrameSubmit& frame) {
+	this->_renderGraph->updateImport(
+		this->_swapchainResource, this->_swapchainImages[imageIndex].image, this->_swapchainImages[imageIndex].imageView);
+	this->_renderGraph->updateImport(this->_gpuCullStatsResource, this->_gpuCuller->getStatsBuffer());
+
+	// Graph batches go to their queues in order; the last graphics batch signals the frame.
+	this->_graphSubmitter->submit(this->_renderGraph, frame);
 }
 
 std::vector<const char*> VulkanRenderer::_getRequiredExtensions() {
@@ -574,30 +1093,7 @@ VkImageView VulkanRenderer::_createImageView(VkImage image, VkFormat format, VkI
 }
 
 void VulkanRenderer::_createSynchronization() {
-	this->_imagesAvailable.resize(MAX_FRAME_DRAWS);
-	this->_rendersFinished.resize(MAX_FRAME_DRAWS);
-	this->_drawFences.resize(MAX_FRAME_DRAWS);
-
-	VkSemaphoreCreateInfo semaphoreCreateInfo = {};
-	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-
-	VkFenceCreateInfo fenceCreateInfo = {};
-	fenceCreateInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-	fenceCreateInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
-	for (size_t i = 0; i < MAX_FRAME_DRAWS; i++) {
-		if (vkCreateSemaphore(this->_mainDevice.logicalDevice, &semaphoreCreateInfo, nullptr, &this->_imagesAvailable[i]) != VK_SUCCESS) {
-			ThrowErr::runtime("Failed to create a image available semaphore!..");
-		}
-
-		if (vkCreateSemaphore(this->_mainDevice.logicalDevice, &semaphoreCreateInfo, nullptr, &this->_rendersFinished[i]) != VK_SUCCESS) {
-			ThrowErr::runtime("Failed to create a render semaphore!..");
-		}
-
-		if (vkCreateFence(this->_mainDevice.logicalDevice, &fenceCreateInfo, nullptr, &this->_drawFences[i]) != VK_SUCCESS) {
-			ThrowErr::runtime("Failed to create a draw fence!..");
-		}
-	}
+	this->_frameSync = new VulkanFrameSync(this->_mainDevice.logicalDevice, this->_framesInFlight);
 }
 
 VkSurfaceFormatKHR VulkanRenderer::_chooseSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& formats) {
@@ -3,35 +3,94 @@
 #include "VulkanValidation.h"
 #include "VulkanUtilities.h"
 #include "VulkanGraphicsPipeline.h"
-#include "VulkanFrameBuffer.h"
-#include "VulkanCommandBuffer.h"
-#include "VulkanGraphicsCommandPool.h"
+#include "VulkanCommandPoolManager.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanMemoryDefragmenter.h"
+#include "VulkanUploadQueue.h"
+#include "VulkanUniformAllocator.h"
+#include "VulkanBindlessDescriptors.h"
+#include "VulkanDescriptorAllocator.h"
+#include "VulkanRenderGraph.h"
+#include "VulkanFrameSync.h"
+#include "VulkanDeletionQueue.h"
+#include "VulkanParallelRecorder.h"
+#include "VulkanCommandCache.h"
+#include "VulkanDrawList.h"
+#include "VulkanInstanceBatcher.h"
+#include "VulkanGpuScene.h"
+#include "VulkanGpuCuller.h"
+#include "VulkanDepthPyramid.h"
+#include "VulkanQueueProfiler.h"
+#include "VulkanGraphSubmitter.h"
+#include "QArenaContainers.h"
+#include "QAllocTracker.h"
 
 class VulkanRenderer {
 public:
-	VulkanRenderer(GLFWwindow* newWindow);
+	VulkanRenderer(GLFWwindow* newWindow, uint32_t framesInFlight = DEFAULT_FRAMES_IN_FLIGHT);
 	~VulkanRenderer();
 	void draw();
+	void setViewProjection(const float viewProjection[16]);
+
+	// Repeated meshes placed from the CPU. Instances added before draw() are batched into that frame.
+	uint32_t addInstancedMesh(const VulkanInstancedMesh& mesh);
+	uint32_t addInstancedMeshes(const QMeshDeduplicator& meshes, VkPipeline pipeline);
+	void addInstance(const VulkanBatchInstance& instance);
+
 	int getInitResult();
+	VulkanQueueStats getQueueStats();
+	VulkanGpuCullStats getCullStats();
+	VulkanRecordStats getRecordStats();
+	VulkanDrawListStats getDrawListStats();
+	VulkanInstanceBatcherStats getInstanceBatcherStats();
 
 private:
-	int _currentFrame = 0;
+	uint32_t _currentFrame = 0;
+	uint32_t _framesInFlight;
 
 	GLFWwindow* _window = nullptr;
 	VkInstance _instance = nullptr;
 	VkQueue _graphicsQueue = nullptr;
+	uint32_t _graphicsQueueFamily = 0;
 	VkQueue _presentationQueue = nullptr;
+	VkQueue _transferQueue = nullptr;
+	VkQueue _computeQueue = nullptr;
+	uint32_t _computeQueueFamily = 0;
 	VkSurfaceKHR _surface = nullptr;
 	VkDebugUtilsMessengerEXT _debugMessenger = nullptr;
 	VkSwapchainKHR _swapchain = nullptr;
 	VkFormat _swapchainImageFormat;
 	VkExtent2D _swapchainExtent;
 	VulkanGraphicsPipeline* _graphicsPipeline = nullptr;
-	VulkanFrameBuffer* _framebuffer = nullptr;
-	VulkanGraphicsCommandPool* _graphicsCommandPool = nullptr;
-	VulkanCommandBuffer* _commandBuffer = nullptr;
+	VulkanCommandPoolManager* _commandPoolManager = nullptr;
+	VulkanMemoryAllocator* _memoryAllocator = nullptr;
+	VulkanMemoryDefragmenter* _memoryDefragmenter = nullptr;
+	VulkanUploadQueue* _uploadQueue = nullptr;
+	VulkanUniformAllocator* _uniformAllocator = nullptr;
+	VulkanBindlessDescriptors* _bindlessDescriptors = nullptr;
+	VulkanDescriptorAllocator* _descriptorAllocator = nullptr;
+	QFrameArena* _frameArena = nullptr;
+	VulkanRenderGraph* _renderGraph = nullptr;
+	VulkanRenderGraph::Resource _swapchainResource = VulkanRenderGraph::INVALID;
+	VulkanRenderGraph::Resource _depthResource = VulkanRenderGraph::INVALID;
+	VulkanRenderGraph::Resource _depthPyramidResource = VulkanRenderGraph::INVALID;
+	VulkanRenderGraph::Resource _gpuCullStatsResource = VulkanRenderGraph::INVALID;
+	QJobSystem* _jobSystem = nullptr;
+	VulkanParallelRecorder* _parallelRecorder = nullptr;
+	VulkanCommandCache* _commandCache = nullptr;
+	VulkanDrawList* _drawList = nullptr;
+	VulkanInstanceBatcher* _instanceBatcher = nullptr;
+	VulkanGpuScene* _gpuScene = nullptr;
+	VulkanGpuCuller* _gpuCuller = nullptr;
+	VulkanDepthPyramid* _depthPyramid = nullptr;
+	VulkanQueueProfiler* _queueProfiler = nullptr;
+	VulkanGraphSubmitter* _graphSubmitter = nullptr;
+	std::vector<VulkanDrawCommand> _staticDrawCommands;
+	float _viewProjection[16] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+	uint32_t _frameUniformOffset = 0;
 
 	std::vector<SwapchainImage> _swapchainImages;
+	bool _swapchainOutOfDate = false;
 
 #ifdef NDEBUG
 	const bool _enableValidationLayers = false;
@@ -46,27 +105,48 @@ private:
 		VkDevice logicalDevice = nullptr;
 	} _mainDevice;
 
-	std::vector<VkSemaphore> _imagesAvailable;
-	std::vector<VkSemaphore> _rendersFinished;
-	std::vector<VkFence> _drawFences;
+	VulkanFrameSync* _frameSync = nullptr;
+	VulkanDeletionQueue* _deletionQueue = nullptr;
 
 	void _getPhysicalDevice();
 	void _createInstance();
 	void _setupDebugMessenger();
 	void _populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo);
 	void _createLogicalDevice();
+	void _createMemoryAllocator();
+	void _createDeletionQueue();
+	void _createMemoryDefragmenter();
+	void _createUploadQueue();
+	void _createDescriptorAllocator();
+	void _createUniformAllocator();
+	void _createBindlessDescriptors();
+	void _createFrameArena();
+	void _createJobSystem();
+	void _createCommandPoolManager();
+	void _createParallelRecorder();
+	void _createCommandCache();
+	void _createDrawList();
+	void _createInstanceBatcher();
+	void _createGpuScene();
+	void _createGpuCuller();
+	void _createQueueProfiler();
+	void _createGraphSubmitter();
 	void _createSurface();
 	void _createSwapchain();
+	void _createDepthPyramid();
 	void _createGraphicsPipeline();
-	void _createFramebuffers();
-	void _createGraphicsCommandPool();
-	void _createCommandBuffer();
+	void _createRenderGraph();
 	void _createSynchronization();
 
-	void _recordCommands();
+	void _recordMainPass(VkCommandBuffer commandBuffer, VulkanRenderGraph& graph, VulkanGpuCullPhase phase);
+	void _submitCommands(uint32_t imageIndex, const VulkanGraphFrameSubmit& frame);
+	bool _recreateSwapchain();
+
+	static void _onFramebufferResize(GLFWwindow* window, int width, int height);
 
 	bool _checkInstanceExtensionsSupport(std::vector<const char*>* checkExtensions);
 	bool _checkDeviceSuitable(VkPhysicalDevice device);
+	bool _checkDeviceFeaturesSupport(VkPhysicalDevice device);
 	int _rateDeviceSuitability(VkPhysicalDevice device);
 	bool _checkValidationLayerSupport();
 	bool _checkDeviceExtensionSupport(VkPhysicalDevice device);
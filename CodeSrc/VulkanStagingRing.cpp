@@ -0,0 +1,100 @@
+#include "VulkanStagingRing.h"
+
+VulkanStagingRing::VulkanStagingRing(VulkanMemoryAllocator* allocator, VkDeviceSize size) : _allocator{ allocator }, _size{ size } {
+	this->_allocation = this->_allocator->createBuffer(
+		size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VulkanMemoryUsage::CPU_TO_GPU, &this->_buffer);
+
+	this->_mapped = static_cast<char*>(this->_allocation->mapped);
+	if (this->_mapped == nullptr) {
+		ThrowErr::runtime("Staging ring memory is not host visible!..");
+	}
+}
+
+VulkanStagingRing::~VulkanStagingRing() {
+	this->_allocator->destroyBuffer(this->_buffer, this->_allocation);
+}
+
+bool VulkanStagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* outOffset, void** outMapped) {
+	if (size > this->_size) {
+		return false;
+	}
+
+	if (this->_usedBytes == 0) {
+		this->_head = 0;
+		this->_tail = 0;
+	}
+	else if (this->_head == this->_tail) {
+		return false;
+	}
+
+	VkDeviceSize offset = (this->_head + alignment - 1) / alignment * alignment;
+	VkDeviceSize consumed = 0;
+
+	if (this->_head >= this->_tail) {
+		if (offset + size <= this->_size) {
+			consumed = offset + size - this->_head;
+		}
+		else if (size <= this->_tail) {
+			// Not enough room before the end, the rest of the buffer is skipped until the tail wraps too.
+			consumed = this->_size - this->_head + size;
+			offset = 0;
+		}
+		else {
+			return false;
+		}
+	}
+	else {
+		if (offset + size > this->_tail) {
+			return false;
+		}
+
+		consumed = offset + size - this->_head;
+	}
+
+	this->_head = offset + size;
+	this->_usedBytes += consumed;
+	this->_unsubmittedBytes += consumed;
+
+	*outOffset = offset;
+	*outMapped = this->_mapped + offset;
+
+	return true;
+}
+
+void VulkanStagingRing::markSubmitted(uint64_t timelineValue) {
+	if (this->_unsubmittedBytes == 0) {
+		return;
+	}
+
+	Segment segment;
+	segment.end = this->_head;
+	segment.bytes = this->_unsubmittedBytes;
+	segment.timelineValue = timelineValue;
+	this->_segments.push_back(segment);
+
+	this->_unsubmittedBytes = 0;
+}
+
+void VulkanStagingRing::retire(uint64_t completedValue) {
+	while (!this->_segments.empty() && this->_segments.front().timelineValue <= completedValue) {
+		this->_tail = this->_segments.front().end;
+		this->_usedBytes -= this->_segments.front().bytes;
+		this->_segments.pop_front();
+	}
+}
+
+uint64_t VulkanStagingRing::getOldestPendingValue() {
+	return this->_segments.empty() ? 0 : this->_segments.front().timelineValue;
+}
+
+VkBuffer VulkanStagingRing::getBuffer() {
+	return this->_buffer;
+}
+
+VkDeviceSize VulkanStagingRing::getSize() {
+	return this->_size;
+}
+
+VkDeviceSize VulkanStagingRing::getUsedBytes() {
+	return this->_usedBytes;
+}
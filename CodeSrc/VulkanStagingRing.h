@@ -0,0 +1,41 @@
+#pragma once
+#include <deque>
+#include "QEngine.h"
+#include "VulkanMemoryAllocator.h"
+
+const VkDeviceSize STAGING_RING_SIZE = 64ull * 1024 * 1024;
+
+// Persistently mapped upload buffer consumed front to back. Every range is tagged with the
+// timeline value of the batch that reads it and becomes reusable once that value is reached.
+class VulkanStagingRing {
+public:
+	VulkanStagingRing(VulkanMemoryAllocator* allocator, VkDeviceSize size = STAGING_RING_SIZE);
+	~VulkanStagingRing();
+
+	bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* outOffset, void** outMapped);
+	void markSubmitted(uint64_t timelineValue);
+	void retire(uint64_t completedValue);
+	uint64_t getOldestPendingValue();
+
+	VkBuffer getBuffer();
+	VkDeviceSize getSize();
+	VkDeviceSize getUsedBytes();
+private:
+	struct Segment {
+		VkDeviceSize end;
+		VkDeviceSize bytes;
+		uint64_t timelineValue;
+	};
+
+	VulkanMemoryAllocator* _allocator;
+	VkBuffer _buffer = VK_NULL_HANDLE;
+	VulkanAllocation* _allocation = nullptr;
+	char* _mapped = nullptr;
+
+	VkDeviceSize _size;
+	VkDeviceSize _head = 0;
+	VkDeviceSize _tail = 0;
+	VkDeviceSize _usedBytes = 0;
+	VkDeviceSize _unsubmittedBytes = 0;
+	std::deque<Segment> _segments;
+};
@@ -0,0 +1,148 @@
+#include "VulkanStaticGeometry.h"
+#include "QAllocTracker.h"
+
+VulkanStaticGeometry::VulkanStaticGeometry(VulkanMemoryAllocator* allocator, VulkanUploadQueue* uploadQueue, QGeometryMerger& merger) :
+	_allocator{ allocator }, _uploadQueue{ uploadQueue } {
+	QAllocScope allocScope(QAllocTag::LOADING);
+	merger.merge();
+	if (merger.getSubmeshCount() == 0) {
+		ThrowErr::runtime("Failed to create static geometry: there are no submeshes!..");
+	}
+
+	const std::vector<uint32_t>& mergedOrder = merger.getMergedOrder();
+	this->_materials = merger.getMaterials();
+
+	// Commands and culling records in merged order, so each material's commands are one contiguous run.
+	std::vector<VkDrawIndexedIndirectCommand> commands(mergedOrder.size());
+	this->_submeshes.resize(mergedOrder.size());
+	for (uint32_t position = 0; position < mergedOrder.size(); position++) {
+		const QMergedSubmesh& merged = merger.getSubmesh(mergedOrder[position]);
+
+		VkDrawIndexedIndirectCommand& command = commands[position];
+		command.indexCount = merged.indexCount;
+		command.instanceCount = 1;
+		command.firstIndex = merged.firstIndex;
+		command.vertexOffset = merged.vertexOffset;
+		command.firstInstance = position;
+
+		VulkanGpuSubmesh& submesh = this->_submeshes[position];
+		memcpy(submesh.boundsCenter, merged.boundsCenter, sizeof(submesh.boundsCenter));
+		submesh.boundsRadius = merged.boundsRadius;
+		submesh.indexCount = merged.indexCount;
+		submesh.firstIndex = merged.firstIndex;
+		submesh.vertexOffset = merged.vertexOffset;
+		submesh.materialIndex = merged.materialIndex;
+	}
+
+	std::vector<uint32_t> counts(this->_materials.size());
+	for (uint32_t i = 0; i < this->_materials.size(); i++) {
+		counts[i] = this->_materials[i].submeshCount;
+	}
+
+	const std::vector<uint8_t>& vertexData = merger.getVertexData();
+	const std::vector<uint32_t>& indexData = merger.getIndexData();
+	VkDeviceSize indexSize = sizeof(uint32_t) * indexData.size();
+	VkDeviceSize commandSize = sizeof(VkDrawIndexedIndirectCommand) * commands.size();
+	VkDeviceSize countSize = sizeof(uint32_t) * counts.size();
+
+	this->_vertexAllocation = this->_createBuffer(
+		vertexData.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, &this->_vertexBuffer);
+	this->_indexAllocation = this->_createBuffer(
+		indexSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, &this->_indexBuffer);
+	this->_indirectAllocation = this->_createBuffer(
+		commandSize, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, &this->_indirectBuffer);
+	this->_countAllocation = this->_createBuffer(
+		countSize, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, &this->_countBuffer);
+
+	this->_upload(this->_vertexBuffer, vertexData.data(), vertexData.size());
+	this->_upload(this->_indexBuffer, indexData.data(), indexSize);
+	this->_upload(this->_indirectBuffer, commands.data(), commandSize);
+	this->_upload(this->_countBuffer, counts.data(), countSize);
+	this->_uploadQueue->submit();
+}
+
+VulkanStaticGeometry::~VulkanStaticGeometry() {
+	this->_allocator->destroyBuffer(this->_countBuffer, this->_countAllocation);
+	this->_allocator->destroyBuffer(this->_indirectBuffer, this->_indirectAllocation);
+	this->_allocator->destroyBuffer(this->_indexBuffer, this->_indexAllocation);
+	this->_allocator->destroyBuffer(this->_vertexBuffer, this->_vertexAllocation);
+}
+
+void VulkanStaticGeometry::addDraws(VulkanDrawList* drawList, VkPipeline pipeline, VulkanDrawPass pass, uint32_t uniformOffset) {
+	// One multi-draw per material; the whole set shares a depth, since it has no single position.
+	for (uint32_t i = 0; i < this->_materials.size(); i++) {
+		const QMergedMaterial& material = this->_materials[i];
+
+		VulkanDrawCommand draw = {};
+		draw.pipeline = pipeline;
+		draw.vertexBuffer = this->_vertexBuffer;
+		draw.indexBuffer = this->_indexBuffer;
+		draw.materialIndex = material.materialIndex;
+		draw.indirectBuffer = this->_indirectBuffer;
+		draw.indirectOffset = sizeof(VkDrawIndexedIndirectCommand) * material.firstSubmesh;
+		draw.countBuffer = this->_countBuffer;
+		draw.countOffset = sizeof(uint32_t) * i;
+		draw.maxDrawCount = material.submeshCount;
+		draw.uniformOffset = uniformOffset;
+		drawList->add(draw, pass, 0.0f);
+	}
+}
+
+void VulkanStaticGeometry::addToScene(VulkanGpuScene* scene, VkPipeline pipeline) {
+	// Static geometry is already in world space: one identity instance per submesh.
+	scene->setGeometry(pipeline, this->_vertexBuffer, this->_indexBuffer);
+
+	for (const VulkanGpuSubmesh& submesh : this->_submeshes) {
+		VulkanGpuInstance instance;
+		instance.submeshIndex = scene->addSubmesh(submesh);
+		scene->addInstance(instance);
+	}
+}
+
+bool VulkanStaticGeometry::isReady() {
+	return this->_uploadQueue->isReady(this->_uploadTicket);
+}
+
+VkBuffer VulkanStaticGeometry::getVertexBuffer() {
+	return this->_vertexBuffer;
+}
+
+VkBuffer VulkanStaticGeometry::getIndexBuffer() {
+	return this->_indexBuffer;
+}
+
+VkBuffer VulkanStaticGeometry::getIndirectBuffer() {
+	return this->_indirectBuffer;
+}
+
+VkBuffer VulkanStaticGeometry::getCountBuffer() {
+	return this->_countBuffer;
+}
+
+uint32_t VulkanStaticGeometry::getSubmeshCount() {
+	return static_cast<uint32_t>(this->_submeshes.size());
+}
+
+uint32_t VulkanStaticGeometry::getMaterialCount() {
+	return static_cast<uint32_t>(this->_materials.size());
+}
+
+VulkanAllocation* VulkanStaticGeometry::_createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer* outBuffer) {
+	// The handles are baked into draw commands and the GPU scene, so the defragmenter must never move them.
+	VkBufferCreateInfo bufferCreateInfo = {};
+	bufferCreateInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+	bufferCreateInfo.size = size;
+	bufferCreateInfo.usage = usage;
+	bufferCreateInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	return this->_allocator->createBuffer(bufferCreateInfo, VulkanMemoryUsage::GPU_ONLY, outBuffer);
+}
+
+void VulkanStaticGeometry::_upload(VkBuffer buffer, const void* data, VkDeviceSize size) {
+	// Chunks keep any one copy well inside the staging ring, however large the merged set is.
+	const char* bytes = static_cast<const char*>(data);
+	for (VkDeviceSize offset = 0; offset < size; offset += STATIC_GEOMETRY_UPLOAD_CHUNK) {
+		VkDeviceSize chunkSize = std::min(STATIC_GEOMETRY_UPLOAD_CHUNK, size - offset);
+		this->_uploadTicket = this->_uploadQueue->uploadBuffer(buffer, offset, bytes + offset, chunkSize);
+	}
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "QEngine.h"
+#include "VulkanUtilities.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanUploadQueue.h"
+#include "VulkanDrawList.h"
+#include "VulkanGpuScene.h"
+#include "QGeometryMerger.h"
+
+const VkDeviceSize STATIC_GEOMETRY_UPLOAD_CHUNK = 8ull * 1024 * 1024;
+
+// Merged static geometry on the GPU: one device-local vertex buffer and one index buffer for every
+// submesh, plus an indirect command per submesh laid out material by material, and a count buffer with
+// each material's command count. Drawing the whole set is then one multi-draw-indirect per material,
+// all against the same pair of buffers, so the recorder binds them once. Each command's firstInstance
+// is the submesh's position in the merged order, for shaders that look up per-submesh data.
+// The same buffers can feed VulkanGpuScene instead, which culls the submeshes one by one. Data goes up
+// through the upload queue in chunks; draws are only valid once isReady() returns true.
+class VulkanStaticGeometry {
+public:
+	VulkanStaticGeometry(VulkanMemoryAllocator* allocator, VulkanUploadQueue* uploadQueue, QGeometryMerger& merger);
+	~VulkanStaticGeometry();
+
+	void addDraws(VulkanDrawList* drawList, VkPipeline pipeline, VulkanDrawPass pass = VulkanDrawPass::OPAQUE_GEOMETRY, uint32_t uniformOffset = 0);
+	void addToScene(VulkanGpuScene* scene, VkPipeline pipeline);
+	bool isReady();
+
+	VkBuffer getVertexBuffer();
+	VkBuffer getIndexBuffer();
+	VkBuffer getIndirectBuffer();
+	VkBuffer getCountBuffer();
+	uint32_t getSubmeshCount();
+	uint32_t getMaterialCount();
+private:
+	VulkanMemoryAllocator* _allocator;
+	VulkanUploadQueue* _uploadQueue;
+	uint64_t _uploadTicket = 0;
+
+	VkBuffer _vertexBuffer = VK_NULL_HANDLE;
+	VulkanAllocation* _vertexAllocation = nullptr;
+	VkBuffer _indexBuffer = VK_NULL_HANDLE;
+	VulkanAllocation* _indexAllocation = nullptr;
+	VkBuffer _indirectBuffer = VK_NULL_HANDLE;
+	VulkanAllocation* _indirectAllocation = nullptr;
+	VkBuffer _countBuffer = VK_NULL_HANDLE;
+	VulkanAllocation* _countAllocation = nullptr;
+
+	std::vector<QMergedMaterial> _materials;
+	std::vector<VulkanGpuSubmesh> _submeshes;
+
+	VulkanAllocation* _createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkBuffer* outBuffer);
+	void _upload(VkBuffer buffer, const void* data, VkDeviceSize size);
+};
@@ -0,0 +1,92 @@
+#include "VulkanUniformAllocator.h"
+
+VulkanUniformAllocator::VulkanUniformAllocator(
+	VkPhysicalDevice physicalDevice, VkDevice logicalDevice, VulkanMemoryAllocator* allocator,
+	VulkanDescriptorAllocator* descriptorAllocator, uint32_t frameCount, VkDeviceSize regionSize) :
+	_logicalDevice{ logicalDevice }, _allocator{ allocator }, _head{ 0 } {
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+	this->_alignment = std::max<VkDeviceSize>(deviceProperties.limits.minUniformBufferOffsetAlignment, 1);
+	this->_bindingRange = std::min<VkDeviceSize>(UNIFORM_BINDING_RANGE, deviceProperties.limits.maxUniformBufferRange);
+	this->_regionSize = (regionSize + this->_alignment - 1) / this->_alignment * this->_alignment;
+
+	// The descriptor range is fixed, so the tail is padded for a dynamic offset near the end of the last region.
+	VkDeviceSize bufferSize = this->_regionSize * frameCount + this->_bindingRange;
+
+	this->_allocation = this->_allocator->createBuffer(
+		bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VulkanMemoryUsage::CPU_TO_GPU, &this->_buffer);
+
+	this->_mapped = static_cast<char*>(this->_allocation->mapped);
+	if (this->_mapped == nullptr) {
+		ThrowErr::runtime("Uniform buffer memory is not host visible!..");
+	}
+
+	this->_createDescriptorSet(descriptorAllocator);
+}
+
+VulkanUniformAllocator::~VulkanUniformAllocator() {
+	vkDestroyDescriptorSetLayout(this->_logicalDevice, this->_descriptorSetLayout, nullptr);
+
+	this->_allocator->destroyBuffer(this->_buffer, this->_allocation);
+}
+
+void VulkanUniformAllocator::beginFrame(uint32_t frameIndex) {
+	// Called once the frame that last used the slot has retired, so nothing on the GPU still reads this region.
+	this->_regionBase = this->_regionSize * frameIndex;
+	this->_head.store(0, std::memory_order_relaxed);
+}
+
+void* VulkanUniformAllocator::allocate(VkDeviceSize size, uint32_t* outDynamicOffset) {
+	VkDeviceSize alignedSize = (size + this->_alignment - 1) / this->_alignment * this->_alignment;
+	VkDeviceSize offset = this->_head.fetch_add(alignedSize, std::memory_order_relaxed);
+
+	if (offset + alignedSize > this->_regionSize || size > this->_bindingRange) {
+		ThrowErr::runtime("Per-frame uniform region is full!..");
+	}
+
+	*outDynamicOffset = static_cast<uint32_t>(this->_regionBase + offset);
+
+	return this->_mapped + this->_regionBase + offset;
+}
+
+void VulkanUniformAllocator::bind(
+	VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t dynamicOffset) {
+	vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, UNIFORM_DESCRIPTOR_SET, 1, &this->_descriptorSet, 1, &dynamicOffset);
+}
+
+VkDescriptorSetLayout VulkanUniformAllocator::getDescriptorSetLayout() {
+	return this->_descriptorSetLayout;
+}
+
+VkDescriptorSet VulkanUniformAllocator::getDescriptorSet() {
+	return this->_descriptorSet;
+}
+
+VkDeviceSize VulkanUniformAllocator::getUsedBytes() {
+	return this->_head.load(std::memory_order_relaxed);
+}
+
+void VulkanUniformAllocator::_createDescriptorSet(VulkanDescriptorAllocator* descriptorAllocator) {
+	VkDescriptorSetLayoutBinding binding = {};
+	binding.binding = 0;
+	binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+	binding.descriptorCount = 1;
+	binding.stageFlags = VK_SHADER_STAGE_ALL_GRAPHICS | VK_SHADER_STAGE_COMPUTE_BIT;
+
+	VkDescriptorSetLayoutCreateInfo layoutCreateInfo = {};
+	layoutCreateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutCreateInfo.bindingCount = 1;
+	layoutCreateInfo.pBindings = &binding;
+
+	VkResult result = vkCreateDescriptorSetLayout(this->_logicalDevice, &layoutCreateInfo, nullptr, &this->_descriptorSetLayout);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to create a uniform descriptor set layout!..");
+	}
+
+	// A persistent set from the shared allocator; it lives as long as the allocator's persistent pools.
+	std::vector<VulkanDescriptorWrite> writes = {
+		VulkanDescriptorWrite::forBuffer(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, this->_buffer, 0, this->_bindingRange),
+	};
+	this->_descriptorSet = descriptorAllocator->getPersistent(this->_descriptorSetLayout, writes);
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <atomic>
+#include "QEngine.h"
+#include "VulkanUtilities.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanDescriptorAllocator.h"
+
+const VkDeviceSize UNIFORM_REGION_SIZE = 4ull * 1024 * 1024;
+const VkDeviceSize UNIFORM_BINDING_RANGE = 64ull * 1024;
+const uint32_t UNIFORM_DESCRIPTOR_SET = 1;
+
+// One persistently mapped uniform buffer split into one region per frame in flight. Constants are bump
+// allocated from the current frame's region and bound through a single dynamic-offset descriptor,
+// so per-draw cost is one atomic add and a memcpy with no descriptor writes. The shared bindless
+// pipeline layout carries the descriptor as set 1, which shaders read at the draw's offset:
+//   layout(set = 1, binding = 0) uniform Constants { ... };
+class VulkanUniformAllocator {
+public:
+	VulkanUniformAllocator(
+		VkPhysicalDevice physicalDevice, VkDevice logicalDevice, VulkanMemoryAllocator* allocator,
+		VulkanDescriptorAllocator* descriptorAllocator, uint32_t frameCount, VkDeviceSize regionSize = UNIFORM_REGION_SIZE);
+	~VulkanUniformAllocator();
+
+	void beginFrame(uint32_t frameIndex);
+	void* allocate(VkDeviceSize size, uint32_t* outDynamicOffset);
+
+	template <typename T>
+	T* allocate(uint32_t* outDynamicOffset) {
+		return static_cast<T*>(this->allocate(sizeof(T), outDynamicOffset));
+	}
+
+	template <typename T>
+	uint32_t push(const T& data) {
+		uint32_t dynamicOffset;
+		memcpy(this->allocate(sizeof(T), &dynamicOffset), &data, sizeof(T));
+		return dynamicOffset;
+	}
+
+	void bind(VkCommandBuffer commandBuffer, VkPipelineBindPoint bindPoint, VkPipelineLayout pipelineLayout, uint32_t dynamicOffset);
+
+	VkDescriptorSetLayout getDescriptorSetLayout();
+	VkDescriptorSet getDescriptorSet();
+	VkDeviceSize getUsedBytes();
+private:
+	VkDevice _logicalDevice;
+	VulkanMemoryAllocator* _allocator;
+
+	VkBuffer _buffer = VK_NULL_HANDLE;
+	VulkanAllocation* _allocation = nullptr;
+	char* _mapped = nullptr;
+
+	VkDeviceSize _regionSize;
+	VkDeviceSize _alignment;
+	VkDeviceSize _bindingRange;
+	VkDeviceSize _regionBase = 0;
+	std::atomic<VkDeviceSize> _head;
+
+	VkDescriptorSetLayout _descriptorSetLayout = VK_NULL_HANDLE;
+	VkDescriptorSet _descriptorSet = VK_NULL_HANDLE;
+
+	void _createDescriptorSet(VulkanDescriptorAllocator* descriptorAllocator);
+};
@@ -0,0 +1,412 @@
+#include "VulkanUploadQueue.h"
+#include "QAllocTracker.h"
+
+VulkanUploadQueue::VulkanUploadQueue(
+	VkDevice logicalDevice, VulkanMemoryAllocator* allocator, VkQueue transferQueue, QueueFamilyIndicies queueFamilyIndices,
+	VkDeviceSize stagingSize) : _logicalDevice{ logicalDevice }, _transferQueue{ transferQueue } {
+	this->_transferFamily = static_cast<uint32_t>(queueFamilyIndices.transferFamily);
+	this->_graphicsFamily = static_cast<uint32_t>(queueFamilyIndices.graphicsFamily);
+	this->_ownershipTransfer = this->_transferFamily != this->_graphicsFamily;
+
+	this->_stagingRing = new VulkanStagingRing(allocator, stagingSize);
+
+	this->_createCommandPools();
+	this->_createTimelineSemaphore();
+}
+
+VulkanUploadQueue::~VulkanUploadQueue() {
+	// Copies still being recorded are submitted rather than dropped, then everything in flight drains.
+	uint64_t lastValue = this->submit();
+	this->_waitValue(lastValue);
+
+	vkDestroySemaphore(this->_logicalDevice, this->_timelineSemaphore, nullptr);
+	vkDestroyCommandPool(this->_logicalDevice, this->_acquirePool, nullptr);
+	vkDestroyCommandPool(this->_logicalDevice, this->_transferPool, nullptr);
+
+	delete this->_stagingRing;
+}
+
+uint64_t VulkanUploadQueue::uploadBuffer(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size) {
+	QAllocScope allocScope(QAllocTag::UPLOAD);
+	std::lock_guard<std::mutex> lock(this->_mutex);
+
+	VkDeviceSize stagingOffset;
+	void* mapped = this->_allocateStaging(size, 16, &stagingOffset);
+	memcpy(mapped, data, static_cast<size_t>(size));
+
+	this->_beginBatch();
+
+	VkBufferCopy region = {};
+	region.srcOffset = stagingOffset;
+	region.dstOffset = offset;
+	region.size = size;
+	vkCmdCopyBuffer(this->_recording.commandBuffer, this->_stagingRing->getBuffer(), buffer, 1, &region);
+
+	if (this->_ownershipTransfer) {
+		VkBufferMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcQueueFamilyIndex = this->_transferFamily;
+		barrier.dstQueueFamilyIndex = this->_graphicsFamily;
+		barrier.buffer = buffer;
+		barrier.offset = offset;
+		barrier.size = size;
+
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = 0;
+		this->_bufferReleases.push_back(barrier);
+
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		this->_recording.bufferAcquires.push_back(barrier);
+	}
+
+	uint64_t ticket = this->_recording.timelineValue;
+
+	if (++this->_recordedCopies >= UPLOAD_BATCH_MAX_COPIES) {
+		this->_submitLocked();
+	}
+
+	return ticket;
+}
+
+uint64_t VulkanUploadQueue::uploadImage(
+	VkImage image, VkExtent3D extent, VkImageAspectFlags aspect, const void* data, VkDeviceSize size, VkImageLayout finalLayout) {
+	QAllocScope allocScope(QAllocTag::UPLOAD);
+	std::lock_guard<std::mutex> lock(this->_mutex);
+
+	VkDeviceSize stagingOffset;
+	void* mapped = this->_allocateStaging(size, 16, &stagingOffset);
+	memcpy(mapped, data, static_cast<size_t>(size));
+
+	this->_beginBatch();
+
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = image;
+	barrier.subresourceRange.aspectMask = aspect;
+	barrier.subresourceRange.baseMipLevel = 0;
+	barrier.subresourceRange.levelCount = 1;
+	barrier.subresourceRange.baseArrayLayer = 0;
+	barrier.subresourceRange.layerCount = 1;
+
+	vkCmdPipelineBarrier(
+		this->_recording.commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VkBufferImageCopy region = {};
+	region.bufferOffset = stagingOffset;
+	region.imageSubresource.aspectMask = aspect;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = 1;
+	region.imageExtent = extent;
+
+	vkCmdCopyBufferToImage(
+		this->_recording.commandBuffer, this->_stagingRing->getBuffer(), image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+	// The transition to the final layout doubles as the release half of the ownership transfer.
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = finalLayout;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = 0;
+
+	if (this->_ownershipTransfer) {
+		barrier.srcQueueFamilyIndex = this->_transferFamily;
+		barrier.dstQueueFamilyIndex = this->_graphicsFamily;
+		this->_imageReleases.push_back(barrier);
+
+		barrier.srcAccessMask = 0;
+		barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+		this->_recording.imageAcquires.push_back(barrier);
+	}
+	else {
+		this->_imageReleases.push_back(barrier);
+	}
+
+	uint64_t ticket = this->_recording.timelineValue;
+
+	if (++this->_recordedCopies >= UPLOAD_BATCH_MAX_COPIES) {
+		this->_submitLocked();
+	}
+
+	return ticket;
+}
+
+uint64_t VulkanUploadQueue::submit() {
+	QAllocScope allocScope(QAllocTag::UPLOAD);
+	std::lock_guard<std::mutex> lock(this->_mutex);
+	return this->_submitLocked();
+}
+
+VkCommandBuffer VulkanUploadQueue::recordAcquire(uint32_t frameIndex, uint64_t* outWaitValue) {
+	QAllocScope allocScope(QAllocTag::UPLOAD);
+	std::lock_guard<std::mutex> lock(this->_mutex);
+
+	this->_retireCompleted();
+
+	// Only batches the transfer queue already finished are acquired, so the wait never stalls the frame.
+	*outWaitValue = this->_completedValue > this->_acquiredValue ? this->_completedValue : 0;
+	this->_acquiredValue = this->_completedValue;
+
+	if (this->_pendingBufferAcquires.empty() && this->_pendingImageAcquires.empty()) {
+		return VK_NULL_HANDLE;
+	}
+
+	VkCommandBuffer commandBuffer = this->_acquireCommandBuffers[frameIndex];
+	vkResetCommandBuffer(commandBuffer, 0);
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	VkResult result = vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to start recording an upload acquire command buffer!..");
+	}
+
+	vkCmdPipelineBarrier(
+		commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+		0, nullptr,
+		static_cast<uint32_t>(this->_pendingBufferAcquires.size()), this->_pendingBufferAcquires.data(),
+		static_cast<uint32_t>(this->_pendingImageAcquires.size()), this->_pendingImageAcquires.data());
+
+	result = vkEndCommandBuffer(commandBuffer);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to stop recording an upload acquire command buffer!..");
+	}
+
+	this->_pendingBufferAcquires.clear();
+	this->_pendingImageAcquires.clear();
+
+	return commandBuffer;
+}
+
+bool VulkanUploadQueue::isComplete(uint64_t ticket) {
+	uint64_t value = 0;
+	vkGetSemaphoreCounterValue(this->_logicalDevice, this->_timelineSemaphore, &value);
+
+	return value >= ticket;
+}
+
+bool VulkanUploadQueue::isReady(uint64_t ticket) {
+	std::lock_guard<std::mutex> lock(this->_mutex);
+	return this->_acquiredValue >= ticket;
+}
+
+void VulkanUploadQueue::wait(uint64_t ticket) {
+	{
+		std::lock_guard<std::mutex> lock(this->_mutex);
+		if (ticket >= this->_nextValue - 1 && this->_recording.commandBuffer != VK_NULL_HANDLE) {
+			this->_submitLocked();
+		}
+	}
+
+	this->_waitValue(ticket);
+}
+
+VkSemaphore VulkanUploadQueue::getTimelineSemaphore() {
+	return this->_timelineSemaphore;
+}
+
+void VulkanUploadQueue::_createCommandPools() {
+	VkCommandPoolCreateInfo poolCreateInfo = {};
+	poolCreateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+	poolCreateInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+	poolCreateInfo.queueFamilyIndex = this->_transferFamily;
+
+	VkResult result = vkCreateCommandPool(this->_logicalDevice, &poolCreateInfo, nullptr, &this->_transferPool);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to create a transfer command pool!..");
+	}
+
+	poolCreateInfo.queueFamilyIndex = this->_graphicsFamily;
+
+	result = vkCreateCommandPool(this->_logicalDevice, &poolCreateInfo, nullptr, &this->_acquirePool);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to create an upload acquire command pool!..");
+	}
+
+	this->_acquireCommandBuffers.resize(MAX_FRAME_DRAWS);
+
+	VkCommandBufferAllocateInfo cbAllocInfo = {};
+	cbAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+	cbAllocInfo.commandPool = this->_acquirePool;
+	cbAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	cbAllocInfo.commandBufferCount = static_cast<uint32_t>(this->_acquireCommandBuffers.size());
+
+	result = vkAllocateCommandBuffers(this->_logicalDevice, &cbAllocInfo, this->_acquireCommandBuffers.data());
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to allocate upload acquire command buffers!..");
+	}
+}
+
+void VulkanUploadQueue::_createTimelineSemaphore() {
+	VkSemaphoreTypeCreateInfo typeCreateInfo = {};
+	typeCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+	typeCreateInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+	typeCreateInfo.initialValue = 0;
+
+	VkSemaphoreCreateInfo semaphoreCreateInfo = {};
+	semaphoreCreateInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+	semaphoreCreateInfo.pNext = &typeCreateInfo;
+
+	VkResult result = vkCreateSemaphore(this->_logicalDevice, &semaphoreCreateInfo, nullptr, &this->_timelineSemaphore);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to create an upload timeline semaphore!..");
+	}
+}
+
+void VulkanUploadQueue::_beginBatch() {
+	if (this->_recording.commandBuffer != VK_NULL_HANDLE) {
+		return;
+	}
+
+	if (this->_freeCommandBuffers.empty()) {
+		VkCommandBufferAllocateInfo cbAllocInfo = {};
+		cbAllocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		cbAllocInfo.commandPool = this->_transferPool;
+		cbAllocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		cbAllocInfo.commandBufferCount = 1;
+
+		VkCommandBuffer commandBuffer;
+		VkResult result = vkAllocateCommandBuffers(this->_logicalDevice, &cbAllocInfo, &commandBuffer);
+		if (result != VK_SUCCESS) {
+			ThrowErr::runtime("Failed to allocate an upload command buffer!..");
+		}
+
+		this->_freeCommandBuffers.push_back(commandBuffer);
+	}
+
+	this->_recording.commandBuffer = this->_freeCommandBuffers.back();
+	this->_recording.timelineValue = this->_nextValue;
+	this->_freeCommandBuffers.pop_back();
+
+	vkResetCommandBuffer(this->_recording.commandBuffer, 0);
+
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	VkResult result = vkBeginCommandBuffer(this->_recording.commandBuffer, &beginInfo);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to start recording an upload command buffer!..");
+	}
+}
+
+void* VulkanUploadQueue::_allocateStaging(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* outOffset) {
+	if (size > this->_stagingRing->getSize()) {
+		ThrowErr::runtime("Upload is larger than the staging ring!..");
+	}
+
+	void* mapped = nullptr;
+
+	// A full ring flushes what is recorded and blocks on the oldest batch still reading from it.
+	while (!this->_stagingRing->allocate(size, alignment, outOffset, &mapped)) {
+		if (this->_recording.commandBuffer != VK_NULL_HANDLE) {
+			this->_submitLocked();
+		}
+
+		this->_waitValue(this->_stagingRing->getOldestPendingValue());
+		this->_retireCompleted();
+	}
+
+	return mapped;
+}
+
+uint64_t VulkanUploadQueue::_submitLocked() {
+	if (this->_recording.commandBuffer == VK_NULL_HANDLE) {
+		return this->_nextValue - 1;
+	}
+
+	if (!this->_bufferReleases.empty() || !this->_imageReleases.empty()) {
+		vkCmdPipelineBarrier(
+			this->_recording.commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+			0, nullptr,
+			static_cast<uint32_t>(this->_bufferReleases.size()), this->_bufferReleases.data(),
+			static_cast<uint32_t>(this->_imageReleases.size()), this->_imageReleases.data());
+
+		this->_bufferReleases.clear();
+		this->_imageReleases.clear();
+	}
+
+	VkResult result = vkEndCommandBuffer(this->_recording.commandBuffer);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to stop recording an upload command buffer!..");
+	}
+
+	uint64_t signalValue = this->_recording.timelineValue;
+
+	VkTimelineSemaphoreSubmitInfo timelineInfo = {};
+	timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+	timelineInfo.signalSemaphoreValueCount = 1;
+	timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+	VkSubmitInfo submitInfo = {};
+	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+	submitInfo.pNext = &timelineInfo;
+	submitInfo.commandBufferCount = 1;
+	submitInfo.pCommandBuffers = &this->_recording.commandBuffer;
+	submitInfo.signalSemaphoreCount = 1;
+	submitInfo.pSignalSemaphores = &this->_timelineSemaphore;
+
+	result = vkQueueSubmit(this->_transferQueue, 1, &submitInfo, VK_NULL_HANDLE);
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to submit upload command buffer to transfer queue!..");
+	}
+
+	this->_stagingRing->markSubmitted(signalValue);
+	this->_inFlight.push_back(this->_recording);
+
+	this->_recording = Batch();
+	this->_recordedCopies = 0;
+	this->_nextValue++;
+
+	return signalValue;
+}
+
+void VulkanUploadQueue::_retireCompleted() {
+	vkGetSemaphoreCounterValue(this->_logicalDevice, this->_timelineSemaphore, &this->_completedValue);
+
+	this->_stagingRing->retire(this->_completedValue);
+
+	size_t kept = 0;
+	for (size_t i = 0; i < this->_inFlight.size(); i++) {
+		Batch& batch = this->_inFlight[i];
+
+		if (batch.timelineValue > this->_completedValue) {
+			this->_inFlight[kept++] = batch;
+			continue;
+		}
+
+		this->_pendingBufferAcquires.insert(
+			this->_pendingBufferAcquires.end(), batch.bufferAcquires.begin(), batch.bufferAcquires.end());
+		this->_pendingImageAcquires.insert(
+			this->_pendingImageAcquires.end(), batch.imageAcquires.begin(), batch.imageAcquires.end());
+		this->_freeCommandBuffers.push_back(batch.commandBuffer);
+	}
+
+	this->_inFlight.resize(kept);
+}
+
+void VulkanUploadQueue::_waitValue(uint64_t value) {
+	if (value == 0) {
+		return;
+	}
+
+	VkSemaphoreWaitInfo waitInfo = {};
+	waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+	waitInfo.semaphoreCount = 1;
+	waitInfo.pSemaphores = &this->_timelineSemaphore;
+	waitInfo.pValues = &value;
+
+	VkResult result = vkWaitSemaphores(this->_logicalDevice, &waitInfo, std::numeric_limits<uint64_t>::max());
+	if (result != VK_SUCCESS) {
+		ThrowErr::runtime("Failed to wait for upload timeline semaphore!..");
+	}
+}
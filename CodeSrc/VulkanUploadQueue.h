@@ -0,0 +1,74 @@
+#pragma once
+#include <mutex>
+#include "QEngine.h"
+#include "VulkanUtilities.h"
+#include "VulkanMemoryAllocator.h"
+#include "VulkanStagingRing.h"
+
+const uint32_t UPLOAD_BATCH_MAX_COPIES = 256;
+
+// Batches staging copies into one transfer submission per flush. When the transfer family differs
+// from graphics, every resource is released on the transfer queue and acquired on graphics later.
+// Without a transfer-only family the transfer queue is the graphics queue, so uploads must then stay
+// on the render thread to keep vkQueueSubmit externally synchronized.
+class VulkanUploadQueue {
+public:
+	VulkanUploadQueue(
+		VkDevice logicalDevice, VulkanMemoryAllocator* allocator, VkQueue transferQueue, QueueFamilyIndicies queueFamilyIndices,
+		VkDeviceSize stagingSize = STAGING_RING_SIZE);
+	~VulkanUploadQueue();
+
+	uint64_t uploadBuffer(VkBuffer buffer, VkDeviceSize offset, const void* data, VkDeviceSize size);
+	uint64_t uploadImage(
+		VkImage image, VkExtent3D extent, VkImageAspectFlags aspect, const void* data, VkDeviceSize size, VkImageLayout finalLayout);
+	uint64_t submit();
+
+	VkCommandBuffer recordAcquire(uint32_t frameIndex, uint64_t* outWaitValue);
+
+	bool isComplete(uint64_t ticket);
+	bool isReady(uint64_t ticket);
+	void wait(uint64_t ticket);
+
+	VkSemaphore getTimelineSemaphore();
+private:
+	struct Batch {
+		VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+		uint64_t timelineValue = 0;
+		std::vector<VkBufferMemoryBarrier> bufferAcquires;
+		std::vector<VkImageMemoryBarrier> imageAcquires;
+	};
+
+	VkDevice _logicalDevice;
+	VkQueue _transferQueue;
+	uint32_t _transferFamily;
+	uint32_t _graphicsFamily;
+	bool _ownershipTransfer;
+
+	VulkanStagingRing* _stagingRing = nullptr;
+	VkSemaphore _timelineSemaphore = VK_NULL_HANDLE;
+	uint64_t _nextValue = 1;
+	uint64_t _acquiredValue = 0;
+
+	VkCommandPool _transferPool = VK_NULL_HANDLE;
+	VkCommandPool _acquirePool = VK_NULL_HANDLE;
+	std::vector<VkCommandBuffer> _freeCommandBuffers;
+	std::vector<VkCommandBuffer> _acquireCommandBuffers;
+
+	std::mutex _mutex;
+	Batch _recording;
+	uint32_t _recordedCopies = 0;
+	std::vector<VkBufferMemoryBarrier> _bufferReleases;
+	std::vector<VkImageMemoryBarrier> _imageReleases;
+	std::vector<Batch> _inFlight;
+	std::vector<VkBufferMemoryBarrier> _pendingBufferAcquires;
+	std::vector<VkImageMemoryBarrier> _pendingImageAcquires;
+	uint64_t _completedValue = 0;
+
+	void _createCommandPools();
+	void _createTimelineSemaphore();
+	void _beginBatch();
+	void* _allocateStaging(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* outOffset);
+	uint64_t _submitLocked();
+	void _retireCompleted();
+	void _waitValue(uint64_t value);
+};
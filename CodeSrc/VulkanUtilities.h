@@ -1,6 +1,7 @@
 #pragma once
 
-const int MAX_FRAME_DRAWS = 2;
+// Upper bound for frames in flight; the count actually used is picked at runtime by VulkanFrameSync.
+const int MAX_FRAME_DRAWS = 4;
 
 const std::vector<const char*> deviceExtensions = {
 	VK_KHR_SWAPCHAIN_EXTENSION_NAME
@@ -9,6 +10,10 @@ const std::vector<const char*> deviceExtensions = {
 struct QueueFamilyIndicies {
 	int graphicsFamily = -1;
 	int presentationFamily = -1;
+	// Transfer-only family for async uploads, falls back to the graphics family when the device has none.
+	int transferFamily = -1;
+	// Compute family without graphics for async compute, falls back to the graphics family as well.
+	int computeFamily = -1;
 
 	bool isValid() {
 		return graphicsFamily >= 0 && presentationFamily >= 0;
@@ -24,4 +29,5 @@ struct SwapchainDetails {
 struct SwapchainImage {
 	VkImage image;
 	VkImageView imageView;
+	VkSemaphore renderFinished;
 };
\ No newline at end of file
@@ -21,6 +21,11 @@ int main() {
 		return EXIT_FAILURE;
 	}
 
+#ifndef NDEBUG
+	// Only does anything in a QENGINE_TRACK_ALLOCATIONS build; shipping builds never report.
+	QAllocTracker::setSteadyStateMode(QAllocSteadyMode::REPORT);
+#endif
+
 	while (!glfwWindowShouldClose(window)) {
 		glfwPollEvents();
 		vkRenderer->draw();
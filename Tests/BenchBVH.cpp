@@ -0,0 +1,163 @@
+#include "QTest.h"
+#include "QBVH.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <random>
+
+// Möller-Trumbore against every triangle, for checking the BVH's closest hits.
+static uint32_t bruteForceHit(const QBVHRay& ray, const std::vector<float>& positions, const std::vector<uint32_t>& indices) {
+	float bestT = ray.tMax;
+	uint32_t best = QBVH::INVALID;
+	const float* direction = ray.direction;
+
+	for (uint32_t t = 0; t < indices.size() / 3; t++) {
+		const float* v0 = &positions[indices[t * 3] * 3];
+		const float* v1 = &positions[indices[t * 3 + 1] * 3];
+		const float* v2 = &positions[indices[t * 3 + 2] * 3];
+
+		float edge1[3] = { v1[0] - v0[0], v1[1] - v0[1], v1[2] - v0[2] };
+		float edge2[3] = { v2[0] - v0[0], v2[1] - v0[1], v2[2] - v0[2] };
+		float p[3] = {
+			direction[1] * edge2[2] - direction[2] * edge2[1],
+			direction[2] * edge2[0] - direction[0] * edge2[2],
+			direction[0] * edge2[1] - direction[1] * edge2[0]
+		};
+
+		float determinant = edge1[0] * p[0] + edge1[1] * p[1] + edge1[2] * p[2];
+		if (std::fabs(determinant) < 1e-12f) {
+			continue;
+		}
+
+		float inverse = 1.0f / determinant;
+		float s[3] = { ray.origin[0] - v0[0], ray.origin[1] - v0[1], ray.origin[2] - v0[2] };
+		float u = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inverse;
+		if (u < 0.0f || u > 1.0f) {
+			continue;
+		}
+
+		float q[3] = { s[1] * edge1[2] - s[2] * edge1[1], s[2] * edge1[0] - s[0] * edge1[2], s[0] * edge1[1] - s[1] * edge1[0] };
+		float v = (direction[0] * q[0] + direction[1] * q[1] + direction[2] * q[2]) * inverse;
+		if (v < 0.0f || u + v > 1.0f) {
+			continue;
+		}
+
+		float hitT = (edge2[0] * q[0] + edge2[1] * q[1] + edge2[2] * q[2]) * inverse;
+		if (hitT > 0.0f && hitT < bestT) {
+			bestT = hitT;
+			best = t;
+		}
+	}
+
+	return best;
+}
+
+// Sponza-sized triangle soup (262k triangles in a flattened 100 m box) and a million instances. Reports
+// build, refit, ray and frustum query times; ray hits are checked against brute force. Pass a worker
+// count to compare scaling, the default is one per hardware thread.
+int main(int argc, char** argv) {
+	const uint32_t triangleCount = 262144;
+	const uint32_t instanceCount = 1000000;
+	const uint32_t rayCount = 100000;
+	const uint32_t checkedRayCount = 200;
+	const uint32_t buildRunCount = 3;
+
+	QJobSystem jobSystem(argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 0);
+
+	std::mt19937 random(3);
+	std::uniform_real_distribution<float> position(-50.0f, 50.0f);
+	std::uniform_real_distribution<float> offset(-0.5f, 0.5f);
+
+	std::vector<float> positions;
+	std::vector<uint32_t> indices;
+	positions.reserve(triangleCount * 9);
+	indices.reserve(triangleCount * 3);
+
+	for (uint32_t t = 0; t < triangleCount; t++) {
+		float center[3] = { position(random), position(random) * 0.3f, position(random) };
+		for (uint32_t corner = 0; corner < 3; corner++) {
+			for (uint32_t axis = 0; axis < 3; axis++) {
+				positions.push_back(center[axis] + offset(random));
+			}
+			indices.push_back(t * 3 + corner);
+		}
+	}
+
+	std::vector<QBVHBounds> bounds;
+	QBVH::computeTriangleBounds(positions.data(), indices.data(), triangleCount, bounds);
+
+	QBVH bvh;
+	double bestBuildMs = 1e30;
+	for (uint32_t run = 0; run < buildRunCount; run++) {
+		bvh.build(bounds.data(), triangleCount, &jobSystem);
+		bestBuildMs = std::min(bestBuildMs, static_cast<double>(bvh.getStats().buildMs));
+	}
+
+	QBVHStats stats = bvh.getStats();
+	std::printf("%u workers\n", jobSystem.getWorkerCount());
+	std::printf("%u triangles: build %.2f ms best of %u, %u nodes, depth %u, %u subtrees, SAH cost %.2f\n",
+		triangleCount, bestBuildMs, buildRunCount, stats.nodeCount, stats.maxDepth, stats.subtreeCount, stats.sahCost);
+
+	std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+	std::vector<QBVHRay> rays(rayCount);
+	for (QBVHRay& ray : rays) {
+		for (uint32_t axis = 0; axis < 3; axis++) {
+			ray.origin[axis] = position(random);
+			ray.direction[axis] = direction(random);
+		}
+	}
+
+	std::vector<QBVHHit> hits(rayCount);
+	uint32_t hitCount = 0;
+	QTestTimer rayTimer;
+	for (uint32_t i = 0; i < rayCount; i++) {
+		hitCount += bvh.intersectTriangles(rays[i], positions.data(), indices.data(), hits[i]) ? 1 : 0;
+	}
+	double rayMs = rayTimer.getMs();
+
+	uint32_t wrongHits = 0;
+	for (uint32_t i = 0; i < checkedRayCount; i++) {
+		wrongHits += bruteForceHit(rays[i], positions, indices) != hits[i].primitive ? 1 : 0;
+	}
+
+	std::printf("%u rays, %u hits: %.3f Mrays/s on one thread, %u of %u differ from brute force\n",
+		rayCount, hitCount, rayCount / rayMs / 1000.0, wrongHits, checkedRayCount);
+
+	const float planes[6][4] = {
+		{ 1.0f, 0.0f, 0.0f, 20.0f }, { -1.0f, 0.0f, 0.0f, 20.0f },
+		{ 0.0f, 1.0f, 0.0f, 5.0f }, { 0.0f, -1.0f, 0.0f, 5.0f },
+		{ 0.0f, 0.0f, 1.0f, 20.0f }, { 0.0f, 0.0f, -1.0f, 10.0f }
+	};
+
+	std::vector<uint32_t> visible;
+	QTestTimer cullTimer;
+	bvh.cullFrustum(planes, visible);
+	std::printf("frustum query: %zu triangles in %.3f ms\n", visible.size(), cullTimer.getMs());
+
+	for (float& coordinate : positions) {
+		coordinate += 0.01f;
+	}
+	QBVH::computeTriangleBounds(positions.data(), indices.data(), triangleCount, bounds);
+	bvh.refit(bounds.data());
+	stats = bvh.getStats();
+	std::printf("refit: %.2f ms, SAH cost %.2f\n", stats.refitMs, stats.sahCost);
+
+	std::vector<QBVHBounds> instances(instanceCount);
+	for (QBVHBounds& instance : instances) {
+		for (uint32_t axis = 0; axis < 3; axis++) {
+			float center = position(random) * 10.0f;
+			instance.min[axis] = center - 1.0f;
+			instance.max[axis] = center + 1.0f;
+		}
+	}
+
+	QBVH instanceBvh;
+	bestBuildMs = 1e30;
+	for (uint32_t run = 0; run < buildRunCount; run++) {
+		instanceBvh.build(instances.data(), instanceCount, &jobSystem);
+		bestBuildMs = std::min(bestBuildMs, static_cast<double>(instanceBvh.getStats().buildMs));
+	}
+	std::printf("%u instances: build %.2f ms best of %u, depth %u\n", instanceCount, bestBuildMs, buildRunCount, instanceBvh.getStats().maxDepth);
+
+	return wrongHits == 0 ? 0 : 1;
+}
@@ -0,0 +1,102 @@
+#include "QTest.h"
+#include "QFrustumCuller.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+// A million instances scattered through a 1 km cube, culled against a camera at the origin looking down -z.
+// Reports the time per cull, the throughput per worker and the lane width the build picked, and checks
+// the visible list against a plain per-object loop so a faster kernel cannot quietly get it wrong.
+int main() {
+	const uint32_t instanceCount = 1000000;
+	const uint32_t runCount = 10;
+
+	QJobSystem jobSystem;
+	QFrustumCuller culler;
+	culler.reserve(instanceCount);
+
+	std::mt19937 random(1);
+	std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+	std::uniform_real_distribution<float> radius(0.5f, 5.0f);
+
+	// What the culler was given, for the reference loop.
+	std::vector<float> centers;
+	std::vector<float> radii;
+	centers.reserve(instanceCount * 3);
+	radii.reserve(instanceCount);
+
+	for (uint32_t i = 0; i < instanceCount; i++) {
+		float center[3] = { position(random), position(random), position(random) };
+		float sphereRadius = radius(random);
+		float extent = sphereRadius * 0.7f;
+		float aabbMin[3] = { center[0] - extent, center[1] - extent, center[2] - extent };
+		float aabbMax[3] = { center[0] + extent, center[1] + extent, center[2] + extent };
+
+		culler.add(center, sphereRadius, aabbMin, aabbMax);
+		centers.insert(centers.end(), center, center + 3);
+		radii.push_back(sphereRadius);
+	}
+
+	// Row-major, column vectors, 90 degree field of view, depth in [0, 1].
+	const float nearPlane = 0.1f;
+	const float farPlane = 300.0f;
+	const float viewProjection[16] = {
+		1.0f, 0.0f, 0.0f, 0.0f,
+		0.0f, 1.0f, 0.0f, 0.0f,
+		0.0f, 0.0f, farPlane / (nearPlane - farPlane), farPlane * nearPlane / (nearPlane - farPlane),
+		0.0f, 0.0f, -1.0f, 0.0f
+	};
+	culler.setViewProjection(viewProjection);
+
+	std::vector<uint32_t> visible;
+	culler.cull(&jobSystem, visible);
+
+	double totalMs = 0.0;
+	double bestMs = 1e30;
+	for (uint32_t run = 0; run < runCount; run++) {
+		QTestTimer timer;
+		culler.cull(&jobSystem, visible);
+		double elapsedMs = timer.getMs();
+
+		totalMs += elapsedMs;
+		bestMs = std::min(bestMs, elapsedMs);
+	}
+
+	// In double precision; objects within a hair of a plane may land either way in float, so only
+	// disagreements with a clear margin count.
+	float planes[6][4];
+	QFrustumCuller::extractPlanes(viewProjection, planes);
+
+	std::vector<bool> culledVisible(instanceCount, false);
+	for (uint32_t index : visible) {
+		culledVisible[index] = true;
+	}
+
+	uint32_t mismatchCount = 0;
+	for (uint32_t i = 0; i < instanceCount; i++) {
+		const float* center = &centers[i * 3];
+		double extent = radii[i] * 0.7f;
+		double margin = 1e30;
+
+		for (uint32_t p = 0; p < 6; p++) {
+			double distance = static_cast<double>(planes[p][0]) * center[0] + static_cast<double>(planes[p][1]) * center[1] +
+				static_cast<double>(planes[p][2]) * center[2] + planes[p][3];
+			double reach = (std::fabs(planes[p][0]) + std::fabs(planes[p][1]) + std::fabs(planes[p][2])) * extent;
+			margin = std::min(margin, std::min(distance + radii[i], distance + reach));
+		}
+
+		if ((margin >= 0.0) != culledVisible[i] && std::fabs(margin) > 1e-3) {
+			mismatchCount++;
+		}
+	}
+
+	QFrustumCullerStats stats = culler.getStats();
+	double averageMs = totalMs / runCount;
+
+	std::printf("%u instances, %u visible, %u lanes, %u workers\n", stats.objectCount, stats.visibleCount, stats.simdWidth, stats.workerCount);
+	std::printf("cull: %.3f ms on average, %.3f ms best, %.3g objects/s per worker\n",
+		averageMs, bestMs, instanceCount / (averageMs / 1000.0) / stats.workerCount);
+	std::printf("%u objects disagree with the per-object loop\n", mismatchCount);
+
+	return mismatchCount == 0 ? 0 : 1;
+}
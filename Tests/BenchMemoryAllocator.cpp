@@ -0,0 +1,62 @@
+#include "QTest.h"
+#include "MockDeviceMemory.h"
+#include <random>
+
+// Streaming-like churn against a mock discrete GPU: mixed sizes, alignments and resource kinds,
+// with a third of the requests freeing a random live allocation. Reports allocator throughput, how
+// few device allocations back the live set, and how fragmented the free space ends up.
+int main() {
+	const uint32_t operationCount = 300000;
+
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	VkPhysicalDeviceLimits limits;
+	mockDiscreteGpu(memoryProperties, limits);
+
+	MockDeviceMemory backend;
+	VulkanMemoryAllocator allocator(memoryProperties, limits, &backend);
+
+	std::mt19937 random(1);
+	std::vector<VulkanAllocation*> live;
+	live.reserve(operationCount);
+
+	uint32_t allocationCount = 0;
+	uint32_t freeCount = 0;
+	QTestTimer timer;
+
+	for (uint32_t i = 0; i < operationCount; i++) {
+		if (live.empty() || random() % 3 != 0) {
+			VkMemoryRequirements requirements = {};
+			requirements.size = 256 + random() % (1u << (8 + random() % 9));
+			requirements.alignment = 1ull << (random() % 9);
+			requirements.memoryTypeBits = 0x7;
+
+			VulkanMemoryUsage usage = (random() % 4 == 0) ? VulkanMemoryUsage::CPU_TO_GPU : VulkanMemoryUsage::GPU_ONLY;
+			QTlsfResourceKind kind = (random() & 1) ? QTlsfResourceKind::LINEAR : QTlsfResourceKind::OPTIMAL;
+
+			live.push_back(allocator.allocate(requirements, usage, kind));
+			allocationCount++;
+		} else {
+			size_t index = random() % live.size();
+			allocator.free(live[index]);
+			live[index] = live.back();
+			live.pop_back();
+			freeCount++;
+		}
+	}
+
+	double elapsedMs = timer.getMs();
+	VulkanMemoryStats stats = allocator.getStats();
+
+	std::printf("%u allocations and %u frees in %.1f ms: %.2f M operations/s\n",
+		allocationCount, freeCount, elapsedMs, operationCount / elapsedMs / 1000.0);
+	std::printf("live: %u allocations, %.1f MiB in %u blocks, %u device allocations\n",
+		stats.allocationCount, stats.usedBytes / (1024.0 * 1024.0), stats.blockCount, stats.deviceAllocationCount);
+	std::printf("free: %.1f MiB, largest range %.1f MiB, fragmentation %.3f\n",
+		stats.freeBytes / (1024.0 * 1024.0), stats.largestFreeRange / (1024.0 * 1024.0), stats.fragmentation);
+
+	for (VulkanAllocation* allocation : live) {
+		allocator.free(allocation);
+	}
+
+	return 0;
+}
@@ -0,0 +1,103 @@
+#include "QTest.h"
+#include "MockDeviceMemory.h"
+#include "VulkanMemoryDefragmenter.h"
+#include <random>
+
+// Streams a few GiB of movable buffers in and out of a mock discrete GPU, then lets the defragmenter run
+// with its default per-frame budget. Reports the CPU cost of planning a frame and how many frames it
+// takes to get the block count and fragmentation back down.
+int main() {
+	const uint32_t frameCount = 3;
+
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	VkPhysicalDeviceLimits limits;
+	mockDiscreteGpu(memoryProperties, limits);
+
+	MockDeviceMemory backend;
+	VulkanMemoryAllocator allocator(memoryProperties, limits, &backend);
+
+	std::mt19937 random(5);
+	std::vector<VulkanAllocation*> live;
+	uint64_t nextBuffer = 1;
+
+	for (uint32_t i = 0; i < 400000; i++) {
+		if (live.empty() || random() % 5 < 3) {
+			VkMemoryRequirements requirements = {};
+			requirements.size = 256 + random() % (1u << (8 + random() % 10));
+			requirements.alignment = 256;
+			requirements.memoryTypeBits = 0x1;
+
+			VulkanAllocation* allocation = allocator.allocate(requirements, VulkanMemoryUsage::GPU_ONLY, QTlsfResourceKind::LINEAR);
+			allocation->buffer = (VkBuffer)(uintptr_t)(nextBuffer++);
+			allocation->bufferSize = allocation->size;
+			allocation->bufferUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+			allocation->movable = true;
+			live.push_back(allocation);
+		} else {
+			size_t index = random() % live.size();
+			allocator.free(live[index]);
+			live[index] = live.back();
+			live.pop_back();
+		}
+	}
+
+	// The level drops: most of what was streamed in goes away, the survivors are scattered.
+	for (size_t i = 0; i < live.size();) {
+		if (random() % 10 < 8) {
+			allocator.free(live[i]);
+			live[i] = live.back();
+			live.pop_back();
+		} else {
+			i++;
+		}
+	}
+
+	VulkanMemoryStats before = allocator.getStats();
+
+	VulkanMemoryDefragmenter defragmenter(&allocator, 0);
+	defragmenter.setMoveCallback([](VulkanAllocation*, VkBuffer) {});
+
+	std::vector<VulkanDefragMove> moves;
+	double planMs = 0.0;
+	double worstPlanMs = 0.0;
+	uint32_t frame = 0;
+
+	for (; frame < 100000; frame++) {
+		defragmenter.releaseFrame(frame % frameCount);
+
+		QTestTimer timer;
+		uint32_t moveCount = defragmenter.planMoves(moves);
+		double elapsedMs = timer.getMs();
+
+		planMs += elapsedMs;
+		worstPlanMs = std::max(worstPlanMs, elapsedMs);
+
+		if (moveCount == 0) {
+			break;
+		}
+
+		for (const VulkanDefragMove& move : moves) {
+			defragmenter.commitMove(move, (VkBuffer)(uintptr_t)(nextBuffer++), frame % frameCount);
+		}
+	}
+
+	for (uint32_t i = 0; i < frameCount; i++) {
+		defragmenter.releaseFrame(i);
+	}
+
+	VulkanMemoryStats after = allocator.getStats();
+	VulkanDefragStats defragStats = defragmenter.getStats();
+
+	std::printf("%u live allocations, %.1f MiB\n", after.allocationCount, after.usedBytes / (1024.0 * 1024.0));
+	std::printf("before: %u blocks, fragmentation %.3f\n", before.blockCount, before.fragmentation);
+	std::printf("after:  %u blocks, fragmentation %.3f\n", after.blockCount, after.fragmentation);
+	std::printf("%u frames, %llu moves, %.1f MiB copied; planning %.3f ms per frame on average, %.3f ms worst\n",
+		frame, static_cast<unsigned long long>(defragStats.movesTotal), defragStats.bytesMovedTotal / (1024.0 * 1024.0),
+		planMs / std::max(frame, 1u), worstPlanMs);
+
+	for (VulkanAllocation* allocation : live) {
+		allocator.free(allocation);
+	}
+
+	return 0;
+}
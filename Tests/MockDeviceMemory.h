@@ -0,0 +1,68 @@
+#pragma once
+#include <cstdint>
+#include "VulkanMemoryAllocator.h"
+
+// Device memory backend with no device behind it. Handles are counters, mapped pointers are fake
+// addresses that are never dereferenced, and an optional budget makes large allocations fail the way
+// an exhausted heap would.
+class MockDeviceMemory : public VulkanDeviceMemoryBackend {
+public:
+	MockDeviceMemory(VkDeviceSize maxAllocationSize = 0) : _maxAllocationSize{ maxAllocationSize } {}
+
+	VkResult allocate(
+		uint32_t, VkDeviceSize size, VkBuffer, VkImage, VkDeviceMemory* outMemory) override {
+		if (this->_maxAllocationSize != 0 && size > this->_maxAllocationSize) {
+			this->failedCount++;
+			return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+		}
+
+		*outMemory = (VkDeviceMemory)(uintptr_t)(++this->_nextHandle);
+		this->allocateCount++;
+		this->liveCount++;
+		this->liveBytes += size;
+		this->lastAllocationSize = size;
+
+		return VK_SUCCESS;
+	}
+
+	void free(VkDeviceMemory) override {
+		this->liveCount--;
+	}
+
+	void* map(VkDeviceMemory) override {
+		this->mapCount++;
+		return reinterpret_cast<void*>(static_cast<uintptr_t>(0x100000));
+	}
+
+	uint32_t allocateCount = 0;
+	uint32_t failedCount = 0;
+	uint32_t mapCount = 0;
+	int32_t liveCount = 0;
+	VkDeviceSize liveBytes = 0;
+	VkDeviceSize lastAllocationSize = 0;
+private:
+	VkDeviceSize _maxAllocationSize;
+	uint64_t _nextHandle = 0;
+};
+
+// A discrete GPU: 8 GiB device local heap and the 256 MiB host visible BAR window.
+inline void mockDiscreteGpu(VkPhysicalDeviceMemoryProperties& outMemoryProperties, VkPhysicalDeviceLimits& outLimits) {
+	outMemoryProperties = {};
+	outMemoryProperties.memoryHeapCount = 2;
+	outMemoryProperties.memoryHeaps[0].size = 8ull * 1024 * 1024 * 1024;
+	outMemoryProperties.memoryHeaps[1].size = 256ull * 1024 * 1024;
+
+	outMemoryProperties.memoryTypeCount = 3;
+	outMemoryProperties.memoryTypes[0].propertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+	outMemoryProperties.memoryTypes[0].heapIndex = 0;
+	outMemoryProperties.memoryTypes[1].propertyFlags =
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+	outMemoryProperties.memoryTypes[1].heapIndex = 1;
+	outMemoryProperties.memoryTypes[2].propertyFlags =
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT;
+	outMemoryProperties.memoryTypes[2].heapIndex = 1;
+
+	outLimits = {};
+	outLimits.bufferImageGranularity = 1024;
+	outLimits.maxMemoryAllocationCount = 4096;
+}
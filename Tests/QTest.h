@@ -0,0 +1,36 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+
+// Just enough of a harness for the headless targets: a failed check prints where it failed and fails
+// the run, but the test keeps going so one run shows every broken expectation.
+static int qTestFailureCount = 0;
+
+#define QTEST_CHECK(expression) \
+	do { \
+		if (!(expression)) { \
+			std::printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #expression); \
+			qTestFailureCount++; \
+		} \
+	} while (0)
+
+inline int qTestResult(const char* testName) {
+	if (qTestFailureCount != 0) {
+		std::printf("%s: %d checks failed\n", testName, qTestFailureCount);
+		return 1;
+	}
+
+	std::printf("%s: passed\n", testName);
+	return 0;
+}
+
+class QTestTimer {
+public:
+	QTestTimer() : _start{ std::chrono::high_resolution_clock::now() } {}
+
+	double getMs() const {
+		return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - this->_start).count();
+	}
+private:
+	std::chrono::high_resolution_clock::time_point _start;
+};
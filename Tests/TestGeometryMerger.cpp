@@ -0,0 +1,185 @@
+#include "QTest.h"
+#include "QGeometryMerger.h"
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+// The position sits behind the uv so the merger has to honour positionOffset.
+struct TestVertex {
+	float uv[2];
+	float position[3];
+};
+
+static const TestVertex QUAD_VERTICES[4] = {
+	{ { 0.0f, 0.0f }, { -1.0f, -2.0f, 0.0f } },
+	{ { 1.0f, 0.0f }, { 3.0f, -2.0f, 0.0f } },
+	{ { 1.0f, 1.0f }, { 3.0f, 2.0f, 0.0f } },
+	{ { 0.0f, 1.0f }, { -1.0f, 2.0f, 0.0f } }
+};
+static const uint32_t QUAD_INDICES[6] = { 0, 1, 2, 0, 2, 3 };
+
+static const TestVertex TRIANGLE_A[3] = {
+	{ { 0.0f, 0.0f }, { 0.0f, 0.0f, 5.0f } },
+	{ { 1.0f, 0.0f }, { 1.0f, 0.0f, 5.0f } },
+	{ { 0.0f, 1.0f }, { 0.0f, 1.0f, 5.0f } }
+};
+static const TestVertex TRIANGLE_B[3] = {
+	{ { 0.0f, 0.0f }, { 10.0f, 0.0f, 0.0f } },
+	{ { 1.0f, 0.0f }, { 10.0f, 4.0f, 0.0f } },
+	{ { 0.0f, 1.0f }, { 10.0f, 0.0f, 2.0f } }
+};
+static const TestVertex TRIANGLE_C[3] = {
+	{ { 0.0f, 0.0f }, { -5.0f, -5.0f, -5.0f } },
+	{ { 1.0f, 0.0f }, { -4.0f, -5.0f, -5.0f } },
+	{ { 0.0f, 1.0f }, { -5.0f, -4.0f, -5.0f } }
+};
+static const TestVertex DIAMOND_VERTICES[4] = {
+	{ { 0.0f, 0.0f }, { 2.0f, -1.0f, 1.0f } },
+	{ { 1.0f, 0.0f }, { 3.0f, 0.0f, 1.0f } },
+	{ { 1.0f, 1.0f }, { 2.0f, 1.0f, 1.0f } },
+	{ { 0.0f, 1.0f }, { 1.0f, 0.0f, 1.0f } }
+};
+static const uint32_t TRIANGLE_INDICES[3] = { 0, 1, 2 };
+static const uint32_t TRIANGLE_INDICES_REVERSED[3] = { 2, 1, 0 };
+
+// The submesh's ranges in the merged arrays hold exactly the data it was added with.
+static bool holdsData(const QGeometryMerger& merger, uint32_t submeshIndex, const TestVertex* vertices, const uint32_t* indices) {
+	const QMergedSubmesh& submesh = merger.getSubmesh(submeshIndex);
+	const uint8_t* mergedVertices = merger.getVertexData().data() + sizeof(TestVertex) * submesh.vertexOffset;
+	const uint32_t* mergedIndices = merger.getIndexData().data() + submesh.firstIndex;
+
+	return memcmp(mergedVertices, vertices, sizeof(TestVertex) * submesh.vertexCount) == 0 &&
+		memcmp(mergedIndices, indices, sizeof(uint32_t) * submesh.indexCount) == 0;
+}
+
+static bool hasRanges(const QMergedSubmesh& submesh, int32_t vertexOffset, uint32_t firstIndex) {
+	return submesh.vertexOffset == vertexOffset && submesh.firstIndex == firstIndex;
+}
+
+static bool sameMaterial(const QMergedMaterial& material, uint32_t materialIndex, uint32_t firstSubmesh, uint32_t submeshCount,
+	uint32_t firstIndex, uint32_t indexCount) {
+	return material.materialIndex == materialIndex && material.firstSubmesh == firstSubmesh &&
+		material.submeshCount == submeshCount && material.firstIndex == firstIndex && material.indexCount == indexCount;
+}
+
+static void testMerge() {
+	QGeometryMerger merger(sizeof(TestVertex), sizeof(float) * 2);
+
+	uint32_t first = merger.add(TRIANGLE_A, 3, TRIANGLE_INDICES, 3, 2);
+	uint32_t quad = merger.add(QUAD_VERTICES, 4, QUAD_INDICES, 6, 1);
+	uint32_t second = merger.add(TRIANGLE_B, 3, TRIANGLE_INDICES_REVERSED, 3, 2);
+	uint32_t third = merger.add(TRIANGLE_C, 3, TRIANGLE_INDICES, 3, 1);
+	QTEST_CHECK(first == 0 && quad == 1 && second == 2 && third == 3);
+
+	// Before merging, submeshes sit in the order they were added.
+	QTEST_CHECK(hasRanges(merger.getSubmesh(quad), 3, 3));
+	QTEST_CHECK(hasRanges(merger.getSubmesh(third), 10, 12));
+
+	merger.merge();
+
+	// Grouped by material, added order kept within each material.
+	const std::vector<uint32_t>& order = merger.getMergedOrder();
+	QTEST_CHECK(order.size() == 4 && order[0] == quad && order[1] == third && order[2] == first && order[3] == second);
+
+	QTEST_CHECK(hasRanges(merger.getSubmesh(quad), 0, 0));
+	QTEST_CHECK(hasRanges(merger.getSubmesh(third), 4, 6));
+	QTEST_CHECK(hasRanges(merger.getSubmesh(first), 7, 9));
+	QTEST_CHECK(hasRanges(merger.getSubmesh(second), 10, 12));
+
+	const std::vector<QMergedMaterial>& materials = merger.getMaterials();
+	QTEST_CHECK(materials.size() == 2);
+	QTEST_CHECK(sameMaterial(materials[0], 1, 0, 2, 0, 9));
+	QTEST_CHECK(sameMaterial(materials[1], 2, 2, 2, 9, 6));
+
+	QTEST_CHECK(merger.getVertexData().size() == sizeof(TestVertex) * 13);
+	QTEST_CHECK(merger.getIndexData().size() == 15);
+	QTEST_CHECK(holdsData(merger, quad, QUAD_VERTICES, QUAD_INDICES));
+	QTEST_CHECK(holdsData(merger, third, TRIANGLE_C, TRIANGLE_INDICES));
+	QTEST_CHECK(holdsData(merger, first, TRIANGLE_A, TRIANGLE_INDICES));
+	QTEST_CHECK(holdsData(merger, second, TRIANGLE_B, TRIANGLE_INDICES_REVERSED));
+
+	// A later add goes behind the merged data until the next merge() folds it into its material.
+	uint32_t fourth = merger.add(TRIANGLE_B, 3, TRIANGLE_INDICES, 3, 0);
+	uint32_t fifth = merger.add(TRIANGLE_A, 3, TRIANGLE_INDICES_REVERSED, 3, 1);
+	QTEST_CHECK(hasRanges(merger.getSubmesh(fourth), 13, 15));
+	QTEST_CHECK(hasRanges(merger.getSubmesh(fifth), 16, 18));
+
+	merger.merge();
+
+	QTEST_CHECK(order.size() == 6 && order[0] == fourth && order[1] == quad && order[2] == third && order[3] == fifth &&
+		order[4] == first && order[5] == second);
+	QTEST_CHECK(hasRanges(merger.getSubmesh(fourth), 0, 0));
+	QTEST_CHECK(hasRanges(merger.getSubmesh(quad), 3, 3));
+	QTEST_CHECK(hasRanges(merger.getSubmesh(third), 7, 9));
+	QTEST_CHECK(hasRanges(merger.getSubmesh(fifth), 10, 12));
+	QTEST_CHECK(hasRanges(merger.getSubmesh(first), 13, 15));
+	QTEST_CHECK(hasRanges(merger.getSubmesh(second), 16, 18));
+
+	QTEST_CHECK(materials.size() == 3);
+	QTEST_CHECK(sameMaterial(materials[0], 0, 0, 1, 0, 3));
+	QTEST_CHECK(sameMaterial(materials[1], 1, 1, 3, 3, 12));
+	QTEST_CHECK(sameMaterial(materials[2], 2, 4, 2, 15, 6));
+
+	QTEST_CHECK(merger.getVertexData().size() == sizeof(TestVertex) * 19);
+	QTEST_CHECK(holdsData(merger, quad, QUAD_VERTICES, QUAD_INDICES));
+	QTEST_CHECK(holdsData(merger, second, TRIANGLE_B, TRIANGLE_INDICES_REVERSED));
+	QTEST_CHECK(holdsData(merger, fourth, TRIANGLE_B, TRIANGLE_INDICES));
+	QTEST_CHECK(holdsData(merger, fifth, TRIANGLE_A, TRIANGLE_INDICES_REVERSED));
+
+	merger.clear();
+	QTEST_CHECK(merger.getSubmeshCount() == 0 && merger.getMaterials().empty() && merger.getVertexData().empty());
+}
+
+static void testBounds() {
+	QGeometryMerger merger(sizeof(TestVertex), sizeof(float) * 2);
+	QMergedSubmesh quad = merger.getSubmesh(merger.add(QUAD_VERTICES, 4, QUAD_INDICES, 6, 1));
+
+	QTEST_CHECK(quad.boundsMin[0] == -1.0f && quad.boundsMin[1] == -2.0f && quad.boundsMin[2] == 0.0f);
+	QTEST_CHECK(quad.boundsMax[0] == 3.0f && quad.boundsMax[1] == 2.0f && quad.boundsMax[2] == 0.0f);
+	QTEST_CHECK(quad.boundsCenter[0] == 1.0f && quad.boundsCenter[1] == 0.0f && quad.boundsCenter[2] == 0.0f);
+	QTEST_CHECK(std::fabs(quad.boundsRadius - std::sqrt(8.0f)) < 1e-5f);
+
+	// The sphere is centred on the box but reaches only the farthest vertex: 1 for this diamond, where
+	// the box's corners would need sqrt(2).
+	QMergedSubmesh diamond = merger.getSubmesh(merger.add(DIAMOND_VERTICES, 4, QUAD_INDICES, 6, 0));
+	QTEST_CHECK(diamond.boundsMin[0] == 1.0f && diamond.boundsMax[0] == 3.0f);
+	QTEST_CHECK(diamond.boundsCenter[0] == 2.0f && diamond.boundsCenter[1] == 0.0f && diamond.boundsCenter[2] == 1.0f);
+	QTEST_CHECK(std::fabs(diamond.boundsRadius - 1.0f) < 1e-5f);
+
+	// Merging moves the data but not the bounds.
+	merger.merge();
+	QTEST_CHECK(merger.getSubmesh(0).vertexOffset == 4 && merger.getSubmesh(1).vertexOffset == 0);
+	QTEST_CHECK(memcmp(merger.getSubmesh(0).boundsMin, quad.boundsMin, sizeof(quad.boundsMin)) == 0);
+	QTEST_CHECK(merger.getSubmesh(0).boundsRadius == quad.boundsRadius);
+	QTEST_CHECK(memcmp(merger.getSubmesh(1).boundsCenter, diamond.boundsCenter, sizeof(diamond.boundsCenter)) == 0);
+	QTEST_CHECK(merger.getSubmesh(1).boundsRadius == diamond.boundsRadius);
+}
+
+static void testInvalidSubmeshes() {
+	bool threw = false;
+	try {
+		QGeometryMerger merger(sizeof(float) * 3, sizeof(float));
+	} catch (const std::runtime_error&) {
+		threw = true;
+	}
+	QTEST_CHECK(threw);
+
+	QGeometryMerger merger(sizeof(TestVertex), sizeof(float) * 2);
+	const uint32_t outOfRange[3] = { 0, 1, 3 };
+	threw = false;
+	try {
+		merger.add(TRIANGLE_A, 3, outOfRange, 3, 0);
+	} catch (const std::runtime_error&) {
+		threw = true;
+	}
+	QTEST_CHECK(threw);
+	QTEST_CHECK(merger.getSubmeshCount() == 0);
+}
+
+int main() {
+	testMerge();
+	testBounds();
+	testInvalidSubmeshes();
+
+	return qTestResult("TestGeometryMerger");
+}
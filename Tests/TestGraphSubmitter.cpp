@@ -0,0 +1,257 @@
+#include "QTest.h"
+#include "VulkanGraphSubmitter.h"
+
+// The submitter, its command pools and the queue profiler only reach the driver through the entry points
+// below, so the test defines them: handles are counters, the profiler sees families without timestamps,
+// and every vkQueueSubmit is recorded with its semaphore waits and signals.
+struct SemaphoreValue {
+	VkSemaphore semaphore;
+	uint64_t value;
+};
+
+struct RecordedSubmit {
+	VkQueue queue;
+	std::vector<SemaphoreValue> waits;
+	std::vector<SemaphoreValue> signals;
+	uint32_t commandBufferCount;
+};
+
+static std::vector<RecordedSubmit> recordedSubmits;
+static uint64_t nextHandle = 0x1000;
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateSemaphore(VkDevice, const VkSemaphoreCreateInfo*, const VkAllocationCallbacks*, VkSemaphore* pSemaphore) {
+	*pSemaphore = (VkSemaphore)(uintptr_t)(++nextHandle);
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroySemaphore(VkDevice, VkSemaphore, const VkAllocationCallbacks*) {}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateCommandPool(VkDevice, const VkCommandPoolCreateInfo*, const VkAllocationCallbacks*, VkCommandPool* pCommandPool) {
+	*pCommandPool = (VkCommandPool)(uintptr_t)(++nextHandle);
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyCommandPool(VkDevice, VkCommandPool, const VkAllocationCallbacks*) {}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkResetCommandPool(VkDevice, VkCommandPool, VkCommandPoolResetFlags) {
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkAllocateCommandBuffers(VkDevice, const VkCommandBufferAllocateInfo*, VkCommandBuffer* pCommandBuffers) {
+	*pCommandBuffers = (VkCommandBuffer)(uintptr_t)(++nextHandle);
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkBeginCommandBuffer(VkCommandBuffer, const VkCommandBufferBeginInfo*) {
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkEndCommandBuffer(VkCommandBuffer) {
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkCmdPipelineBarrier2(VkCommandBuffer, const VkDependencyInfo*) {}
+
+VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceProperties(VkPhysicalDevice, VkPhysicalDeviceProperties* pProperties) {
+	*pProperties = {};
+	pProperties->limits.timestampPeriod = 1.0f;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkGetPhysicalDeviceQueueFamilyProperties(
+	VkPhysicalDevice, uint32_t* pQueueFamilyPropertyCount, VkQueueFamilyProperties* pQueueFamilyProperties) {
+	if (pQueueFamilyProperties != nullptr) {
+		for (uint32_t i = 0; i < *pQueueFamilyPropertyCount; i++) {
+			pQueueFamilyProperties[i] = {};
+		}
+	}
+
+	*pQueueFamilyPropertyCount = 2;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkCreateQueryPool(VkDevice, const VkQueryPoolCreateInfo*, const VkAllocationCallbacks*, VkQueryPool* pQueryPool) {
+	*pQueryPool = (VkQueryPool)(uintptr_t)(++nextHandle);
+	return VK_SUCCESS;
+}
+
+VKAPI_ATTR void VKAPI_CALL vkDestroyQueryPool(VkDevice, VkQueryPool, const VkAllocationCallbacks*) {}
+VKAPI_ATTR void VKAPI_CALL vkResetQueryPool(VkDevice, VkQueryPool, uint32_t, uint32_t) {}
+VKAPI_ATTR void VKAPI_CALL vkCmdWriteTimestamp2(VkCommandBuffer, VkPipelineStageFlags2, VkQueryPool, uint32_t) {}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkGetQueryPoolResults(VkDevice, VkQueryPool, uint32_t, uint32_t, size_t, void*, VkDeviceSize, VkQueryResultFlags) {
+	return VK_NOT_READY;
+}
+
+VKAPI_ATTR VkResult VKAPI_CALL vkQueueSubmit(VkQueue queue, uint32_t submitCount, const VkSubmitInfo* pSubmits, VkFence) {
+	for (uint32_t i = 0; i < submitCount; i++) {
+		const VkSubmitInfo& submit = pSubmits[i];
+		const VkTimelineSemaphoreSubmitInfo* timelineInfo = static_cast<const VkTimelineSemaphoreSubmitInfo*>(submit.pNext);
+
+		RecordedSubmit recorded;
+		recorded.queue = queue;
+		recorded.commandBufferCount = submit.commandBufferCount;
+
+		for (uint32_t w = 0; w < submit.waitSemaphoreCount; w++) {
+			SemaphoreValue wait = { submit.pWaitSemaphores[w], timelineInfo->pWaitSemaphoreValues[w] };
+			recorded.waits.push_back(wait);
+		}
+		for (uint32_t s = 0; s < submit.signalSemaphoreCount; s++) {
+			SemaphoreValue signal = { submit.pSignalSemaphores[s], timelineInfo->pSignalSemaphoreValues[s] };
+			recorded.signals.push_back(signal);
+		}
+
+		recordedSubmits.push_back(recorded);
+	}
+
+	return VK_SUCCESS;
+}
+
+static bool hasSemaphore(const std::vector<SemaphoreValue>& semaphores, VkSemaphore semaphore, uint64_t value) {
+	for (const SemaphoreValue& entry : semaphores) {
+		if (entry.semaphore == semaphore && entry.value == value) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+static const VkQueue GRAPHICS_QUEUE = (VkQueue)(uintptr_t)0x10;
+static const VkQueue COMPUTE_QUEUE = (VkQueue)(uintptr_t)0x20;
+
+static const VkSemaphore UPLOAD_TIMELINE = (VkSemaphore)(uintptr_t)0x200;
+static const VkSemaphore IMAGE_AVAILABLE = (VkSemaphore)(uintptr_t)0x300;
+static const VkSemaphore RENDER_FINISHED = (VkSemaphore)(uintptr_t)0x400;
+static const VkSemaphore FRAME_TIMELINE = (VkSemaphore)(uintptr_t)0x500;
+
+// Light binning on compute, shading on graphics, as in TestRenderGraph.
+static void buildGraph(VulkanRenderGraph& graph) {
+	VulkanGraphImageDesc colorDesc;
+	colorDesc.extent = { 1280, 720 };
+	colorDesc.format = VK_FORMAT_R8G8B8A8_UNORM;
+
+	VulkanGraphImageDesc gridDesc;
+	gridDesc.extent = { 80, 45 };
+	gridDesc.format = VK_FORMAT_R32_UINT;
+
+	VulkanRenderGraph::Resource swapchain = graph.importImage(
+		"swapchain", colorDesc, (VkImage)(uintptr_t)1, (VkImageView)(uintptr_t)2, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	VulkanRenderGraph::Resource grid = graph.createImage("light grid", gridDesc);
+
+	VulkanRenderGraph::Pass binning = graph.addPass("light binning", nullptr);
+	graph.setAsyncCompute(binning);
+	graph.write(binning, grid, VulkanGraphAccess::STORAGE_WRITE);
+
+	VulkanRenderGraph::Pass shading = graph.addPass("shading", nullptr);
+	graph.read(shading, grid, VulkanGraphAccess::SAMPLED_GRAPHICS);
+	graph.write(shading, swapchain, VulkanGraphAccess::COLOR_ATTACHMENT);
+}
+
+// The frame as the renderer hands it over: a prefix command buffer behind an upload timeline, the
+// acquire semaphore, and present plus frame timeline signals.
+static void submitFrame(VulkanGraphSubmitter& submitter, VulkanRenderGraph& graph) {
+	VkCommandBuffer prefixBuffers[] = { (VkCommandBuffer)(uintptr_t)0x100 };
+	VkSemaphore prefixWaitSemaphores[] = { UPLOAD_TIMELINE };
+	uint64_t prefixWaitValues[] = { 5 };
+	VkSemaphore waitSemaphores[] = { IMAGE_AVAILABLE };
+	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+	VkSemaphore signalSemaphores[] = { RENDER_FINISHED, FRAME_TIMELINE };
+	uint64_t signalValues[] = { 0, 1 };
+
+	VulkanGraphFrameSubmit frame;
+	frame.prefixCommandBuffers = QSpan<const VkCommandBuffer>(prefixBuffers, 1);
+	frame.prefixWaitSemaphores = QSpan<const VkSemaphore>(prefixWaitSemaphores, 1);
+	frame.prefixWaitValues = QSpan<const uint64_t>(prefixWaitValues, 1);
+	frame.waitSemaphores = QSpan<const VkSemaphore>(waitSemaphores, 1);
+	frame.waitStages = QSpan<const VkPipelineStageFlags>(waitStages, 1);
+	frame.signalSemaphores = QSpan<const VkSemaphore>(signalSemaphores, 2);
+	frame.signalValues = QSpan<const uint64_t>(signalValues, 2);
+
+	recordedSubmits.clear();
+	submitter.submit(&graph, frame);
+}
+
+// With a compute family: the prefix goes out on its own, compute waits for it, and graphics waits for
+// compute's batch on the compute timeline before taking the acquire semaphore and the frame signals.
+static void testAsyncSubmission() {
+	VulkanCommandPoolManager commandPoolManager(VK_NULL_HANDLE, 1);
+	VulkanQueueProfiler profiler(VK_NULL_HANDLE, VK_NULL_HANDLE, 2, 0, 1);
+	VulkanGraphSubmitter submitter(VK_NULL_HANDLE, &commandPoolManager, &profiler, GRAPHICS_QUEUE, 0, COMPUTE_QUEUE, 1);
+
+	VulkanRenderGraph graph;
+	graph.setQueueFamilies(0, 1);
+	buildGraph(graph);
+	graph.compile();
+
+	submitFrame(submitter, graph);
+
+	VkSemaphore graphicsTimeline = submitter.getTimelineSemaphore(VulkanGraphQueue::GRAPHICS);
+	VkSemaphore computeTimeline = submitter.getTimelineSemaphore(VulkanGraphQueue::ASYNC_COMPUTE);
+	QTEST_CHECK(graphicsTimeline != computeTimeline);
+
+	QTEST_CHECK(recordedSubmits.size() == 3);
+	if (recordedSubmits.size() != 3) {
+		return;
+	}
+
+	const RecordedSubmit& prefix = recordedSubmits[0];
+	QTEST_CHECK(prefix.queue == GRAPHICS_QUEUE);
+	QTEST_CHECK(prefix.commandBufferCount == 1);
+	QTEST_CHECK(prefix.waits.size() == 1 && hasSemaphore(prefix.waits, UPLOAD_TIMELINE, 5));
+	QTEST_CHECK(prefix.signals.size() == 1 && hasSemaphore(prefix.signals, graphicsTimeline, 1));
+
+	const RecordedSubmit& compute = recordedSubmits[1];
+	QTEST_CHECK(compute.queue == COMPUTE_QUEUE);
+	QTEST_CHECK(compute.commandBufferCount == 1);
+	QTEST_CHECK(compute.waits.size() == 1 && hasSemaphore(compute.waits, graphicsTimeline, 1));
+	QTEST_CHECK(compute.signals.size() == 1 && hasSemaphore(compute.signals, computeTimeline, 1));
+
+	const RecordedSubmit& graphics = recordedSubmits[2];
+	QTEST_CHECK(graphics.queue == GRAPHICS_QUEUE);
+	QTEST_CHECK(graphics.commandBufferCount == 1);
+	QTEST_CHECK(graphics.waits.size() == 2);
+	QTEST_CHECK(hasSemaphore(graphics.waits, IMAGE_AVAILABLE, 0));
+	QTEST_CHECK(hasSemaphore(graphics.waits, computeTimeline, 1));
+	QTEST_CHECK(graphics.signals.size() == 3);
+	QTEST_CHECK(hasSemaphore(graphics.signals, RENDER_FINISHED, 0));
+	QTEST_CHECK(hasSemaphore(graphics.signals, FRAME_TIMELINE, 1));
+	QTEST_CHECK(hasSemaphore(graphics.signals, graphicsTimeline, 2));
+
+	QTEST_CHECK(submitter.getTimelineValue(VulkanGraphQueue::GRAPHICS) == 2);
+	QTEST_CHECK(submitter.getTimelineValue(VulkanGraphQueue::ASYNC_COMPUTE) == 1);
+}
+
+// One family: the same graph is a single graphics submission carrying the prefix and every frame semaphore.
+static void testSingleQueueSubmission() {
+	VulkanCommandPoolManager commandPoolManager(VK_NULL_HANDLE, 1);
+	VulkanQueueProfiler profiler(VK_NULL_HANDLE, VK_NULL_HANDLE, 2, 0, 0);
+	VulkanGraphSubmitter submitter(VK_NULL_HANDLE, &commandPoolManager, &profiler, GRAPHICS_QUEUE, 0, GRAPHICS_QUEUE, 0);
+
+	VulkanRenderGraph graph;
+	graph.setQueueFamilies(0, 0);
+	buildGraph(graph);
+	graph.compile();
+
+	submitFrame(submitter, graph);
+
+	QTEST_CHECK(recordedSubmits.size() == 1);
+	if (recordedSubmits.size() != 1) {
+		return;
+	}
+
+	const RecordedSubmit& graphics = recordedSubmits[0];
+	QTEST_CHECK(graphics.queue == GRAPHICS_QUEUE);
+	QTEST_CHECK(graphics.commandBufferCount == 2);
+	QTEST_CHECK(graphics.waits.size() == 2);
+	QTEST_CHECK(hasSemaphore(graphics.waits, UPLOAD_TIMELINE, 5));
+	QTEST_CHECK(hasSemaphore(graphics.waits, IMAGE_AVAILABLE, 0));
+	QTEST_CHECK(graphics.signals.size() == 3);
+	QTEST_CHECK(hasSemaphore(graphics.signals, submitter.getTimelineSemaphore(VulkanGraphQueue::GRAPHICS), 1));
+	QTEST_CHECK(submitter.getTimelineValue(VulkanGraphQueue::ASYNC_COMPUTE) == 0);
+}
+
+int main() {
+	testAsyncSubmission();
+	testSingleQueueSubmission();
+
+	return qTestResult("TestGraphSubmitter");
+}
@@ -0,0 +1,115 @@
+#include "QTest.h"
+#include "QJobSystem.h"
+#include "QAllocTracker.h"
+#include <atomic>
+
+// Built with QENGINE_TRACK_ALLOCATIONS, so the tracker's operator new sees every heap allocation.
+
+static void testCoverage() {
+	QJobSystem jobSystem(3);
+
+	std::vector<std::atomic<uint32_t>> hits(10000);
+	for (std::atomic<uint32_t>& hit : hits) {
+		hit.store(0);
+	}
+
+	std::atomic<uint32_t> badWorker(0);
+	jobSystem.parallelFor(static_cast<uint32_t>(hits.size()), 7, [&](uint32_t begin, uint32_t end, uint32_t workerIndex) {
+		if (workerIndex >= jobSystem.getWorkerCount()) {
+			badWorker++;
+		}
+
+		for (uint32_t i = begin; i < end; i++) {
+			hits[i]++;
+		}
+	});
+
+	uint32_t wrong = 0;
+	for (const std::atomic<uint32_t>& hit : hits) {
+		wrong += hit.load() != 1 ? 1 : 0;
+	}
+
+	QTEST_CHECK(wrong == 0);
+	QTEST_CHECK(badWorker.load() == 0);
+}
+
+static void testSubmitDoesNotAllocate() {
+	QJobSystem jobSystem(3);
+	std::vector<uint32_t> values(4096, 1);
+	std::atomic<uint64_t> sum(0);
+
+	// A capture bigger than any small-buffer optimization a std::function might have had.
+	uint64_t padding[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+	auto body = [&values, &sum, padding](uint32_t begin, uint32_t end, uint32_t) {
+		uint64_t local = padding[0] - 1;
+		for (uint32_t i = begin; i < end; i++) {
+			local += values[i];
+		}
+		sum += local;
+	};
+
+	// The first loop wakes the workers; count only the steady state.
+	jobSystem.parallelFor(static_cast<uint32_t>(values.size()), 64, body);
+	sum.store(0);
+
+	uint64_t before = QAllocTracker::getTagStats(QAllocTag::UNTAGGED).count;
+	for (uint32_t i = 0; i < 100; i++) {
+		jobSystem.parallelFor(static_cast<uint32_t>(values.size()), 64, body);
+	}
+	uint64_t after = QAllocTracker::getTagStats(QAllocTag::UNTAGGED).count;
+
+	QTEST_CHECK(sum.load() == 100 * values.size());
+	QTEST_CHECK(after == before);
+}
+
+static void testNestedRunsInline() {
+	QJobSystem jobSystem(3);
+
+	std::atomic<uint32_t> innerItems(0);
+	std::atomic<uint32_t> workerMismatches(0);
+
+	// Would deadlock if the inner loop waited for the pool the outer loop occupies.
+	jobSystem.parallelFor(32, 1, [&](uint32_t begin, uint32_t end, uint32_t outerWorker) {
+		for (uint32_t i = begin; i < end; i++) {
+			jobSystem.parallelFor(100, 10, [&](uint32_t innerBegin, uint32_t innerEnd, uint32_t innerWorker) {
+				if (innerWorker != outerWorker) {
+					workerMismatches++;
+				}
+				innerItems += innerEnd - innerBegin;
+			});
+		}
+	});
+
+	QTEST_CHECK(innerItems.load() == 32 * 100);
+	QTEST_CHECK(workerMismatches.load() == 0);
+
+	// And the pool is still usable afterwards.
+	std::atomic<uint32_t> items(0);
+	jobSystem.parallelFor(1000, 10, [&](uint32_t begin, uint32_t end, uint32_t) { items += end - begin; });
+	QTEST_CHECK(items.load() == 1000);
+}
+
+static void testWorkersInheritTag() {
+	QJobSystem jobSystem(3);
+
+	uint64_t before = QAllocTracker::getTagStats(QAllocTag::CULLING).count;
+	{
+		QAllocScope allocScope(QAllocTag::CULLING);
+		jobSystem.parallelFor(64, 1, [](uint32_t, uint32_t, uint32_t) {
+			std::vector<uint32_t> scratch(16);
+			scratch[0] = 1;
+		});
+	}
+	uint64_t after = QAllocTracker::getTagStats(QAllocTag::CULLING).count;
+
+	QTEST_CHECK(after - before == 64);
+}
+
+int main() {
+	testCoverage();
+	testSubmitDoesNotAllocate();
+	testNestedRunsInline();
+	testWorkersInheritTag();
+
+	return qTestResult("TestJobSystem");
+}
@@ -0,0 +1,136 @@
+#include "QTest.h"
+#include "QMaskedOcclusion.h"
+#include <random>
+
+// 2:1 viewport, 90 degree vertical field of view, near 0.5 and far 200. Row-major, column vectors, depth
+// in [0, 1] and screen y flipped to grow downwards, as the renderer sets it up.
+static const float NEAR_PLANE = 0.5f;
+static const float FAR_PLANE = 200.0f;
+static const float VIEW_PROJECTION[16] = {
+	0.5f, 0.0f, 0.0f, 0.0f,
+	0.0f, -1.0f, 0.0f, 0.0f,
+	0.0f, 0.0f, FAR_PLANE / (NEAR_PLANE - FAR_PLANE), FAR_PLANE * NEAR_PLANE / (NEAR_PLANE - FAR_PLANE),
+	0.0f, 0.0f, -1.0f, 0.0f
+};
+
+// A 20 m square wall 10 m in front of the camera, covering the middle half of the screen. Clockwise seen
+// from the camera, which stays clockwise on the y-down screen: a front face.
+static const float WALL_POSITIONS[12] = {
+	-10.0f, -10.0f, -10.0f,
+	10.0f, -10.0f, -10.0f,
+	10.0f, 10.0f, -10.0f,
+	-10.0f, 10.0f, -10.0f
+};
+static const uint32_t WALL_INDICES[6] = { 0, 2, 1, 0, 3, 2 };
+static const uint32_t WALL_INDICES_REVERSED[6] = { 0, 1, 2, 0, 2, 3 };
+
+static QBVHBounds makeBox(float x, float y, float z, float extent) {
+	QBVHBounds box = { { x - extent, y - extent, z - extent }, { x + extent, y + extent, z + extent } };
+	return box;
+}
+
+static void testHiddenAndVisible(QJobSystem* jobSystem) {
+	QMaskedOcclusion occlusion;
+	occlusion.setViewProjection(VIEW_PROJECTION);
+	occlusion.clear();
+	occlusion.addOccluder(WALL_POSITIONS, WALL_INDICES, 2);
+	occlusion.render(jobSystem);
+
+	QMaskedOcclusionStats stats = occlusion.getStats();
+	QTEST_CHECK(stats.occluderTriangles == 2);
+	QTEST_CHECK(stats.rasterizedTriangles == 2);
+
+	QBVHBounds hidden = makeBox(0.0f, 0.0f, -50.0f, 2.0f);
+	QBVHBounds besideWall = makeBox(60.0f, 0.0f, -50.0f, 2.0f);
+	QBVHBounds inFront = makeBox(0.0f, 0.0f, -5.0f, 1.0f);
+	QBVHBounds offScreen = makeBox(500.0f, 0.0f, -50.0f, 1.0f);
+
+	QTEST_CHECK(occlusion.testAabb(hidden) == QOcclusionResult::OCCLUDED);
+	QTEST_CHECK(occlusion.testAabb(besideWall) == QOcclusionResult::VISIBLE);
+	QTEST_CHECK(occlusion.testAabb(inFront) == QOcclusionResult::VISIBLE);
+	QTEST_CHECK(occlusion.testAabb(offScreen) == QOcclusionResult::VIEW_CULLED);
+
+	// The batched path agrees with the single test and keeps the input order.
+	QBVHBounds boxes[4] = { besideWall, hidden, offScreen, inFront };
+	std::vector<uint32_t> visible;
+	occlusion.testAabbs(boxes, 4, jobSystem, visible);
+	QTEST_CHECK(visible.size() == 2 && visible[0] == 0 && visible[1] == 3);
+
+	// Seen from behind the wall is back-facing and draws nothing, unless culling is turned off.
+	occlusion.clear();
+	occlusion.addOccluder(WALL_POSITIONS, WALL_INDICES_REVERSED, 2);
+	occlusion.render(jobSystem);
+	QTEST_CHECK(occlusion.testAabb(hidden) == QOcclusionResult::VISIBLE);
+
+	occlusion.clear();
+	occlusion.addOccluder(WALL_POSITIONS, WALL_INDICES_REVERSED, 2, nullptr, false);
+	occlusion.render(jobSystem);
+	QTEST_CHECK(occlusion.testAabb(hidden) == QOcclusionResult::OCCLUDED);
+}
+
+// A few hundred boxes as occluders and 100k objects to test, timed. Anything behind the wall's middle
+// must come out occluded whatever else is in the scene.
+static void testTimed(QJobSystem* jobSystem) {
+	const uint32_t occluderCount = 300;
+	const uint32_t objectCount = 100000;
+	static const uint32_t CUBE_INDICES[36] = {
+		0, 1, 2, 0, 2, 3, 4, 6, 5, 4, 7, 6, 0, 4, 5, 0, 5, 1, 1, 5, 6, 1, 6, 2, 2, 6, 7, 2, 7, 3, 3, 7, 4, 3, 4, 0
+	};
+
+	std::mt19937 random(7);
+	std::uniform_real_distribution<float> spread(-40.0f, 40.0f);
+	std::uniform_real_distribution<float> depth(-120.0f, -15.0f);
+	std::uniform_real_distribution<float> size(0.5f, 6.0f);
+
+	std::vector<float> cubes;
+	for (uint32_t i = 0; i < occluderCount; i++) {
+		float center[3] = { spread(random), spread(random) * 0.5f, depth(random) };
+		float extent[3] = { size(random), size(random), size(random) };
+		for (uint32_t corner = 0; corner < 8; corner++) {
+			bool right = corner == 1 || corner == 2 || corner == 5 || corner == 6;
+			bool top = corner == 2 || corner == 3 || corner == 6 || corner == 7;
+			cubes.push_back(center[0] + (right ? extent[0] : -extent[0]));
+			cubes.push_back(center[1] + (top ? extent[1] : -extent[1]));
+			cubes.push_back(center[2] + (corner >= 4 ? extent[2] : -extent[2]));
+		}
+	}
+
+	std::uniform_real_distribution<float> objectDepth(-200.0f, -1.0f);
+	std::uniform_real_distribution<float> objectSize(0.1f, 2.0f);
+	std::vector<QBVHBounds> objects(objectCount);
+	for (QBVHBounds& object : objects) {
+		object = makeBox(spread(random) * 1.5f, spread(random) * 0.75f, objectDepth(random), objectSize(random));
+	}
+
+	QMaskedOcclusion occlusion;
+	occlusion.setViewProjection(VIEW_PROJECTION);
+	occlusion.clear();
+	occlusion.addOccluder(WALL_POSITIONS, WALL_INDICES, 2);
+	for (uint32_t i = 0; i < occluderCount; i++) {
+		// The cubes are wound either way, so draw both sides.
+		occlusion.addOccluder(&cubes[i * 24], CUBE_INDICES, 12, nullptr, false);
+	}
+	occlusion.render(jobSystem);
+
+	std::vector<uint32_t> visible;
+	occlusion.testAabbs(objects.data(), objectCount, jobSystem, visible);
+
+	QMaskedOcclusionStats stats = occlusion.getStats();
+	QTEST_CHECK(stats.testedObjects == objectCount);
+	QTEST_CHECK(stats.visibleObjects == visible.size());
+	QTEST_CHECK(stats.occludedObjects > 0);
+	QTEST_CHECK(occlusion.testAabb(makeBox(0.0f, 0.0f, -150.0f, 1.0f)) == QOcclusionResult::OCCLUDED);
+
+	std::printf("%u lanes, %u workers: %u occluder triangles rendered in %.3f ms, %u objects tested in %.3f ms, %u occluded\n",
+		stats.simdWidth, stats.workerCount, stats.occluderTriangles, stats.renderMs, stats.testedObjects, stats.testMs,
+		stats.occludedObjects);
+}
+
+int main() {
+	QJobSystem jobSystem;
+
+	testHiddenAndVisible(&jobSystem);
+	testTimed(&jobSystem);
+
+	return qTestResult("TestMaskedOcclusion");
+}
@@ -0,0 +1,157 @@
+#include "QTest.h"
+#include "MockDeviceMemory.h"
+#include <stdexcept>
+
+static VkMemoryRequirements makeRequirements(VkDeviceSize size, VkDeviceSize alignment) {
+	VkMemoryRequirements requirements = {};
+	requirements.size = size;
+	requirements.alignment = alignment;
+	requirements.memoryTypeBits = 0x7;
+	return requirements;
+}
+
+static void testMemoryTypeSelection() {
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	VkPhysicalDeviceLimits limits;
+	mockDiscreteGpu(memoryProperties, limits);
+
+	MockDeviceMemory backend;
+	VulkanMemoryAllocator allocator(memoryProperties, limits, &backend);
+
+	VulkanAllocation* gpuOnly = allocator.allocate(makeRequirements(4096, 256), VulkanMemoryUsage::GPU_ONLY, QTlsfResourceKind::OPTIMAL);
+	VulkanAllocation* upload = allocator.allocate(makeRequirements(4096, 256), VulkanMemoryUsage::CPU_TO_GPU, QTlsfResourceKind::LINEAR);
+	VulkanAllocation* readback = allocator.allocate(makeRequirements(4096, 256), VulkanMemoryUsage::GPU_TO_CPU, QTlsfResourceKind::LINEAR);
+
+	QTEST_CHECK(gpuOnly->memoryTypeIndex == 0);
+	QTEST_CHECK(gpuOnly->mapped == nullptr);
+	QTEST_CHECK(upload->memoryTypeIndex == 1);
+	QTEST_CHECK(upload->mapped != nullptr);
+	QTEST_CHECK(readback->memoryTypeIndex == 2);
+
+	// One block per memory type, each persistently mapped once if host visible.
+	QTEST_CHECK(backend.allocateCount == 3);
+	QTEST_CHECK(backend.mapCount == 2);
+
+	allocator.free(readback);
+	allocator.free(upload);
+	allocator.free(gpuOnly);
+}
+
+static void testSubAllocation() {
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	VkPhysicalDeviceLimits limits;
+	mockDiscreteGpu(memoryProperties, limits);
+
+	MockDeviceMemory backend;
+	{
+		VulkanMemoryAllocator allocator(memoryProperties, limits, &backend);
+
+		std::vector<VulkanAllocation*> allocations;
+		for (uint32_t i = 0; i < 1000; i++) {
+			VkDeviceSize alignment = 1ull << (i % 9);
+			QTlsfResourceKind kind = (i % 3 == 0) ? QTlsfResourceKind::OPTIMAL : QTlsfResourceKind::LINEAR;
+
+			VulkanAllocation* allocation = allocator.allocate(makeRequirements(64 * 1024 + i, alignment), VulkanMemoryUsage::GPU_ONLY, kind);
+			QTEST_CHECK(allocation->offset % alignment == 0);
+			QTEST_CHECK(allocation->block != nullptr);
+			allocations.push_back(allocation);
+		}
+
+		// A thousand resources, but the device only saw one allocation for the whole lot.
+		VulkanMemoryStats stats = allocator.getStats();
+		QTEST_CHECK(stats.allocationCount == 1000);
+		QTEST_CHECK(stats.blockCount == 1);
+		QTEST_CHECK(stats.deviceAllocationCount == 1);
+		QTEST_CHECK(backend.allocateCount == 1);
+
+		for (VulkanAllocation* allocation : allocations) {
+			allocator.free(allocation);
+		}
+
+		// The last empty block of a type stays around for the next burst of streaming.
+		stats = allocator.getStats();
+		QTEST_CHECK(stats.allocationCount == 0);
+		QTEST_CHECK(stats.blockCount == 1);
+		QTEST_CHECK(backend.liveCount == 1);
+	}
+
+	QTEST_CHECK(backend.liveCount == 0);
+}
+
+static void testDedicatedAllocations() {
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	VkPhysicalDeviceLimits limits;
+	mockDiscreteGpu(memoryProperties, limits);
+
+	MockDeviceMemory backend;
+	VulkanMemoryAllocator allocator(memoryProperties, limits, &backend);
+
+	// Anything over half a block, or anything the driver asks to be dedicated, gets its own memory.
+	VulkanAllocation* large = allocator.allocate(makeRequirements(MEMORY_BLOCK_SIZE / 2 + 1, 256), VulkanMemoryUsage::GPU_ONLY, QTlsfResourceKind::OPTIMAL);
+	VulkanAllocation* preferred = allocator.allocate(makeRequirements(4096, 256), VulkanMemoryUsage::GPU_ONLY, QTlsfResourceKind::OPTIMAL, true);
+
+	QTEST_CHECK(large->block == nullptr);
+	QTEST_CHECK(large->offset == 0);
+	QTEST_CHECK(preferred->block == nullptr);
+
+	VulkanMemoryStats stats = allocator.getStats();
+	QTEST_CHECK(stats.dedicatedCount == 2);
+	QTEST_CHECK(stats.blockCount == 0);
+
+	allocator.free(large);
+	allocator.free(preferred);
+	QTEST_CHECK(backend.liveCount == 0);
+}
+
+static void testMemoryPressure() {
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	VkPhysicalDeviceLimits limits;
+	mockDiscreteGpu(memoryProperties, limits);
+
+	// The device refuses a full block, so the allocator retries with halved blocks until one fits.
+	MockDeviceMemory backend(MEMORY_BLOCK_SIZE / 4);
+	VulkanMemoryAllocator allocator(memoryProperties, limits, &backend);
+
+	VulkanAllocation* allocation = allocator.allocate(makeRequirements(1024 * 1024, 256), VulkanMemoryUsage::GPU_ONLY, QTlsfResourceKind::LINEAR);
+	QTEST_CHECK(allocation != nullptr);
+	QTEST_CHECK(backend.failedCount == 2);
+	QTEST_CHECK(backend.lastAllocationSize == MEMORY_BLOCK_SIZE / 4);
+
+	allocator.free(allocation);
+}
+
+static void testAllocationCountLimit() {
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	VkPhysicalDeviceLimits limits;
+	mockDiscreteGpu(memoryProperties, limits);
+	limits.maxMemoryAllocationCount = 2;
+
+	MockDeviceMemory backend;
+	VulkanMemoryAllocator allocator(memoryProperties, limits, &backend);
+
+	VulkanAllocation* first = allocator.allocate(makeRequirements(4096, 256), VulkanMemoryUsage::GPU_ONLY, QTlsfResourceKind::LINEAR, true);
+	VulkanAllocation* second = allocator.allocate(makeRequirements(4096, 256), VulkanMemoryUsage::GPU_ONLY, QTlsfResourceKind::LINEAR, true);
+
+	bool threw = false;
+	try {
+		allocator.allocate(makeRequirements(4096, 256), VulkanMemoryUsage::GPU_ONLY, QTlsfResourceKind::LINEAR, true);
+	} catch (const std::runtime_error&) {
+		threw = true;
+	}
+
+	QTEST_CHECK(threw);
+	QTEST_CHECK(backend.allocateCount == 2);
+
+	allocator.free(first);
+	allocator.free(second);
+}
+
+int main() {
+	testMemoryTypeSelection();
+	testSubAllocation();
+	testDedicatedAllocations();
+	testMemoryPressure();
+	testAllocationCountLimit();
+
+	return qTestResult("TestMemoryAllocator");
+}
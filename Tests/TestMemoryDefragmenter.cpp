@@ -0,0 +1,177 @@
+#include "QTest.h"
+#include "MockDeviceMemory.h"
+#include "VulkanMemoryDefragmenter.h"
+#include <random>
+
+// 512 MiB of device local memory, so blocks are 64 MiB.
+static void mockSmallGpu(VkPhysicalDeviceMemoryProperties& outMemoryProperties, VkPhysicalDeviceLimits& outLimits) {
+	outMemoryProperties = {};
+	outMemoryProperties.memoryHeapCount = 1;
+	outMemoryProperties.memoryHeaps[0].size = 512ull * 1024 * 1024;
+	outMemoryProperties.memoryTypeCount = 1;
+	outMemoryProperties.memoryTypes[0].propertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+	outLimits = {};
+	outLimits.bufferImageGranularity = 1;
+	outLimits.maxMemoryAllocationCount = 4096;
+}
+
+// What createBuffer(..., movable = true) records, minus the real buffer.
+static void markMovable(VulkanAllocation* allocation, uint64_t fakeBuffer) {
+	allocation->buffer = (VkBuffer)(uintptr_t)fakeBuffer;
+	allocation->bufferSize = allocation->size;
+	allocation->bufferUsage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+	allocation->movable = true;
+}
+
+// Fills several blocks, then frees three quarters of the allocations at random, leaving every block sparse.
+static void fragment(VulkanMemoryAllocator& allocator, bool movable, std::vector<VulkanAllocation*>& outLive) {
+	std::mt19937 random(3);
+	std::vector<VulkanAllocation*> allocations;
+
+	for (uint32_t i = 0; i < 6000; i++) {
+		VkMemoryRequirements requirements = {};
+		requirements.size = (1 + random() % 64) * 1024;
+		requirements.alignment = 256;
+		requirements.memoryTypeBits = 1;
+
+		VulkanAllocation* allocation = allocator.allocate(requirements, VulkanMemoryUsage::GPU_ONLY, QTlsfResourceKind::LINEAR);
+		if (movable) {
+			markMovable(allocation, i + 1);
+		}
+
+		allocations.push_back(allocation);
+	}
+
+	outLive.clear();
+	for (VulkanAllocation* allocation : allocations) {
+		if (random() % 4 == 0) {
+			outLive.push_back(allocation);
+		} else {
+			allocator.free(allocation);
+		}
+	}
+}
+
+static void testNothingMovesWithoutOptIn() {
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	VkPhysicalDeviceLimits limits;
+	mockSmallGpu(memoryProperties, limits);
+
+	MockDeviceMemory backend;
+	VulkanMemoryAllocator allocator(memoryProperties, limits, &backend);
+
+	std::vector<VulkanAllocation*> live;
+	fragment(allocator, true, live);
+
+	std::vector<VulkanDefragMove> moves;
+	{
+		// Movable buffers, but no callback to hand the new handles to.
+		VulkanMemoryDefragmenter defragmenter(&allocator, 0);
+		QTEST_CHECK(defragmenter.planMoves(moves) == 0);
+	}
+
+	for (VulkanAllocation* allocation : live) {
+		allocation->movable = false;
+	}
+
+	{
+		// A callback, but buffers that were not created movable.
+		VulkanMemoryDefragmenter defragmenter(&allocator, 0);
+		defragmenter.setMoveCallback([](VulkanAllocation*, VkBuffer) {});
+		QTEST_CHECK(defragmenter.planMoves(moves) == 0);
+	}
+
+	for (VulkanAllocation* allocation : live) {
+		allocator.free(allocation);
+	}
+}
+
+static void testCompaction() {
+	VkPhysicalDeviceMemoryProperties memoryProperties;
+	VkPhysicalDeviceLimits limits;
+	mockSmallGpu(memoryProperties, limits);
+
+	MockDeviceMemory backend;
+	VulkanMemoryAllocator allocator(memoryProperties, limits, &backend);
+
+	std::vector<VulkanAllocation*> live;
+	fragment(allocator, true, live);
+
+	VulkanMemoryStats before = allocator.getStats();
+	QTEST_CHECK(before.blockCount >= 3);
+
+	const uint32_t maxMoves = 64;
+	const VkDeviceSize maxBytes = 2ull * 1024 * 1024;
+	const uint32_t frameCount = 2;
+
+	VulkanMemoryDefragmenter defragmenter(&allocator, 0, maxMoves, maxBytes);
+
+	uint32_t callbackCount = 0;
+	bool staleBuffer = false;
+	defragmenter.setMoveCallback([&](VulkanAllocation* allocation, VkBuffer oldBuffer) {
+		callbackCount++;
+		staleBuffer = staleBuffer || allocation->buffer == oldBuffer;
+	});
+
+	std::vector<VulkanDefragMove> moves;
+	uint32_t frame = 0;
+	uint64_t nextBuffer = 1000000;
+
+	for (; frame < 1000; frame++) {
+		uint32_t frameIndex = frame % frameCount;
+		defragmenter.releaseFrame(frameIndex);
+
+		if (defragmenter.planMoves(moves) == 0) {
+			break;
+		}
+
+		// Every frame stays within its move and byte budgets.
+		VkDeviceSize plannedBytes = 0;
+		for (const VulkanDefragMove& move : moves) {
+			plannedBytes += move.size;
+			QTEST_CHECK(move.dstOffset % move.allocation->alignment == 0);
+			QTEST_CHECK(move.srcBlock != move.dstBlock);
+		}
+
+		QTEST_CHECK(moves.size() <= maxMoves);
+		QTEST_CHECK(plannedBytes <= maxBytes);
+
+		for (const VulkanDefragMove& move : moves) {
+			defragmenter.commitMove(move, (VkBuffer)(uintptr_t)(nextBuffer++), frameIndex);
+		}
+
+		// Old ranges are held until their frame slot comes around again.
+		QTEST_CHECK(defragmenter.getStats().pendingReleases > 0);
+	}
+
+	for (uint32_t i = 0; i < frameCount; i++) {
+		defragmenter.releaseFrame(i);
+	}
+
+	VulkanMemoryStats after = allocator.getStats();
+	VulkanDefragStats defragStats = defragmenter.getStats();
+
+	QTEST_CHECK(frame < 1000);
+	QTEST_CHECK(defragStats.movesTotal == callbackCount);
+	QTEST_CHECK(defragStats.pendingReleases == 0);
+	QTEST_CHECK(!staleBuffer);
+	QTEST_CHECK(after.allocationCount == before.allocationCount);
+	QTEST_CHECK(after.usedBytes == before.usedBytes);
+	QTEST_CHECK(after.blockCount < before.blockCount);
+
+	std::printf("compaction: %u blocks -> %u in %u frames, %llu moves, fragmentation %.3f -> %.3f\n",
+		before.blockCount, after.blockCount, frame, static_cast<unsigned long long>(defragStats.movesTotal),
+		before.fragmentation, after.fragmentation);
+
+	for (VulkanAllocation* allocation : live) {
+		allocator.free(allocation);
+	}
+}
+
+int main() {
+	testNothingMovesWithoutOptIn();
+	testCompaction();
+
+	return qTestResult("TestMemoryDefragmenter");
+}
@@ -0,0 +1,138 @@
+#include "QTest.h"
+#include "QMeshDeduplicator.h"
+#include <cstring>
+#include <stdexcept>
+
+struct TestVertex {
+	float position[3];
+	float uv[2];
+};
+
+static const TestVertex QUAD_VERTICES[4] = {
+	{ { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f } },
+	{ { 1.0f, 0.0f, 0.0f }, { 1.0f, 0.0f } },
+	{ { 1.0f, 1.0f, 0.0f }, { 1.0f, 1.0f } },
+	{ { 0.0f, 1.0f, 0.0f }, { 0.0f, 1.0f } }
+};
+static const uint32_t QUAD_INDICES[6] = { 0, 1, 2, 0, 2, 3 };
+static const uint32_t QUAD_INDICES_FLIPPED[6] = { 0, 2, 1, 0, 3, 2 };
+
+static const TestVertex TRIANGLE_VERTICES[3] = {
+	{ { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f } },
+	{ { 1.0f, 0.0f, 1.0f }, { 1.0f, 0.0f } },
+	{ { 0.0f, 1.0f, 1.0f }, { 0.0f, 1.0f } }
+};
+static const uint32_t TRIANGLE_INDICES[3] = { 0, 1, 2 };
+
+static const uint32_t QUAD_BYTES = sizeof(QUAD_VERTICES) + sizeof(QUAD_INDICES);
+static const uint32_t TRIANGLE_BYTES = sizeof(TRIANGLE_VERTICES) + sizeof(TRIANGLE_INDICES);
+
+static void testHitsAndMisses() {
+	QMeshDeduplicator deduplicator(sizeof(TestVertex));
+
+	uint32_t quad = deduplicator.add(QUAD_VERTICES, 4, QUAD_INDICES, 6);
+	uint32_t triangle = deduplicator.add(TRIANGLE_VERTICES, 3, TRIANGLE_INDICES, 3);
+	QTEST_CHECK(quad == 0 && triangle == 1);
+
+	// A copy from other memory is found by content, not by address.
+	TestVertex vertexCopy[4];
+	uint32_t indexCopy[6];
+	memcpy(vertexCopy, QUAD_VERTICES, sizeof(vertexCopy));
+	memcpy(indexCopy, QUAD_INDICES, sizeof(indexCopy));
+	QTEST_CHECK(deduplicator.add(vertexCopy, 4, indexCopy, 6) == quad);
+	QTEST_CHECK(deduplicator.add(QUAD_VERTICES, 4, QUAD_INDICES, 6) == quad);
+
+	// Same vertices with other indices, or one vertex moved, is another mesh.
+	uint32_t flipped = deduplicator.add(QUAD_VERTICES, 4, QUAD_INDICES_FLIPPED, 6);
+	QTEST_CHECK(flipped == 2);
+	vertexCopy[2].position[2] = 0.5f;
+	uint32_t bent = deduplicator.add(vertexCopy, 4, QUAD_INDICES, 6);
+	QTEST_CHECK(bent == 3);
+
+	QTEST_CHECK(deduplicator.getMeshCount() == 4);
+	QTEST_CHECK(deduplicator.getMesh(quad).referenceCount == 3);
+	QTEST_CHECK(deduplicator.getMesh(triangle).referenceCount == 1);
+	QTEST_CHECK(deduplicator.getMesh(flipped).referenceCount == 1);
+
+	// Packed one after another; indices stay relative to each mesh's first vertex.
+	const QUniqueMesh& triangleMesh = deduplicator.getMesh(triangle);
+	QTEST_CHECK(triangleMesh.firstVertex == 4 && triangleMesh.vertexCount == 3);
+	QTEST_CHECK(triangleMesh.firstIndex == 6 && triangleMesh.indexCount == 3);
+	QTEST_CHECK(deduplicator.getVertexData().size() == sizeof(TestVertex) * (4 + 3 + 4 + 4));
+	QTEST_CHECK(deduplicator.getIndexData().size() == 6 + 3 + 6 + 6);
+	QTEST_CHECK(memcmp(deduplicator.getVertexData().data() + sizeof(TestVertex) * 4, TRIANGLE_VERTICES, sizeof(TRIANGLE_VERTICES)) == 0);
+	QTEST_CHECK(memcmp(deduplicator.getIndexData().data() + 6, TRIANGLE_INDICES, sizeof(TRIANGLE_INDICES)) == 0);
+
+	QMeshDeduplicatorStats stats = deduplicator.getStats();
+	QTEST_CHECK(stats.addedMeshes == 6);
+	QTEST_CHECK(stats.uniqueMeshes == 4);
+	QTEST_CHECK(stats.addedBytes == 5 * QUAD_BYTES + TRIANGLE_BYTES);
+	QTEST_CHECK(stats.storedBytes == 3 * QUAD_BYTES + TRIANGLE_BYTES);
+
+	deduplicator.clear();
+	QTEST_CHECK(deduplicator.getMeshCount() == 0);
+	QTEST_CHECK(deduplicator.getVertexData().empty() && deduplicator.getIndexData().empty());
+	QTEST_CHECK(deduplicator.getStats().addedMeshes == 0 && deduplicator.getStats().storedBytes == 0);
+	QTEST_CHECK(deduplicator.add(TRIANGLE_VERTICES, 3, TRIANGLE_INDICES, 3) == 0);
+}
+
+// The same FNV-1a step the deduplicator hashes each 8-byte word with.
+static uint64_t hashWord(uint64_t hash, uint64_t word) {
+	return (hash ^ word) * 1099511628211ull;
+}
+
+// Two meshes of two 8-byte vertices that hash the same: after the first word differs, the second is
+// chosen to bring the hash state back together. Only the byte compare can tell them apart.
+static void testHashCollision() {
+	const uint32_t indices[3] = { 0, 1, 1 };
+	uint64_t state = hashWord(hashWord(14695981039346656037ull, 16), 3);
+
+	uint64_t first[2] = { 0x1111111111111111ull, 0x2222222222222222ull };
+	uint64_t second[2] = { first[0] ^ 1, 0 };
+	second[1] = first[1] ^ hashWord(state, first[0]) ^ hashWord(state, second[0]);
+
+	uint64_t firstHash = QMeshDeduplicator::hashMesh(first, sizeof(first), indices, 3);
+	QTEST_CHECK(firstHash == QMeshDeduplicator::hashMesh(second, sizeof(second), indices, 3));
+
+	QMeshDeduplicator deduplicator(sizeof(uint64_t));
+	uint32_t firstMesh = deduplicator.add(first, 2, indices, 3);
+	uint32_t secondMesh = deduplicator.add(second, 2, indices, 3);
+	QTEST_CHECK(firstMesh != secondMesh);
+	QTEST_CHECK(deduplicator.getMesh(firstMesh).hash == deduplicator.getMesh(secondMesh).hash);
+
+	// Both stay findable behind the shared hash.
+	QTEST_CHECK(deduplicator.add(second, 2, indices, 3) == secondMesh);
+	QTEST_CHECK(deduplicator.add(first, 2, indices, 3) == firstMesh);
+	QTEST_CHECK(deduplicator.getStats().uniqueMeshes == 2);
+	QTEST_CHECK(memcmp(deduplicator.getVertexData().data() + sizeof(first), second, sizeof(second)) == 0);
+}
+
+static void testInvalidMeshes() {
+	QMeshDeduplicator deduplicator(sizeof(TestVertex));
+	const uint32_t outOfRange[3] = { 0, 1, 3 };
+
+	bool threw = false;
+	try {
+		deduplicator.add(TRIANGLE_VERTICES, 3, outOfRange, 3);
+	} catch (const std::runtime_error&) {
+		threw = true;
+	}
+	QTEST_CHECK(threw);
+
+	threw = false;
+	try {
+		deduplicator.add(TRIANGLE_VERTICES, 3, TRIANGLE_INDICES, 0);
+	} catch (const std::runtime_error&) {
+		threw = true;
+	}
+	QTEST_CHECK(threw);
+	QTEST_CHECK(deduplicator.getMeshCount() == 0);
+}
+
+int main() {
+	testHitsAndMisses();
+	testHashCollision();
+	testInvalidMeshes();
+
+	return qTestResult("TestMeshDeduplicator");
+}
@@ -0,0 +1,110 @@
+#include "QTest.h"
+#include "QRadixSort.h"
+#include <algorithm>
+#include <random>
+
+// Sorts keys carrying their original index and checks the result against std::stable_sort, which
+// also checks stability since equal keys must keep their indices in order.
+static bool sortsLikeStableSort(QRadixSort& radixSort, const std::vector<uint64_t>& input, QJobSystem* jobSystem) {
+	uint32_t count = static_cast<uint32_t>(input.size());
+	std::vector<uint64_t> keys = input;
+	std::vector<uint32_t> values(count);
+	for (uint32_t i = 0; i < count; i++) {
+		values[i] = i;
+	}
+
+	radixSort.sort(keys.data(), values.data(), count, jobSystem);
+
+	std::vector<uint32_t> expected(values.size());
+	for (uint32_t i = 0; i < count; i++) {
+		expected[i] = i;
+	}
+	std::stable_sort(expected.begin(), expected.end(), [&input](uint32_t a, uint32_t b) { return input[a] < input[b]; });
+
+	for (uint32_t i = 0; i < count; i++) {
+		if (values[i] != expected[i] || keys[i] != input[expected[i]]) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Random keys with the given bits free and every other bit fixed, from a small pool so keys repeat.
+static std::vector<uint64_t> makeKeys(uint32_t count, uint64_t freeBits, uint64_t fixedBits, uint32_t distinctCount, uint32_t seed) {
+	std::mt19937_64 random(seed);
+	std::vector<uint64_t> pool(distinctCount);
+	for (uint64_t& key : pool) {
+		key = (random() & freeBits) | (fixedBits & ~freeBits);
+	}
+
+	std::vector<uint64_t> keys(count);
+	for (uint64_t& key : keys) {
+		key = pool[random() % distinctCount];
+	}
+
+	return keys;
+}
+
+static void testPassCounts(QJobSystem* jobSystem) {
+	QRadixSort radixSort;
+
+	// Only the lowest byte varies: one pass, so the result comes back from scratch.
+	QTEST_CHECK(sortsLikeStableSort(radixSort, makeKeys(5000, 0xFFull, 0x1234567890ABCD00ull, 64, 1), jobSystem));
+	QTEST_CHECK(radixSort.getLastPassCount() == 1);
+
+	// Two varying bytes: an even count ends in the caller's arrays.
+	QTEST_CHECK(sortsLikeStableSort(radixSort, makeKeys(5000, 0xFFFFull, 0, 300, 2), jobSystem));
+	QTEST_CHECK(radixSort.getLastPassCount() == 2);
+
+	// Three bytes spread over the key, with constant bytes between them that are skipped.
+	QTEST_CHECK(sortsLikeStableSort(radixSort, makeKeys(5000, 0xFF0000FF0000FF00ull, 0x00AA00000000000Full, 500, 3), jobSystem));
+	QTEST_CHECK(radixSort.getLastPassCount() == 3);
+
+	// Every key equal: nothing to do.
+	QTEST_CHECK(sortsLikeStableSort(radixSort, std::vector<uint64_t>(100, 0xDEADBEEFull), jobSystem));
+	QTEST_CHECK(radixSort.getLastPassCount() == 0);
+
+	// Fully random keys need all eight bytes.
+	QTEST_CHECK(sortsLikeStableSort(radixSort, makeKeys(5000, ~0ull, 0, 5000, 4), jobSystem));
+	QTEST_CHECK(radixSort.getLastPassCount() == 8);
+}
+
+static void testSmallCounts(QJobSystem* jobSystem) {
+	QRadixSort radixSort;
+
+	radixSort.sort(nullptr, nullptr, 0, jobSystem);
+	QTEST_CHECK(radixSort.getLastPassCount() == 0);
+
+	uint64_t key = 42;
+	uint32_t value = 7;
+	radixSort.sort(&key, &value, 1, jobSystem);
+	QTEST_CHECK(key == 42 && value == 7);
+	QTEST_CHECK(radixSort.getLastPassCount() == 0);
+
+	QTEST_CHECK(sortsLikeStableSort(radixSort, { 3, 1, 2, 1 }, jobSystem));
+}
+
+// A tiny minimum block size and several workers split even small inputs into many blocks, which is
+// where the per-block offsets have to keep equal keys in order across blocks.
+static void testMultipleBlocks() {
+	QJobSystem jobSystem(4);
+	QRadixSort radixSort(16);
+
+	QTEST_CHECK(sortsLikeStableSort(radixSort, makeKeys(1000, 0xFFFFFFull, 0, 50, 5), &jobSystem));
+	QTEST_CHECK(radixSort.getLastPassCount() == 3);
+
+	// Uneven last block, and fewer keys than workers times the block size.
+	QTEST_CHECK(sortsLikeStableSort(radixSort, makeKeys(1001, 0xFF00ull, 0, 7, 6), &jobSystem));
+	QTEST_CHECK(sortsLikeStableSort(radixSort, makeKeys(37, ~0ull, 0, 10, 7), &jobSystem));
+}
+
+int main() {
+	QJobSystem jobSystem;
+
+	testPassCounts(&jobSystem);
+	testSmallCounts(&jobSystem);
+	testMultipleBlocks();
+
+	return qTestResult("TestRadixSort");
+}
@@ -0,0 +1,391 @@
+#include "QTest.h"
+#include "VulkanRenderGraph.h"
+
+// The graph only talks to the driver through vkCmdPipelineBarrier2 when it has no allocator, so the test
+// defines it and records what would have been submitted. Passes log themselves in between.
+struct RecordedBarrier {
+	uint32_t beforePass;
+	VkImageMemoryBarrier2 barrier;
+};
+
+struct RecordedBufferBarrier {
+	uint32_t beforePass;
+	VkBufferMemoryBarrier2 barrier;
+};
+
+static std::vector<RecordedBarrier> recordedBarriers;
+static std::vector<RecordedBufferBarrier> recordedBufferBarriers;
+static std::vector<std::string> executedPasses;
+
+VKAPI_ATTR void VKAPI_CALL vkCmdPipelineBarrier2(VkCommandBuffer, const VkDependencyInfo* dependencyInfo) {
+	for (uint32_t i = 0; i < dependencyInfo->imageMemoryBarrierCount; i++) {
+		RecordedBarrier recorded = { static_cast<uint32_t>(executedPasses.size()), dependencyInfo->pImageMemoryBarriers[i] };
+		recordedBarriers.push_back(recorded);
+	}
+
+	for (uint32_t i = 0; i < dependencyInfo->bufferMemoryBarrierCount; i++) {
+		RecordedBufferBarrier recorded = { static_cast<uint32_t>(executedPasses.size()), dependencyInfo->pBufferMemoryBarriers[i] };
+		recordedBufferBarriers.push_back(recorded);
+	}
+}
+
+static const RecordedBufferBarrier* findBufferBarrier(uint32_t beforePass, VkBuffer buffer) {
+	for (const RecordedBufferBarrier& recorded : recordedBufferBarriers) {
+		if (recorded.beforePass == beforePass && recorded.barrier.buffer == buffer) {
+			return &recorded;
+		}
+	}
+
+	return nullptr;
+}
+
+static const RecordedBarrier* findBarrier(uint32_t beforePass, VkImageLayout oldLayout, VkImageLayout newLayout) {
+	for (const RecordedBarrier& recorded : recordedBarriers) {
+		if (recorded.beforePass == beforePass && recorded.barrier.oldLayout == oldLayout && recorded.barrier.newLayout == newLayout) {
+			return &recorded;
+		}
+	}
+
+	return nullptr;
+}
+
+// depth -> lighting -> tonemap -> swapchain, plus a debug view of the depth buffer nobody reads.
+static void testCompile() {
+	VulkanGraphImageDesc colorDesc;
+	colorDesc.extent = { 1920, 1080 };
+	colorDesc.format = VK_FORMAT_R8G8B8A8_UNORM;
+
+	VulkanGraphImageDesc depthDesc = colorDesc;
+	depthDesc.format = VK_FORMAT_D32_SFLOAT;
+	depthDesc.aspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+
+	VulkanGraphImageDesc hdrDesc = colorDesc;
+	hdrDesc.format = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+	VulkanRenderGraph graph;
+	VulkanRenderGraph::Resource swapchain = graph.importImage(
+		"swapchain", colorDesc, (VkImage)(uintptr_t)1, (VkImageView)(uintptr_t)2, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	VulkanRenderGraph::Resource depth = graph.createImage("depth", depthDesc);
+	VulkanRenderGraph::Resource debugView = graph.createImage("debug view", colorDesc);
+	VulkanRenderGraph::Resource hdr = graph.createImage("hdr", hdrDesc);
+
+	auto logPass = [](const char* name) {
+		return [name](VkCommandBuffer, VulkanRenderGraph&) { executedPasses.push_back(name); };
+	};
+
+	VulkanRenderGraph::Pass depthPass = graph.addPass("depth", logPass("depth"));
+	graph.write(depthPass, depth, VulkanGraphAccess::DEPTH_ATTACHMENT);
+
+	VulkanRenderGraph::Pass debugPass = graph.addPass("debug", logPass("debug"));
+	graph.read(debugPass, depth, VulkanGraphAccess::SAMPLED_GRAPHICS);
+	graph.write(debugPass, debugView, VulkanGraphAccess::COLOR_ATTACHMENT);
+
+	VulkanRenderGraph::Pass lightingPass = graph.addPass("lighting", logPass("lighting"));
+	graph.read(lightingPass, depth, VulkanGraphAccess::SAMPLED_COMPUTE);
+	graph.write(lightingPass, hdr, VulkanGraphAccess::STORAGE_WRITE);
+
+	VulkanRenderGraph::Pass tonemapPass = graph.addPass("tonemap", logPass("tonemap"));
+	graph.read(tonemapPass, hdr, VulkanGraphAccess::SAMPLED_GRAPHICS);
+	graph.write(tonemapPass, swapchain, VulkanGraphAccess::COLOR_ATTACHMENT);
+
+	graph.compile();
+
+	// Only the debug pass feeds nothing that reaches an import.
+	QTEST_CHECK(!graph.isCulled(depthPass));
+	QTEST_CHECK(graph.isCulled(debugPass));
+	QTEST_CHECK(!graph.isCulled(lightingPass));
+	QTEST_CHECK(!graph.isCulled(tonemapPass));
+
+	VulkanGraphStats stats = graph.getStats();
+	QTEST_CHECK(stats.passCount == 4);
+	QTEST_CHECK(stats.culledPasses == 1);
+	QTEST_CHECK(stats.batchCount == 1);
+	QTEST_CHECK(stats.barrierCount == 6);
+
+	graph.execute(VK_NULL_HANDLE);
+
+	QTEST_CHECK(executedPasses.size() == 3);
+	QTEST_CHECK(executedPasses.size() == 3 && executedPasses[0] == "depth" && executedPasses[1] == "lighting" && executedPasses[2] == "tonemap");
+	QTEST_CHECK(recordedBarriers.size() == 6);
+
+	// Transients start undefined.
+	const RecordedBarrier* depthInit = findBarrier(0, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL);
+	QTEST_CHECK(depthInit != nullptr);
+	QTEST_CHECK(depthInit != nullptr && depthInit->barrier.subresourceRange.aspectMask == VK_IMAGE_ASPECT_DEPTH_BIT);
+
+	// Depth written by the fragment tests, then sampled by compute.
+	const RecordedBarrier* depthRead = findBarrier(1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	QTEST_CHECK(depthRead != nullptr);
+	if (depthRead != nullptr) {
+		QTEST_CHECK(depthRead->barrier.srcStageMask == (VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT));
+		QTEST_CHECK(depthRead->barrier.srcAccessMask & VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+		QTEST_CHECK(depthRead->barrier.dstStageMask == VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+		QTEST_CHECK(depthRead->barrier.dstAccessMask == VK_ACCESS_2_SHADER_SAMPLED_READ_BIT);
+	}
+
+	QTEST_CHECK(findBarrier(1, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL) != nullptr);
+
+	// Storage writes from compute become visible to the tonemap's fragment sampling.
+	const RecordedBarrier* hdrRead = findBarrier(2, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	QTEST_CHECK(hdrRead != nullptr);
+	if (hdrRead != nullptr) {
+		QTEST_CHECK(hdrRead->barrier.srcStageMask == VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+		QTEST_CHECK(hdrRead->barrier.srcAccessMask & VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+		QTEST_CHECK(hdrRead->barrier.dstStageMask & VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+	}
+
+	// The swapchain image moves into attachment layout before the tonemap and out to present after it.
+	const RecordedBarrier* swapchainInit = findBarrier(2, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+	QTEST_CHECK(swapchainInit != nullptr && swapchainInit->barrier.image == (VkImage)(uintptr_t)1);
+
+	const RecordedBarrier* present = findBarrier(3, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	QTEST_CHECK(present != nullptr);
+	QTEST_CHECK(present != nullptr && present->barrier.srcStageMask == VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+}
+
+// A second sampled read at the same stage is already visible and needs no barrier of its own.
+static void testReadAfterReadIsElided() {
+	VulkanGraphImageDesc colorDesc;
+	colorDesc.extent = { 256, 256 };
+	colorDesc.format = VK_FORMAT_R8G8B8A8_UNORM;
+
+	VulkanRenderGraph graph;
+	VulkanRenderGraph::Resource target = graph.importImage(
+		"target", colorDesc, (VkImage)(uintptr_t)1, (VkImageView)(uintptr_t)2, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	VulkanRenderGraph::Resource source = graph.createImage("source", colorDesc);
+	VulkanRenderGraph::Resource blurred = graph.createImage("blurred", colorDesc);
+
+	VulkanRenderGraph::Pass produce = graph.addPass("produce", nullptr);
+	graph.write(produce, source, VulkanGraphAccess::COLOR_ATTACHMENT);
+
+	VulkanRenderGraph::Pass blur = graph.addPass("blur", nullptr);
+	graph.read(blur, source, VulkanGraphAccess::SAMPLED_GRAPHICS);
+	graph.write(blur, blurred, VulkanGraphAccess::COLOR_ATTACHMENT);
+
+	VulkanRenderGraph::Pass combine = graph.addPass("combine", nullptr);
+	graph.read(combine, source, VulkanGraphAccess::SAMPLED_GRAPHICS);
+	graph.read(combine, blurred, VulkanGraphAccess::SAMPLED_GRAPHICS);
+	graph.write(combine, target, VulkanGraphAccess::COLOR_ATTACHMENT);
+
+	graph.compile();
+
+	VulkanGraphStats stats = graph.getStats();
+	QTEST_CHECK(stats.culledPasses == 0);
+	QTEST_CHECK(stats.elidedBarriers == 1);
+}
+
+// a -> b -> c -> target: a is dead by the time c is written, so they can share memory; b overlaps both.
+static void testTransientAliasing() {
+	VulkanGraphImageDesc colorDesc;
+	colorDesc.extent = { 512, 512 };
+	colorDesc.format = VK_FORMAT_R8G8B8A8_UNORM;
+
+	VulkanRenderGraph graph;
+	VulkanRenderGraph::Resource target = graph.importImage(
+		"target", colorDesc, (VkImage)(uintptr_t)1, (VkImageView)(uintptr_t)2, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	VulkanRenderGraph::Resource a = graph.createImage("a", colorDesc);
+	VulkanRenderGraph::Resource b = graph.createImage("b", colorDesc);
+	VulkanRenderGraph::Resource c = graph.createImage("c", colorDesc);
+
+	VulkanRenderGraph::Pass writeA = graph.addPass("write a", nullptr);
+	graph.write(writeA, a, VulkanGraphAccess::COLOR_ATTACHMENT);
+
+	VulkanRenderGraph::Pass aToB = graph.addPass("a to b", nullptr);
+	graph.read(aToB, a, VulkanGraphAccess::SAMPLED_GRAPHICS);
+	graph.write(aToB, b, VulkanGraphAccess::COLOR_ATTACHMENT);
+
+	VulkanRenderGraph::Pass bToC = graph.addPass("b to c", nullptr);
+	graph.read(bToC, b, VulkanGraphAccess::SAMPLED_GRAPHICS);
+	graph.write(bToC, c, VulkanGraphAccess::COLOR_ATTACHMENT);
+
+	VulkanRenderGraph::Pass cToTarget = graph.addPass("c to target", nullptr);
+	graph.read(cToTarget, c, VulkanGraphAccess::SAMPLED_GRAPHICS);
+	graph.write(cToTarget, target, VulkanGraphAccess::COLOR_ATTACHMENT);
+
+	graph.compile();
+
+	QTEST_CHECK(graph.getMemoryBucket(a) != VulkanRenderGraph::INVALID);
+	QTEST_CHECK(graph.getMemoryBucket(a) == graph.getMemoryBucket(c));
+	QTEST_CHECK(graph.getMemoryBucket(b) != graph.getMemoryBucket(a));
+	QTEST_CHECK(graph.getMemoryBucket(target) == VulkanRenderGraph::INVALID);
+
+	VulkanGraphStats stats = graph.getStats();
+	QTEST_CHECK(stats.transientImages == 3);
+	QTEST_CHECK(stats.memoryBuckets == 2);
+	QTEST_CHECK(stats.transientBytes == 3 * 512 * 512 * 4);
+	QTEST_CHECK(stats.allocatedBytes == 2 * 512 * 512 * 4);
+}
+
+// A compute pass fills a light grid that the shading pass samples. With a separate compute family the
+// graph splits into a compute batch and a graphics batch that waits for it, and the grid changes owner
+// through a release on compute and an acquire on graphics. With one family it stays a single batch.
+static void testAsyncComputeBatches() {
+	VulkanGraphImageDesc colorDesc;
+	colorDesc.extent = { 1280, 720 };
+	colorDesc.format = VK_FORMAT_R8G8B8A8_UNORM;
+
+	VulkanGraphImageDesc gridDesc;
+	gridDesc.extent = { 80, 45 };
+	gridDesc.format = VK_FORMAT_R32_UINT;
+
+	const uint32_t graphicsFamily = 0;
+	const uint32_t computeFamily = 1;
+
+	VulkanRenderGraph graph;
+	graph.setQueueFamilies(graphicsFamily, computeFamily);
+
+	VulkanRenderGraph::Resource swapchain = graph.importImage(
+		"swapchain", colorDesc, (VkImage)(uintptr_t)1, (VkImageView)(uintptr_t)2, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	VulkanRenderGraph::Resource grid = graph.createImage("light grid", gridDesc);
+
+	auto logPass = [](const char* name) {
+		return [name](VkCommandBuffer, VulkanRenderGraph&) { executedPasses.push_back(name); };
+	};
+
+	VulkanRenderGraph::Pass binning = graph.addPass("light binning", logPass("light binning"));
+	graph.setAsyncCompute(binning);
+	graph.write(binning, grid, VulkanGraphAccess::STORAGE_WRITE);
+
+	VulkanRenderGraph::Pass shading = graph.addPass("shading", logPass("shading"));
+	graph.read(shading, grid, VulkanGraphAccess::SAMPLED_GRAPHICS);
+	graph.write(shading, swapchain, VulkanGraphAccess::COLOR_ATTACHMENT);
+
+	graph.compile();
+
+	VulkanGraphStats stats = graph.getStats();
+	QTEST_CHECK(stats.asyncPasses == 1);
+	QTEST_CHECK(stats.batchCount == 2);
+	QTEST_CHECK(stats.queueTransfers == 1);
+
+	QTEST_CHECK(graph.getBatchCount() == 2);
+	QTEST_CHECK(graph.getBatchQueue(0) == VulkanGraphQueue::ASYNC_COMPUTE);
+	QTEST_CHECK(graph.getBatchWait(0) == VulkanRenderGraph::INVALID);
+	QTEST_CHECK(graph.getBatchQueue(1) == VulkanGraphQueue::GRAPHICS);
+	QTEST_CHECK(graph.getBatchWait(1) == 0);
+
+	recordedBarriers.clear();
+	executedPasses.clear();
+	graph.executeBatch(0, VK_NULL_HANDLE);
+	graph.executeBatch(1, VK_NULL_HANDLE);
+	QTEST_CHECK(executedPasses.size() == 2);
+
+	// Both halves of the transfer carry the same families and layout change; the release has no
+	// destination stage, the acquire no source access.
+	const RecordedBarrier* release = nullptr;
+	const RecordedBarrier* acquire = nullptr;
+	for (const RecordedBarrier& recorded : recordedBarriers) {
+		if (recorded.barrier.srcQueueFamilyIndex != computeFamily || recorded.barrier.dstQueueFamilyIndex != graphicsFamily) {
+			continue;
+		}
+
+		QTEST_CHECK(recorded.beforePass == 1);
+		QTEST_CHECK(recorded.barrier.oldLayout == VK_IMAGE_LAYOUT_GENERAL);
+		QTEST_CHECK(recorded.barrier.newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+		if (recorded.barrier.dstStageMask == VK_PIPELINE_STAGE_2_NONE) {
+			release = &recorded;
+		}
+		else {
+			acquire = &recorded;
+		}
+	}
+
+	QTEST_CHECK(release != nullptr && acquire != nullptr && release < acquire);
+	if (release != nullptr && acquire != nullptr) {
+		QTEST_CHECK(release->barrier.srcStageMask == VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+		QTEST_CHECK(release->barrier.srcAccessMask & VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+		QTEST_CHECK(acquire->barrier.srcAccessMask == VK_ACCESS_2_NONE);
+		QTEST_CHECK(acquire->barrier.dstStageMask & VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT);
+		QTEST_CHECK(acquire->barrier.dstAccessMask == VK_ACCESS_2_SHADER_SAMPLED_READ_BIT);
+	}
+
+	graph.setQueueFamilies(graphicsFamily, graphicsFamily);
+	graph.compile();
+
+	stats = graph.getStats();
+	QTEST_CHECK(stats.asyncPasses == 0);
+	QTEST_CHECK(stats.batchCount == 1);
+	QTEST_CHECK(stats.queueTransfers == 0);
+}
+
+// The GPU culling shape on one queue: the cull reads the visibility the previous frame's late pass wrote
+// and clears the draw count the previous frame's draws read. Imported buffers persist across frames, so
+// their first use in the frame waits for their last use in the one before.
+static void testPersistentBuffersAcrossFrames() {
+	VulkanGraphImageDesc colorDesc;
+	colorDesc.extent = { 256, 256 };
+	colorDesc.format = VK_FORMAT_R8G8B8A8_UNORM;
+
+	const VkBuffer instanceBuffer = (VkBuffer)(uintptr_t)10;
+	const VkBuffer visibilityBuffer = (VkBuffer)(uintptr_t)11;
+	const VkBuffer countBuffer = (VkBuffer)(uintptr_t)12;
+
+	VulkanRenderGraph graph;
+	VulkanRenderGraph::Resource swapchain = graph.importImage(
+		"swapchain", colorDesc, (VkImage)(uintptr_t)1, (VkImageView)(uintptr_t)2, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+	VulkanRenderGraph::Resource instances = graph.importBuffer("instances", instanceBuffer);
+	VulkanRenderGraph::Resource visibility = graph.importBuffer("visibility", visibilityBuffer);
+	VulkanRenderGraph::Resource drawCount = graph.importBuffer("draw count", countBuffer);
+
+	auto logPass = [](const char* name) {
+		return [name](VkCommandBuffer, VulkanRenderGraph&) { executedPasses.push_back(name); };
+	};
+
+	VulkanRenderGraph::Pass cull = graph.addPass("cull", logPass("cull"));
+	graph.read(cull, instances, VulkanGraphAccess::STORAGE_READ);
+	graph.read(cull, visibility, VulkanGraphAccess::STORAGE_READ);
+	graph.write(cull, drawCount, VulkanGraphAccess::TRANSFER_DST);
+	graph.write(cull, drawCount, VulkanGraphAccess::STORAGE_WRITE);
+
+	VulkanRenderGraph::Pass draw = graph.addPass("draw", logPass("draw"));
+	graph.read(draw, drawCount, VulkanGraphAccess::INDIRECT_READ);
+	graph.write(draw, swapchain, VulkanGraphAccess::COLOR_ATTACHMENT);
+
+	VulkanRenderGraph::Pass late = graph.addPass("late", logPass("late"));
+	graph.read(late, visibility, VulkanGraphAccess::STORAGE_READ);
+	graph.write(late, visibility, VulkanGraphAccess::STORAGE_WRITE);
+
+	graph.compile();
+
+	recordedBufferBarriers.clear();
+	executedPasses.clear();
+	graph.execute(VK_NULL_HANDLE);
+
+	// Written only outside the graph, so whoever uploaded it synchronizes it.
+	QTEST_CHECK(findBufferBarrier(0, instanceBuffer) == nullptr);
+
+	// RAW on last frame's late pass.
+	const RecordedBufferBarrier* visibilityRead = findBufferBarrier(0, visibilityBuffer);
+	QTEST_CHECK(visibilityRead != nullptr);
+	if (visibilityRead != nullptr) {
+		QTEST_CHECK(visibilityRead->barrier.srcStageMask == VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+		QTEST_CHECK(visibilityRead->barrier.srcAccessMask & VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT);
+		QTEST_CHECK(visibilityRead->barrier.dstStageMask == VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+	}
+
+	// WAR on last frame's indirect read, and WAW on its clear and compute writes.
+	const RecordedBufferBarrier* countClear = findBufferBarrier(0, countBuffer);
+	QTEST_CHECK(countClear != nullptr);
+	if (countClear != nullptr) {
+		QTEST_CHECK(countClear->barrier.srcStageMask & VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT);
+		QTEST_CHECK(countClear->barrier.srcStageMask & VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+		QTEST_CHECK(countClear->barrier.srcStageMask & VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+		QTEST_CHECK(countClear->barrier.srcAccessMask & VK_ACCESS_2_TRANSFER_WRITE_BIT);
+		QTEST_CHECK(countClear->barrier.dstStageMask & VK_PIPELINE_STAGE_2_TRANSFER_BIT);
+		QTEST_CHECK(countClear->barrier.dstAccessMask & VK_ACCESS_2_TRANSFER_WRITE_BIT);
+	}
+
+	// Within the frame the usual RAW: the draw waits for the cull's count.
+	const RecordedBufferBarrier* countRead = findBufferBarrier(1, countBuffer);
+	QTEST_CHECK(countRead != nullptr && countRead->barrier.dstStageMask == VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT);
+}
+
+int main() {
+	testCompile();
+	testReadAfterReadIsElided();
+	testTransientAliasing();
+	testAsyncComputeBatches();
+	testPersistentBuffersAcrossFrames();
+
+	return qTestResult("TestRenderGraph");
+}
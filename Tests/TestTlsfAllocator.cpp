@@ -0,0 +1,106 @@
+#include "QTest.h"
+#include "QTlsfAllocator.h"
+#include <map>
+#include <random>
+
+struct LiveRange {
+	uint64_t offset;
+	uint64_t size;
+	QTlsfResourceKind kind;
+};
+
+static void testAlignmentAndGranularity() {
+	const uint64_t capacity = 64ull * 1024 * 1024;
+	const uint64_t granularity = 1024;
+
+	QTlsfAllocator allocator(capacity, granularity);
+	std::mt19937 random(7);
+	std::map<uint32_t, LiveRange> live;
+
+	for (uint32_t i = 0; i < 50000; i++) {
+		if (live.empty() || random() % 3 != 0) {
+			uint64_t size = 1 + random() % (1u << (random() % 18));
+			uint64_t alignment = 1ull << (random() % 9);
+			QTlsfResourceKind kind = (random() & 1) ? QTlsfResourceKind::LINEAR : QTlsfResourceKind::OPTIMAL;
+
+			uint32_t handle = allocator.allocate(size, alignment, kind);
+			if (handle == QTlsfAllocator::INVALID_HANDLE) {
+				continue;
+			}
+
+			QTEST_CHECK(allocator.getOffset(handle) % alignment == 0);
+			QTEST_CHECK(allocator.getSize(handle) == size);
+			QTEST_CHECK(live.count(handle) == 0);
+
+			LiveRange range = { allocator.getOffset(handle), size, kind };
+			live[handle] = range;
+		} else {
+			auto it = live.begin();
+			std::advance(it, random() % live.size());
+			allocator.free(it->first);
+			live.erase(it);
+		}
+	}
+
+	// Ranges never overlap, and neighbours of a different kind never share a granularity page.
+	std::map<uint64_t, LiveRange> byOffset;
+	for (const auto& entry : live) {
+		byOffset[entry.second.offset] = entry.second;
+	}
+
+	const LiveRange* previous = nullptr;
+	for (const auto& entry : byOffset) {
+		const LiveRange& range = entry.second;
+		QTEST_CHECK(range.offset + range.size <= capacity);
+
+		if (previous != nullptr) {
+			uint64_t previousEnd = previous->offset + previous->size;
+			QTEST_CHECK(range.offset >= previousEnd);
+
+			if (previous->kind != range.kind) {
+				QTEST_CHECK((previousEnd - 1) / granularity != range.offset / granularity);
+			}
+		}
+
+		previous = &range;
+	}
+
+	QTlsfStats stats = allocator.getStats();
+	QTEST_CHECK(stats.allocationCount == live.size());
+	QTEST_CHECK(stats.usedBytes + stats.freeBytes <= capacity);
+
+	// Freeing everything coalesces back into one range covering the whole capacity.
+	for (const auto& entry : live) {
+		allocator.free(entry.first);
+	}
+
+	stats = allocator.getStats();
+	QTEST_CHECK(allocator.isEmpty());
+	QTEST_CHECK(stats.freeRangeCount == 1);
+	QTEST_CHECK(stats.largestFreeRange == capacity);
+}
+
+static void testExhaustion() {
+	QTlsfAllocator allocator(4096);
+
+	uint32_t first = allocator.allocate(2048, 1, QTlsfResourceKind::LINEAR);
+	uint32_t second = allocator.allocate(2048, 1, QTlsfResourceKind::LINEAR);
+	QTEST_CHECK(first != QTlsfAllocator::INVALID_HANDLE);
+	QTEST_CHECK(second != QTlsfAllocator::INVALID_HANDLE);
+	QTEST_CHECK(allocator.allocate(1, 1, QTlsfResourceKind::LINEAR) == QTlsfAllocator::INVALID_HANDLE);
+
+	// A hole in the middle is found again, and user data survives until the range is freed.
+	int marker = 0;
+	allocator.free(first);
+	uint32_t third = allocator.allocate(1024, 256, QTlsfResourceKind::LINEAR, &marker);
+	QTEST_CHECK(third != QTlsfAllocator::INVALID_HANDLE);
+	QTEST_CHECK(allocator.getOffset(third) + 1024 <= 2048);
+	QTEST_CHECK(allocator.getUserData(third) == &marker);
+}
+
+int main() {
+	testAlignmentAndGranularity();
+	testExhaustion();
+
+	return qTestResult("TestTlsfAllocator");
+}